@@ -5,49 +5,11 @@
 
 //================================================================================
 
+// Коды, имена и свойства операций описаны один раз в op_codes_table
 enum op_code_t {
-    OP_NONE = 0,
-
-    OP_EQ,                                      
-    OP_NEQ,
-    OP_LE,                             
-    OP_GE,                             
-    OP_LT,                             
-    OP_GT,                              
-    OP_AND, 
-    OP_OR,
-    
-    OP_PLUS,                                                        
-    OP_MINUS,                           
-    OP_MUL,                             
-    OP_DIV,  
-
-    OP_POW,
-    OP_LOG,
-
-    OP_ASSIGN,  
-
-    OP_VIS_START,                                           
-    OP_LCAT,                             
-    OP_ENUM_SEP,    
-
-    OP_IF,                              
-
-    OP_WHILE,                             
-    OP_BREAK,                             
-    OP_CONTINUE,     
-                           
-    OP_FINISH,                             
-    OP_RETURN,                             
-    OP_FUNC_DECL, 
-    OP_PROC_DECL, 
-    OP_FUNC_INFO,
-
-    OP_CALL,           
-    
-    OP_PRINT,                             
-    OP_INPUT,
-
+    #define OP_CODE(op_code, ...) op_code,
+    #include "op_codes_table"
+    #undef OP_CODE
 };
 
 //================================================================================
@@ -58,12 +20,28 @@ struct keyword_def_t {
     const char*    tree_name; 
     bool           is_func;
     bool           is_calculatable;
+    bool           is_pure;           // сам узел не имеет побочных эффектов
 };
 
 //================================================================================
 
-extern const keyword_def_t KEYWORDS[];
-extern const size_t        KEYWORDS_COUNT;
+// KEYWORDS[op_code].op_code == op_code: поиск по коду — обычная индексация
+inline constexpr keyword_def_t KEYWORDS[] = {
+    #define OP_CODE(op_code, lang_name, tree_name, is_func, is_calculatable, is_pure) \
+        {op_code, lang_name, tree_name, is_func, is_calculatable, is_pure},
+    #include "op_codes_table"
+    #undef OP_CODE
+};
+
+inline constexpr size_t KEYWORDS_COUNT = sizeof(KEYWORDS) / sizeof(KEYWORDS[0]);
+inline constexpr size_t OP_CODES_COUNT = KEYWORDS_COUNT;
+
+// nullptr для кода вне таблицы
+inline constexpr const keyword_def_t* get_op_keyword(op_code_t op_code) {
+    return (size_t)op_code < OP_CODES_COUNT ? &KEYWORDS[op_code] : nullptr;
+}
+
+//================================================================================
 
 extern const keyword_def_t IGNORED_KEYWORDS[];
 extern const size_t        IGNORED_KEYWORDS_COUNT;
@@ -16,11 +16,21 @@ struct tex_squash_binding_t {
     tree_node_t* expr_subtree;
 };
 
+struct tree_name_chunk_t;
+
+// Текст имён, которые заводит не разбор, а сами проходы: ident_stack хранит
+// только ссылки, поэтому текст лежит в блоках дерева и живёт вместе с ним
+struct tree_names_t {
+    tree_name_chunk_t* chunks;
+    size_t             generated;  // счетчик для номеров в таких именах
+};
+
 struct tree_t {
     tree_node_t*   root;
     size_t         size;
     ident_stack_t* ident_stack;
     c_string_t     buff;
+    tree_names_t   names;
     ON_TREE_DEBUG(
         tree_ver_info_t ver_info;
         FILE* dump_file;
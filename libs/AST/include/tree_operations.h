@@ -10,11 +10,24 @@
 
 error_code tree_init(tree_t* tree ON_TREE_DEBUG(, tree_ver_info_t ver_info));
 
+// Пул узлов: tree_nodes_reserve выделяет nodes_count узлов одним блоком,
+// init_node берет их оттуда, free_node возвращает. Узлы освобождать только через free_node.
+// Свободный список у каждого потока свой, опустевший пополняется из общего.
+// reserve добирает узлы в список вызывающего потока, release возвращает их
+// в общий (вызывать перед выходом потока). pool_destroy — когда других потоков нет
+error_code tree_nodes_reserve(size_t nodes_count);
+void       tree_nodes_release();
+void       tree_nodes_pool_destroy();
+void       free_node(tree_node_t* node);
+
 tree_node_t* init_node(node_type_t node_type, value_t value, tree_node_t* left, tree_node_t* right);
 tree_node_t* init_node_with_dump(node_type_t node_type, value_t value, tree_node_t* left, tree_node_t* right, const tree_t* tree);
 
 error_code tree_destroy(tree_t* tree);
 
+// size байт под текст имени, освобождаются в tree_destroy. Не потокобезопасно
+char* tree_names_alloc(tree_t* tree, size_t size);
+
 bool tree_is_empty(const tree_t* tree);
 bool is_subree_const(const tree_node_t* node);
 
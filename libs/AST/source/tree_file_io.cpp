@@ -112,12 +112,10 @@ static void attach_node_to_parent(tree_t* tree, tree_node_t* new_node, tree_node
     HARD_ASSERT(tree     != nullptr, "tree nullptr");
     HARD_ASSERT(new_node != nullptr, "new_node nullptr");
 
+    // Детей привязывает read_children: иначе правый ребёнок при пустом левом
+    // попадал бы в оба поля родителя
     if (parent == nullptr) {
         tree->root = new_node;
-    } else if (parent->left == nullptr) {
-        parent->left = new_node;
-    } else {
-        parent->right = new_node;
     }
 }
 
@@ -535,11 +533,8 @@ error_code tree_read_from_file(tree_t* tree, const char* filename, string_t* buf
 
 
 const char* get_func_name_by_type(op_code_t func_type_value) {
-    for (size_t i = 0; i < KEYWORDS_COUNT; ++i) {
-        if (KEYWORDS[i].op_code == func_type_value) {
-            return KEYWORDS[i].tree_name;
-        }
-    }
+    const keyword_def_t* keyword = get_op_keyword(func_type_value);
+    if (keyword != nullptr) return keyword->tree_name;
 
     LOGGER_ERROR("write_node: unknown func_type %d", (int)func_type_value);
     return "";
@@ -568,7 +563,7 @@ static error_code write_ident(const tree_t* tree, FILE* file, const tree_node_t*
     HARD_ASSERT(node != nullptr, "node nullptr");
 
     c_string_t str = tree->ident_stack->data[node->value.ident_idx];
-    if (fprintf(file, "\"%.*str\"", (int)str.len, str.ptr) < 0) return ERROR_OPEN_FILE;
+    if (fprintf(file, "\"%.*s\"", (int)str.len, str.ptr) < 0) return ERROR_OPEN_FILE;
 
     return ERROR_NO;
 }
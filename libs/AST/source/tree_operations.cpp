@@ -5,6 +5,9 @@
 #include <stdarg.h>
 #include <math.h>
 
+#include <atomic>
+#include <mutex>
+
 #include "debug_meta.h"
 #include "asserts.h"
 #include "common/logger/include/logger.h"
@@ -62,8 +65,136 @@ value_t make_union_universal(node_type_t type, ...) {
     return val;
 }
 
+//================================================================================
+//                   Пул узлов: заранее выделенные блоки
+//================================================================================
+
+struct node_slab_t {
+    tree_node_t* nodes;
+    size_t       count;
+    node_slab_t* next;
+};
+
+// Блоки общие, свободных списков два: у каждого потока свой и общий под
+// node_pool_lock. Поток берет узлы из своего, пустой пополняет из общего
+// пачкой, а tree_nodes_release отдает свой список обратно в общий
+static const size_t NODE_REFILL_BATCH = 256;
+
+static std::atomic<node_slab_t*> node_slabs{nullptr};
+static std::mutex                node_pool_lock;
+static std::atomic<tree_node_t*> node_shared_list{nullptr};  // меняется только под node_pool_lock
+static thread_local tree_node_t* node_free_list   = nullptr; // связь через left
+
+static bool node_from_slab(const tree_node_t* node) {
+    for (const node_slab_t* slab = node_slabs.load(std::memory_order_acquire); slab != nullptr; slab = slab->next) {
+        if (node >= slab->nodes && node < slab->nodes + slab->count) return true;
+    }
+    return false;
+}
+
+// Переносит до max_count узлов из головы общего списка в список потока,
+// не меняя их порядка: первыми уйдут недавно освобожденные
+static size_t node_take_shared(size_t max_count) {
+    if (max_count == 0) return 0;
+
+    std::lock_guard<std::mutex> guard(node_pool_lock);
+
+    tree_node_t* head = node_shared_list.load(std::memory_order_relaxed);
+    if (head == nullptr) return 0;
+
+    size_t       taken = 1;
+    tree_node_t* tail  = head;
+    while (tail->left != nullptr && taken < max_count) {
+        tail = tail->left;
+        taken++;
+    }
+    node_shared_list.store(tail->left, std::memory_order_relaxed);
+
+    tail->left     = node_free_list;
+    node_free_list = head;
+    return taken;
+}
+
+error_code tree_nodes_reserve(size_t nodes_count) {
+    size_t free_count = 0;
+    for (const tree_node_t* node = node_free_list; node != nullptr && free_count < nodes_count; node = node->left) {
+        free_count++;
+    }
+    if (free_count < nodes_count) free_count += node_take_shared(nodes_count - free_count);
+    if (free_count >= nodes_count) return ERROR_NO;
+
+    node_slab_t* slab = (node_slab_t*)calloc(1, sizeof(node_slab_t));
+    if (slab == nullptr) return ERROR_MEM_ALLOC;
+
+    slab->count = nodes_count - free_count;
+    slab->nodes = (tree_node_t*)calloc(slab->count, sizeof(tree_node_t));
+    if (slab->nodes == nullptr) {
+        free(slab);
+        return ERROR_MEM_ALLOC;
+    }
+
+    for (size_t i = slab->count; i > 0; --i) {
+        slab->nodes[i - 1].left = node_free_list;
+        node_free_list = &slab->nodes[i - 1];
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(node_pool_lock);
+        slab->next = node_slabs.load(std::memory_order_relaxed);
+        node_slabs.store(slab, std::memory_order_release);
+    }
+
+    LOGGER_DEBUG("tree_nodes_reserve: reserved %zu nodes", slab->count);
+    return ERROR_NO;
+}
+
+void tree_nodes_release() {
+    if (node_free_list == nullptr) return;
+
+    tree_node_t* tail = node_free_list;
+    while (tail->left != nullptr) tail = tail->left;
+
+    std::lock_guard<std::mutex> guard(node_pool_lock);
+    tail->left     = node_shared_list.load(std::memory_order_relaxed);
+    node_shared_list.store(node_free_list, std::memory_order_relaxed);
+    node_free_list = nullptr;
+}
+
+void tree_nodes_pool_destroy() {
+    node_slab_t* slab = node_slabs.exchange(nullptr);
+    while (slab != nullptr) {
+        node_slab_t* next = slab->next;
+        free(slab->nodes);
+        free(slab);
+        slab = next;
+    }
+    node_shared_list.store(nullptr);
+    node_free_list = nullptr;
+}
+
+void free_node(tree_node_t* node) {
+    if (node == nullptr) return;
+
+    if (node_slabs.load(std::memory_order_acquire) == nullptr || !node_from_slab(node)) {
+        free(node);
+        return;
+    }
+
+    node->left     = node_free_list;
+    node_free_list = node;
+}
+
+//================================================================================
+
 tree_node_t* init_node(node_type_t node_type, value_t value, tree_node_t* left, tree_node_t* right) {
-    tree_node_t* node = (tree_node_t*)calloc(1, sizeof(tree_node_t));
+    if (node_free_list == nullptr && node_shared_list.load(std::memory_order_relaxed) != nullptr) node_take_shared(NODE_REFILL_BATCH);
+
+    tree_node_t* node = node_free_list;
+    if (node != nullptr) {
+        node_free_list = node->left;
+    } else {
+        node = (tree_node_t*)calloc(1, sizeof(tree_node_t));
+    }
     if (node == nullptr) {
         LOGGER_ERROR("allocate_node: calloc failed");
         return nullptr;
@@ -100,12 +231,58 @@ error_code destroy_node_recursive(tree_node_t* node, size_t* removed_out) {
     size_t right_removed = 0;
     error |= destroy_node_recursive(node->right, &right_removed);
 
-    free(node);
+    free_node(node);
     removed_local = 1 + left_removed + right_removed;
     if (removed_out != nullptr) *removed_out = removed_local;
     return error;
 }
 
+//================================================================================
+//                     Имена, заведенные проходами
+//================================================================================
+
+struct tree_name_chunk_t {
+    tree_name_chunk_t* next;
+    size_t             capacity;
+    size_t             used;
+    // следом лежат capacity байт текста
+};
+
+static const size_t NAME_CHUNK_SIZE = 4096;
+
+char* tree_names_alloc(tree_t* tree, size_t size) {
+    HARD_ASSERT(tree != nullptr, "tree pointer is nullptr");
+
+    tree_name_chunk_t* chunk = tree->names.chunks;
+    if (chunk == nullptr || chunk->capacity - chunk->used < size) {
+        size_t capacity = size > NAME_CHUNK_SIZE ? size : NAME_CHUNK_SIZE;
+        chunk = (tree_name_chunk_t*)calloc(1, sizeof(tree_name_chunk_t) + capacity);
+        if (chunk == nullptr) {
+            LOGGER_ERROR("tree_names_alloc: calloc failed");
+            return nullptr;
+        }
+        chunk->capacity = capacity;
+        chunk->next     = tree->names.chunks;
+        tree->names.chunks = chunk;
+    }
+
+    char* text = (char*)(chunk + 1) + chunk->used;
+    chunk->used += size;
+    return text;
+}
+
+static void names_destroy(tree_names_t* names) {
+    tree_name_chunk_t* chunk = names->chunks;
+    while (chunk != nullptr) {
+        tree_name_chunk_t* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    *names = {nullptr, 0};
+}
+
+//================================================================================
+
 error_code tree_init(tree_t* tree ON_TREE_DEBUG(, tree_ver_info_t ver_info)) {
     HARD_ASSERT(tree != nullptr, "tree pointer is nullptr");
 
@@ -113,9 +290,10 @@ error_code tree_init(tree_t* tree ON_TREE_DEBUG(, tree_ver_info_t ver_info)) {
 
     error_code error = ERROR_NO;
 
-    tree->root = nullptr;
-    tree->size = 0;
-    tree->buff = {nullptr, 0};
+    tree->root  = nullptr;
+    tree->size  = 0;
+    tree->buff  = {nullptr, 0};
+    tree->names = {nullptr, 0};
 
     ident_stack_t* stack = (ident_stack_t*)calloc(1, sizeof(ident_stack_t));
     if (stack == nullptr) {
@@ -147,6 +325,8 @@ error_code tree_destroy(tree_t* tree) {
     error |= ident_stack_destroy(tree->ident_stack);
     free(tree->ident_stack);
     tree->ident_stack = nullptr;
+
+    names_destroy(&tree->names);
     return error;
 }
 //TODO очистка squashes
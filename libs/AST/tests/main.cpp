@@ -69,12 +69,8 @@ static int g_failed = 0;
 static tree_t make_empty_tree() {
     tree_t tree = {};
 
-    // ВАЖНО: tree_destroy() делает ident_stack_destroy() и free(tree->ident_stack),
-    // поэтому стек выделяем на куче.
-    ident_stack_t* vs = (ident_stack_t*)calloc(1, sizeof(ident_stack_t));
-    CHECK_TRUE(vs != nullptr);
-    ident_stack_init(vs, 10, STACK_VER_INIT);
-    error_code err = tree_init(&tree, vs ON_TREE_DEBUG(, TREE_VER_INIT));
+    // Стек имен tree_init заводит сам, tree_destroy его освобождает
+    error_code err = tree_init(&tree ON_TREE_DEBUG(, TREE_VER_INIT));
     CHECK_EQ_INT(err, ERROR_NO);
 
     return tree;
@@ -230,9 +226,9 @@ TEST_CASE(test_parse_empty_and_nil) {
         CHECK_EQ_U64(t.size, 0);
     }
 
-    // "nil" => пустое дерево
+    // "()" (так write_nil пишет пустой узел) => пустое дерево
     {
-        const char* s = "nil";
+        const char* s = "()";
         t.buff = {(char*)s, (unsigned long)strlen(s)};
         error_code err = tree_parse_from_buffer(&t);
         CHECK_EQ_INT(err, ERROR_NO);
@@ -356,6 +352,47 @@ TEST_CASE(test_read_write_with_IDENT) {
     remove(fname);
 }
 
+// Правый ребенок при пустом левом: раньше читался в оба поля родителя,
+// и destroy_tree освобождал его дважды
+TEST_CASE(test_read_empty_left_child) {
+    const char* fname = "tree_test_tmp_nil.ast";
+
+    {
+        tree_t t = make_empty_tree();
+
+        // (OP_RETURN nil 7)
+        tree_node_t* root = mk_func(OP_RETURN, nullptr, mk_const(7.0));
+        (void)tree_change_root(&t, root);
+
+        error_code err = tree_write_to_file(&t, fname);
+        CHECK_EQ_INT(err, ERROR_NO);
+
+        destroy_tree(&t);
+    }
+
+    {
+        tree_t t = make_empty_tree();
+        string_t buff = {};
+        error_code err = tree_read_from_file(&t, fname, &buff);
+        CHECK_EQ_INT(err, ERROR_NO);
+
+        CHECK_TRUE(t.root != nullptr);
+        if (t.root != nullptr) {
+            CHECK_TRUE(t.root->left == nullptr);
+            CHECK_TRUE(t.root->right != nullptr);
+            if (t.root->right != nullptr) {
+                CHECK_EQ_INT(t.root->right->type, CONSTANT);
+                CHECK_DBL_NEAR(t.root->right->value.constant, 7.0, 1e-12);
+            }
+        }
+
+        free(buff.ptr);
+        destroy_tree(&t);
+    }
+
+    remove(fname);
+}
+
 //------------------------------------------------------------------------------
 
 int main() {
@@ -370,6 +407,7 @@ int main() {
     test_parse_invalid();
     test_write_read_roundtrip_function();
     test_read_write_with_IDENT();
+    test_read_empty_left_child();
 
     if (g_failed == 0) {
         printf("OK\n");
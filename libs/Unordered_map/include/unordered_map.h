@@ -28,6 +28,7 @@ typedef struct u_map_t {
     size_t        size;        
     size_t        occupied;     
     size_t        capacity;     
+    size_t        min_capacity; // нижняя граница при сжатии (u_map_reserve)
 
     size_t        key_size;
     size_t        key_align;
@@ -87,6 +88,9 @@ size_t u_map_size    (const u_map_t* u_map);
 size_t u_map_capacity(const u_map_t* u_map);
 bool   u_map_is_empty(const u_map_t* u_map);
 
+// Готовит таблицу к elems_count элементам без рехэшей и запрещает сжатие ниже.
+hm_error_t u_map_reserve(u_map_t* u_map, size_t elems_count);
+
 bool       u_map_get_elem   (const u_map_t* u_map, const void* key, void* value_out);
 hm_error_t u_map_insert_elem(u_map_t*       u_map, const void* key, const void* value);
 hm_error_t u_map_remove_elem(u_map_t*       u_map, const void* key, void* value_out);
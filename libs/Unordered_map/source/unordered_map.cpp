@@ -247,6 +247,8 @@ static hm_error_t u_map_rehash(u_map_t* u_map, size_t new_capacity) {
         new_map.occupied++;
     }
 
+    new_map.min_capacity = u_map->min_capacity;
+
     free(u_map->data);
     *u_map = new_map;
     return HM_ERR_OK;
@@ -265,10 +267,13 @@ static hm_error_t normalize_capacity(u_map_t* u_map) {
     size_t new_capacity = u_map->capacity;
     bool need_rehash = false;
 
-    if (u_map->capacity > INITIAL_CAPACITY && load_real < MIN_LOAD_FACTOR) {
+    size_t min_capacity = INITIAL_CAPACITY;
+    if (u_map->min_capacity > min_capacity) min_capacity = u_map->min_capacity;
+
+    if (u_map->capacity > min_capacity && load_real < MIN_LOAD_FACTOR) {
         new_capacity = u_map->capacity / 2;
-        if (new_capacity < INITIAL_CAPACITY)
-            new_capacity = INITIAL_CAPACITY;
+        if (new_capacity < min_capacity)
+            new_capacity = min_capacity;
         need_rehash = true;
     }
     else if (load_occupied > MAX_LOAD_FACTOR) {
@@ -324,9 +329,10 @@ hm_error_t u_map_init(u_map_t* u_map, size_t capacity,
     u_map->data_values = (void*)((unsigned char*)data + values_offset);
     u_map->data_states = (elem_state_t*)((unsigned char*)data + states_offset);
 
-    u_map->size      = 0;
-    u_map->occupied  = 0;
-    u_map->capacity  = capacity;
+    u_map->size         = 0;
+    u_map->occupied     = 0;
+    u_map->capacity     = capacity;
+    u_map->min_capacity = 0;
 
     u_map->key_size   = key_size;
     u_map->key_align  = key_align;
@@ -380,9 +386,10 @@ hm_error_t u_map_static_init(u_map_t* u_map, void* data, size_t capacity,
     u_map->data_values = (void*)((unsigned char*)data + values_offset);
     u_map->data_states = (elem_state_t*)((unsigned char*)data + states_offset);
 
-    u_map->size     = 0;
-    u_map->occupied = 0;
-    u_map->capacity = capacity;
+    u_map->size         = 0;
+    u_map->occupied     = 0;
+    u_map->capacity     = capacity;
+    u_map->min_capacity = 0;
 
     u_map->key_size   = key_size;
     u_map->key_align  = key_align;
@@ -491,6 +498,22 @@ size_t u_map_capacity(const u_map_t* u_map) {
     return u_map->capacity;
 }
 
+hm_error_t u_map_reserve(u_map_t* u_map, size_t elems_count) {
+    HARD_ASSERT(u_map != nullptr, "u_map is nullptr");
+
+    size_t need_capacity = next_pow2_size_t((size_t)((double)elems_count / MAX_LOAD_FACTOR) + 1);
+    if (need_capacity < INITIAL_CAPACITY) need_capacity = INITIAL_CAPACITY;
+
+    if (u_map->is_static) {
+        return (need_capacity <= u_map->capacity) ? HM_ERR_OK : HM_ERR_FULL;
+    }
+
+    if (need_capacity > u_map->min_capacity) u_map->min_capacity = need_capacity;
+    if (need_capacity <= u_map->capacity)    return HM_ERR_OK;
+
+    return u_map_rehash(u_map, need_capacity);
+}
+
 bool u_map_get_elem(const u_map_t* u_map, const void* key, void* value_out) {
     HARD_ASSERT(u_map != nullptr, "u_map is nullptr");
     HARD_ASSERT(key   != nullptr, "key is nullptr");
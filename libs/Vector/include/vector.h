@@ -16,6 +16,7 @@ struct vector_t {
     size_t capacity;
 
     size_t elem_size;
+    size_t min_capacity; // нижняя граница при сжатии (vector_reserve)
 
     bool   is_static;
 };
@@ -42,6 +43,9 @@ const void* vector_get_const(const vector_t* vec, size_t index);
 
 void vector_clear(vector_t* vec);
 
+// Выделяет место под capacity элементов сразу и запрещает сжатие ниже него.
+vector_error_t vector_reserve(vector_t* vec, size_t capacity);
+
 //================================================================================
 //                           Модифицирующие операции
 //================================================================================
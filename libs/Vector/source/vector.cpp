@@ -78,18 +78,21 @@ static vector_error_t normalize_for_grow(vector_t* vector, size_t need_elems) {
 static vector_error_t normalize_for_shrink(vector_t* vector) {
     HARD_ASSERT(vector != nullptr, "vector is nullptr");
 
-    if (vector->is_static)                    return VEC_ERR_OK;
-    if (vector->capacity <= INITIAL_CAPACITY) return VEC_ERR_OK;
+    size_t min_capacity = INITIAL_CAPACITY;
+    if (vector->min_capacity > min_capacity) min_capacity = vector->min_capacity;
+
+    if (vector->is_static)                return VEC_ERR_OK;
+    if (vector->capacity <= min_capacity) return VEC_ERR_OK;
 
     size_t new_capacity = vector->capacity;
 
-    while (new_capacity > INITIAL_CAPACITY) {
+    while (new_capacity > min_capacity) {
         const double load = (new_capacity == 0) ? 1.0 : (double)vector->size / (double)new_capacity;
 
         if (load >= MIN_LOAD_FACTOR) break;
         size_t candidate = (size_t)((double)new_capacity * (double)SHRINK_FACTOR);
-        if (candidate < INITIAL_CAPACITY) candidate = INITIAL_CAPACITY;
-        if (candidate < vector->size)        candidate = vector->size;
+        if (candidate < min_capacity)  candidate = min_capacity;
+        if (candidate < vector->size)  candidate = vector->size;
         if (candidate >= new_capacity) break; 
         new_capacity = candidate;
     }
@@ -114,11 +117,12 @@ vector_error_t vector_init(vector_t* vector, size_t capacity, size_t elem_size)
     void* data = calloc(capacity, elem_size);
     if (data == nullptr) return VEC_ERR_MEM_ALLOC;
 
-    vector->data      = data;
-    vector->size      = 0;
-    vector->capacity  = capacity;
-    vector->elem_size = elem_size;
-    vector->is_static = false;
+    vector->data         = data;
+    vector->size         = 0;
+    vector->capacity     = capacity;
+    vector->elem_size    = elem_size;
+    vector->min_capacity = 0;
+    vector->is_static    = false;
 
     LOGGER_DEBUG("vector_init finished");
     return VEC_ERR_OK;
@@ -135,11 +139,12 @@ vector_error_t vector_static_init(vector_t* vector, void* data, size_t capacity,
 
     memset(data, 0, capacity * elem_size);
 
-    vector->data      = data;
-    vector->size      = 0;
-    vector->capacity  = capacity;
-    vector->elem_size = elem_size;
-    vector->is_static = true;
+    vector->data         = data;
+    vector->size         = 0;
+    vector->capacity     = capacity;
+    vector->elem_size    = elem_size;
+    vector->min_capacity = 0;
+    vector->is_static    = true;
 
     LOGGER_DEBUG("vector_static_init finished");
     return VEC_ERR_OK;
@@ -190,6 +195,19 @@ void vector_clear(vector_t* vector) {
     normalize_for_shrink(vector);
 }
 
+vector_error_t vector_reserve(vector_t* vector, size_t capacity) {
+    HARD_ASSERT(vector != nullptr, "vector is nullptr");
+
+    if (vector->is_static) {
+        return (capacity <= vector->capacity) ? VEC_ERR_OK : VEC_ERR_FULL;
+    }
+
+    if (capacity > vector->min_capacity) vector->min_capacity = capacity;
+    if (capacity <= vector->capacity)    return VEC_ERR_OK;
+
+    return vector_realloc(vector, capacity);
+}
+
 //================================================================================
 //                           Основные функции
 //================================================================================
@@ -18,6 +18,8 @@
 #include "project/frontend/parser/include/frontend_parser.h"
 #include "project/frontend/error_logger/include/frontend_err_logger.h"
 #include "project/midend/include/tree_optimize.h"
+#include "project/midend/include/tree_passes.h"
+#include "project/midend/include/tree_call_graph.h"
 #include "project/backend/include/backend.h"
 
 //================================================================================
@@ -88,11 +90,57 @@ static const char* token_kind_name(lexer_token_kind_t kind) {
 }
 
 static const char* op_code_tree_name(op_code_t op_code) {
-    for (size_t i = 0; i < KEYWORDS_COUNT; ++i) {
-        if (KEYWORDS[i].op_code == op_code)
-            return KEYWORDS[i].tree_name;
+    const keyword_def_t* keyword = get_op_keyword(op_code);
+    return keyword != nullptr ? keyword->tree_name : nullptr;
+}
+
+// Позиционные аргументы — всё, что не пусто и не начинается с '-'
+static bool is_positional_arg(const char* arg) {
+    return arg[0] != '\0' && arg[0] != '-';
+}
+
+static void print_pass_times(const optimize_stats_t* stats) {
+    fprintf(stderr, "%-12s %8s %10s %12s %8s\n", "проход", "запусков", "изменений", "время, мкс",
+            "урезано");
+    for (size_t i = 0; i < stats->passes_count; i++) {
+        const optimize_pass_stats_t* pass = &stats->passes[i];
+        if (pass->runs == 0 && pass->truncated == 0) continue;
+        fprintf(stderr, "%-12s %8zu %10zu %12llu %8zu\n", pass->name, pass->runs, pass->changes,
+                (unsigned long long)(pass->time_ns / 1000), pass->truncated);
+    }
+}
+
+// Печатается всегда, когда бюджет что-то урезал: код собран с неполной оптимизацией
+static void print_truncation_report(const optimize_stats_t* stats) {
+    if (!stats->truncated) return;
+
+    fprintf(stderr, "Оптимизация урезана бюджетом (топлива потрачено: %zu), проходы:", stats->fuel_used);
+    for (size_t i = 0; i < stats->passes_count; i++) {
+        if (stats->passes[i].truncated != 0) {
+            fprintf(stderr, " %s x%zu", stats->passes[i].name, stats->passes[i].truncated);
+        }
     }
-    return nullptr;
+    fprintf(stderr, "\n");
+}
+
+// Формат по расширению: .json — JSON, иначе DOT
+static bool write_call_graph(const tree_t* tree, const char* root_name, const char* path) {
+    call_graph_t graph = {};
+    if (call_graph_build(tree, root_name, &graph) != ERROR_NO) return false;
+
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        call_graph_destroy(&graph);
+        return false;
+    }
+
+    size_t     path_len = strlen(path);
+    bool       is_json  = path_len >= 5 && strcmp(path + path_len - 5, ".json") == 0;
+    error_code error    = is_json ? call_graph_write_json(&graph, file) : call_graph_write_dot(&graph, file);
+
+    fclose(file);
+    call_graph_destroy(&graph);
+    return error == ERROR_NO;
 }
 
 static void print_token(const lexer_token_t* token) {
@@ -133,16 +181,61 @@ int main(int argc, char** argv) {
     logger_initialize_stream(stderr);
 
     // Аргументы:
-    //   main.exe <input.alc> [output.asm] [frontend.ast] [midend.ast] [--keep-temps]
+    //   main.exe <input.alc> [output.asm] [frontend.ast] [midend.ast] [--keep-temps] [--fast-math]
+    //            [--eval-steps=N] [-O0|-O1|-O2|-O3] [--dump-after=PASS] [--time-passes]
+    //            [--parser-stats] [--jobs=N] [--fuel=N] [--time-budget=US] [--opt-bisect-limit=N]
+    //            [--entry=NAME] [--call-graph=FILE.dot|FILE.json] [--clone-budget=N]
     const char* input_filename  = nullptr;
     const char* output_filename = "output.asm";
     const char* ast_frontend    = "frontend.ast";
     const char* ast_midend      = "midend.ast";
-    bool keep_temps = false;
+    bool keep_temps   = false;
+    bool time_passes  = false;
+    bool parser_stats = false;
+    const char* call_graph_path = nullptr;
+    optimize_options_t opt_options = OPTIMIZE_DEFAULT_OPTIONS;
 
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--keep-temps") == 0) {
             keep_temps = true;
+        } else if (strcmp(argv[i], "--fast-math") == 0) {
+            opt_options.fast_math = true;
+        } else if (strncmp(argv[i], "--eval-steps=", 13) == 0) {
+            opt_options.eval_steps = (size_t)strtoull(argv[i] + 13, nullptr, 10);
+        } else if (strncmp(argv[i], "-O", 2) == 0) {
+            if (argv[i][2] < '0' || argv[i][2] > '0' + OPTIMIZE_MAX_LEVEL || argv[i][3] != '\0') {
+                fprintf(stderr, "Ошибка: неизвестный уровень оптимизации: %s\n", argv[i]);
+                return 1;
+            }
+            opt_options.opt_level = argv[i][2] - '0';
+        } else if (strncmp(argv[i], "--dump-after=", 13) == 0) {
+            opt_options.dump_after = argv[i] + 13;
+            if (optimize_find_pass(opt_options.dump_after) == OPTIMIZE_NO_PASS) {
+                fprintf(stderr, "Ошибка: неизвестный проход: %s. Есть:", opt_options.dump_after);
+                for (size_t j = 0; j < optimize_passes_count(); j++) {
+                    fprintf(stderr, " %s", optimize_pass_at(j)->name);
+                }
+                fprintf(stderr, "\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--time-passes") == 0) {
+            time_passes = true;
+        } else if (strcmp(argv[i], "--parser-stats") == 0) {
+            parser_stats = true;
+        } else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+            opt_options.jobs = (size_t)strtoull(argv[i] + 7, nullptr, 10);
+        } else if (strncmp(argv[i], "--fuel=", 7) == 0) {
+            opt_options.fuel = (size_t)strtoull(argv[i] + 7, nullptr, 10);
+        } else if (strncmp(argv[i], "--time-budget=", 14) == 0) {
+            opt_options.time_budget_us = (uint64_t)strtoull(argv[i] + 14, nullptr, 10);
+        } else if (strncmp(argv[i], "--opt-bisect-limit=", 19) == 0) {
+            opt_options.bisect_limit = (size_t)strtoull(argv[i] + 19, nullptr, 10);
+        } else if (strncmp(argv[i], "--entry=", 8) == 0) {
+            opt_options.entry_name = argv[i] + 8;
+        } else if (strncmp(argv[i], "--call-graph=", 13) == 0) {
+            call_graph_path = argv[i] + 13;
+        } else if (strncmp(argv[i], "--clone-budget=", 15) == 0) {
+            opt_options.clone_budget = (size_t)strtoull(argv[i] + 15, nullptr, 10);
         }
     }
 
@@ -152,19 +245,19 @@ int main(int argc, char** argv) {
     size_t file_size = 0;
     bool need_free = false;
 
-    if (argc >= 2 && argv[1] != nullptr && argv[1][0] != '\0' && strcmp(argv[1], "--keep-temps") != 0) {
+    if (argc >= 2 && argv[1] != nullptr && is_positional_arg(argv[1])) {
         input_filename = argv[1];
     }
 
-    if (argc >= 3 && argv[2] != nullptr && argv[2][0] != '\0' && strcmp(argv[2], "--keep-temps") != 0) {
+    if (argc >= 3 && argv[2] != nullptr && is_positional_arg(argv[2])) {
         output_filename = argv[2];
     }
 
-    if (argc >= 4 && argv[3] != nullptr && argv[3][0] != '\0' && strcmp(argv[3], "--keep-temps") != 0) {
+    if (argc >= 4 && argv[3] != nullptr && is_positional_arg(argv[3])) {
         ast_frontend = argv[3];
     }
 
-    if (argc >= 5 && argv[4] != nullptr && argv[4][0] != '\0' && strcmp(argv[4], "--keep-temps") != 0) {
+    if (argc >= 5 && argv[4] != nullptr && is_positional_arg(argv[4])) {
         ast_midend = argv[4];
     }
 
@@ -207,7 +300,8 @@ int main(int argc, char** argv) {
     lexer_cfg.ignored_words_count = IGNORED_KEYWORDS_COUNT;
 
     LOGGER_DEBUG("Начало токенизации");
-    lexer_error_t lex_error = lexer_tokenize(buffer, &lexer_cfg, &token_vec, &diag_vec);
+    lexer_stats_t lex_stats = {};
+    lexer_error_t lex_error = lexer_tokenize(buffer, &lexer_cfg, &token_vec, &diag_vec, &lex_stats);
 
     if (vector_size(&diag_vec) != 0) {
         fprintf(stderr, "Ошибки лексера:\n");
@@ -253,7 +347,10 @@ int main(int argc, char** argv) {
     }
     tree_open_dump_file(&tree, "TEST0.html");
     LOGGER_DEBUG("Начало парсинга AST");
-    frontend_parse_ast(&tree, &token_vec, &parser_func_table, &diag_vec);
+    parser_stats_t parse_stats = frontend_parse_ast(&tree, &token_vec, &parser_func_table,
+                                                    &diag_vec, &lex_stats, nullptr);
+    // Без PARSER_STATS_DEBUG счетчики нулевые
+    if (parser_stats) parser_stats_dump(stderr, &parse_stats);
 
     if (vector_size(&diag_vec) != 0) {
         fprintf(stderr, "Ошибки парсера:\n");
@@ -268,6 +365,7 @@ int main(int argc, char** argv) {
         vector_destroy(&token_vec);
         u_map_destroy(&parser_func_table);
         tree_destroy(&tree);
+        tree_nodes_pool_destroy();
         vector_destroy(&diag_vec);
         if (need_free) free(file_data);
         return 1;
@@ -282,6 +380,7 @@ int main(int argc, char** argv) {
     if (write_front_err != ERROR_NO) {
         fprintf(stderr, "Ошибка: не удалось записать AST в файл: %s\n", ast_frontend);
         tree_destroy(&tree);
+        tree_nodes_pool_destroy();
         vector_destroy(&diag_vec);
         if (need_free) free(file_data);
         return 1;
@@ -292,6 +391,7 @@ int main(int argc, char** argv) {
     vector_destroy(&token_vec);
     u_map_destroy(&parser_func_table);
     tree_destroy(&tree);
+    tree_nodes_pool_destroy();
     vector_destroy(&diag_vec);
 
     // Важно: буфер исходного кода должен жить как минимум до tree_write_to_file()
@@ -321,14 +421,34 @@ int main(int argc, char** argv) {
     LOGGER_DEBUG("Начало оптимизации дерева (midend)");
     tree_dump(&mid_tree, TREE_VER_INIT, true, "aaaa");
 
-    error_code opt_error = tree_optimize(&mid_tree);
+    optimize_stats_t opt_stats = {};
+    error_code opt_error = tree_optimize(&mid_tree, &opt_options, &opt_stats);
     if (opt_error != ERROR_NO) {
         fprintf(stderr, "Ошибка оптимизации дерева\n");
         tree_destroy(&mid_tree);
         free(mid_buffer.ptr);
         return 1;
     }
-    LOGGER_DEBUG("Оптимизация завершена (midend)");
+    LOGGER_DEBUG("Оптимизация завершена (midend): %zu хвостовых вызовов, %zu встроенных вызовов, "
+                 "%zu подстановок, %zu вычисленных вызовов, %zu клонов, %zu специализированных вызовов, "
+                 "%zu недостижимых функций, "
+                 "%zu перестроенных цепочек, %zu итераций, "
+                 "%zu переписываний, %zu упрощённых условий, %zu мёртвых операторов, "
+                 "%zu инвариантов циклов, "
+                 "%zu упрощений операций, %zu временных, %zu мёртвых присваиваний, "
+                 "%zu выброшенных переменных, %zu прогонов%s",
+                 opt_stats.tail_calls, opt_stats.inlined_calls, opt_stats.substitutions, opt_stats.calls_evaluated,
+                 opt_stats.clones, opt_stats.specialized_calls, opt_stats.dead_funcs, opt_stats.reassociations,
+                 opt_stats.iterations, opt_stats.rewrites, opt_stats.predicates,
+                 opt_stats.statements_removed,
+                 opt_stats.loop_invariants, opt_stats.strength_reductions, opt_stats.cse_temps,
+                 opt_stats.dead_stores, opt_stats.dropped_vars, opt_stats.rounds,
+                 opt_stats.budget_exhausted ? ", бюджет исчерпан" : "");
+    if (time_passes) print_pass_times(&opt_stats);
+    print_truncation_report(&opt_stats);
+    if (call_graph_path != nullptr && !write_call_graph(&mid_tree, opt_options.entry_name, call_graph_path)) {
+        fprintf(stderr, "Ошибка: не удалось записать граф вызовов в файл: %s\n", call_graph_path);
+    }
     tree_dump(&mid_tree, TREE_VER_INIT, true, "aaaa");
     LOGGER_DEBUG("Запись AST (midend) в файл: %s", ast_midend);
     error_code write_mid_err = tree_write_to_file(&mid_tree, ast_midend);
@@ -380,7 +500,8 @@ int main(int argc, char** argv) {
     }
 
     LOGGER_DEBUG("Начало генерации ассемблера (backend)");
-    hm_error_t backend_error = backend_emit_asm(&back_tree, asm_file, &backend_func_table);
+    hm_error_t backend_error = backend_emit_asm(&back_tree, asm_file, &backend_func_table,
+                                                opt_options.entry_name);
     fclose(asm_file);
 
     if (backend_error != HM_ERR_OK) {
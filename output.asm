@@ -0,0 +1,86 @@
+PUSH 0
+POPR RBX
+CALL :main
+HLT
+
+:main
+PUSHR RBX
+POPR RDX
+PUSHR RBX
+PUSH 1
+ADD
+POPR RBX
+PUSHR RBX
+PUSH 1
+ADD
+POPR RBX
+PUSHR RDX
+PUSH 1
+ADD
+POPR RCX
+POPM [CX]
+PUSHR RDX
+PUSH 0
+ADD
+POPR RCX
+POPM [CX]
+:tailbody_1
+PUSHR RBX
+PUSHR RDX
+PUSH 0
+ADD
+POPR RCX
+PUSHM [CX]
+PUSHR RDX
+PUSH 1
+ADD
+POPR RCX
+PUSHM [CX]
+ADD
+PUSHR RBX
+PUSH 1
+ADD
+POPR RBX
+PUSH 0
+PUSHR RDX
+PUSH 2
+ADD
+POPR RCX
+POPM [CX]
+PUSHR RDX
+PUSH 2
+ADD
+POPR RCX
+POPM [CX]
+PUSHR RDX
+PUSH 2
+ADD
+POPR RCX
+PUSHM [CX]
+POP
+PUSHR RDX
+PUSH 2
+ADD
+POPR RCX
+PUSHM [CX]
+PUSH 1
+JE :iftrue_2
+JUMP :ifend_3
+:iftrue_2
+PUSHR RBX
+PUSH 0
+OUT
+POPR RBX
+:ifend_3
+PUSHR RDX
+PUSH 2
+ADD
+POPR RCX
+PUSHM [CX]
+POPR RAX
+POPR RBX
+RET
+POPR RBX
+PUSH 0
+POPR RAX
+RET
@@ -21,8 +21,11 @@ struct backend_func_symbol_t {
 // func_table должен быть инициализирован снаружи (u_map_init / u_map_static_init).
 // key   = size_t ident_idx
 // value = backend_func_symbol_t
+//
+// Пролог вызывает entry_name (nullptr — main), а если её нет — первую функцию таблицы
 hm_error_t backend_emit_asm(const tree_t* tree,
                             FILE* asm_file,
-                            u_map_t* func_table);
+                            u_map_t* func_table,
+                            const char* entry_name);
 
 #endif /* PROJECT_BACKEND_INCLUDE_BACKEND_H_NCLUDED */
@@ -11,6 +11,7 @@
 #include "libs/Unordered_map/include/unordered_map.h"
 #include "libs/Unordered_map/include/error_handler.h"
 
+#include <math.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -94,13 +95,22 @@ static const backend_scope_t* scope_top_const(const vector_t* scop_stack) {
 
 //================================================================================
 
+struct backend_loop_t {
+    size_t labl_head;
+    size_t labl_end;
+    size_t scop_depth;   // глубина областей на входе в цикл
+};
+
 struct backend_ctx_t {
     const tree_t* tree_ptr;
     FILE*         file_ptr;
     u_map_t*      func_table;
 
     vector_t      scop_stack; 
+    vector_t      loop_stack;  // backend_loop_t
     size_t        label_next;
+    size_t        func_idnt;   // функция, тело которой сейчас генерируется
+    const char*   entry_name;  // вызывается из пролога
 
     size_t        offc_curr;   
     size_t        scop_depth;  
@@ -362,7 +372,7 @@ static inline void* u_map_val_ptr(const u_map_t* map_ptr, size_t indx) {
     return (void*)((unsigned char*)map_ptr->data_values + indx * map_ptr->value_stride);
 }
 
-static bool func_table_find_main(const backend_ctx_t* ctx_ptr, size_t* idnt_out) {
+static bool func_table_find_entry(const backend_ctx_t* ctx_ptr, size_t* idnt_out) {
     HARD_ASSERT(ctx_ptr != nullptr, "ctx_ptr is nullptr");
     HARD_ASSERT(idnt_out != nullptr, "idnt_out is nullptr");
 
@@ -373,7 +383,7 @@ static bool func_table_find_main(const backend_ctx_t* ctx_ptr, size_t* idnt_out)
         size_t idnt_idx = *(size_t*)u_map_key_ptr(tabl_ptr, idx_i);
         c_string_t name_ptr = ident_name_by_idx(ctx_ptr->tree_ptr, idnt_idx);
 
-        if (my_scstrcmp(name_ptr, "main") == 0) {
+        if (my_scstrcmp(name_ptr, ctx_ptr->entry_name) == 0) {
             *idnt_out = idnt_idx;
             return true;
         }
@@ -498,7 +508,11 @@ static void emit_decl_label(backend_ctx_t* ctx_ptr, size_t idnt_idx) {
 static hm_error_t emit_call_common(backend_ctx_t* ctx_ptr, const tree_node_t* call_ptr, bool need_value) {
     HARD_ASSERT(is_func_node(call_ptr, OP_CALL), "expected OP_CALL");
 
-    const tree_node_t* name_ptr = call_ptr->right;
+    // CALL(FUNC_INFO(args, name), nullptr)
+    const tree_node_t* info_ptr = call_ptr->left;
+    HARD_ASSERT(is_func_node(info_ptr, OP_FUNC_INFO), "bad call func_info");
+
+    const tree_node_t* name_ptr = get_info_name(info_ptr);
     HARD_ASSERT(node_is_ident(name_ptr), "call name must be IDENT");
     size_t idnt_idx = require_ident_idx(name_ptr);
 
@@ -510,7 +524,7 @@ static hm_error_t emit_call_common(backend_ctx_t* ctx_ptr, const tree_node_t* ca
 
     vector_t args_list = {};
     (void)SIMPLE_VECTOR_INIT(&args_list, 8, const tree_node_t*);
-    collect_call_args(call_ptr->left, &args_list);
+    collect_call_args(get_info_args(info_ptr), &args_list);
 
     for (size_t idx_i = 0; idx_i < vector_size(&args_list); ++idx_i) {
         const tree_node_t* expr_ptr = *(const tree_node_t**)vector_get_const(&args_list, idx_i);
@@ -603,9 +617,9 @@ static hm_error_t emit_expr(backend_ctx_t* ctx_ptr, const tree_node_t* node_ptr)
 
 //================================================================================
 
-static void emit_truthy_jump_end(backend_ctx_t* ctx_ptr, size_t labl_end) {
+static void emit_truthy_jump_end(backend_ctx_t* ctx_ptr, const char* pref_ptr, size_t labl_end) {
     emit_push_size(ctx_ptr, 0);
-    emit_jump_id(ctx_ptr, "JE", "ifend", labl_end);
+    emit_jump_id(ctx_ptr, "JE", pref_ptr, labl_end);
 }
 
 static hm_error_t emit_if_stmt(backend_ctx_t* ctx_ptr, const tree_node_t* node_ptr) {
@@ -677,7 +691,7 @@ static hm_error_t emit_if_stmt(backend_ctx_t* ctx_ptr, const tree_node_t* node_p
     hm_error_t erro_code = emit_expr(ctx_ptr, cond_ptr);
     if (erro_code != HM_ERR_OK) return erro_code;
 
-    emit_truthy_jump_end(ctx_ptr, labl_end);
+    emit_truthy_jump_end(ctx_ptr, "ifend", labl_end);
 
     erro_code = emit_stmt(ctx_ptr, body_ptr);
     if (erro_code != HM_ERR_OK) return erro_code;
@@ -688,6 +702,143 @@ static hm_error_t emit_if_stmt(backend_ctx_t* ctx_ptr, const tree_node_t* node_p
 
 //================================================================================
 
+// Переход на whileend, если условие ложно; сравнение — одним переходом
+static hm_error_t emit_while_cond(backend_ctx_t* ctx_ptr, const tree_node_t* cond_ptr,
+                                  size_t labl_body, size_t labl_end) {
+    if (cond_ptr != nullptr && cond_ptr->type == CONSTANT && fabs(cond_ptr->value.constant) > 1e-9) {
+        return HM_ERR_OK;
+    }
+
+    if (cond_ptr == nullptr || cond_ptr->type != FUNCTION ||
+        !(cond_ptr->value.func == OP_EQ || cond_ptr->value.func == OP_LT ||
+          cond_ptr->value.func == OP_GT || cond_ptr->value.func == OP_LE ||
+          cond_ptr->value.func == OP_GE || cond_ptr->value.func == OP_NEQ)) {
+        hm_error_t erro_code = emit_expr(ctx_ptr, cond_ptr);
+        if (erro_code != HM_ERR_OK) return erro_code;
+
+        emit_truthy_jump_end(ctx_ptr, "whileend", labl_end);
+        return HM_ERR_OK;
+    }
+
+    hm_error_t erro_code = emit_expr(ctx_ptr, cond_ptr->left);
+    if (erro_code != HM_ERR_OK) return erro_code;
+
+    erro_code = emit_expr(ctx_ptr, cond_ptr->right);
+    if (erro_code != HM_ERR_OK) return erro_code;
+
+    op_code_t op_code = cond_ptr->value.func;
+
+    if (op_code == OP_NEQ) { emit_jump_id(ctx_ptr, "JE", "whileend", labl_end); return HM_ERR_OK; }
+    if (op_code == OP_LE)  { emit_jump_id(ctx_ptr, "JA", "whileend", labl_end); return HM_ERR_OK; }
+    if (op_code == OP_GE)  { emit_jump_id(ctx_ptr, "JB", "whileend", labl_end); return HM_ERR_OK; }
+
+    if      (op_code == OP_EQ) emit_jump_id(ctx_ptr, "JE", "whilebody", labl_body);
+    else if (op_code == OP_LT) emit_jump_id(ctx_ptr, "JB", "whilebody", labl_body);
+    else                       emit_jump_id(ctx_ptr, "JA", "whilebody", labl_body);
+
+    emit_jump_id(ctx_ptr, "JUMP", "whileend", labl_end);
+    emit_label_id(ctx_ptr, "whilebody", labl_body);
+    return HM_ERR_OK;
+}
+
+static hm_error_t emit_while_stmt(backend_ctx_t* ctx_ptr, const tree_node_t* node_ptr) {
+    HARD_ASSERT(is_func_node(node_ptr, OP_WHILE), "expected OP_WHILE");
+
+    backend_loop_t loop_val = {};
+    loop_val.labl_head  = new_label_id(ctx_ptr);
+    loop_val.labl_end   = new_label_id(ctx_ptr);
+    loop_val.scop_depth = ctx_ptr->scop_depth;
+    size_t labl_body    = new_label_id(ctx_ptr);
+
+    emit_label_id(ctx_ptr, "whilehead", loop_val.labl_head);
+
+    hm_error_t erro_code = emit_while_cond(ctx_ptr, node_ptr->left, labl_body, loop_val.labl_end);
+    if (erro_code != HM_ERR_OK) return erro_code;
+
+    if (vector_push_back(&ctx_ptr->loop_stack, &loop_val) != VEC_ERR_OK) return HM_ERR_MEM_ALLOC;
+    erro_code = emit_stmt(ctx_ptr, node_ptr->right);
+    (void)vector_pop_back(&ctx_ptr->loop_stack, &loop_val);
+    if (erro_code != HM_ERR_OK) return erro_code;
+
+    emit_jump_id(ctx_ptr, "JUMP", "whilehead", loop_val.labl_head);
+    emit_label_id(ctx_ptr, "whileend", loop_val.labl_end);
+    return HM_ERR_OK;
+}
+
+// break и continue снимают области, открытые внутри цикла
+static hm_error_t emit_loop_jump_stmt(backend_ctx_t* ctx_ptr, const tree_node_t* node_ptr) {
+    bool is_break = is_func_node(node_ptr, OP_BREAK);
+    HARD_ASSERT(is_break || is_func_node(node_ptr, OP_CONTINUE), "expected OP_BREAK/OP_CONTINUE");
+
+    size_t loop_count = vector_size(&ctx_ptr->loop_stack);
+    if (loop_count == 0) {
+        LOGGER_ERROR("%s outside of a loop", is_break ? "break" : "continue");
+        return HM_ERR_BAD_ARG;
+    }
+
+    const backend_loop_t* loop_ptr = (const backend_loop_t*)
+        vector_get_const(&ctx_ptr->loop_stack, loop_count - 1);
+
+    emit_unwind_scopes(ctx_ptr, ctx_ptr->scop_depth - loop_ptr->scop_depth);
+    if (is_break) emit_jump_id(ctx_ptr, "JUMP", "whileend",  loop_ptr->labl_end);
+    else          emit_jump_id(ctx_ptr, "JUMP", "whilehead", loop_ptr->labl_head);
+    return HM_ERR_OK;
+}
+
+//================================================================================
+
+// return f(args) внутри самой f: аргументы пишутся прямо в слоты параметров,
+// области снимаются, и вместо CALL идёт переход за пролог — кадр и стек
+// возвратов не растут
+static bool is_self_tail_call(const backend_ctx_t* ctx_ptr, const tree_node_t* expr_ptr,
+                              backend_func_symbol_t* symb_out) {
+    if (!is_func_node(expr_ptr, OP_CALL) || !is_func_node(expr_ptr->left, OP_FUNC_INFO)) return false;
+
+    const tree_node_t* name_ptr = get_info_name(expr_ptr->left);
+    if (!node_is_ident(name_ptr) || name_ptr->value.ident_idx != ctx_ptr->func_idnt) return false;
+
+    return func_table_get_symbol(ctx_ptr, ctx_ptr->func_idnt, symb_out);
+}
+
+static hm_error_t emit_tail_call(backend_ctx_t* ctx_ptr, const tree_node_t* call_ptr,
+                                 const backend_func_symbol_t* symb_ptr) {
+    vector_t args_list = {};
+    if (SIMPLE_VECTOR_INIT(&args_list, 8, const tree_node_t*) != VEC_ERR_OK) {
+        LOGGER_ERROR("tail call: args list allocation failed");
+        return HM_ERR_MEM_ALLOC;
+    }
+    collect_call_args(get_info_args(call_ptr->left), &args_list);
+
+    if (vector_size(&args_list) != symb_ptr->param_count) {
+        LOGGER_ERROR("tail call with %zu args for %zu params",
+                     vector_size(&args_list), symb_ptr->param_count);
+        vector_destroy(&args_list);
+        return HM_ERR_BAD_ARG;
+    }
+
+    // Все аргументы считаются до первой записи: они читают старые параметры
+    for (size_t idx_i = 0; idx_i < vector_size(&args_list); ++idx_i) {
+        const tree_node_t* expr_ptr = *(const tree_node_t* const*)vector_get_const(&args_list, idx_i);
+        hm_error_t erro_code = emit_expr(ctx_ptr, expr_ptr);
+        if (erro_code != HM_ERR_OK) {
+            vector_destroy(&args_list);
+            return erro_code;
+        }
+    }
+    vector_destroy(&args_list);
+
+    for (size_t idx_i = symb_ptr->param_count; idx_i > 0; --idx_i) {
+        emit_addr_from_base(ctx_ptr, idx_i - 1);
+        emit_popm(ctx_ptr, REG_RCX);
+    }
+
+    emit_unwind_scopes(ctx_ptr, ctx_ptr->scop_depth);
+    emit_jump_id(ctx_ptr, "JUMP", "tailbody", symb_ptr->label_id);
+    return HM_ERR_OK;
+}
+
+//================================================================================
+
 static hm_error_t emit_print_stmt(backend_ctx_t* ctx_ptr, const tree_node_t* node_ptr) {
     HARD_ASSERT(is_func_node(node_ptr, OP_PRINT), "expected OP_PRINT");
     hm_error_t erro_code = emit_expr(ctx_ptr, node_ptr->right);
@@ -699,6 +850,11 @@ static hm_error_t emit_print_stmt(backend_ctx_t* ctx_ptr, const tree_node_t* nod
 static hm_error_t emit_return_stmt(backend_ctx_t* ctx_ptr, const tree_node_t* node_ptr) {
     HARD_ASSERT(is_func_node(node_ptr, OP_RETURN), "expected OP_RETURN");
 
+    backend_func_symbol_t symb_val = {};
+    if (is_self_tail_call(ctx_ptr, node_ptr->right, &symb_val)) {
+        return emit_tail_call(ctx_ptr, node_ptr->right, &symb_val);
+    }
+
     hm_error_t erro_code = emit_expr(ctx_ptr, node_ptr->right);
     if (erro_code != HM_ERR_OK) return erro_code;
 
@@ -751,6 +907,9 @@ static hm_error_t emit_stmt(backend_ctx_t* ctx_ptr, const tree_node_t* node_ptr)
     if (op_code == OP_RETURN)    return emit_return_stmt(ctx_ptr, node_ptr);
     if (op_code == OP_FINISH)    return emit_finish_stmt(ctx_ptr, node_ptr);
     if (op_code == OP_IF)        return emit_if_stmt(ctx_ptr, node_ptr);
+    if (op_code == OP_WHILE)     return emit_while_stmt(ctx_ptr, node_ptr);
+    if (op_code == OP_BREAK)     return emit_loop_jump_stmt(ctx_ptr, node_ptr);
+    if (op_code == OP_CONTINUE)  return emit_loop_jump_stmt(ctx_ptr, node_ptr);
 
     if (op_code == OP_CALL) {
         return emit_call_common(ctx_ptr, node_ptr, false);
@@ -783,6 +942,7 @@ static hm_error_t emit_func_body(backend_ctx_t* ctx_ptr, const tree_node_t* decl
     HARD_ASSERT(func_table_get_symbol(ctx_ptr, idnt_idx, &symb_val), "symbol missing in table");
 
     emit_decl_label(ctx_ptr, idnt_idx);
+    ctx_ptr->func_idnt = idnt_idx;
 
     hm_error_t erro_code = scopes_reset(ctx_ptr);
     if (erro_code != HM_ERR_OK) return erro_code;
@@ -809,6 +969,8 @@ static hm_error_t emit_func_body(backend_ctx_t* ctx_ptr, const tree_node_t* decl
 
     vector_destroy(&parm_list);
 
+    emit_label_id(ctx_ptr, "tailbody", symb_val.label_id);
+
     erro_code = emit_stmt(ctx_ptr, decl_ptr->right);
     if (erro_code != HM_ERR_OK) return erro_code;
 
@@ -842,7 +1004,7 @@ static void emit_entry_prelude(backend_ctx_t* ctx_ptr) {
     emit_popr(ctx_ptr, REG_RBX);
 
     size_t entry_idx = 0;
-    if (func_table_find_main(ctx_ptr, &entry_idx) ||
+    if (func_table_find_entry(ctx_ptr, &entry_idx) ||
         func_table_find_first(ctx_ptr->func_table, &entry_idx)) {
         emit_call_label(ctx_ptr, entry_idx);
     }
@@ -854,7 +1016,8 @@ static void emit_entry_prelude(backend_ctx_t* ctx_ptr) {
 
 hm_error_t backend_emit_asm(const tree_t* tree,
                            FILE* asm_file,
-                           u_map_t* func_table) {
+                           u_map_t* func_table,
+                           const char* entry_name) {
     HARD_ASSERT(tree      != nullptr, "tree is nullptr");
     HARD_ASSERT(asm_file  != nullptr, "asm_file is nullptr");
     HARD_ASSERT(func_table != nullptr, "func_table is nullptr");
@@ -863,6 +1026,7 @@ hm_error_t backend_emit_asm(const tree_t* tree,
     ctx_data.tree_ptr    = tree;
     ctx_data.file_ptr    = asm_file;
     ctx_data.func_table  = func_table;
+    ctx_data.entry_name  = entry_name != nullptr ? entry_name : "main";
     ctx_data.label_next  = 1;
     ctx_data.offc_curr   = 0;
     ctx_data.scop_depth  = 0;
@@ -870,9 +1034,16 @@ hm_error_t backend_emit_asm(const tree_t* tree,
     vector_error_t vec_error = SIMPLE_VECTOR_INIT(&ctx_data.scop_stack, 16, backend_scope_t);
     if (vec_error != VEC_ERR_OK) return HM_ERR_MEM_ALLOC;
 
+    vec_error = SIMPLE_VECTOR_INIT(&ctx_data.loop_stack, 8, backend_loop_t);
+    if (vec_error != VEC_ERR_OK) {
+        vector_destroy(&ctx_data.scop_stack);
+        return HM_ERR_MEM_ALLOC;
+    }
+
     hm_error_t erro_code = pass1_collect(&ctx_data, tree->root);
     if (erro_code != HM_ERR_OK) {
         vector_destroy(&ctx_data.scop_stack);
+        vector_destroy(&ctx_data.loop_stack);
         return erro_code;
     }
 
@@ -886,6 +1057,7 @@ hm_error_t backend_emit_asm(const tree_t* tree,
         scope_destroy(&scop_old);
     }
     vector_destroy(&ctx_data.scop_stack);
+    vector_destroy(&ctx_data.loop_stack);
 
     return erro_code;
 }
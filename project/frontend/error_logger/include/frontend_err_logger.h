@@ -2,53 +2,76 @@
 #define PROJECT_FRONTEND_INCLUDE_FRONTEND_ERR_LOGGER_H_NCLUDED
 
 #include <stdio.h>
+#include <stdint.h>
 
 #include "libs/My_string/include/my_string.h"
 #include "libs/Vector/include/vector.h"
 
-const int MAX_ERROR_MESSAGE_LENGTH = 512;
+const int DIAG_MAX_ARGS            = 2;
 
-enum error_source_t {
+enum error_source_t : uint8_t {
     LEXER_ERROR,
     PARSER_ERROR,
 };
 
-enum diag_code_t {
+// Текст сообщения строится в print_diags по коду; в комментарии — смысл args
+enum diag_code_t : uint8_t {
     DIAG_LEX_UNKNOWN_SYMBOL,
     DIAG_LEX_BAD_NUMBER,
     DIAG_LEX_UNTERMINATED_COMMENT,
-    DIAG_PARSE_EXPECTED,
-    DIAG_PARSE_UNDEF_FUNCTION,
-    DIAG_PARSE_REDEF_FUNCTION,
+    DIAG_PARSE_EXPECTED,             // args[0] = diag_expected_t
+    DIAG_PARSE_UNCLOSED_BLOCK,
+    DIAG_PARSE_UNDEF_FUNCTION,       // args[0] = ident_idx
+    DIAG_PARSE_DECL_NOT_COLLECTED,   // args[0] = ident_idx
+    DIAG_PARSE_REDEF_FUNCTION,       // args[0] = ident_idx
+    DIAG_PARSE_DECL_KIND_MISMATCH,   // args[0] = op_code 1-го прохода
+    DIAG_PARSE_DECL_ARGC_MISMATCH,   // args[0] = ожидалось, args[1] = получено
     DIAG_PARSE_NESTED_DECL,
-    DIAG_PARSE_VOID_IN_EXPR,
+    DIAG_PARSE_VOID_IN_EXPR,         // args[0] = op_code (OP_CALL для proc)
     DIAG_PARSE_RETURN_IN_PROC,
     DIAG_PARSE_FINISH_IN_FUNC,
-    DIAG_PARSE_BREAK_OUTSIDE,
-    DIAG_PARSE_ARGC_MISMATCH,
-    DIAG_PARSE_UNDEF_IDENT,
-    DIAG_PARSE_TOPLEVEL_STMT,
+    DIAG_PARSE_BREAK_OUTSIDE,        // args[0] = op_code (OP_BREAK | OP_CONTINUE)
+    DIAG_PARSE_ARGC_MISMATCH,        // args[0] = ожидалось, args[1] = получено
+    DIAG_PARSE_UNDEF_IDENT,          // args[0] = ident_idx
+    DIAG_PARSE_TOPLEVEL_STMT,        // args[0] = op_code
+    DIAG_PARSE_ASSIGN_TO_RVALUE,
+    DIAG_PARSE_TOO_MANY_ERRORS,      // args[0] = предел ошибок на объявление
 };
 
+enum diag_expected_t : uint8_t {
+    DIAG_EXP_LBRACE,
+    DIAG_EXP_RBRACE,
+    DIAG_EXP_LPAREN,
+    DIAG_EXP_RPAREN,
+    DIAG_EXP_RPAREN_OR_COMMA,
+    DIAG_EXP_SEMICOLON,
+    DIAG_EXP_PARAM_IDENT,
+    DIAG_EXP_DECL_NAME,
+    DIAG_EXP_CALL_NAME,
+    DIAG_EXP_EXPR,
+    DIAG_EXP_RETURN_EXPR,
+};
+
+// 24 байта: код, место в исходнике и пара типизированных аргументов
 struct diag_log_t {
-    error_source_t  source;
-    diag_code_t code;
+    error_source_t source;
+    diag_code_t    code;
+    uint16_t       length;
 
-    size_t position;
-    size_t length;
-    
-    size_t line;
-    size_t column;
+    uint32_t       position;
+    uint32_t       line;
+    uint32_t       column;
 
-    char message[MAX_ERROR_MESSAGE_LENGTH]; 
+    uint32_t       args[DIAG_MAX_ARGS];
 };
 
+// Форматирует все сообщения в один буфер и выводит его одной записью
 void print_diags(FILE* stream, c_string_t buffer, 
                  const char* file_name, const vector_t* diags);
 
 diag_log_t diag_log_init(error_source_t source, diag_code_t code,
                          size_t position, size_t length,
                          size_t line,     size_t column,
-                         const char* message, ...);
+                         uint32_t arg0,   uint32_t arg1);
 
 #endif /* PROJECT_FRONTEND_INCLUDE_FRONTEND_ERR_LOGGER_H_NCLUDED */
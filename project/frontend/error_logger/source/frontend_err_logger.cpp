@@ -6,6 +6,7 @@
 #include <ctype.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stdlib.h>
 
 //================================================================================
 
@@ -31,7 +32,65 @@ static void find_line_bounds(c_string_t buffer, size_t position,
     *end_out = end;
 }
 
-static void print_caret_line(FILE* stream, c_string_t line,
+//================================================================================
+//                      Буфер вывода (одна запись в поток)
+//================================================================================
+
+struct diag_out_t {
+    char*  data;
+    size_t len;
+    size_t cap;
+    bool   failed;
+};
+
+static bool diag_out_reserve(diag_out_t* out, size_t extra) {
+    if (out->failed) return false;
+    if (out->len + extra + 1 <= out->cap) return true;
+
+    size_t new_cap = (out->cap == 0) ? 1024 : out->cap;
+    while (new_cap < out->len + extra + 1) new_cap *= 2;
+
+    char* new_data = (char*)realloc(out->data, new_cap);
+    if (new_data == nullptr) {
+        out->failed = true;
+        return false;
+    }
+
+    out->data = new_data;
+    out->cap  = new_cap;
+    return true;
+}
+
+static void diag_out_write(diag_out_t* out, const char* data, size_t len) {
+    if (!diag_out_reserve(out, len)) return;
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+}
+
+static void diag_out_putc(diag_out_t* out, char ch) {
+    diag_out_write(out, &ch, 1);
+}
+
+__attribute__((format(printf, 2, 3)))
+static void diag_out_printf(diag_out_t* out, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    va_list args_copy;
+    va_copy(args_copy, args);
+
+    int need = vsnprintf(nullptr, 0, format, args);
+    if (need > 0 && diag_out_reserve(out, (size_t)need)) {
+        vsnprintf(out->data + out->len, (size_t)need + 1, format, args_copy);
+        out->len += (size_t)need;
+    }
+
+    va_end(args_copy);
+    va_end(args);
+}
+
+//================================================================================
+
+static void print_caret_line(diag_out_t* out, c_string_t line,
                              size_t column_1based, size_t length) {
     if (column_1based == 0) column_1based = 1;
     if (length == 0) length = 1;
@@ -40,24 +99,126 @@ static void print_caret_line(FILE* stream, c_string_t line,
     for (size_t i = 0; i < line.len && col < column_1based; ++i) {
         unsigned char ch = (unsigned char)line.ptr[i];
 
-        if (ch == '\t') fputc('\t', stream);
-        else            fputc(' ', stream);
+        if (ch == '\t') diag_out_putc(out, '\t');
+        else            diag_out_putc(out, ' ');
 
         col++;
     }
 
-    fputc('^', stream);
-    for (size_t i = 1; i < length; ++i) fputc('~', stream);
-    fputc('\n', stream);
+    diag_out_putc(out, '^');
+    for (size_t i = 1; i < length; ++i) diag_out_putc(out, '~');
+    diag_out_putc(out, '\n');
 }
 
-//================================================================================
+static const char* diag_expected_name(uint32_t what) {
+    switch ((diag_expected_t)what) {
+        case DIAG_EXP_LBRACE:          return "'{'";
+        case DIAG_EXP_RBRACE:          return "'}'";
+        case DIAG_EXP_LPAREN:          return "'('";
+        case DIAG_EXP_RPAREN:          return "')'";
+        case DIAG_EXP_RPAREN_OR_COMMA: return "')' или ','";
+        case DIAG_EXP_SEMICOLON:       return "';'";
+        case DIAG_EXP_PARAM_IDENT:     return "идентификатор параметра";
+        case DIAG_EXP_DECL_NAME:       return "имя функции/процедуры";
+        case DIAG_EXP_CALL_NAME:       return "имя вызываемой функции/процедуры";
+        case DIAG_EXP_EXPR:            return "выражение";
+        case DIAG_EXP_RETURN_EXPR:     return "выражение после return";
+        default:                       return "?";
+    }
+}
+
+static void append_diag_message(diag_out_t* out, c_string_t buffer, const diag_log_t* diag) {
+    c_string_t span = {};
+    if (diag->position < buffer.len) {
+        span.ptr = buffer.ptr + diag->position;
+        span.len = buffer.len - diag->position;
+        if (span.len > diag->length) span.len = diag->length;
+    }
+    int span_len = (int)span.len;
+    const char* span_ptr = (span.ptr != nullptr) ? span.ptr : "";
+
+    switch (diag->code) {
+        case DIAG_LEX_UNKNOWN_SYMBOL: {
+            unsigned char got = (unsigned char)diag->args[0];
+            if (isprint(got)) diag_out_printf(out, "unknown symbol '%c'", (char)got);
+            else              diag_out_printf(out, "unknown symbol (0x%02X)", (unsigned)got);
+            break;
+        }
+        case DIAG_LEX_BAD_NUMBER:
+            diag_out_printf(out, "bad number literal '%.*s'", span_len, span_ptr);
+            break;
+        case DIAG_LEX_UNTERMINATED_COMMENT:
+            diag_out_printf(out, "unterminated block comment");
+            break;
+        case DIAG_PARSE_EXPECTED:
+            diag_out_printf(out, "ожидалось: %s", diag_expected_name(diag->args[0]));
+            break;
+        case DIAG_PARSE_UNCLOSED_BLOCK:
+            diag_out_printf(out, "ожидалось: '}' (не закрыт блок)");
+            break;
+        case DIAG_PARSE_UNDEF_FUNCTION:
+            diag_out_printf(out, "вызов неизвестной функции/процедуры '%.*s'", span_len, span_ptr);
+            break;
+        case DIAG_PARSE_DECL_NOT_COLLECTED:
+            diag_out_printf(out, "объявление '%.*s' не найдено в таблице 1-го прохода", span_len, span_ptr);
+            break;
+        case DIAG_PARSE_REDEF_FUNCTION:
+            diag_out_printf(out, "переопределение функции/процедуры '%.*s'", span_len, span_ptr);
+            break;
+        case DIAG_PARSE_DECL_KIND_MISMATCH:
+            diag_out_printf(out, "несовпадение вида (func/proc) с 1-м проходом");
+            break;
+        case DIAG_PARSE_DECL_ARGC_MISMATCH:
+            diag_out_printf(out, "несовпадение числа параметров с 1-м проходом (было %u, стало %u)",
+                            (unsigned)diag->args[0], (unsigned)diag->args[1]);
+            break;
+        case DIAG_PARSE_NESTED_DECL:
+            diag_out_printf(out, "объявления func/proc запрещены внутри тела");
+            break;
+        case DIAG_PARSE_VOID_IN_EXPR:
+            diag_out_printf(out, "'%.*s' нельзя использовать как выражение", span_len, span_ptr);
+            break;
+        case DIAG_PARSE_RETURN_IN_PROC:
+            diag_out_printf(out, "return запрещен в proc");
+            break;
+        case DIAG_PARSE_FINISH_IN_FUNC:
+            diag_out_printf(out, "finish запрещен в func");
+            break;
+        case DIAG_PARSE_BREAK_OUTSIDE:
+            diag_out_printf(out, "'%.*s' вне while", span_len, span_ptr);
+            break;
+        case DIAG_PARSE_ARGC_MISMATCH:
+            diag_out_printf(out, "несовпадение числа аргументов (ожидалось %u, получено %u)",
+                            (unsigned)diag->args[0], (unsigned)diag->args[1]);
+            break;
+        case DIAG_PARSE_UNDEF_IDENT:
+            diag_out_printf(out, "неизвестная переменная '%.*s'", span_len, span_ptr);
+            break;
+        case DIAG_PARSE_TOPLEVEL_STMT:
+            diag_out_printf(out, "оператор '%.*s' запрещен на глобальном уровне", span_len, span_ptr);
+            break;
+        case DIAG_PARSE_ASSIGN_TO_RVALUE:
+            diag_out_printf(out, "слева от '=' должна быть переменная");
+            break;
+        case DIAG_PARSE_TOO_MANY_ERRORS:
+            diag_out_printf(out, "слишком много ошибок (больше %u), остаток объявления пропущен",
+                            (unsigned)diag->args[0]);
+            break;
+        default:
+            LOGGER_ERROR("Unknown diag code %d", (int)diag->code);
+            diag_out_printf(out, "unknown diagnostic");
+            break;
+    }
+}
 
 void print_diags(FILE* stream, c_string_t buffer,
                  const char* filename, const vector_t* diags) {
 
     if (stream == nullptr) stream = stderr;
     if (diags == nullptr) return;
+    if (filename == nullptr) filename = "<missed file>";
+
+    diag_out_t out = {};
 
     size_t diag_count = vector_size(diags);
     for (size_t i = 0; i < diag_count; ++i) {
@@ -65,18 +226,18 @@ void print_diags(FILE* stream, c_string_t buffer,
         if (diag == nullptr) continue;
 
         if (diag->source == LEXER_ERROR) {
-            fprintf(stream, "%s:%zu:%zu:" ORANGE_CONSOLE " lexer_error: " RESET_CONSOLE,
-                    filename != nullptr ? filename : "<missed file>", diag->line, diag->column);
+            diag_out_printf(&out, "%s:%u:%u:" ORANGE_CONSOLE " lexer_error: " RESET_CONSOLE,
+                            filename, (unsigned)diag->line, (unsigned)diag->column);
         } else if (diag->source == PARSER_ERROR) {
-            fprintf(stream, "%s:%zu:%zu:" RED_CONSOLE " error: " RESET_CONSOLE,
-                    filename != nullptr ? filename : "<missed file>", diag->line, diag->column);
+            diag_out_printf(&out, "%s:%u:%u:" RED_CONSOLE " error: " RESET_CONSOLE,
+                            filename, (unsigned)diag->line, (unsigned)diag->column);
         } else {
             LOGGER_ERROR("Wrong source type");
-            fprintf(stream, "%s:%zu:%zu:" RED_CONSOLE " unkown source error: " RESET_CONSOLE,
-                    filename != nullptr ? filename : "<missed file>", diag->line, diag->column);
+            diag_out_printf(&out, "%s:%u:%u:" RED_CONSOLE " unkown source error: " RESET_CONSOLE,
+                            filename, (unsigned)diag->line, (unsigned)diag->column);
         }
-        fprintf(stream, diag->message);
-        fputc('\n', stream);
+        append_diag_message(&out, buffer, diag);
+        diag_out_putc(&out, '\n');
 
         size_t line_start = 0;
         size_t line_end = 0;
@@ -84,29 +245,36 @@ void print_diags(FILE* stream, c_string_t buffer,
 
         c_string_t line = { buffer.ptr + line_start, line_end - line_start };
 
-        fwrite(line.ptr, 1, line.len, stream);
-        fputc('\n', stream);
-        print_caret_line(stream, line, diag->column, diag->length);
+        diag_out_write(&out, line.ptr, line.len);
+        diag_out_putc(&out, '\n');
+        print_caret_line(&out, line, diag->column, diag->length);
+    }
+
+    if (out.failed) {
+        LOGGER_ERROR("print_diags: out of memory, output truncated");
     }
+    if (out.len > 0) fwrite(out.data, 1, out.len, stream);
+    free(out.data);
+}
+
+static uint32_t diag_clamp_u32(size_t value) {
+    return (value > UINT32_MAX) ? UINT32_MAX : (uint32_t)value;
 }
 
 diag_log_t diag_log_init(error_source_t source, diag_code_t code,
                          size_t position, size_t length,
                          size_t line,     size_t column,
-                         const char* message, ...) {
+                         uint32_t arg0,   uint32_t arg1) {
     diag_log_t diag = {};
 
     diag.source   = source;
     diag.code     = code;
-    diag.position = position;
-    diag.length   = length;
-    diag.line     = line;
-    diag.column   = column;
-
-    va_list args = {};
-    va_start(args, message);
-    vsnprintf(diag.message, MAX_ERROR_MESSAGE_LENGTH, message != nullptr ? message : "", args);
-    va_end(args);
+    diag.position = diag_clamp_u32(position);
+    diag.length   = (length > UINT16_MAX) ? (uint16_t)UINT16_MAX : (uint16_t)length;
+    diag.line     = diag_clamp_u32(line);
+    diag.column   = diag_clamp_u32(column);
+    diag.args[0]  = arg0;
+    diag.args[1]  = arg1;
 
     return diag;
-}
\ No newline at end of file
+}
@@ -53,11 +53,19 @@ struct lexer_token_t {
     bool       is_func;
 };
 
+// Статистика токенов — по ней парсер заранее выделяет память под дерево и таблицы
+struct lexer_stats_t {
+    size_t kind_count[LEX_TK_KEYWORD + 1];
+    size_t keyword_count[OP_CODES_COUNT];
+    size_t max_brace_depth;
+};
 
 //================================================================================
 
+// stats_out может быть nullptr
 lexer_error_t lexer_tokenize(c_string_t buffer, const lexer_config_t* config,
-                             vector_t* tokens_out, vector_t* diags_out);
+                             vector_t* tokens_out, vector_t* diags_out,
+                             lexer_stats_t* stats_out);
 
 //================================================================================
 #endif /* PROJECT_FRONTEND_LEXER_INCLUDE_LEXER_TOKENIZER_H_NCLUDED */
@@ -21,6 +21,9 @@ struct lexer_state_t {
 
     vector_t* tokens_out;
     vector_t* diags_out;
+
+    lexer_stats_t* stats;
+    size_t         brace_depth;
 };
 
 static bool is_space_char(unsigned char ch) {
@@ -110,8 +113,7 @@ static lexer_error_t skip_block_comment(lexer_state_t* state) {
 
     diag_log_t diag = diag_log_init(LEXER_ERROR, DIAG_LEX_UNTERMINATED_COMMENT,
                                     start_pos, 2,
-                                    start_line, start_col,
-                                    "unterminated block comment");
+                                    start_line, start_col, 0, 0);
 
     lexer_error_t err = lexer_push_diag(state, &diag);
     if (err != LEX_ERR_OK) return err;
@@ -141,11 +143,32 @@ static lexer_error_t lexer_skip_trivia(lexer_state_t* state) {
 
 //================================================================================
 
+static void lexer_count_token(lexer_state_t* state, const lexer_token_t* token) {
+    HARD_ASSERT(state != nullptr, "state is nullptr");
+    HARD_ASSERT(token != nullptr, "token is nullptr");
+
+    lexer_stats_t* stats = state->stats;
+    if (stats == nullptr) return;
+
+    stats->kind_count[token->kind]++;
+    if (token->kind == LEX_TK_KEYWORD) {
+        stats->keyword_count[token->op_code]++;
+        if (token->op_code == OP_VIS_START) {
+            state->brace_depth++;
+            if (state->brace_depth > stats->max_brace_depth) stats->max_brace_depth = state->brace_depth;
+        }
+    } else if (token->kind == LEX_TK_RBRACE && state->brace_depth > 0) {
+        state->brace_depth--;
+    }
+}
+
 static lexer_error_t lexer_push_token(lexer_state_t* state,
                                       const lexer_token_t* token) {
     HARD_ASSERT(state != nullptr, "state is nullptr");
     HARD_ASSERT(token != nullptr, "token is nullptr");
 
+    lexer_count_token(state, token);
+
     vector_error_t err = vector_push_back(state->tokens_out, token);
     return (err == 0) ? LEX_ERR_OK : LEX_ERR_VEC_FAIL;
 }
@@ -381,9 +404,7 @@ static lexer_error_t lex_unknown_symbol(lexer_state_t* state, unsigned char got)
 
     diag_log_t diag = diag_log_init(LEXER_ERROR, DIAG_LEX_UNKNOWN_SYMBOL,
                                     state->position, 1,
-                                    state->line, state->column,
-                                    isprint(got) ? "unknown symbol '%c'" : "unknown symbol (0x%02X)",
-                                    isprint(got) ? (char)got : (unsigned)got);
+                                    state->line, state->column, got, 0);
 
     lexer_error_t err = lexer_push_diag(state, &diag);
     if (err != LEX_ERR_OK) return err;
@@ -397,13 +418,12 @@ static lexer_error_t lex_bad_number(lexer_state_t* state, size_t length) {
 
     diag_log_t diag = diag_log_init(LEXER_ERROR, DIAG_LEX_BAD_NUMBER,
                                     state->position, (length > 0) ? length : 1,
-                                    state->line, state->column,
-                                    "bad number literal");
+                                    state->line, state->column, 0, 0);
 
     lexer_error_t err = lexer_push_diag(state, &diag);
     if (err != LEX_ERR_OK) return err;
 
-    lexer_advance(state, diag.length);
+    lexer_advance(state, (length > 0) ? length : 1);
     return LEX_ERR_OK;
 }
 
@@ -557,7 +577,8 @@ static lexer_error_t lex_try_ident(lexer_state_t* state, bool* matched_out) {
 //================================================================================
 
 lexer_error_t lexer_tokenize(c_string_t buffer, const lexer_config_t* config,
-                             vector_t* tokens_out, vector_t* diags_out) {
+                             vector_t* tokens_out, vector_t* diags_out,
+                             lexer_stats_t* stats_out) {
     HARD_ASSERT(config != nullptr, "config is nullptr");
     HARD_ASSERT(tokens_out != nullptr, "tokens_out is nullptr");
     HARD_ASSERT(diags_out != nullptr, "diags_out is nullptr");
@@ -570,6 +591,8 @@ lexer_error_t lexer_tokenize(c_string_t buffer, const lexer_config_t* config,
     state.config = config;
     state.tokens_out = tokens_out;
     state.diags_out = diags_out;
+    state.stats = stats_out;
+    if (stats_out != nullptr) *stats_out = {};
 
     while (state.position < state.buffer.len) {
         lexer_error_t skip_err = lexer_skip_trivia(&state);
@@ -19,11 +19,8 @@ static const char* token_kind_name(lexer_token_kind_t kind) {
 }
 
 static const char* op_code_tree_name(op_code_t op_code) {
-    for (size_t i = 0; i < KEYWORDS_COUNT; ++i) {
-        if (KEYWORDS[i].op_code == op_code)
-            return KEYWORDS[i].tree_name;
-    }
-    return nullptr;
+    const keyword_def_t* keyword = get_op_keyword(op_code);
+    return keyword != nullptr ? keyword->tree_name : nullptr;
 }
 
 static void print_token(const lexer_token_t* token) {
@@ -82,7 +79,7 @@ int main() {
     if (SIMPLE_VECTOR_INIT(&diags,  32, diag_log_t)  != 0) return 1;
 
     lexer_error_t lex_err =
-        lexer_tokenize(buffer, &config, &tokens, &diags);
+        lexer_tokenize(buffer, &config, &tokens, &diags, nullptr);
 
     printf("lexer_tokenize returned: %d\n", (int)lex_err);
 
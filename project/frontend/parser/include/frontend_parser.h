@@ -3,6 +3,8 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #include "libs/AST/include/tree_info.h"
 #include "libs/Vector/include/vector.h"
@@ -10,17 +12,114 @@
 #include "common/keywords/include/keywords.h"
 #include "libs/Unordered_map/include/unordered_map.h"
 
+#ifdef PARSER_STATS_DEBUG
+    #define ON_PARSER_STATS(...) __VA_ARGS__
+#else
+    #define ON_PARSER_STATS(...)
+#endif
+
+// Сверх этого ошибок на объявление/оператор верхнего уровня не выдается:
+// последней идет DIAG_PARSE_TOO_MANY_ERRORS
+const size_t PARSER_MAX_DIAGS_PER_ITEM = 10;
+
 // key = ident_idx (size_t), value = func_decl_info_t
 struct func_decl_info_t {
     op_code_t decl_opcode; // OP_FUNC_DECL | OP_PROC_DECL
     size_t    argc;
 };
 
+// Продукции, по которым считаются съеденные токены
+enum parser_prod_t {
+    PARSER_PROD_PASS1,
+    PARSER_PROD_TOPLEVEL,
+    PARSER_PROD_DECL,
+    PARSER_PROD_BLOCK,
+    PARSER_PROD_STMT,
+    PARSER_PROD_EXPR,
+    PARSER_PROD_CALL,
+    PARSER_PROD_RECOVERY,
+
+    PARSER_PROD_COUNT,
+};
+
+// Счетчики парсера. Заполняются только при PARSER_STATS_DEBUG, иначе нули.
+struct parser_stats_t {
+    size_t   tokens_consumed[PARSER_PROD_COUNT];
+    size_t   nodes_allocated;
+
+    size_t   sync_calls;
+    size_t   sync_skipped_tokens;
+
+    size_t   var_lookups;
+    size_t   func_lookups;
+
+    size_t   scope_enters;
+    size_t   scope_leaves;
+
+    uint64_t pass1_time_ns;
+    uint64_t parse_time_ns;
+};
+
+// Объявление верхнего уровня и место в спине OP_LCAT. Позиции отсчитаны от конца
+// предыдущего объявления, так что правка не сдвигает записи после себя
+struct parser_decl_entry_t {
+    size_t           lead;        // токенов от конца предыдущего объявления до начала этого
+    size_t           span;        // токенов от конца предыдущего объявления до конца этого
+    size_t           item_index;  // номер элемента в списке верхнего уровня
+    tree_node_t**    slot;
+    size_t           name_idx;
+    func_decl_info_t info;
+};
+
+struct parser_global_var_t {
+    size_t name_idx;
+    size_t decls_before;  // сколько объявлений стоит выше переменной
+};
+
+// Карта объявлений для инкрементального разбора
+struct parser_decl_map_t {
+    vector_t decls;        // parser_decl_entry_t в порядке исходника
+    vector_t ends;         // size_t, дерево Фенвика по span: префиксная сумма — конец объявления
+    vector_t global_vars;  // parser_global_var_t переменных верхнего уровня по порядку
+};
+
+// Правка: токены [edit_begin, old_end) старого вектора заменены на [edit_begin, new_end) нового
+struct parser_token_edit_t {
+    size_t edit_begin;
+    size_t old_end;
+    size_t new_end;
+};
+
+enum parser_reparse_result_t {
+    PARSER_REPARSE_OK,
+    PARSER_REPARSE_FULL_NEEDED, // правка вышла за границы объявлений или сменила сигнатуру — нужен полный разбор
+};
+
 size_t parser_hash_size_t(const void* key_ptr);
 bool   parser_key_cmp_size_t(const void* left_ptr, const void* right_ptr);
 
-void frontend_parse_ast(tree_t* tree, const vector_t* tokens,
-                        u_map_t* func_table, vector_t* diags_out);
+// stats (может быть nullptr) — статистика лексера, по ней заранее выделяются узлы и таблицы
+// decl_map (может быть nullptr) — заполняется для последующего frontend_reparse_ast
+parser_stats_t frontend_parse_ast(tree_t* tree, const vector_t* tokens,
+                                  u_map_t* func_table, vector_t* diags_out,
+                                  const lexer_stats_t* stats, parser_decl_map_t* decl_map);
+
+// Переразбирает только объявления, задетые правкой, и вшивает их в дерево.
+// tokens — полный вектор токенов после правки. Старый буфер исходника должен жить,
+// пока живет дерево (ident_stack ссылается на него). Смена имени, вида или числа
+// параметров объявления дает FULL_NEEDED: вызовы в остальных надо проверить заново.
+// При FULL_NEEDED дерево и func_table не тронуты — нужен полный frontend_parse_ast с нуля.
+// diags_out очищается и получает только ошибки переразобранных объявлений: прежние
+// ошибки правленого участка устарели, а ошибки остальных вызывающий хранит сам.
+parser_reparse_result_t frontend_reparse_ast(tree_t* tree, const vector_t* tokens,
+                                             u_map_t* func_table, vector_t* diags_out,
+                                             parser_decl_map_t* decl_map,
+                                             const parser_token_edit_t* edit);
+
+void parser_decl_map_init   (parser_decl_map_t* decl_map);
+void parser_decl_map_destroy(parser_decl_map_t* decl_map);
+
+void parser_stats_dump(FILE* stream, const parser_stats_t* stats);
 
 
 #endif /* PROJECT_FRONTEND_PARSER_INCLUDE_FRONTEND_PARSER_H_NCLUDED */
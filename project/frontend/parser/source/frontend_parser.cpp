@@ -8,10 +8,10 @@
 #include "error_logger/include/frontend_err_logger.h"
 #include "lexer/include/lexer_tokenizer.h"
 
-#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
 
 //================================================================================
 
@@ -21,6 +21,7 @@ struct var_info_t {
 
 struct var_record_t {
     size_t     name_idx;
+    size_t     token;      // где переменная заведена
     bool       had_prev;
     var_info_t prev_info;
 };
@@ -42,8 +43,52 @@ struct parser_state_t {
 
     op_code_t        current_decl; // OP_FUNC_DECL | OP_PROC_DECL | OP_NONE
     size_t           while_depth;
+
+    parser_decl_map_t* decl_map;   // nullptr, если карта объявлений не нужна
+    size_t           last_decl_end; // конец последнего записанного в карту объявления
+
+    vector_t         match_table;  // [i - match_base] -> индекс парной скобки или match_end
+    size_t           match_base;
+    size_t           match_end;
+    size_t           item_diags;   // ошибок в текущем объявлении/операторе верхнего уровня
+
+    ON_PARSER_STATS(
+        mutable parser_stats_t stats;
+        parser_prod_t          prod;
+    )
+};
+
+//================================================================================
+//                      Статистика (PARSER_STATS_DEBUG)
+//================================================================================
+
+#ifdef PARSER_STATS_DEBUG
+
+static size_t ast_nodes_allocated = 0;
+
+// Токены, съеденные внутри области, идут в счетчик продукции prod
+struct parser_prod_scope_t {
+    parser_state_t* parser;
+    parser_prod_t   prev_prod;
+
+    parser_prod_scope_t(parser_state_t* parser_ptr, parser_prod_t prod)
+        : parser(parser_ptr), prev_prod(parser_ptr->prod) {
+        parser->prod = prod;
+    }
+    ~parser_prod_scope_t() { parser->prod = prev_prod; }
+
+    parser_prod_scope_t(const parser_prod_scope_t&)            = delete;
+    parser_prod_scope_t& operator=(const parser_prod_scope_t&) = delete;
 };
 
+static uint64_t parser_now_ns() {
+    timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#endif
+
 static bool opcode_is_void_builtin(op_code_t opcode) {
     return opcode == OP_PRINT; 
 }
@@ -75,6 +120,7 @@ static const lexer_token_t* parser_advance(parser_state_t* parser) {
     HARD_ASSERT(parser != nullptr, "parser is nullptr");
     if (!parser_is_eof(parser)) {
         parser->position++;
+        ON_PARSER_STATS(parser->stats.tokens_consumed[parser->prod]++;)
     }
     return parser_prev(parser);
 }
@@ -109,48 +155,142 @@ static bool parser_match_keyword(parser_state_t* parser,
 
 static void parser_push_diag(parser_state_t* parser, diag_code_t diag_code,
                              const lexer_token_t* token,
-                             const char* format, ...) {
+                             uint32_t arg0, uint32_t arg1) {
     HARD_ASSERT(parser != nullptr, "parser is nullptr");
     HARD_ASSERT(parser->diags != nullptr, "parser->diags is nullptr");
-    HARD_ASSERT(format != nullptr, "format is nullptr");
 
     const lexer_token_t dummy = {};
     if (token == nullptr) token = parser_peek(parser);
     if (token == nullptr) token = &dummy;
 
-    char message_buf[MAX_ERROR_MESSAGE_LENGTH] = {};
-
-    va_list args;
-    va_start(args, format);
-    vsnprintf(message_buf, sizeof(message_buf), format, args);
-    va_end(args);
+    parser->item_diags++;
+    if (parser->item_diags > PARSER_MAX_DIAGS_PER_ITEM + 1) return;
+    if (parser->item_diags == PARSER_MAX_DIAGS_PER_ITEM + 1) {
+        diag_code = DIAG_PARSE_TOO_MANY_ERRORS;
+        arg0      = (uint32_t)PARSER_MAX_DIAGS_PER_ITEM;
+        arg1      = 0;
+    }
 
     diag_log_t diag = diag_log_init(PARSER_ERROR, diag_code,
                                    token->position, token->lexeme.len,
                                    token->line, token->column,
-                                   "%s", message_buf);
+                                   arg0, arg1);
 
     vector_push_back(parser->diags, &diag);
 }
 
-static void parser_expected(parser_state_t* parser, const char* what) {
-    parser_push_diag(parser, DIAG_PARSE_EXPECTED, nullptr,
-                     "ожидалось: %s", what);
+static void parser_expected(parser_state_t* parser, diag_expected_t what) {
+    parser_push_diag(parser, DIAG_PARSE_EXPECTED, nullptr, what, 0);
+}
+
+//================================================================================
+//                      Таблица парных скобок для восстановления
+//================================================================================
+
+static bool token_is_opener(const lexer_token_t* token) {
+    return token->kind == LEX_TK_LPAREN ||
+           (token->kind == LEX_TK_KEYWORD && token->op_code == OP_VIS_START);
+}
+
+// Один проход с общим стеком '{' и '(': для каждой открывающей в [begin, end) — индекс
+// парной закрывающей. Закрывающая снимает со стека ближайшую открывающую своего вида,
+// а оставшиеся над ней чужие считаются незакрытыми: в "( { ) }" ')' закрывает '(',
+// '{' остается без пары, и группы не пересекаются. Незакрытые получают end.
+// false — есть незакрытые или лишние закрывающие.
+static bool parser_build_match_table(parser_state_t* parser, size_t begin, size_t end) {
+    HARD_ASSERT(parser != nullptr, "parser is nullptr");
+    HARD_ASSERT(begin <= end, "bad token range");
+
+    parser->match_base = begin;
+    parser->match_end  = end;
+    vector_clear(&parser->match_table);
+    vector_reserve(&parser->match_table, end - begin);
+
+    vector_t open_stack = {};
+    SIMPLE_VECTOR_INIT(&open_stack, 32, size_t);
+
+    bool balanced = true;
+    for (size_t index = begin; index < end; ++index) {
+        vector_push_back(&parser->match_table, &end);
+
+        const lexer_token_t* token = parser_token_at(parser, index);
+        if (token_is_opener(token)) {
+            vector_push_back(&open_stack, &index);
+            continue;
+        }
+        if (token->kind != LEX_TK_RBRACE && token->kind != LEX_TK_RPAREN) continue;
+
+        lexer_token_kind_t open_kind = (token->kind == LEX_TK_RPAREN) ? LEX_TK_LPAREN : LEX_TK_KEYWORD;
+        size_t depth = vector_size(&open_stack);
+        while (depth > 0) {
+            size_t open_index = *(const size_t*)vector_get_const(&open_stack, depth - 1);
+            if (parser_token_at(parser, open_index)->kind == open_kind) break;
+            depth--;
+        }
+        if (depth == 0) {
+            balanced = false;
+            continue;
+        }
+        if (depth != vector_size(&open_stack)) balanced = false;
+
+        size_t open_index = 0;
+        while (vector_size(&open_stack) >= depth) vector_pop_back(&open_stack, &open_index);
+        *(size_t*)vector_get(&parser->match_table, open_index - begin) = index;
+    }
+
+    if (vector_size(&open_stack) != 0) balanced = false;
+
+    vector_destroy(&open_stack);
+    return balanced;
+}
+
+static size_t parser_match_of(const parser_state_t* parser, size_t index) {
+    if (index < parser->match_base || index >= parser->match_end) return parser->match_end;
+    return *(const size_t*)vector_get_const(&parser->match_table, index - parser->match_base);
+}
+
+static void parser_jump_to(parser_state_t* parser, size_t index) {
+    HARD_ASSERT(index >= parser->position, "jump backwards");
+    ON_PARSER_STATS(parser->stats.tokens_consumed[parser->prod] += index - parser->position;)
+    parser->position = index;
+}
+
+// Перепрыгивает группу, начатую текущей '{' / '(', вместе с закрывающей.
+// false — группа не закрыта (позиция не меняется).
+static bool parser_jump_over_group(parser_state_t* parser) {
+    size_t close_index = parser_match_of(parser, parser->position);
+    if (close_index >= parser->match_end) return false;
+
+    parser_jump_to(parser, close_index + 1);
+    return true;
 }
 
 static void parser_sync_to_lcat(parser_state_t* parser) {
+    ON_PARSER_STATS(
+        parser_prod_scope_t prod_scope(parser, PARSER_PROD_RECOVERY);
+        size_t start_pos = parser->position;
+    )
+
     while (!parser_is_eof(parser)) {
+        const lexer_token_t* token = parser_peek(parser);
+        if (token_is_opener(token) && parser_jump_over_group(parser)) continue;
+
         if (parser_check_kind(parser, LEX_TK_RBRACE)) { //TODO: change to proper sync
             parser_advance(parser);
-            return;
+            break;
         }
 
         if (parser_check_keyword(parser, OP_LCAT)) {
             parser_advance(parser);
-            return;
+            break;
         }
         parser_advance(parser);
     }
+
+    ON_PARSER_STATS(
+        parser->stats.sync_calls++;
+        parser->stats.sync_skipped_tokens += parser->position - start_pos;
+    )
 }
 
 //================================================================================
@@ -168,10 +308,11 @@ bool parser_key_cmp_size_t(const void* left_ptr, const void* right_ptr) {
     return (*(const size_t*)left_ptr) == (*(const size_t*)right_ptr);
 }
 
-static bool func_table_get(const u_map_t* func_table,
+static bool func_table_get(const parser_state_t* parser,
                            size_t name_idx,
                            func_decl_info_t* info_out) {
-    return u_map_get_elem(func_table, &name_idx, info_out);
+    ON_PARSER_STATS(parser->stats.func_lookups++;)
+    return u_map_get_elem(parser->func_table, &name_idx, info_out);
 }
 
 static void func_table_put(u_map_t* func_table,
@@ -187,16 +328,19 @@ static void func_table_put(u_map_t* func_table,
 static tree_node_t* ast_func(op_code_t op_code,
                              tree_node_t* left_node,
                              tree_node_t* right_node) {
+    ON_PARSER_STATS(ast_nodes_allocated++;)
     value_t value = make_union_func(op_code);
     return init_node(FUNCTION, value, left_node, right_node);
 }
 
 static tree_node_t* ast_const(double value) {
+    ON_PARSER_STATS(ast_nodes_allocated++;)
     value_t node_val = make_union_const(value);
     return init_node(CONSTANT, node_val, nullptr, nullptr);
 }
 
 static tree_node_t* ast_var(size_t ident_idx) {
+    ON_PARSER_STATS(ast_nodes_allocated++;)
     value_t node_val = make_union_var(ident_idx);
     return init_node(IDENT, node_val, nullptr, nullptr);
 }
@@ -220,7 +364,7 @@ static tree_node_t* parse_toplevel(parser_state_t* parser);
 static tree_node_t* parse_decl(parser_state_t* parser);
 static tree_node_t* parse_block(parser_state_t* parser);
 
-static tree_node_t* parse_stmt_list(parser_state_t* parser);
+static tree_node_t* parse_stmt_list(parser_state_t* parser, size_t block_end);
 static tree_node_t* parse_stmt(parser_state_t* parser);
 
 static tree_node_t* parse_assign(parser_state_t* parser);
@@ -264,33 +408,15 @@ static size_t parse_ident_idx(parser_state_t* parser,
 //================================================================================
 
 static void pass1_skip_block(parser_state_t* parser) {
-    size_t brace_depth = 0;
-
-    if (parser_match_keyword(parser, OP_VIS_START)) {
-        brace_depth = 1;
-    } else {
-        parser_expected(parser, "'{'");
+    if (!parser_check_keyword(parser, OP_VIS_START)) {
+        parser_expected(parser, DIAG_EXP_LBRACE);
         parser_sync_to_lcat(parser);
         return;
     }
 
-    while (!parser_is_eof(parser) && brace_depth > 0) {
-        if (parser_check_keyword(parser, OP_VIS_START)) {
-            parser_advance(parser);
-            brace_depth++;
-            continue;
-        }
-        if (parser_check_kind(parser, LEX_TK_RBRACE)) {
-            parser_advance(parser);
-            brace_depth--;
-            continue;
-        }
-        parser_advance(parser);
-    }
-
-    if (brace_depth != 0) {
-        parser_push_diag(parser, DIAG_PARSE_EXPECTED, nullptr,
-                         "ожидалось: '}' (не закрыт блок)");
+    if (!parser_jump_over_group(parser)) {
+        parser_jump_to(parser, parser->match_end);
+        parser_push_diag(parser, DIAG_PARSE_UNCLOSED_BLOCK, nullptr, 0, 0);
     }
 }
 
@@ -298,7 +424,7 @@ static size_t pass1_count_params(parser_state_t* parser) {
     size_t argc = 0;
 
     if (!parser_match_kind(parser, LEX_TK_LPAREN)) {
-        parser_expected(parser, "'('");
+        parser_expected(parser, DIAG_EXP_LPAREN);
         return 0;
     }
 
@@ -308,7 +434,7 @@ static size_t pass1_count_params(parser_state_t* parser) {
 
     while (!parser_is_eof(parser)) {
         if (!parser_check_kind(parser, LEX_TK_IDENT)) {
-            parser_expected(parser, "идентификатор параметра");
+            parser_expected(parser, DIAG_EXP_PARAM_IDENT);
             parser_sync_to_lcat(parser);
             break;
         }
@@ -320,7 +446,7 @@ static size_t pass1_count_params(parser_state_t* parser) {
         if (parser_match_keyword(parser, OP_ENUM_SEP)) continue;
         if (parser_match_kind(parser, LEX_TK_RPAREN)) break;
 
-        parser_expected(parser, "')' или ','");
+        parser_expected(parser, DIAG_EXP_RPAREN_OR_COMMA);
         parser_sync_to_lcat(parser);
         break;
     }
@@ -328,13 +454,20 @@ static size_t pass1_count_params(parser_state_t* parser) {
     return argc;
 }
 
-static void pass1_collect_one(parser_state_t* parser, op_code_t decl_opcode) {
+// Читает сигнатуру объявления и пропускает его тело. false — нет имени.
+static bool pass1_scan_decl(parser_state_t* parser, op_code_t decl_opcode,
+                            const lexer_token_t** name_tok_out,
+                            size_t* name_idx_out, func_decl_info_t* info_out) {
+    HARD_ASSERT(name_tok_out != nullptr, "name_tok_out is nullptr");
+    HARD_ASSERT(name_idx_out != nullptr, "name_idx_out is nullptr");
+    HARD_ASSERT(info_out     != nullptr, "info_out is nullptr");
+
     parser_advance(parser); // func/proc
 
     if (!parser_check_kind(parser, LEX_TK_IDENT)) {
-        parser_expected(parser, "имя функции/процедуры");
+        parser_expected(parser, DIAG_EXP_DECL_NAME);
         parser_sync_to_lcat(parser);
-        return;
+        return false;
     }
 
     const lexer_token_t* name_tok = parser_advance(parser);
@@ -345,23 +478,38 @@ static void pass1_collect_one(parser_state_t* parser, op_code_t decl_opcode) {
                    (int)name_tok->lexeme.len, name_tok->lexeme.ptr);
     size_t argc = pass1_count_params(parser);
 
-    func_decl_info_t exists = {};
-    if (func_table_get(parser->func_table, name_idx, &exists)) {
-        parser_push_diag(parser, DIAG_PARSE_REDEF_FUNCTION, name_tok,
-                         "переопределение функции/процедуры");
-    } else {
-        func_decl_info_t info = {decl_opcode, argc};
-        func_table_put(parser->func_table, name_idx, &info);
-    }
-
     pass1_skip_block(parser);
 
     if (parser_check_keyword(parser, OP_LCAT)) {
         parser_advance(parser);
     }
+
+    *name_tok_out = name_tok;
+    *name_idx_out = name_idx;
+    *info_out     = {decl_opcode, argc};
+    return true;
+}
+
+static void pass1_collect_one(parser_state_t* parser, op_code_t decl_opcode) {
+    parser->item_diags = 0;
+
+    const lexer_token_t* name_tok = nullptr;
+    size_t               name_idx = 0;
+    func_decl_info_t     info     = {};
+    if (!pass1_scan_decl(parser, decl_opcode, &name_tok, &name_idx, &info)) return;
+
+    func_decl_info_t exists = {};
+    if (func_table_get(parser, name_idx, &exists)) {
+        parser_push_diag(parser, DIAG_PARSE_REDEF_FUNCTION, name_tok,
+                         (uint32_t)name_idx, 0);
+    } else {
+        func_table_put(parser->func_table, name_idx, &info);
+    }
 }
 
 static void parser_pass1_collect(parser_state_t* parser) {
+    ON_PARSER_STATS(parser_prod_scope_t prod_scope(parser, PARSER_PROD_PASS1);)
+
     while (!parser_is_eof(parser)) {
         if (parser_check_keyword(parser, OP_FUNC_DECL)) {
             pass1_collect_one(parser, OP_FUNC_DECL);
@@ -386,7 +534,7 @@ static bool parser_consume_stmt_end(parser_state_t* parser,
     HARD_ASSERT(trailing_out != nullptr, "trailing_out is nullptr");
 
     if (!parser_match_keyword(parser, OP_LCAT)) {
-        parser_expected(parser, "';'");
+        parser_expected(parser, DIAG_EXP_SEMICOLON);
         parser_sync_to_lcat(parser);
         *trailing_out = false;
         return false;
@@ -406,8 +554,14 @@ static void parser_consume_optional_lcat(parser_state_t* parser) {
     if (parser_check_keyword(parser, OP_LCAT)) parser_advance(parser);
 }
 
+static void parser_decl_map_record(parser_state_t* parser, const tree_node_t* decl_node,
+                                   size_t token_begin, size_t item_index);
+
 static tree_node_t* parse_toplevel(parser_state_t* parser) {
-    tree_node_t* list_root = nullptr;
+    ON_PARSER_STATS(parser_prod_scope_t prod_scope(parser, PARSER_PROD_TOPLEVEL);)
+
+    tree_node_t* list_root   = nullptr;
+    size_t       items_count = 0;
 
     while (!parser_is_eof(parser)) {
         if (parser_match_keyword(parser, OP_LCAT)) {
@@ -419,8 +573,8 @@ static tree_node_t* parse_toplevel(parser_state_t* parser) {
             parser_check_keyword(parser, OP_BREAK)  ||
             parser_check_keyword(parser, OP_CONTINUE)) {
 
-            parser_push_diag(parser, DIAG_PARSE_EXPECTED, parser_peek(parser),
-                             "оператор запрещен на глобальном уровне");
+            parser_push_diag(parser, DIAG_PARSE_TOPLEVEL_STMT, parser_peek(parser),
+                             parser_peek(parser)->op_code, 0);
             parser_sync_to_lcat(parser);
             parser_consume_optional_lcat(parser);
             continue;
@@ -429,6 +583,8 @@ static tree_node_t* parse_toplevel(parser_state_t* parser) {
         bool is_decl = parser_check_keyword(parser, OP_FUNC_DECL) ||
                        parser_check_keyword(parser, OP_PROC_DECL);
 
+        size_t       item_begin = parser->position;
+        parser->item_diags      = 0;
         tree_node_t* item_node = is_decl ? parse_decl(parser)
                                          : parse_stmt(parser);
 
@@ -446,6 +602,11 @@ static tree_node_t* parse_toplevel(parser_state_t* parser) {
         }
 
         list_root = ast_make_list(OP_LCAT, list_root, item_node);
+
+        if (is_decl && parser->decl_map != nullptr) {
+            parser_decl_map_record(parser, item_node, item_begin, items_count);
+        }
+        items_count++;
     }
 
     return ast_unary(OP_VIS_START, list_root);
@@ -462,7 +623,7 @@ static tree_node_t* parse_param_list(parser_state_t* parser,
     *argc_out = 0;
 
     if (!parser_match_kind(parser, LEX_TK_LPAREN)) {
-        parser_expected(parser, "'('");
+        parser_expected(parser, DIAG_EXP_LPAREN);
         return nullptr;
     }
 
@@ -474,7 +635,7 @@ static tree_node_t* parse_param_list(parser_state_t* parser,
 
     while (!parser_is_eof(parser)) {
         if (!parser_check_kind(parser, LEX_TK_IDENT)) {
-            parser_expected(parser, "идентификатор параметра");
+            parser_expected(parser, DIAG_EXP_PARAM_IDENT);
             break;
         }
 
@@ -490,7 +651,7 @@ static tree_node_t* parse_param_list(parser_state_t* parser,
         if (parser_match_keyword(parser, OP_ENUM_SEP)) continue;
         if (parser_match_kind(parser, LEX_TK_RPAREN)) break;
 
-        parser_expected(parser, "')' или ','");
+        parser_expected(parser, DIAG_EXP_RPAREN_OR_COMMA);
         break;
     }
 
@@ -502,6 +663,8 @@ static tree_node_t* parse_param_list(parser_state_t* parser,
 }
 
 static tree_node_t* parse_decl(parser_state_t* parser) {
+    ON_PARSER_STATS(parser_prod_scope_t prod_scope(parser, PARSER_PROD_DECL);)
+
     op_code_t decl_opcode = OP_NONE;
 
     if (parser_match_keyword(parser, OP_FUNC_DECL)) decl_opcode = OP_FUNC_DECL;
@@ -509,7 +672,7 @@ static tree_node_t* parse_decl(parser_state_t* parser) {
     else return nullptr;
 
     if (!parser_check_kind(parser, LEX_TK_IDENT)) {
-        parser_expected(parser, "имя функции/процедуры");
+        parser_expected(parser, DIAG_EXP_DECL_NAME);
         return nullptr;
     }
 
@@ -517,15 +680,15 @@ static tree_node_t* parse_decl(parser_state_t* parser) {
     size_t name_idx = parse_ident_idx(parser, name_tok);
 
     func_decl_info_t decl_info = {};
-    if (!func_table_get(parser->func_table, name_idx, &decl_info)) {
-        parser_push_diag(parser, DIAG_PARSE_UNDEF_FUNCTION, name_tok,
-                         "объявление не найдено в таблице 1-го прохода");
+    if (!func_table_get(parser, name_idx, &decl_info)) {
+        parser_push_diag(parser, DIAG_PARSE_DECL_NOT_COLLECTED, name_tok,
+                         (uint32_t)name_idx, 0);
     }
 
     if (decl_info.decl_opcode != OP_NONE &&
         decl_info.decl_opcode != decl_opcode) {
-        parser_push_diag(parser, DIAG_PARSE_EXPECTED, name_tok,
-                         "несовпадение вида (func/proc) с 1-м проходом");
+        parser_push_diag(parser, DIAG_PARSE_DECL_KIND_MISMATCH, name_tok,
+                         decl_info.decl_opcode, 0);
     }
 
     vector_clear(&parser->pending_params);          
@@ -534,8 +697,8 @@ static tree_node_t* parse_decl(parser_state_t* parser) {
     tree_node_t* args_node = parse_param_list(parser, &argc);
 
     if (decl_info.decl_opcode != OP_NONE && decl_info.argc != argc) {
-        parser_push_diag(parser, DIAG_PARSE_EXPECTED, name_tok,
-                         "несовпадение числа параметров с 1-м проходом");
+        parser_push_diag(parser, DIAG_PARSE_DECL_ARGC_MISMATCH, name_tok,
+                         (uint32_t)decl_info.argc, (uint32_t)argc);
     }
 
     tree_node_t* name_node = ast_var(name_idx);
@@ -559,6 +722,8 @@ static tree_node_t* parse_decl(parser_state_t* parser) {
 }
 
 static void parser_skip_failed_decl(parser_state_t* parser) {
+    ON_PARSER_STATS(parser_prod_scope_t prod_scope(parser, PARSER_PROD_RECOVERY);)
+
     parser_advance(parser);
 
     while (!parser_is_eof(parser)) {
@@ -602,17 +767,20 @@ static bool stmt_is_block_like(const tree_node_t* node) {
 }
 
 static tree_node_t* parse_block(parser_state_t* parser) {
+    ON_PARSER_STATS(parser_prod_scope_t prod_scope(parser, PARSER_PROD_BLOCK);)
+
+    size_t block_end = parser_match_of(parser, parser->position);
     if (!parser_match_keyword(parser, OP_VIS_START)) {
-        parser_expected(parser, "'{'");
+        parser_expected(parser, DIAG_EXP_LBRACE);
         return nullptr;
     }
 
     parser_scope_enter(parser);
 
-    tree_node_t* list_node = parse_stmt_list(parser);
+    tree_node_t* list_node = parse_stmt_list(parser, block_end);
 
     if (!parser_match_kind(parser, LEX_TK_RBRACE)) {
-        parser_expected(parser, "'}'");
+        parser_expected(parser, DIAG_EXP_RBRACE);
         parser_sync_to_lcat(parser);
     }
 
@@ -620,12 +788,18 @@ static tree_node_t* parse_block(parser_state_t* parser) {
     return ast_unary(OP_VIS_START, list_node);
 }
 
-static tree_node_t* parse_stmt_list(parser_state_t* parser) {
+// block_end — индекс '}' этого блока: при лавине ошибок остаток блока пропускается разом
+static tree_node_t* parse_stmt_list(parser_state_t* parser, size_t block_end) {
     tree_node_t* list_root = nullptr;
 
     while (!parser_is_eof(parser) &&
            !parser_check_kind(parser, LEX_TK_RBRACE)) {
 
+        if (parser->item_diags > PARSER_MAX_DIAGS_PER_ITEM) {
+            if (block_end > parser->position) parser_jump_to(parser, block_end);
+            break;
+        }
+
         if (parser_match_keyword(parser, OP_LCAT)) {
             continue; // пустой оператор
         }
@@ -657,24 +831,11 @@ static tree_node_t* parse_stmt_list(parser_state_t* parser) {
 }
 
 static void parser_skip_block(parser_state_t* parser) {
-    if (!parser_match_keyword(parser, OP_VIS_START)) return;
+    ON_PARSER_STATS(parser_prod_scope_t prod_scope(parser, PARSER_PROD_RECOVERY);)
 
-    size_t depth = 1;
-    while (!parser_is_eof(parser) && depth > 0) {
-        if (parser_check_keyword(parser, OP_VIS_START)) {
-            parser_advance(parser);
-            depth++;
-            continue;
-        }
+    if (!parser_check_keyword(parser, OP_VIS_START)) return;
 
-        if (parser_check_kind(parser, LEX_TK_RBRACE)) {
-            parser_advance(parser);
-            depth--;
-            continue;
-        }
-
-        parser_advance(parser);
-    }
+    if (!parser_jump_over_group(parser)) parser_jump_to(parser, parser->match_end);
 }
 
 
@@ -689,7 +850,7 @@ static tree_node_t* parse_if(parser_state_t* parser) {
     tree_node_t* cond_node = parse_assign(parser);
 
     if (has_paren && !parser_match_kind(parser, LEX_TK_RPAREN)) {
-        parser_expected(parser, "')'");
+        parser_expected(parser, DIAG_EXP_RPAREN);
         parser_sync_to_lcat(parser);
     }
 
@@ -707,7 +868,7 @@ static tree_node_t* parse_while(parser_state_t* parser) {
     tree_node_t* cond_node = parse_assign(parser);
 
     if (has_paren && !parser_match_kind(parser, LEX_TK_RPAREN)) {
-        parser_expected(parser, "')'");
+        parser_expected(parser, DIAG_EXP_RPAREN);
         parser_sync_to_lcat(parser);
     }
 
@@ -738,11 +899,12 @@ static tree_node_t* parse_stmt_expr(parser_state_t* parser) {
 }
 
 static tree_node_t* parse_stmt(parser_state_t* parser) {
+    ON_PARSER_STATS(parser_prod_scope_t prod_scope(parser, PARSER_PROD_STMT);)
+
     if (parser_check_keyword(parser, OP_FUNC_DECL) ||
         parser_check_keyword(parser, OP_PROC_DECL)) {
 
-        parser_push_diag(parser, DIAG_PARSE_NESTED_DECL, parser_peek(parser),
-                        "объявления func/proc запрещены внутри тела");
+        parser_push_diag(parser, DIAG_PARSE_NESTED_DECL, parser_peek(parser), 0, 0);
         parser_skip_failed_decl(parser);
         return nullptr;
     }
@@ -752,7 +914,7 @@ static tree_node_t* parse_stmt(parser_state_t* parser) {
     if (parser_match_keyword(parser, OP_BREAK)) {
         if (parser->while_depth == 0) {
             parser_push_diag(parser, DIAG_PARSE_BREAK_OUTSIDE, parser_prev(parser),
-                             "break вне while");
+                             OP_BREAK, 0);
         }
         return ast_unary(OP_BREAK, nullptr);
     }
@@ -760,19 +922,18 @@ static tree_node_t* parse_stmt(parser_state_t* parser) {
     if (parser_match_keyword(parser, OP_CONTINUE)) {
         if (parser->while_depth == 0) {
             parser_push_diag(parser, DIAG_PARSE_BREAK_OUTSIDE, parser_prev(parser),
-                             "continue вне while");
+                             OP_CONTINUE, 0);
         }
         return ast_unary(OP_CONTINUE, nullptr);
     }
 
     if (parser_match_keyword(parser, OP_FINISH)) {
         if (parser->current_decl == OP_FUNC_DECL) {
-            parser_push_diag(parser, DIAG_PARSE_FINISH_IN_FUNC, parser_prev(parser),
-                             "finish запрещен в func");
+            parser_push_diag(parser, DIAG_PARSE_FINISH_IN_FUNC, parser_prev(parser), 0, 0);
         }
         if (parser->current_decl == OP_NONE) {
             parser_push_diag(parser, DIAG_PARSE_TOPLEVEL_STMT, parser_prev(parser),
-                            "оператор запрещен на глобальном уровне");
+                             parser_prev(parser)->op_code, 0);
         }
 
         return ast_unary(OP_FINISH, nullptr);
@@ -780,18 +941,17 @@ static tree_node_t* parse_stmt(parser_state_t* parser) {
 
     if (parser_match_keyword(parser, OP_RETURN)) {
         if (parser->current_decl == OP_PROC_DECL) {
-            parser_push_diag(parser, DIAG_PARSE_RETURN_IN_PROC, parser_prev(parser),
-                             "return запрещен в proc");
+            parser_push_diag(parser, DIAG_PARSE_RETURN_IN_PROC, parser_prev(parser), 0, 0);
         }
         if (parser->current_decl == OP_NONE) {
             parser_push_diag(parser, DIAG_PARSE_TOPLEVEL_STMT, parser_prev(parser),
-                            "оператор запрещен на глобальном уровне");
+                             parser_prev(parser)->op_code, 0);
         }
 
         if (parser_check_keyword(parser, OP_LCAT) ||
             parser_check_kind(parser, LEX_TK_RBRACE) ||
             parser_is_eof(parser)) {
-            parser_expected(parser, "выражение после return");
+            parser_expected(parser, DIAG_EXP_RETURN_EXPR);
             return ast_unary(OP_RETURN, nullptr);
         }
 
@@ -811,6 +971,7 @@ static tree_node_t* parse_stmt(parser_state_t* parser) {
 static bool parser_var_lookup(const parser_state_t* parser,
                               size_t name_idx,
                               var_info_t* info_out) {
+    ON_PARSER_STATS(parser->stats.var_lookups++;)
     return u_map_get_elem(parser->var_table, &name_idx, info_out);
 }
 
@@ -825,6 +986,7 @@ static void parser_var_define(parser_state_t* parser,
 
     var_record_t record = {};
     record.name_idx = name_idx;
+    record.token    = parser->position;
     record.had_prev = found;
     if (found) record.prev_info = existing;
 
@@ -836,6 +998,7 @@ static void parser_var_define(parser_state_t* parser,
 }
 
 static void parser_scope_enter(parser_state_t* parser) {
+    ON_PARSER_STATS(parser->stats.scope_enters++;)
     size_t marker = vector_size(&parser->var_records);
     vector_push_back(&parser->scope_markers, &marker);
 
@@ -854,6 +1017,7 @@ static void parser_scope_enter(parser_state_t* parser) {
 }
 
 static void parser_scope_leave(parser_state_t* parser) {
+    ON_PARSER_STATS(parser->stats.scope_leaves++;)
     size_t marker = 0;
     vector_pop_back(&parser->scope_markers, &marker);
 
@@ -890,6 +1054,8 @@ static bool parser_is_lvalue_assign(const parser_state_t* parser) {
 }
 
 static tree_node_t* parse_assign(parser_state_t* parser) {
+    ON_PARSER_STATS(parser_prod_scope_t prod_scope(parser, PARSER_PROD_EXPR);)
+
     if (parser_is_lvalue_assign(parser)) {
         const lexer_token_t* name_tok = parser_advance(parser);
         size_t name_idx = parse_ident_idx(parser, name_tok);
@@ -909,8 +1075,7 @@ static tree_node_t* parse_assign(parser_state_t* parser) {
         return left_node;
     }
 
-    parser_push_diag(parser, DIAG_PARSE_EXPECTED, parser_prev(parser),
-                     "слева от '=' должна быть переменная");
+    parser_push_diag(parser, DIAG_PARSE_ASSIGN_TO_RVALUE, parser_prev(parser), 0, 0);
 
     tree_node_t* right_node = parse_assign(parser);
     return ast_func(OP_ASSIGN, left_node, right_node);
@@ -1072,7 +1237,7 @@ static tree_node_t* parse_primary(parser_state_t* parser) {
         var_info_t info = {};
         if (!parser_var_lookup(parser, name_idx, &info)) {
             parser_push_diag(parser, DIAG_PARSE_UNDEF_IDENT, token,
-                            "неизвестная переменная");
+                             (uint32_t)name_idx, 0);
         }
 
     return ast_var(name_idx);
@@ -1082,13 +1247,13 @@ static tree_node_t* parse_primary(parser_state_t* parser) {
     if (parser_match_kind(parser, LEX_TK_LPAREN)) {
         tree_node_t* node = parse_assign(parser);
         if (!parser_match_kind(parser, LEX_TK_RPAREN)) {
-            parser_expected(parser, "')'");
+            parser_expected(parser, DIAG_EXP_RPAREN);
             parser_sync_to_lcat(parser);
         }
         return node;
     }
 
-    parser_expected(parser, "выражение");
+    parser_expected(parser, DIAG_EXP_EXPR);
     return nullptr;
 }
 
@@ -1102,7 +1267,7 @@ static tree_node_t* parse_call_args(parser_state_t* parser,
     *argc_out = 0;
 
     if (!parser_match_kind(parser, LEX_TK_LPAREN)) {
-        parser_expected(parser, "'('");
+        parser_expected(parser, DIAG_EXP_LPAREN);
         return nullptr;
     }
 
@@ -1120,7 +1285,7 @@ static tree_node_t* parse_call_args(parser_state_t* parser,
         if (parser_match_keyword(parser, OP_ENUM_SEP)) continue;
         if (parser_match_kind(parser, LEX_TK_RPAREN)) break;
 
-        parser_expected(parser, "')' или ','");
+        parser_expected(parser, DIAG_EXP_RPAREN_OR_COMMA);
         parser_sync_to_lcat(parser);
         break;
     }
@@ -1130,10 +1295,12 @@ static tree_node_t* parse_call_args(parser_state_t* parser,
 
 static tree_node_t* parse_call(parser_state_t* parser,
                                bool value_context) {
+    ON_PARSER_STATS(parser_prod_scope_t prod_scope(parser, PARSER_PROD_CALL);)
+
     parser_advance(parser); // CALL
 
     if (!parser_check_kind(parser, LEX_TK_IDENT)) {
-        parser_expected(parser, "имя вызываемой функции/процедуры");
+        parser_expected(parser, DIAG_EXP_CALL_NAME);
         return nullptr;
     }
 
@@ -1141,10 +1308,10 @@ static tree_node_t* parse_call(parser_state_t* parser,
     size_t name_idx = parse_ident_idx(parser, name_tok);
 
     func_decl_info_t decl_info = {};
-    bool known = func_table_get(parser->func_table, name_idx, &decl_info);
+    bool known = func_table_get(parser, name_idx, &decl_info);
     if (!known) {
         parser_push_diag(parser, DIAG_PARSE_UNDEF_FUNCTION, name_tok,
-                         "вызов неизвестной функции/процедуры");
+                         (uint32_t)name_idx, 0);
     }
 
     size_t argc = 0;
@@ -1152,14 +1319,12 @@ static tree_node_t* parse_call(parser_state_t* parser,
 
     if (known && decl_info.argc != argc) {
         parser_push_diag(parser, DIAG_PARSE_ARGC_MISMATCH, name_tok,
-                         "несовпадение числа аргументов (ожидалось %zu, получено %zu)",
-                         decl_info.argc, argc);
+                         (uint32_t)decl_info.argc, (uint32_t)argc);
     }
 
     bool is_proc = known && decl_info.decl_opcode == OP_PROC_DECL;
     if (is_proc && value_context) {
-        parser_push_diag(parser, DIAG_PARSE_VOID_IN_EXPR, name_tok,
-                         "proc нельзя использовать как выражение");
+        parser_push_diag(parser, DIAG_PARSE_VOID_IN_EXPR, name_tok, OP_CALL, 0);
     }
 
     tree_node_t* name_node = ast_var(name_idx);
@@ -1177,6 +1342,8 @@ static bool parser_is_direct_call(const parser_state_t* parser) {
 }
 
 static tree_node_t* parse_direct_call(parser_state_t* parser, bool value_context) {
+    ON_PARSER_STATS(parser_prod_scope_t prod_scope(parser, PARSER_PROD_CALL);)
+
     const lexer_token_t* name_tok = parser_advance(parser);
     size_t name_idx = parse_ident_idx(parser, name_tok);
 
@@ -1184,21 +1351,19 @@ static tree_node_t* parse_direct_call(parser_state_t* parser, bool value_context
     tree_node_t* args_node = parse_call_args(parser, &argc); 
 
     func_decl_info_t decl_info = {};
-    bool known = func_table_get(parser->func_table, name_idx, &decl_info);
+    bool known = func_table_get(parser, name_idx, &decl_info);
 
     if (!known) {
         parser_push_diag(parser, DIAG_PARSE_UNDEF_FUNCTION, name_tok,
-                         "вызов неизвестной функции/процедуры");
+                         (uint32_t)name_idx, 0);
     } else {
         if (decl_info.argc != argc) {
             parser_push_diag(parser, DIAG_PARSE_ARGC_MISMATCH, name_tok,
-                             "несовпадение числа аргументов (ожидалось %zu, получено %zu)",
-                             decl_info.argc, argc);
+                             (uint32_t)decl_info.argc, (uint32_t)argc);
         }
 
         if (decl_info.decl_opcode == OP_PROC_DECL && value_context) {
-            parser_push_diag(parser, DIAG_PARSE_VOID_IN_EXPR, name_tok,
-                             "proc нельзя использовать как выражение");
+            parser_push_diag(parser, DIAG_PARSE_VOID_IN_EXPR, name_tok, OP_CALL, 0);
         }
     }
 
@@ -1208,6 +1373,8 @@ static tree_node_t* parse_direct_call(parser_state_t* parser, bool value_context
 }
 
 static tree_node_t* parse_keyword_func_call(parser_state_t* parser, bool value_ctx) {
+    ON_PARSER_STATS(parser_prod_scope_t prod_scope(parser, PARSER_PROD_CALL);)
+
     const lexer_token_t* token = parser_advance(parser);
     op_code_t op_code = token->op_code;
 
@@ -1216,49 +1383,294 @@ static tree_node_t* parse_keyword_func_call(parser_state_t* parser, bool value_c
     if (args_node == nullptr) return nullptr;
 
     if (value_ctx && opcode_is_void_builtin(op_code)) {
-        parser_push_diag(parser, DIAG_PARSE_VOID_IN_EXPR, token,
-                         "нельзя использовать как выражение");
+        parser_push_diag(parser, DIAG_PARSE_VOID_IN_EXPR, token, op_code, 0);
+    }
+
+    // pow(a, b) и log(a, b) хранятся как обычные бинарные операции:
+    // так их сворачивает midend и считает backend
+    if ((op_code == OP_POW || op_code == OP_LOG) && argc == 2 &&
+        args_node->type == FUNCTION && args_node->value.func == OP_ENUM_SEP) {
+        tree_node_t* binary_node = ast_func(op_code, args_node->left, args_node->right);
+        free_node(args_node);
+        return binary_node;
     }
 
     return ast_func(op_code, args_node, nullptr);
 }
 
 
+// Верхняя оценка числа узлов: лист на каждый операнд/ключевое слово,
+// пара служебных узлов (LCAT/ENUM_SEP/FUNC_INFO) на скобку, EQ + константа на if.
+static size_t parser_estimate_nodes(const lexer_stats_t* stats) {
+    HARD_ASSERT(stats != nullptr, "stats is nullptr");
+
+    return stats->kind_count[LEX_TK_NUMBER]
+         + stats->kind_count[LEX_TK_IDENT]
+         + stats->kind_count[LEX_TK_KEYWORD]
+         + 2 * stats->kind_count[LEX_TK_LPAREN]
+         + 2 * stats->keyword_count[OP_IF]
+         + 1;
+}
+
+static void parser_reserve_from_stats(parser_state_t* parser, const lexer_stats_t* stats) {
+    HARD_ASSERT(parser != nullptr, "parser is nullptr");
+    HARD_ASSERT(stats  != nullptr, "stats is nullptr");
+
+    size_t idents_count = stats->kind_count[LEX_TK_IDENT];
+    size_t decls_count  = stats->keyword_count[OP_FUNC_DECL] + stats->keyword_count[OP_PROC_DECL];
+
+    if (tree_nodes_reserve(parser_estimate_nodes(stats)) != ERROR_NO) {
+        LOGGER_WARNING("parser_reserve_from_stats: node reserve failed, fallback to calloc");
+    }
+
+    // Без запаса таблицы и векторы просто растут по ходу разбора
+    bool reserved = true;
+    reserved &= u_map_reserve (parser->var_table,      idents_count)               == HM_ERR_OK;
+    reserved &= u_map_reserve (parser->func_table,     decls_count)                == HM_ERR_OK;
+    reserved &= vector_reserve(&parser->var_records,   idents_count)               == VEC_ERR_OK;
+    reserved &= vector_reserve(&parser->scope_markers, stats->max_brace_depth + 1) == VEC_ERR_OK;
+    if (!reserved) {
+        LOGGER_WARNING("parser_reserve_from_stats: table reserve failed, fallback to growth");
+    }
+
+    LOGGER_DEBUG("parser_reserve_from_stats: nodes=%zu idents=%zu decls=%zu depth=%zu",
+                 parser_estimate_nodes(stats), idents_count, decls_count, stats->max_brace_depth);
+}
+
+//================================================================================
+//                      Инкрементальный разбор: карта объявлений
+//================================================================================
+
+static void decl_node_signature(const tree_node_t* decl_node,
+                                size_t* name_idx_out, func_decl_info_t* info_out) {
+    HARD_ASSERT(decl_node          != nullptr, "decl_node is nullptr");
+    HARD_ASSERT(decl_node->left    != nullptr, "decl info is nullptr");
+    HARD_ASSERT(name_idx_out       != nullptr, "name_idx_out is nullptr");
+    HARD_ASSERT(info_out           != nullptr, "info_out is nullptr");
+
+    const tree_node_t* info_node = decl_node->left;
+    *name_idx_out = info_node->right->value.ident_idx;
+
+    size_t argc = 0;
+    const tree_node_t* args_node = info_node->left;
+    while (args_node != nullptr && args_node->type == FUNCTION &&
+           args_node->value.func == OP_ENUM_SEP) {
+        argc++;
+        args_node = args_node->left;
+    }
+    if (args_node != nullptr) argc++;
+
+    *info_out = {decl_node->value.func, argc};
+}
+
+static void parser_decl_map_record(parser_state_t* parser, const tree_node_t* decl_node,
+                                   size_t token_begin, size_t item_index) {
+    parser_decl_entry_t entry = {};
+    entry.lead       = token_begin - parser->last_decl_end;
+    entry.span       = parser->position - parser->last_decl_end;
+    entry.item_index = item_index;
+    decl_node_signature(decl_node, &entry.name_idx, &entry.info);
+
+    vector_push_back(&parser->decl_map->decls, &entry);
+    parser->last_decl_end = parser->position;
+}
+
+// Концы объявлений — префиксные суммы span в дереве Фенвика: правка меняет
+// span только своих объявлений, концы всех следующих сдвигаются сами
+static void decl_ends_build(parser_decl_map_t* decl_map) {
+    vector_t* ends = &decl_map->ends;
+    vector_clear(ends);
+
+    size_t decls_count = vector_size(&decl_map->decls);
+    for (size_t i = 0; i < decls_count; ++i) {
+        const parser_decl_entry_t* entry =
+            (const parser_decl_entry_t*)vector_get_const(&decl_map->decls, i);
+        vector_push_back(ends, &entry->span);
+    }
+    for (size_t i = 0; i < decls_count; ++i) {
+        size_t parent = i | (i + 1);
+        if (parent < decls_count) *(size_t*)vector_get(ends, parent) += *(size_t*)vector_get(ends, i);
+    }
+}
+
+// delta прибавляется по модулю: уменьшение span передается как -(size_t)n
+static void decl_ends_add(vector_t* ends, size_t index, size_t delta) {
+    size_t count = vector_size(ends);
+    for (size_t i = index; i < count; i |= i + 1) *(size_t*)vector_get(ends, i) += delta;
+}
+
+// Конец объявления index: сумма span[0..index]
+static size_t decl_ends_get(const vector_t* ends, size_t index) {
+    size_t end = 0;
+    for (size_t i = index + 1; i > 0; i &= i - 1) end += *(const size_t*)vector_get_const(ends, i - 1);
+    return end;
+}
+
+// Первое объявление, кончающееся после position, или число объявлений
+static size_t decl_ends_find(const vector_t* ends, size_t position) {
+    size_t count = vector_size(ends);
+    size_t step  = 1;
+    while (step <= count / 2) step *= 2;
+
+    size_t index = 0;
+    for (; step > 0; step /= 2) {
+        if (index + step > count) continue;
+
+        size_t sum = *(const size_t*)vector_get_const(ends, index + step - 1);
+        if (sum <= position) {
+            index    += step;
+            position -= sum;
+        }
+    }
+    return index;
+}
+
+// Спина LCAT левоассоциативна: первый элемент лежит глубже всех слева
+static void parser_decl_map_bind_slots(parser_decl_map_t* decl_map, tree_node_t* root) {
+    HARD_ASSERT(decl_map != nullptr, "decl_map is nullptr");
+    HARD_ASSERT(root     != nullptr, "root is nullptr");
+
+    vector_t slots = {};
+    SIMPLE_VECTOR_INIT(&slots, vector_size(&decl_map->decls) + 1, tree_node_t**);
+
+    tree_node_t** slot = &root->right;
+    while (*slot != nullptr && (*slot)->type == FUNCTION && (*slot)->value.func == OP_LCAT) {
+        tree_node_t** item_slot = &(*slot)->right;
+        vector_push_back(&slots, &item_slot);
+        slot = &(*slot)->left;
+    }
+    if (*slot != nullptr) vector_push_back(&slots, &slot);
+
+    size_t items_count = vector_size(&slots);
+    size_t decls_count = vector_size(&decl_map->decls);
+    for (size_t i = 0; i < decls_count; ++i) {
+        parser_decl_entry_t* entry = (parser_decl_entry_t*)vector_get(&decl_map->decls, i);
+        HARD_ASSERT(entry->item_index < items_count, "decl item out of spine");
+
+        entry->slot = *(tree_node_t***)vector_get(&slots, items_count - 1 - entry->item_index);
+    }
+
+    vector_destroy(&slots);
+}
+
+// Глобальные и объявления идут по исходнику, так что хватает одного прохода
+static void parser_decl_map_save_globals(parser_state_t* parser) {
+    parser_decl_map_t* decl_map = parser->decl_map;
+    vector_clear(&decl_map->global_vars);
+
+    size_t decls_count  = vector_size(&decl_map->decls);
+    size_t decls_before = 0;
+    size_t decl_end     = 0;
+    if (decls_count > 0) decl_end = ((const parser_decl_entry_t*)vector_get_const(&decl_map->decls, 0))->span;
+
+    size_t records_count = vector_size(&parser->var_records);
+    for (size_t i = 0; i < records_count; ++i) {
+        const var_record_t* record = (const var_record_t*)vector_get_const(&parser->var_records, i);
+        while (decls_before < decls_count && decl_end <= record->token) {
+            decls_before++;
+            if (decls_before < decls_count) {
+                decl_end += ((const parser_decl_entry_t*)vector_get_const(&decl_map->decls, decls_before))->span;
+            }
+        }
+
+        parser_global_var_t global = {record->name_idx, decls_before};
+        vector_push_back(&decl_map->global_vars, &global);
+    }
+}
+
+void parser_decl_map_init(parser_decl_map_t* decl_map) {
+    HARD_ASSERT(decl_map != nullptr, "decl_map is nullptr");
+
+    SIMPLE_VECTOR_INIT(&decl_map->decls,       16, parser_decl_entry_t);
+    SIMPLE_VECTOR_INIT(&decl_map->ends,        16, size_t);
+    SIMPLE_VECTOR_INIT(&decl_map->global_vars, 16, parser_global_var_t);
+}
+
+void parser_decl_map_destroy(parser_decl_map_t* decl_map) {
+    HARD_ASSERT(decl_map != nullptr, "decl_map is nullptr");
+
+    vector_destroy(&decl_map->decls);
+    vector_destroy(&decl_map->ends);
+    vector_destroy(&decl_map->global_vars);
+}
+
 //================================================================================
 //                               Основные функции
 //================================================================================
 
-void frontend_parse_ast(tree_t* tree, const vector_t* tokens,
-                        u_map_t* func_table, vector_t* diags_out) {
+static void parser_state_init(parser_state_t* parser, u_map_t* var_table,
+                              tree_t* tree, const vector_t* tokens,
+                              u_map_t* func_table, vector_t* diags_out,
+                              parser_decl_map_t* decl_map) {
+    HARD_ASSERT(parser    != nullptr, "parser is nullptr");
+    HARD_ASSERT(var_table != nullptr, "var_table is nullptr");
+
+    *parser = {};
+    parser->tree         = tree;
+    parser->tokens       = tokens;
+    parser->position     = 0;
+    parser->func_table   = func_table;
+    parser->diags        = diags_out;
+    parser->current_decl = OP_NONE;
+    parser->while_depth  = 0;
+    parser->decl_map     = decl_map;
+
+    SIMPLE_U_MAP_INIT(var_table, 256,
+                    size_t, var_info_t,
+                    parser_hash_size_t, parser_key_cmp_size_t);
+
+    SIMPLE_VECTOR_INIT(&parser->var_records, 128, var_record_t);
+    SIMPLE_VECTOR_INIT(&parser->scope_markers, 32, size_t);
+    SIMPLE_VECTOR_INIT(&parser->pending_params, 16, size_t);
+    SIMPLE_VECTOR_INIT(&parser->match_table, 64, size_t);
+
+    parser->var_table = var_table;
+    parser->scope_depth = 0;
+    parser->pending_params_active = false;
+
+    ON_PARSER_STATS(parser->prod = PARSER_PROD_TOPLEVEL;)
+}
+
+static void parser_state_destroy(parser_state_t* parser) {
+    HARD_ASSERT(parser != nullptr, "parser is nullptr");
+
+    u_map_destroy (parser->var_table);
+    vector_destroy(&parser->var_records);
+    vector_destroy(&parser->scope_markers);
+    vector_destroy(&parser->pending_params);
+    vector_destroy(&parser->match_table);
+}
+
+parser_stats_t frontend_parse_ast(tree_t* tree, const vector_t* tokens,
+                                  u_map_t* func_table, vector_t* diags_out,
+                                  const lexer_stats_t* stats, parser_decl_map_t* decl_map) {
     HARD_ASSERT(tree != nullptr, "tree is nullptr");
     HARD_ASSERT(tokens != nullptr, "tokens is nullptr");
     HARD_ASSERT(func_table != nullptr, "func_table is nullptr");
     HARD_ASSERT(diags_out != nullptr, "diags_out is nullptr");
 
-    parser_state_t parser = {};
-    parser.tree         = tree;
-    parser.tokens       = tokens;
-    parser.position     = 0;
-    parser.func_table   = func_table;
-    parser.diags        = diags_out;
-    parser.current_decl = OP_NONE;
-    parser.while_depth  = 0;
-
-    u_map_t var_table = {};
-    SIMPLE_U_MAP_INIT(&var_table, 256,
-                    size_t, var_info_t,
-                    parser_hash_size_t, parser_key_cmp_size_t);
+    parser_state_t parser    = {};
+    u_map_t        var_table = {};
+    parser_state_init(&parser, &var_table, tree, tokens, func_table, diags_out, decl_map);
 
-    SIMPLE_VECTOR_INIT(&parser.var_records, 128, var_record_t);
-    SIMPLE_VECTOR_INIT(&parser.scope_markers, 32, size_t);
-    SIMPLE_VECTOR_INIT(&parser.pending_params, 16, size_t);
+    if (stats != nullptr) parser_reserve_from_stats(&parser, stats);
+    if (decl_map != nullptr) vector_clear(&decl_map->decls);
 
-    parser.var_table = &var_table;
-    parser.scope_depth = 0;
-    parser.pending_params_active = false;
+    size_t tokens_count = vector_size(tokens);
+    parser_build_match_table(&parser, 0, (tokens_count > 0) ? tokens_count - 1 : 0);
+
+    ON_PARSER_STATS(
+        ast_nodes_allocated = 0;
+        uint64_t pass1_start = parser_now_ns();
+    )
 
     parser_pass1_collect(&parser);
 
+    ON_PARSER_STATS(
+        uint64_t parse_start = parser_now_ns();
+        parser.stats.pass1_time_ns = parse_start - pass1_start;
+    )
+
     parser.position = 0;
 
     LOGGER_DEBUG("start parser AST");
@@ -1267,9 +1679,214 @@ void frontend_parse_ast(tree_t* tree, const vector_t* tokens,
     LOGGER_DEBUG(" end parser AST");
     tree->size = count_nodes_recursive(root);
 
-    u_map_destroy (&var_table);
-    vector_destroy(&parser.var_records);
-    vector_destroy(&parser.scope_markers);
-    vector_destroy(&parser.pending_params);
+    if (decl_map != nullptr) {
+        parser_decl_map_bind_slots(decl_map, root);
+        decl_ends_build(decl_map);
+        parser_decl_map_save_globals(&parser);
+    }
+
+    parser_stats_t result = {};
+    ON_PARSER_STATS(
+        parser.stats.parse_time_ns   = parser_now_ns() - parse_start;
+        parser.stats.nodes_allocated = ast_nodes_allocated;
+        result = parser.stats;
+    )
+
+    parser_state_destroy(&parser);
+    return result;
+}
+
+//================================================================================
+//                      Инкрементальный разбор: правка
+//================================================================================
+
+// Ищет непрерывную цепочку объявлений [first, last], целиком накрывающую правку;
+// begin_out — первый токен first, end_out — конец last до правки
+static bool reparse_find_range(const parser_decl_map_t* decl_map,
+                               const parser_token_edit_t* edit,
+                               size_t* first_out, size_t* last_out,
+                               size_t* begin_out, size_t* end_out) {
+    size_t decls_count = vector_size(&decl_map->decls);
+
+    size_t first = decl_ends_find(&decl_map->ends, edit->edit_begin);
+    if (first == decls_count) return false;
+
+    const parser_decl_entry_t* first_entry =
+        (const parser_decl_entry_t*)vector_get_const(&decl_map->decls, first);
+    size_t end   = decl_ends_get(&decl_map->ends, first);
+    size_t begin = end - first_entry->span + first_entry->lead;
+    if (begin > edit->edit_begin) return false;
+
+    size_t last = first;
+    while (end < edit->old_end) {
+        if (last + 1 >= decls_count) return false;
+
+        const parser_decl_entry_t* next =
+            (const parser_decl_entry_t*)vector_get_const(&decl_map->decls, last + 1);
+        if (next->lead != 0) return false;
+
+        last++;
+        end += next->span;
+    }
+
+    *first_out = first;
+    *last_out  = last;
+    *begin_out = begin;
+    *end_out   = end;
+    return true;
+}
+
+// Сверяет сигнатуры правленых объявлений со старыми. Новое имя, вид или
+// число параметров меняют проверку вызовов и в нетронутых объявлениях,
+// так что любая такая правка требует полного разбора
+static bool reparse_check_signatures(parser_state_t* parser, size_t token_end,
+                                     const parser_decl_entry_t* old_entries, size_t count) {
+    for (size_t k = 0; k < count; ++k) {
+        while (parser_match_keyword(parser, OP_LCAT)) {}
+
+        op_code_t decl_opcode = OP_NONE;
+        if      (parser_check_keyword(parser, OP_FUNC_DECL)) decl_opcode = OP_FUNC_DECL;
+        else if (parser_check_keyword(parser, OP_PROC_DECL)) decl_opcode = OP_PROC_DECL;
+        else return false;
+
+        const lexer_token_t* name_tok = nullptr;
+        size_t               name_idx = 0;
+        func_decl_info_t     info     = {};
+        if (!pass1_scan_decl(parser, decl_opcode, &name_tok, &name_idx, &info)) return false;
+        if (parser->position > token_end) return false;
+
+        const parser_decl_entry_t* old_entry = &old_entries[k];
+        if (old_entry->name_idx         != name_idx ||
+            old_entry->info.decl_opcode != info.decl_opcode ||
+            old_entry->info.argc        != info.argc) {
+            return false;
+        }
+    }
+
+    return parser->position == token_end;
+}
+
+parser_reparse_result_t frontend_reparse_ast(tree_t* tree, const vector_t* tokens,
+                                             u_map_t* func_table, vector_t* diags_out,
+                                             parser_decl_map_t* decl_map,
+                                             const parser_token_edit_t* edit) {
+    HARD_ASSERT(tree       != nullptr, "tree is nullptr");
+    HARD_ASSERT(tokens     != nullptr, "tokens is nullptr");
+    HARD_ASSERT(func_table != nullptr, "func_table is nullptr");
+    HARD_ASSERT(diags_out  != nullptr, "diags_out is nullptr");
+    HARD_ASSERT(decl_map   != nullptr, "decl_map is nullptr");
+    HARD_ASSERT(edit       != nullptr, "edit is nullptr");
+    HARD_ASSERT(edit->edit_begin <= edit->old_end && edit->edit_begin <= edit->new_end,
+                "bad edit range");
+
+    vector_clear(diags_out);
+
+    size_t first = 0, last = 0, token_begin = 0, old_token_end = 0;
+    if (!reparse_find_range(decl_map, edit, &first, &last, &token_begin, &old_token_end)) {
+        return PARSER_REPARSE_FULL_NEEDED;
+    }
+
+    size_t count = last - first + 1;
+    parser_decl_entry_t* entries = (parser_decl_entry_t*)vector_get(&decl_map->decls, first);
+
+    size_t token_end = old_token_end - edit->old_end + edit->new_end;
+    if (token_end > vector_size(tokens)) return PARSER_REPARSE_FULL_NEEDED;
+
+    parser_state_t parser    = {};
+    u_map_t        var_table = {};
+    parser_state_init(&parser, &var_table, tree, tokens, func_table, diags_out, nullptr);
+
+    // Полный разбор видит только глобальные, заведенные выше объявления
+    size_t globals_count = vector_size(&decl_map->global_vars);
+    for (size_t i = 0; i < globals_count; ++i) {
+        const parser_global_var_t* global =
+            (const parser_global_var_t*)vector_get_const(&decl_map->global_vars, i);
+        if (global->decls_before > first) break;
+        parser_var_define(&parser, global->name_idx);
+    }
+
+    parser.position = token_begin;
+    bool ok = parser_build_match_table(&parser, token_begin, token_end) &&
+              reparse_check_signatures(&parser, token_end, entries, count);
+
+    vector_t new_decls = {};
+    SIMPLE_VECTOR_INIT(&new_decls, count, parser_decl_entry_t);
+    vector_t new_nodes = {};
+    SIMPLE_VECTOR_INIT(&new_nodes, count, tree_node_t*);
+
+    parser.position      = token_begin;
+    parser.last_decl_end = token_begin - entries[0].lead;
+    while (ok && parser.position < token_end) {
+        if (parser_match_keyword(&parser, OP_LCAT)) continue;
+
+        size_t decl_begin = parser.position;
+        parser.item_diags = 0;
+        tree_node_t* decl_node = parse_decl(&parser);
+        if (decl_node == nullptr) break;
+        parser_consume_optional_lcat(&parser);
+
+        parser_decl_entry_t entry = {};
+        entry.lead = decl_begin      - parser.last_decl_end;
+        entry.span = parser.position - parser.last_decl_end;
+        parser.last_decl_end = parser.position;
+        decl_node_signature(decl_node, &entry.name_idx, &entry.info);
+
+        vector_push_back(&new_decls, &entry);
+        vector_push_back(&new_nodes, &decl_node);
+    }
+
+    ok = ok && parser.position == token_end && vector_size(&new_nodes) == count;
+
+    for (size_t k = 0; k < vector_size(&new_nodes); ++k) {
+        tree_node_t* new_node = *(tree_node_t**)vector_get(&new_nodes, k);
+        if (!ok) {
+            destroy_node_recursive(new_node, nullptr);
+            continue;
+        }
+
+        const parser_decl_entry_t* new_entry =
+            (const parser_decl_entry_t*)vector_get_const(&new_decls, k);
+        parser_decl_entry_t* old_entry = &entries[k];
+
+        size_t removed = 0;
+        destroy_node_recursive(*old_entry->slot, &removed);
+        *old_entry->slot = new_node;
+        tree->size = tree->size - removed + count_nodes_recursive(new_node);
+
+        decl_ends_add(&decl_map->ends, first + k, new_entry->span - old_entry->span);
+        old_entry->lead     = new_entry->lead;
+        old_entry->span     = new_entry->span;
+        old_entry->name_idx = new_entry->name_idx;
+        old_entry->info     = new_entry->info;
+    }
+    if (!ok) vector_clear(diags_out);
+
+    vector_destroy(&new_decls);
+    vector_destroy(&new_nodes);
+    parser_state_destroy(&parser);
+
+    return ok ? PARSER_REPARSE_OK : PARSER_REPARSE_FULL_NEEDED;
+}
 
+void parser_stats_dump(FILE* stream, const parser_stats_t* stats) {
+    HARD_ASSERT(stream != nullptr, "stream is nullptr");
+    HARD_ASSERT(stats  != nullptr, "stats is nullptr");
+
+    static const char* const PROD_NAMES[PARSER_PROD_COUNT] = {
+        "pass1", "toplevel", "decl", "block", "stmt", "expr", "call", "recovery",
+    };
+
+    fprintf(stream, "parser stats:\n");
+    for (size_t i = 0; i < PARSER_PROD_COUNT; ++i) {
+        fprintf(stream, "  tokens[%-8s] = %zu\n", PROD_NAMES[i], stats->tokens_consumed[i]);
+    }
+    fprintf(stream, "  nodes allocated = %zu\n", stats->nodes_allocated);
+    fprintf(stream, "  sync calls      = %zu (skipped tokens: %zu)\n",
+            stats->sync_calls, stats->sync_skipped_tokens);
+    fprintf(stream, "  var lookups     = %zu\n", stats->var_lookups);
+    fprintf(stream, "  func lookups    = %zu\n", stats->func_lookups);
+    fprintf(stream, "  scopes          = %zu enter / %zu leave\n",
+            stats->scope_enters, stats->scope_leaves);
+    fprintf(stream, "  pass1 time      = %llu ns\n", (unsigned long long)stats->pass1_time_ns);
+    fprintf(stream, "  parse time      = %llu ns\n", (unsigned long long)stats->parse_time_ns);
 }
@@ -102,6 +102,303 @@ static c_string_t make_cstr(const char* data_ptr, size_t data_len) {
     return result;
 }
 
+static void tokenize_inline(const char* src, vector_t* tokens, vector_t* diags) {
+    lexer_config_t lexer_cfg = {};
+    lexer_cfg.filename            = "inline_test.alc";
+    lexer_cfg.keywords            = KEYWORDS;
+    lexer_cfg.keywords_count      = KEYWORDS_COUNT;
+    lexer_cfg.ignored_words       = IGNORED_KEYWORDS;
+    lexer_cfg.ignored_words_count = IGNORED_KEYWORDS_COUNT;
+
+    lexer_tokenize(make_cstr(src, strlen(src)), &lexer_cfg, tokens, diags, nullptr);
+}
+
+static bool tokens_same(const lexer_token_t* left, const lexer_token_t* right) {
+    return left->kind == right->kind && left->op_code == right->op_code &&
+           left->lexeme.len == right->lexeme.len &&
+           strncmp(left->lexeme.ptr, right->lexeme.ptr, left->lexeme.len) == 0;
+}
+
+// Правка = токены между общим префиксом и общим суффиксом двух версий
+static parser_token_edit_t tokens_diff(const vector_t* old_tokens, const vector_t* new_tokens) {
+    size_t old_count = vector_size(old_tokens);
+    size_t new_count = vector_size(new_tokens);
+
+    size_t prefix = 0;
+    while (prefix < old_count && prefix < new_count &&
+           tokens_same((const lexer_token_t*)vector_get_const(old_tokens, prefix),
+                       (const lexer_token_t*)vector_get_const(new_tokens, prefix))) {
+        prefix++;
+    }
+
+    size_t suffix = 0;
+    while (suffix < old_count - prefix && suffix < new_count - prefix &&
+           tokens_same((const lexer_token_t*)vector_get_const(old_tokens, old_count - 1 - suffix),
+                       (const lexer_token_t*)vector_get_const(new_tokens, new_count - 1 - suffix))) {
+        suffix++;
+    }
+
+    return {prefix, old_count - suffix, new_count - suffix};
+}
+
+// Идентификаторы сравниваются по тексту: у деревьев свои ident_stack
+static bool ast_same(const tree_t* left_tree, const tree_node_t* left,
+                     const tree_t* right_tree, const tree_node_t* right) {
+    if (left == nullptr || right == nullptr) return left == right;
+    if (left->type != right->type) return false;
+
+    if (left->type == IDENT) {
+        c_string_t left_name  = left_tree->ident_stack->data[left->value.ident_idx];
+        c_string_t right_name = right_tree->ident_stack->data[right->value.ident_idx];
+        if (left_name.len != right_name.len ||
+            strncmp(left_name.ptr, right_name.ptr, left_name.len) != 0) return false;
+    } else if (left->type == CONSTANT) {
+        // Обе версии читают один и тот же литерал — совпасть должны побитно
+        if (memcmp(&left->value.constant, &right->value.constant, sizeof(const_val_type)) != 0) return false;
+    } else if (left->value.func != right->value.func) {
+        return false;
+    }
+
+    return ast_same(left_tree, left->left,  right_tree, right->left) &&
+           ast_same(left_tree, left->right, right_tree, right->right);
+}
+
+// Аргументы диагностик — ident_idx, их не сравниваем
+static bool diags_same(const vector_t* left, const vector_t* right) {
+    if (vector_size(left) != vector_size(right)) return false;
+
+    for (size_t i = 0; i < vector_size(left); ++i) {
+        const diag_log_t* left_diag  = (const diag_log_t*)vector_get_const(left,  i);
+        const diag_log_t* right_diag = (const diag_log_t*)vector_get_const(right, i);
+        if (left_diag->code != right_diag->code || left_diag->line != right_diag->line ||
+            left_diag->column != right_diag->column) return false;
+    }
+    return true;
+}
+
+// Переразбирает правку от tokens к next_tokens и сверяет с полным разбором next_tokens.
+// diags — ошибки прошлого разбора: переразбор должен заменить их свежими
+static bool reparse_step(tree_t* tree, u_map_t* func_table, parser_decl_map_t* decl_map,
+                         const vector_t* tokens, const vector_t* next_tokens, vector_t* diags,
+                         const char* name, parser_reparse_result_t expected) {
+    size_t old_size = tree->size;
+
+    parser_token_edit_t edit = tokens_diff(tokens, next_tokens);
+    parser_reparse_result_t result =
+        frontend_reparse_ast(tree, next_tokens, func_table, diags, decl_map, &edit);
+
+    vector_t full_diags = {};
+    SIMPLE_VECTOR_INIT(&full_diags, 16, diag_log_t);
+    tree_t full_tree = {};
+    tree_init(&full_tree ON_TREE_DEBUG(, TREE_VER_INIT));
+    u_map_t full_func_table = {};
+    SIMPLE_U_MAP_INIT(&full_func_table, 16, size_t, func_decl_info_t,
+                      parser_hash_size_t, parser_key_cmp_size_t);
+    frontend_parse_ast(&full_tree, next_tokens, &full_func_table, &full_diags, nullptr, nullptr);
+
+    printf("incremental reparse (%s): edit [%zu, %zu) -> [%zu, %zu), result=%s, "
+           "size=%zu (full parse: %zu), diags=%zu (full parse: %zu)\n", name,
+           edit.edit_begin, edit.old_end, edit.edit_begin, edit.new_end,
+           (result == PARSER_REPARSE_OK) ? "OK" : "FULL_NEEDED",
+           tree->size, full_tree.size, vector_size(diags), vector_size(&full_diags));
+
+    bool ok = result == expected;
+    if (ok && result == PARSER_REPARSE_OK) {
+        ok = tree->size == full_tree.size && ast_same(tree, tree->root, &full_tree, full_tree.root) &&
+             diags_same(diags, &full_diags);
+    } else if (ok) {
+        ok = tree->size == old_size && vector_size(&full_diags) > 0;
+    }
+
+    tree_destroy(&full_tree);
+    u_map_destroy(&full_func_table);
+    vector_destroy(&full_diags);
+    return ok;
+}
+
+// Разбирает old_src и переразбирает правку до new_src, а затем, если задан next_src, до него:
+// вторая правка проверяет сдвинутые первой позиции объявлений
+static bool reparse_case(const char* name, const char* old_src, const char* new_src,
+                         const char* next_src, parser_reparse_result_t expected) {
+    vector_t old_tokens = {}, new_tokens = {}, next_tokens = {}, lex_diags = {}, diags = {};
+    SIMPLE_VECTOR_INIT(&old_tokens,  64, lexer_token_t);
+    SIMPLE_VECTOR_INIT(&new_tokens,  64, lexer_token_t);
+    SIMPLE_VECTOR_INIT(&next_tokens, 64, lexer_token_t);
+    SIMPLE_VECTOR_INIT(&lex_diags,   16, diag_log_t);
+    SIMPLE_VECTOR_INIT(&diags,       16, diag_log_t);
+    tokenize_inline(old_src, &old_tokens, &lex_diags);
+    tokenize_inline(new_src, &new_tokens, &lex_diags);
+
+    u_map_t func_table = {};
+    SIMPLE_U_MAP_INIT(&func_table, 16, size_t, func_decl_info_t,
+                      parser_hash_size_t, parser_key_cmp_size_t);
+    parser_decl_map_t decl_map = {};
+    parser_decl_map_init(&decl_map);
+
+    tree_t tree = {};
+    tree_init(&tree ON_TREE_DEBUG(, TREE_VER_INIT));
+    frontend_parse_ast(&tree, &old_tokens, &func_table, &diags, nullptr, &decl_map);
+
+    bool ok = reparse_step(&tree, &func_table, &decl_map, &old_tokens, &new_tokens, &diags,
+                           name, expected);
+    if (ok && next_src != nullptr) {
+        tokenize_inline(next_src, &next_tokens, &lex_diags);
+        ok = reparse_step(&tree, &func_table, &decl_map, &new_tokens, &next_tokens, &diags,
+                          name, PARSER_REPARSE_OK);
+    }
+
+    tree_destroy(&tree);
+    u_map_destroy(&func_table);
+    parser_decl_map_destroy(&decl_map);
+    vector_destroy(&diags);
+    vector_destroy(&lex_diags);
+    vector_destroy(&next_tokens);
+    vector_destroy(&new_tokens);
+    vector_destroy(&old_tokens);
+    return ok;
+}
+
+static void test_incremental_reparse() {
+    // Правка внутри одного тела
+    bool body_ok = reparse_case("body",
+        "func f(a) { return a; };"
+        "func main() { x = f(1); return x; };",
+        "func f(a) { return a * 3 + 1; };"
+        "func main() { x = f(1); return x; };",
+        nullptr, PARSER_REPARSE_OK);
+
+    // g заведена ниже f: полный разбор в f ее не видит, переразбор тоже не должен
+    bool globals_ok = reparse_case("globals",
+        "func f(a) { return a; };"
+        "g = 1;"
+        "func main() { return f(g); };",
+        "func f(a) { return a + g; };"
+        "g = 1;"
+        "func main() { return f(g); };",
+        nullptr, PARSER_REPARSE_OK);
+
+    // Новая арность f ломает вызов в нетронутом main
+    bool signature_ok = reparse_case("signature",
+        "func f(a) { return a; };"
+        "func main() { x = f(1); return x; };",
+        "func f(a, b) { return a + b; };"
+        "func main() { x = f(1); return x; };",
+        nullptr, PARSER_REPARSE_FULL_NEEDED);
+
+    // Ошибка в f исправлена: ее старая диагностика уйти должна. Затем правка в h,
+    // стоящей за удлинившейся f и глобальной g
+    bool shifted_ok = reparse_case("shifted",
+        "func f(a) { return a + ; };"
+        "g = 2;"
+        "func h(b) { return b; };"
+        "func main() { return f(1) + h(g); };",
+        "func f(a) { return a + 1 * 2; };"
+        "g = 2;"
+        "func h(b) { return b; };"
+        "func main() { return f(1) + h(g); };",
+        "func f(a) { return a + 1 * 2; };"
+        "g = 2;"
+        "func h(b) { return b - g; };"
+        "func main() { return f(1) + h(g); };",
+        PARSER_REPARSE_OK);
+
+    if (!body_ok || !globals_ok || !signature_ok || !shifted_ok) printf("\nFailed\n");
+    else                                          printf("\nPAssed\n");
+}
+
+// Разбирает src целиком; возвращает размер дерева, диагностики — в diags
+static size_t parse_inline(const char* src, vector_t* diags) {
+    vector_t tokens = {};
+    SIMPLE_VECTOR_INIT(&tokens, 64, lexer_token_t);
+    tokenize_inline(src, &tokens, diags);
+
+    u_map_t func_table = {};
+    SIMPLE_U_MAP_INIT(&func_table, 16, size_t, func_decl_info_t,
+                      parser_hash_size_t, parser_key_cmp_size_t);
+
+    tree_t tree = {};
+    tree_init(&tree ON_TREE_DEBUG(, TREE_VER_INIT));
+    frontend_parse_ast(&tree, &tokens, &func_table, diags, nullptr, nullptr);
+    size_t size = tree.size;
+
+    tree_destroy(&tree);
+    u_map_destroy(&func_table);
+    vector_destroy(&tokens);
+    return size;
+}
+
+static size_t count_diags(const vector_t* diags, diag_code_t code) {
+    size_t count = 0;
+    for (size_t i = 0; i < vector_size(diags); i++) {
+        count += ((const diag_log_t*)vector_get_const(diags, i))->code == code;
+    }
+    return count;
+}
+
+static const size_t DIAG_CAP_STMTS = 20000;
+
+// Лавина ошибок в одном теле: не больше PARSER_MAX_DIAGS_PER_ITEM + 1 на элемент,
+// следующее объявление разбирается и отчитывается отдельно
+static void test_diag_cap() {
+    const char head[] = "func main() {";
+    const char stmt[] = " x = ;";
+    const char tail[] = " return 0; }; func g() { y = ; return 1; };";
+
+    char* src = (char*)calloc(sizeof(head) + DIAG_CAP_STMTS * (sizeof(stmt) - 1) + sizeof(tail), 1);
+    if (src == nullptr) {
+        printf("\nFailed\n");
+        return;
+    }
+    size_t pos = 0;
+    memcpy(src, head, sizeof(head) - 1);
+    pos += sizeof(head) - 1;
+    for (size_t i = 0; i < DIAG_CAP_STMTS; i++) {
+        memcpy(src + pos, stmt, sizeof(stmt) - 1);
+        pos += sizeof(stmt) - 1;
+    }
+    memcpy(src + pos, tail, sizeof(tail));
+
+    vector_t diags = {};
+    SIMPLE_VECTOR_INIT(&diags, 32, diag_log_t);
+    parse_inline(src, &diags);
+
+    size_t diags_count = vector_size(&diags);
+    size_t too_many    = count_diags(&diags, DIAG_PARSE_TOO_MANY_ERRORS);
+    printf("diag cap: %zu statements -> diags=%zu, too_many=%zu\n", DIAG_CAP_STMTS, diags_count, too_many);
+
+    // main: предел + TOO_MANY_ERRORS, g: своя одна ошибка
+    bool capped = diags_count == PARSER_MAX_DIAGS_PER_ITEM + 2 && too_many == 1 &&
+                  ((const diag_log_t*)vector_get_const(&diags, PARSER_MAX_DIAGS_PER_ITEM))->code ==
+                      DIAG_PARSE_TOO_MANY_ERRORS;
+    if (!capped) printf("\nFailed\n");
+    else         printf("\nPAssed\n");
+
+    vector_destroy(&diags);
+    free(src);
+}
+
+// ( { ) }: ')' закрывает '(', а не чужую '{' — ошибки остаются на сломанной группе,
+// без каскада на остаток main и с найденным g
+static void test_crossed_brackets() {
+    const char*    src           = "func main() { x = ( { ) }; return 0; }; func g() { return 1; };";
+    const uint32_t broken_column = 21;
+
+    vector_t diags = {};
+    SIMPLE_VECTOR_INIT(&diags, 16, diag_log_t);
+    parse_inline(src, &diags);
+
+    bool local = vector_size(&diags) > 0;
+    for (size_t i = 0; i < vector_size(&diags); i++) {
+        local &= ((const diag_log_t*)vector_get_const(&diags, i))->column == broken_column;
+    }
+    printf("crossed brackets: diags=%zu, local=%d\n", vector_size(&diags), local);
+
+    if (!local) printf("\nFailed\n");
+    else        printf("\nPAssed\n");
+
+    vector_destroy(&diags);
+}
+
 int main(int argc, char** argv) {
     logger_initialize_stream(stderr);
     const char* filename = (argc >= 2) ? argv[1] : "inline_test.alc";
@@ -140,8 +437,9 @@ int main(int argc, char** argv) {
     lexer_cfg.ignored_words       = IGNORED_KEYWORDS;
     lexer_cfg.ignored_words_count = IGNORED_KEYWORDS_COUNT;
 
+    lexer_stats_t lex_stats = {};
     lexer_error_t lex_error = lexer_tokenize(buffer, &lexer_cfg,
-                                             &token_vec, &diag_vec);
+                                             &token_vec, &diag_vec, &lex_stats);
     dump_tokens(&token_vec, 100);
     if (vector_size(&diag_vec) != 0) {
         print_diags(stderr, buffer, filename, &diag_vec);
@@ -170,7 +468,10 @@ int main(int argc, char** argv) {
         tree_open_dump_file(&tree, "parser_test_tree_dump.txt");
     )
     LOGGER_DEBUG("Starting frontend_parse_ast");
-    frontend_parse_ast(&tree, &token_vec, &func_table, &diag_vec);
+    parser_stats_t parse_stats = frontend_parse_ast(&tree, &token_vec, &func_table,
+                                                    &diag_vec, &lex_stats, nullptr);
+    ON_PARSER_STATS(parser_stats_dump(stdout, &parse_stats);)
+    (void)parse_stats;
 
     if (vector_size(&diag_vec) != 0) {
         print_diags(stderr, buffer, filename, &diag_vec);
@@ -181,7 +482,12 @@ int main(int argc, char** argv) {
         tree_close_dump_file(&tree);
     )
     tree_destroy(&tree);
-    
+    tree_nodes_pool_destroy();
+
+    test_incremental_reparse();
+    test_diag_cap();
+    test_crossed_brackets();
+
     u_map_destroy(&func_table);
     vector_destroy(&token_vec);
     vector_destroy(&diag_vec);
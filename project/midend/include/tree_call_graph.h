@@ -0,0 +1,56 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_CALL_GRAPH_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_CALL_GRAPH_H_NCLUDED
+
+#include <stdio.h>
+
+#include "libs/AST/include/tree_info.h"
+#include "libs/Vector/include/vector.h"
+#include "libs/Unordered_map/include/unordered_map.h"
+
+const size_t CALL_GRAPH_NO_FUNC = (size_t)-1;
+const size_t CALL_GRAPH_NO_EDGE = (size_t)-1;
+
+// Корень графа, если другой не задан
+const char* const CALL_GRAPH_DEFAULT_ROOT = "main";
+
+struct call_graph_func_t {
+    tree_node_t* decl;
+    size_t       name_idx;
+    bool         is_proc;
+    bool         reachable;   // из корня или из операторов вне функций
+    size_t       first_out;   // первое исходящее ребро, CALL_GRAPH_NO_EDGE — нет
+};
+
+// caller == CALL_GRAPH_NO_FUNC — вызов с верхнего уровня, вне функций
+struct call_graph_edge_t {
+    size_t caller;
+    size_t callee;
+    size_t sites;     // вызовов callee в теле caller
+    size_t next_out;  // следующее ребро того же caller
+};
+
+struct call_graph_t {
+    const tree_t* tree;
+    vector_t      funcs;   // call_graph_func_t в порядке объявления
+    vector_t      edges;   // call_graph_edge_t, пара caller-callee встречается один раз
+    size_t        root;    // CALL_GRAPH_NO_FUNC, если корня нет
+    size_t        top_first_out;  // рёбра вызовов вне функций
+    u_map_t       by_name;        // name_idx -> индекс в funcs, первое объявление
+    u_map_t       by_decl;        // узел объявления -> индекс в funcs
+};
+
+// Граф по вызовам OP_CALL. root_name (nullptr — CALL_GRAPH_DEFAULT_ROOT)
+// вместе с вызовами вне функций задаёт, что достижимо. Без корня
+// достижимыми считаются все функции: точку входа тогда выбирает бэкенд
+error_code call_graph_build(const tree_t* tree, const char* root_name, call_graph_t* graph);
+void       call_graph_destroy(call_graph_t* graph);
+
+// Выгрузка для внешних инструментов; недостижимые функции помечены
+error_code call_graph_write_dot(const call_graph_t* graph, FILE* file);
+error_code call_graph_write_json(const call_graph_t* graph, FILE* file);
+
+// Удаляет объявления функций, недостижимых из корня.
+// removed_out (число удалённых) может быть nullptr
+error_code tree_remove_dead_funcs(tree_t* tree, const char* root_name, size_t* removed_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_CALL_GRAPH_H_NCLUDED */
@@ -0,0 +1,20 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_CONST_EVAL_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_CONST_EVAL_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+#include "tree_summaries.h"
+
+// Глубже стольких вложенных вызовов интерпретатор не спускается
+const size_t CONST_EVAL_MAX_DEPTH = 64;
+
+// Вычисляет при компиляции вызовы чистых func с константными аргументами
+// и заменяет их результатом. Чистая функция не печатает, не читает ввод и
+// вызывает только чистые функции; это берётся из summaries, а при nullptr
+// сводки строятся заново. На каждый вызов даётся step_budget шагов
+// интерпретатора: не уложившийся вызов остаётся как есть, 0 выключает проход.
+// Вызов, в котором встретилось дробное значение, тоже остаётся: SPU делит нацело.
+// evaluated_out (число заменённых вызовов) может быть nullptr
+error_code tree_evaluate_pure_calls(tree_t* tree, const func_summaries_t* summaries,
+                                    size_t step_budget, size_t* evaluated_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_CONST_EVAL_H_NCLUDED */
@@ -0,0 +1,13 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_CSE_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_CSE_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+#include "tree_summaries.h"
+
+// Повторные чистые выражения блока (от двух операций) считаются один раз
+// во временную переменную, объявленную перед первым вхождением. Вызов
+// функции, не чистой по summaries (nullptr — сводок нет), сбрасывает всё.
+// temps_out (число заведённых временных) может быть nullptr
+error_code tree_eliminate_common_subexpr(tree_t* tree, const func_summaries_t* summaries, size_t* temps_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_CSE_H_NCLUDED */
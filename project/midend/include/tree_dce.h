@@ -0,0 +1,11 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_DCE_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_DCE_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+
+// Удаляет недостижимые хвосты списков после return/finish/break/continue,
+// условия и циклы с ложным константным условием, раскрывает if с истинным.
+// removed_out (число удалённых операторов) может быть nullptr
+error_code tree_eliminate_dead_code(tree_t* tree, size_t* removed_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_DCE_H_NCLUDED */
@@ -0,0 +1,18 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_INLINE_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_INLINE_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+
+// Тело длиннее стольких узлов не встраивается
+const size_t INLINE_MAX_CALLEE_NODES  = 48;
+// Сколько узлов встраивание может добавить в одну функцию
+const size_t INLINE_MAX_CALLER_GROWTH = 512;
+
+// Подставляет тела маленьких func/proc на место вызовов. Параметры и локальные
+// переменные тела получают новые имена, завершающий return становится
+// присваиванием временной, которая и заменяет вызов. Рекурсивные по графу
+// вызовов функции не встраиваются; вызываемые обрабатываются раньше вызывающих.
+// inlined_out (число встроенных вызовов) может быть nullptr
+error_code tree_inline_calls(tree_t* tree, size_t* inlined_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_INLINE_H_NCLUDED */
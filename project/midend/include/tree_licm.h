@@ -0,0 +1,16 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_LICM_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_LICM_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+#include "tree_summaries.h"
+
+// Выносит из while чистые подвыражения, чьи переменные в цикле не
+// присваиваются, во временные перед циклом. Цикл с вызовом функции, не
+// чистой по summaries (nullptr — сводок нет), не трогается: такой вызов
+// считается затирающим всё. Из тела выносится только то, что не может
+// упасть (деление на переменную, log, pow с переменной степенью остаются),
+// ведь тело может не выполниться ни разу.
+// hoisted_out (число вынесенных выражений) может быть nullptr
+error_code tree_hoist_loop_invariants(tree_t* tree, const func_summaries_t* summaries, size_t* hoisted_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_LICM_H_NCLUDED */
@@ -0,0 +1,20 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_LIVENESS_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_LIVENESS_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+#include "tree_summaries.h"
+
+// Обратным анализом живости по списку операторов, if и while удаляет
+// присваивания переменным, которые дальше не читаются, если правая часть
+// чиста; вызов чист, если по summaries (nullptr — сводок нет) функция чиста
+// и всегда завершается. Аргументы, которых вызываемая по сводке не читает,
+// заменяются нулём. Все переменные локальны, поэтому после return и конца
+// тела живых нет.
+// Переменные, исчезнувшие из тела функции целиком, печатаются в лог:
+// бэкенд больше не заводит для них слот в кадре.
+// removed_out (удалённые присваивания и обнулённые аргументы) и dropped_out
+// (исчезнувшие переменные) могут быть nullptr
+error_code tree_eliminate_dead_stores(tree_t* tree, const func_summaries_t* summaries,
+                                      size_t* removed_out, size_t* dropped_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_LIVENESS_H_NCLUDED */
@@ -0,0 +1,33 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_NODE_UTILS_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_NODE_UTILS_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/Vector/include/vector.h"
+#include "common/keywords/include/keywords.h"
+
+inline bool midend_node_is_func(const tree_node_t* node, op_code_t op_code) {
+    return node != nullptr && node->type == FUNCTION && node->value.func == op_code;
+}
+
+// Параметры и аргументы — ENUM_SEP-дерево. Элементы кладутся слева направо:
+// в items — указатели на узлы, в массив — не больше capacity, а count
+// считает и не влезшие
+void midend_collect_enum_items(const tree_node_t* node, vector_t* items, error_code* error);
+void midend_collect_enum_array(tree_node_t* node, tree_node_t** items, size_t capacity, size_t* count);
+
+// Освобождает только звенья ENUM_SEP, элементы остаются
+void midend_free_enum_links(tree_node_t* node);
+
+// Деление на переменную или ноль, log и pow с переменной степенью могут
+// упасть в SPU. midend_node_may_trap смотрит только на сам узел,
+// midend_expr_may_trap — на всё поддерево
+bool midend_node_may_trap(const tree_node_t* node);
+bool midend_expr_may_trap(const tree_node_t* node);
+
+// В выражении нет присваиваний, ввода-вывода и вызовов: свойство узла берется
+// из столбца is_pure в op_codes_table. Вызов чистой функции так не распознать,
+// это дело func_summaries_call_is_pure
+bool midend_expr_is_pure(const tree_node_t* node);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_NODE_UTILS_H_NCLUDED */
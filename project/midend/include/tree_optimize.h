@@ -1,16 +1,126 @@
 #ifndef PROJECT_MIDEND_INCLUDE_TREE_OPTIMIZE_H_NCLUDED
 #define PROJECT_MIDEND_INCLUDE_TREE_OPTIMIZE_H_NCLUDED
 
+#include <stdint.h>
+
 #include "libs/AST/include/tree_info.h"
 
-const int MAX_NEUTRAL_ARGS = 2;
+struct func_summaries_t;
 
 struct args_arr_t {
     size_t* arr;
     size_t  size;
 };
 
-error_code tree_optimize(tree_t* tree);
+// Предел снятий узлов с рабочего списка по умолчанию
+const size_t OPTIMIZE_DEFAULT_BUDGET = (size_t)1 << 20;
+
+// Шагов интерпретатора на один вычисляемый при компиляции вызов по умолчанию
+const size_t OPTIMIZE_DEFAULT_EVAL_STEPS = (size_t)1 << 14;
+
+// Клонов функций под константные аргументы по умолчанию
+const size_t OPTIMIZE_DEFAULT_CLONE_BUDGET = 8;
+
+// -O0 ничего не делает, -O1 — только локальные упрощения, -O2 — все проходы,
+// -O3 — повторяет повторяемые проходы, пока они что-то меняют
+const int OPTIMIZE_MAX_LEVEL     = 3;
+const int OPTIMIZE_DEFAULT_LEVEL = 2;
+
+// Сколько раз -O3 может прогнать повторяемые проходы
+const size_t OPTIMIZE_MAX_ROUNDS = 4;
+
+// Не больше стольких зарегистрированных проходов
+const size_t OPTIMIZE_MAX_PASSES = 16;
+
+// Топливо и бисекция без предела
+const size_t OPTIMIZE_NO_LIMIT = (size_t)-1;
+
+struct optimize_options_t {
+    size_t      iterations_budget; // предел снятий с рабочего списка
+    bool        fast_math;         // разрешить перестановки, меняющие округление
+    size_t      eval_steps;        // шагов на вызов чистой функции, 0 — не вычислять
+    int         opt_level;         // 0..OPTIMIZE_MAX_LEVEL
+    const char* dump_after;        // имя прохода, после которого дампить дерево, или nullptr
+    size_t      jobs;              // потоков на внутрипроцедурные проходы, 0 и 1 — без потоков
+    size_t      fuel;              // посещений узлов на весь конвейер или OPTIMIZE_NO_LIMIT
+    uint64_t    time_budget_us;    // микросекунд на весь конвейер, 0 — без предела
+    size_t      bisect_limit;      // сколько запусков проходов разрешено или OPTIMIZE_NO_LIMIT
+    const char* entry_name;        // корень графа вызовов, nullptr — main
+    size_t      clone_budget;      // клонов под константные аргументы, 0 — не специализировать
+    const func_summaries_t* summaries; // сводки функций, их заводит конвейер; nullptr — вызов затирает всё
+};
+
+const optimize_options_t OPTIMIZE_DEFAULT_OPTIONS = {OPTIMIZE_DEFAULT_BUDGET, false,
+                                                     OPTIMIZE_DEFAULT_EVAL_STEPS,
+                                                     OPTIMIZE_DEFAULT_LEVEL, nullptr, 1,
+                                                     OPTIMIZE_NO_LIMIT, 0, OPTIMIZE_NO_LIMIT,
+                                                     nullptr, OPTIMIZE_DEFAULT_CLONE_BUDGET,
+                                                     nullptr};
+
+// Больше потоков не запускается, сколько бы ни попросили
+const size_t OPTIMIZE_MAX_JOBS = 64;
+
+struct optimize_pass_stats_t {
+    const char* name;
+    size_t      runs;     // запусков прохода
+    size_t      changes;  // его собственный счётчик изменений за все запуски
+    uint64_t    time_ns;  // суммарное время, в параллельном режиме — по всем потокам
+    size_t      truncated; // запусков, пропущенных или оборванных бюджетом и бисекцией
+};
+
+struct optimize_stats_t {
+    size_t tail_calls;       // хвостовых самовызовов, ставших циклом
+    size_t inlined_calls;    // встроенных вызовов
+    size_t substitutions;    // подстановок констант и копий
+    size_t calls_evaluated;  // вызовов чистых функций вычислено при компиляции
+    size_t clones;           // клонов функций под константные аргументы
+    size_t specialized_calls; // вызовов, перенаправленных на клоны
+    size_t dead_funcs;       // функций, недостижимых из корня графа вызовов
+    size_t reassociations;   // перестроенных ассоциативных цепочек
+    size_t iterations;       // узлов снято с рабочего списка
+    size_t rewrites;         // успешных переписываний узлов
+    size_t predicates;         // упрощённых сравнений и логических связок
+    size_t statements_removed; // операторов удалено как мёртвый код
+    size_t loop_invariants;    // выражений вынесено из циклов
+    size_t strength_reductions; // дорогих операций заменено дешёвыми
+    size_t cse_temps;          // временных для общих подвыражений
+    size_t dead_stores;        // присваиваний никем не читаемым переменным
+    size_t dropped_vars;       // переменных, исчезнувших из тел функций
+    bool   budget_exhausted; // остановлены бюджетом, а не неподвижной точкой
+    size_t rounds;           // прогонов повторяемых проходов на -O3
+    size_t fuel_used;        // потрачено топлива, если оно задано
+    bool   truncated;        // хоть один запуск прохода урезан бюджетом или бисекцией
+
+    optimize_pass_stats_t passes[OPTIMIZE_MAX_PASSES]; // в порядке регистрации
+    size_t                passes_count;
+};
+
+// Прогоняет конвейер проходов уровня options->opt_level (см. tree_passes.h):
+// превращает хвостовую рекурсию в цикл, встраивает маленькие функции, распространяет константы и копии, вычисляет
+// вызовы чистых функций от констант, клонирует функции под константные
+// аргументы, удаляет недостижимые функции,
+// перестраивает ассоциативные цепочки,
+// доводит дерево до неподвижной точки локальных упрощений, упрощает условия,
+// удаляет ставший мёртвым код,
+// выносит инварианты из циклов, удешевляет операции
+// с константами, убирает общие подвыражения и мёртвые присваивания.
+// options и stats_out могут быть nullptr
+error_code tree_optimize(tree_t* tree, const optimize_options_t* options, optimize_stats_t* stats_out);
+
+// Сворачивание констант и нейтральных элементов по рабочему списку до
+// неподвижной точки или исчерпания budget снятий
+error_code tree_fold_locally(tree_t* tree, size_t budget, size_t* iterations_out,
+                             size_t* rewrites_out, bool* exhausted_out);
+
+// Операция без побочных эффектов, вычислимая от констант
+bool get_is_calculatable(op_code_t op_code);
+
+// SPU считает в int: значение целое и влезает в int, так что на SPU оно то же
+bool fits_spu_int(const_val_type value);
+
+// Значение вычислимой операции от констант
+const_val_type eval_function_constant(op_code_t func_type_value,
+                                      const_val_type left_value, const_val_type right_value);
 
 tree_node_t* optimize_subtree_recursive(tree_node_t* node, error_code* error_ptr);
 
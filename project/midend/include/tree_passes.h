@@ -0,0 +1,54 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_PASSES_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_PASSES_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+#include "tree_optimize.h"
+
+const size_t OPTIMIZE_NO_PASS = (size_t)-1;
+
+// Проход добавляет свои счётчики в stats, а в changes_out кладёт число
+// изменений за этот запуск: по нему -O3 решает, нужен ли ещё прогон
+typedef error_code (*optimize_pass_func_t)(tree_t* tree, const optimize_options_t* options,
+                                           optimize_stats_t* stats, size_t* changes_out);
+
+struct optimize_pass_t {
+    const char*          name;
+    optimize_pass_func_t run;
+    int                  min_level;  // наименьший -O, на котором проход включён
+    bool                 repeat;     // повторяется на -O3
+    bool                 per_decl;   // смотрит только внутрь одной функции
+    size_t               cost;       // 1..OPTIMIZE_MAX_PASS_COST, примерно обходов дерева за запуск
+};
+
+// Дороже проходов не бывает
+const size_t OPTIMIZE_MAX_PASS_COST = 4;
+
+size_t optimize_passes_count();
+const optimize_pass_t* optimize_pass_at(size_t index);
+
+// Номер прохода по имени или OPTIMIZE_NO_PASS
+size_t optimize_find_pass(const char* name);
+
+// Проходы уровня options->opt_level в порядке регистрации. При jobs > 1
+// хвост конвейера из внутрипроцедурных проходов идёт по функциям верхнего
+// уровня в options->jobs потоков; ошибки и счётчики функций складываются в
+// порядке функций и от числа потоков не зависят. На -O3 затем
+// повторяемые, пока они что-то меняют, но не больше OPTIMIZE_MAX_ROUNDS раз.
+// Время и изменения каждого прохода копятся в stats->passes,
+// после прохода options->dump_after дерево дампится.
+// Перед первым прогоном, после специализации и каждым кругом -O3 строятся
+// сводки функций (tree_summaries.h): проходы видят их через options->summaries.
+//
+// Бюджет. Запуск прохода стоит cost * размер дерева топлива (fold платит
+// за каждое снятие с рабочего списка и обрывается, когда топливо кончилось),
+// и проход, которому топлива не хватает, пропускается — дорогие отпадают
+// первыми, дерево при этом всегда целое. По времени проход стоимости cost
+// запускается, пока не истекла доля (MAX + 1 - cost) / MAX бюджета; начатый
+// проход время не прерывает. bisect_limit разрешает только первые N
+// запусков и печатает их номера — делением пополам по N находится проход,
+// портящий программу. С любым бюджетом потоки не используются: что урезано,
+// не должно зависеть от расписания
+error_code optimize_run_pipeline(tree_t* tree, const optimize_options_t* options,
+                                 optimize_stats_t* stats);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_PASSES_H_NCLUDED */
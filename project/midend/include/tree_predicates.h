@@ -0,0 +1,15 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_PREDICATES_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_PREDICATES_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+
+// Упрощает сравнения и && / ||: константа уходит вправо, x == x сворачивается,
+// (cmp == 1) и (cmp != 0) становятся cmp, (cmp == 0) — обратным сравнением.
+// && и || вычисляются слева направо с коротким замыканием: константа слева
+// решает всё, константа справа отбрасывает левую часть, только если та чиста.
+// if (p && q) с чистым q раскладывается на вложенные if, чтобы бэкенд
+// обошёлся одним сравнением с переходом на каждую часть.
+// simplified_out (число переписываний) может быть nullptr
+error_code tree_simplify_predicates(tree_t* tree, size_t* simplified_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_PREDICATES_H_NCLUDED */
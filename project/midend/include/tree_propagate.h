@@ -0,0 +1,14 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_PROPAGATE_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_PROPAGATE_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+#include "tree_summaries.h"
+
+// Подставляет в чтения переменных известные константы и копии (x = 5; y = x),
+// правые части присваиваний сразу сворачиваются.
+// Факты сбрасываются присваиванием, телом условия и цикла и вызовом
+// функции, не чистой по summaries (nullptr — сводок нет).
+// substituted_out может быть nullptr
+error_code tree_propagate(tree_t* tree, const func_summaries_t* summaries, size_t* substituted_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_PROPAGATE_H_NCLUDED */
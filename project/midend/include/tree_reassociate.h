@@ -0,0 +1,15 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_REASSOCIATE_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_REASSOCIATE_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+
+// Цепочки + и * из чистых операндов, которые не могут упасть, разворачиваются, операнды
+// упорядочиваются (константы в конец), константы сливаются в одну, а цепочка
+// собирается заново левым гребнем: самый глубокий операнд первым, так стек
+// VM растёт меньше всего.
+// Значения SPU целые, поэтому без fast_math сливаются только целые константы;
+// fast_math разрешает и дробные, меняя порядок округлений.
+// reassociated_out (число перестроенных цепочек) может быть nullptr
+error_code tree_reassociate(tree_t* tree, bool fast_math, size_t* reassociated_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_REASSOCIATE_H_NCLUDED */
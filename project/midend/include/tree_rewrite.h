@@ -0,0 +1,321 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_REWRITE_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_REWRITE_H_NCLUDED
+
+#include <stdint.h>
+
+#include "libs/AST/include/tree_info.h"
+#include "common/keywords/include/keywords.h"
+
+// Правила переписывания: образец из операций, констант и переменных захвата
+// и шаблон правой части, записанные в духе DSL.h:
+//
+//     RW_RULE(RW_MUL_(RW_c(0), RW_v(0)), RW_c(0))     // 0 * v = 0
+//
+// rewrite_compile ещё при сборке строит по набору правил дерево решений:
+// первый шаг — таблица по коду операции корня, дальше каждое решение смотрит
+// одну позицию образца. Сопоставление идёт по одному пути, длина которого
+// ограничена размером образца, а не числом правил. Из подошедших правил
+// выигрывает стоящее раньше.
+
+// Позиции образца нумеруются как в куче: корень 1, дети позиции p — 2p и 2p + 1
+const size_t REWRITE_MAX_DEPTH     = 3;
+const size_t REWRITE_MAX_POSITIONS = (size_t)1 << REWRITE_MAX_DEPTH;
+const size_t REWRITE_MAX_CAPTURES  = 4;
+const size_t REWRITE_MAX_RULES     = 32;
+const size_t REWRITE_MAX_DECISIONS = 128;
+const size_t REWRITE_MAX_EDGES     = 256;
+const size_t REWRITE_NO_INDEX      = (size_t)-1;
+
+enum rewrite_symbol_kind_t {
+    RW_SYM_ANY = 0,   // в образце — что угодно, в шаблоне — nullptr
+    RW_SYM_OP,
+    RW_SYM_CONST,
+    RW_SYM_CAPTURE,
+};
+
+struct rewrite_symbol_t {
+    rewrite_symbol_kind_t kind;
+    op_code_t             op_code;
+    const_val_type        value;
+    size_t                capture;
+};
+
+struct rewrite_expr_t {
+    rewrite_symbol_t at[REWRITE_MAX_POSITIONS];
+    bool             too_deep;
+};
+
+struct rewrite_rule_t {
+    rewrite_expr_t pattern;
+    rewrite_expr_t result;
+};
+
+struct rewrite_edge_t {
+    rewrite_symbol_t symbol;
+    size_t           next;
+};
+
+// position == REWRITE_NO_INDEX — лист с правилом rule (или без него)
+struct rewrite_decision_t {
+    size_t position;
+    size_t first_edge;
+    size_t edges_count;
+    size_t otherwise;    // если узел не подошёл ни к одному ребру
+    size_t rule;
+};
+
+enum rewrite_compile_error_t {
+    RW_COMPILE_OK = 0,
+    RW_COMPILE_TOO_MANY_RULES,
+    RW_COMPILE_TOO_DEEP,
+    RW_COMPILE_BAD_ROOT,       // корень образца — не операция
+    RW_COMPILE_BAD_CAPTURE,    // захват повторяется или в шаблоне нет такого в образце
+    RW_COMPILE_BAD_RESULT,     // пустой шаблон
+    RW_COMPILE_TOO_BIG,        // не хватило решений или рёбер
+};
+
+struct rewrite_program_t {
+    rewrite_rule_t          rules[REWRITE_MAX_RULES];
+    size_t                  rules_count;
+    size_t                  root[OP_CODES_COUNT];   // первое решение по коду корня
+    rewrite_decision_t      decisions[REWRITE_MAX_DECISIONS];
+    size_t                  decisions_count;
+    rewrite_edge_t          edges[REWRITE_MAX_EDGES];
+    size_t                  edges_count;
+    bool                    constant_operand_only;  // каждое правило ждёт ребёнка-константу
+    rewrite_compile_error_t error;
+};
+
+//================================================================================
+//                                 Запись правил
+//================================================================================
+
+constexpr rewrite_expr_t rewrite_const(const_val_type value) {
+    rewrite_expr_t expr = {};
+    expr.at[1].kind  = RW_SYM_CONST;
+    expr.at[1].value = value;
+    return expr;
+}
+
+constexpr rewrite_expr_t rewrite_capture(size_t index) {
+    rewrite_expr_t expr = {};
+    expr.at[1].kind    = RW_SYM_CAPTURE;
+    expr.at[1].capture = index;
+    return expr;
+}
+
+// Переносит выражение с корнем в 1 под позицию base
+constexpr void rewrite_place(rewrite_expr_t* into, const rewrite_expr_t& sub, size_t base) {
+    into->too_deep = into->too_deep || sub.too_deep;
+
+    for (size_t position = 1; position < REWRITE_MAX_POSITIONS; position++) {
+        if (sub.at[position].kind == RW_SYM_ANY) continue;
+
+        size_t level_start = 1;
+        while (level_start * 2 <= position) level_start *= 2;
+
+        size_t target = base * level_start + (position - level_start);
+        if (target >= REWRITE_MAX_POSITIONS) {
+            into->too_deep = true;
+            continue;
+        }
+        into->at[target] = sub.at[position];
+    }
+}
+
+constexpr rewrite_expr_t rewrite_op(op_code_t op_code, const rewrite_expr_t& left,
+                                    const rewrite_expr_t& right) {
+    rewrite_expr_t expr = {};
+    expr.at[1].kind    = RW_SYM_OP;
+    expr.at[1].op_code = op_code;
+    rewrite_place(&expr, left,  2);
+    rewrite_place(&expr, right, 3);
+    return expr;
+}
+
+#define RW_RULE(pattern, result)  rewrite_rule_t{(pattern), (result)}
+
+#define RW_c(val)    rewrite_const(val)
+#define RW_v(index)  rewrite_capture(index)
+#define RW_NONE      rewrite_expr_t{}
+
+#define RW_OP(op_code, left, right)  rewrite_op(op_code, left, right)
+
+#define RW_PLUS_(left, right)   RW_OP(OP_PLUS,  left, right)
+#define RW_MINUS_(left, right)  RW_OP(OP_MINUS, left, right)
+#define RW_MUL_(left, right)    RW_OP(OP_MUL,   left, right)
+#define RW_DIV_(left, right)    RW_OP(OP_DIV,   left, right)
+#define RW_POW_(left, right)    RW_OP(OP_POW,   left, right)
+#define RW_LOG_(left, right)    RW_OP(OP_LOG,   left, right)
+
+//================================================================================
+//                           Компиляция дерева решений
+//================================================================================
+
+// Без ==: -Wfloat-equal, а при сборке нужно именно точное совпадение
+constexpr bool rewrite_same_symbol(const rewrite_symbol_t& a, const rewrite_symbol_t& b) {
+    if (a.kind != b.kind) return false;
+    if (a.kind == RW_SYM_OP)    return a.op_code == b.op_code;
+    if (a.kind == RW_SYM_CONST) return !(a.value < b.value) && !(a.value > b.value);
+    return true;
+}
+
+constexpr size_t rewrite_next_position(const rewrite_program_t& program, uint32_t rules,
+                                       uint32_t tested) {
+    for (size_t position = 1; position < REWRITE_MAX_POSITIONS; position++) {
+        if (tested & ((uint32_t)1 << position)) continue;
+
+        for (size_t i = 0; i < program.rules_count; i++) {
+            if ((rules & ((uint32_t)1 << i)) == 0) continue;
+            if (program.rules[i].pattern.at[position].kind != RW_SYM_ANY) return position;
+        }
+    }
+    return REWRITE_NO_INDEX;
+}
+
+// Правила, у которых в position стоит symbol или которым там всё равно.
+// Захват подходит к любому непустому узлу: такие правила идут во все рёбра,
+// а последнее ребро "непустой узел" — для узлов, не подошедших к остальным.
+// Пустой узел уходит в otherwise, где остаются только правила без проверки.
+// Непроверенные позиции выбираются по возрастанию, так что родитель всегда
+// проверен раньше ребёнка
+constexpr size_t rewrite_build(rewrite_program_t* program, uint32_t rules, uint32_t tested) {
+    if (program->decisions_count == REWRITE_MAX_DECISIONS) {
+        program->error = RW_COMPILE_TOO_BIG;
+        return REWRITE_NO_INDEX;
+    }
+    size_t index = program->decisions_count++;
+
+    rewrite_decision_t decision = {REWRITE_NO_INDEX, 0, 0, REWRITE_NO_INDEX, REWRITE_NO_INDEX};
+
+    size_t position = rewrite_next_position(*program, rules, tested);
+    if (position == REWRITE_NO_INDEX) {
+        for (size_t i = 0; i < program->rules_count && decision.rule == REWRITE_NO_INDEX; i++) {
+            if (rules & ((uint32_t)1 << i)) decision.rule = i;
+        }
+        program->decisions[index] = decision;
+        return index;
+    }
+
+    rewrite_symbol_t symbols[REWRITE_MAX_RULES + 1] = {};
+    size_t           symbols_count = 0;
+    uint32_t         wildcards     = 0;
+    uint32_t         captured      = 0;
+
+    for (size_t i = 0; i < program->rules_count; i++) {
+        if ((rules & ((uint32_t)1 << i)) == 0) continue;
+
+        const rewrite_symbol_t& symbol = program->rules[i].pattern.at[position];
+        if (symbol.kind == RW_SYM_ANY) {
+            wildcards |= (uint32_t)1 << i;
+            continue;
+        }
+        if (symbol.kind == RW_SYM_CAPTURE) {
+            captured |= (uint32_t)1 << i;
+            continue;
+        }
+
+        bool seen = false;
+        for (size_t j = 0; j < symbols_count; j++) seen = seen || rewrite_same_symbol(symbols[j], symbol);
+        if (!seen) symbols[symbols_count++] = symbol;
+    }
+    if (captured != 0) symbols[symbols_count++] = rewrite_symbol_t{RW_SYM_CAPTURE, OP_NONE, 0, 0};
+
+    if (program->edges_count + symbols_count > REWRITE_MAX_EDGES) {
+        program->error = RW_COMPILE_TOO_BIG;
+        return REWRITE_NO_INDEX;
+    }
+
+    decision.position    = position;
+    decision.first_edge  = program->edges_count;
+    decision.edges_count = symbols_count;
+    program->edges_count += symbols_count;
+
+    uint32_t now_tested = tested | ((uint32_t)1 << position);
+    for (size_t j = 0; j < symbols_count; j++) {
+        uint32_t subset = wildcards | captured;
+        for (size_t i = 0; i < program->rules_count; i++) {
+            if ((rules & ((uint32_t)1 << i)) == 0) continue;
+            if (rewrite_same_symbol(program->rules[i].pattern.at[position], symbols[j])) {
+                subset |= (uint32_t)1 << i;
+            }
+        }
+        program->edges[decision.first_edge + j] = {symbols[j], rewrite_build(program, subset, now_tested)};
+    }
+    if (wildcards != 0) decision.otherwise = rewrite_build(program, wildcards, now_tested);
+
+    program->decisions[index] = decision;
+    return index;
+}
+
+constexpr rewrite_compile_error_t rewrite_check_rule(const rewrite_rule_t& rule) {
+    if (rule.pattern.too_deep || rule.result.too_deep) return RW_COMPILE_TOO_DEEP;
+    if (rule.pattern.at[1].kind != RW_SYM_OP)          return RW_COMPILE_BAD_ROOT;
+    if (rule.result.at[1].kind  == RW_SYM_ANY)         return RW_COMPILE_BAD_RESULT;
+
+    size_t in_pattern[REWRITE_MAX_CAPTURES] = {};
+    size_t in_result[REWRITE_MAX_CAPTURES]  = {};
+    for (size_t position = 1; position < REWRITE_MAX_POSITIONS; position++) {
+        const rewrite_symbol_t& from = rule.pattern.at[position];
+        const rewrite_symbol_t& to   = rule.result.at[position];
+
+        if (from.kind == RW_SYM_CAPTURE) {
+            if (from.capture >= REWRITE_MAX_CAPTURES) return RW_COMPILE_BAD_CAPTURE;
+            in_pattern[from.capture]++;
+        }
+        if (to.kind == RW_SYM_CAPTURE) {
+            if (to.capture >= REWRITE_MAX_CAPTURES) return RW_COMPILE_BAD_CAPTURE;
+            in_result[to.capture]++;
+        }
+    }
+
+    // Захват переносится, а не копируется: в шаблоне он не больше одного раза
+    for (size_t i = 0; i < REWRITE_MAX_CAPTURES; i++) {
+        if (in_pattern[i] > 1 || in_result[i] > 1)   return RW_COMPILE_BAD_CAPTURE;
+        if (in_result[i] == 1 && in_pattern[i] == 0) return RW_COMPILE_BAD_CAPTURE;
+    }
+    return RW_COMPILE_OK;
+}
+
+template <size_t RULES_COUNT>
+constexpr rewrite_program_t rewrite_compile(const rewrite_rule_t (&rules)[RULES_COUNT]) {
+    rewrite_program_t program = {};
+    for (size_t op = 0; op < OP_CODES_COUNT; op++) program.root[op] = REWRITE_NO_INDEX;
+
+    if (RULES_COUNT > REWRITE_MAX_RULES) {
+        program.error = RW_COMPILE_TOO_MANY_RULES;
+        return program;
+    }
+
+    program.rules_count           = RULES_COUNT;
+    program.constant_operand_only = true;
+    for (size_t i = 0; i < RULES_COUNT; i++) {
+        program.rules[i] = rules[i];
+
+        rewrite_compile_error_t error = rewrite_check_rule(rules[i]);
+        if (error != RW_COMPILE_OK) {
+            program.error = error;
+            return program;
+        }
+        program.constant_operand_only = program.constant_operand_only &&
+            (rules[i].pattern.at[2].kind == RW_SYM_CONST || rules[i].pattern.at[3].kind == RW_SYM_CONST);
+    }
+
+    for (size_t op = 0; op < OP_CODES_COUNT && program.error == RW_COMPILE_OK; op++) {
+        uint32_t subset = 0;
+        for (size_t i = 0; i < RULES_COUNT; i++) {
+            if ((size_t)rules[i].pattern.at[1].op_code == op) subset |= (uint32_t)1 << i;
+        }
+        if (subset != 0) program.root[op] = rewrite_build(&program, subset, (uint32_t)1 << 1);
+    }
+    return program;
+}
+
+//================================================================================
+
+// Первое по порядку подошедшее к node правило переписывает его на месте:
+// node остаётся тем же узлом, снятые части образца освобождаются.
+// applied_out — сработало ли правило
+error_code rewrite_apply(const rewrite_program_t* program, tree_node_t* node, bool* applied_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_REWRITE_H_NCLUDED */
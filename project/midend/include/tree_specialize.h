@@ -0,0 +1,23 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_SPECIALIZE_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_SPECIALIZE_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+
+// Вызовы с большим числом аргументов не специализируются
+const size_t SPECIALIZE_MAX_ARGS = 8;
+
+// Функции больше стольких узлов не клонируются
+const size_t SPECIALIZE_MAX_NODES = 512;
+
+// Вызов функции верхнего уровня с константными аргументами перенаправляется
+// на её клон под этот набор констант: константы подставляются в тело клона,
+// их параметры убираются (перезаписываемые телом параметры не в счёт), клон сворачивается и чистится от мёртвого кода
+// (fold_budget — бюджет сворачивания) и встаёт в список сразу за оригиналом.
+// Одинаковые наборы делят клон, новых клонов не больше clone_budget; вызовы
+// внутри клона тоже специализируются, так что рекурсия с тем же флагом
+// остаётся в клоне. Оставшийся без вызовов оригинал убирает dead-funcs.
+// clones_out и retargeted_out (перенаправленные вызовы) могут быть nullptr
+error_code tree_specialize_calls(tree_t* tree, size_t clone_budget, size_t fold_budget,
+                                 size_t* clones_out, size_t* retargeted_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_SPECIALIZE_H_NCLUDED */
@@ -0,0 +1,15 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_STRENGTH_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_STRENGTH_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+
+// Наибольшая степень, раскладываемая в умножения
+const unsigned STRENGTH_MAX_POW_EXP = 16;
+
+// Заменяет дорогие операции с константным операндом на дешёвые:
+// x^n -> умножения с возведением в квадрат, x * 2 -> x + x,
+// x / c -> x * (1 / c), если обратное точно представимо.
+// reduced_out (число замен) может быть nullptr
+error_code tree_reduce_strength(tree_t* tree, size_t* reduced_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_STRENGTH_H_NCLUDED */
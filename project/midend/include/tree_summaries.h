@@ -0,0 +1,51 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_SUMMARIES_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_SUMMARIES_H_NCLUDED
+
+#include <stdint.h>
+
+#include "libs/AST/include/tree_info.h"
+
+// Столько первых параметров различает reads_args, остальные считаются читаемыми
+const size_t SUMMARY_MAX_TRACKED_ARGS = 64;
+
+struct func_summary_t {
+    bool     known;         // имя объявлено ровно одной функцией
+    bool     is_proc;
+    bool     does_io;       // PRINT или INPUT в теле или в вызываемых
+    bool     pure;          // без ввода-вывода, вложенных объявлений и неизвестных вызовов
+    bool     terminates;    // вдобавок без циклов и рекурсии: вызов можно выбросить
+    bool     recursive;     // лежит на цикле графа вызовов
+    size_t   params_count;
+    uint64_t reads_args;    // бит i — параметр i читается в теле
+};
+
+// Боковая таблица сводок, индекс — ident_idx имени функции
+struct func_summaries_t {
+    func_summary_t* by_ident;
+    size_t          idents_count;
+    size_t          funcs_count;
+};
+
+// Сводки снизу вверх по графу вызовов: компоненты сильной связности
+// (взаимная рекурсия) обрабатываются целиком после всех вызываемых ими.
+// Чистота сохраняется преобразованиями, так что устаревшая таблица
+// остаётся верной; функции, которых в ней нет, считаются затирающими всё
+error_code func_summaries_build(const tree_t* tree, func_summaries_t* summaries);
+void       func_summaries_destroy(func_summaries_t* summaries);
+
+// Сводка функции с таким именем или nullptr. summaries может быть nullptr
+const func_summary_t* func_summaries_find(const func_summaries_t* summaries, size_t name_idx);
+
+// Сводка вызываемой в CALL(FUNC_INFO(args, name), nullptr) или nullptr
+const func_summary_t* func_summaries_callee(const func_summaries_t* summaries, const tree_node_t* call);
+
+// Вызов ничего не меняет вне себя: его можно не считать затирающим переменные
+bool func_summaries_call_is_pure(const func_summaries_t* summaries, const tree_node_t* call);
+
+// Вызов чист и всегда завершается: неиспользуемый результат можно выбросить
+bool func_summaries_call_is_removable(const func_summaries_t* summaries, const tree_node_t* call);
+
+// false, только если вызываемая точно не читает параметр arg_idx
+bool func_summary_reads_arg(const func_summary_t* summary, size_t arg_idx);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_SUMMARIES_H_NCLUDED */
@@ -0,0 +1,14 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_TAIL_CALLS_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_TAIL_CALLS_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+
+// Превращает `return f(args)` внутри самой f в присваивание параметрам
+// (через временные, чтобы аргументы считались от старых значений) и continue,
+// а тело функции — в while (1) { тело; break; }. Вызовы внутри собственных
+// while функции не трогаются: continue ушёл бы не в тот цикл, такие вызовы
+// бэкенд переводит в переход с повторным использованием кадра.
+// eliminated_out (число убранных вызовов) может быть nullptr
+error_code tree_eliminate_tail_calls(tree_t* tree, size_t* eliminated_out);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_TAIL_CALLS_H_NCLUDED */
@@ -0,0 +1,41 @@
+#ifndef PROJECT_MIDEND_INCLUDE_TREE_TEMPS_H_NCLUDED
+#define PROJECT_MIDEND_INCLUDE_TREE_TEMPS_H_NCLUDED
+
+#include "libs/AST/include/tree_info.h"
+
+// Запас новых имён на один запуск прохода: под него проходы заводят таблицы
+// по идентификаторам, а параллельный режим — заглушки
+const size_t MIDEND_MAX_TEMPS = 1024;
+const size_t MIDEND_JOB_TEMPS = 64;
+const size_t MIDEND_NO_TEMP   = (size_t)-1;
+
+// Заводит новую временную переменную в ident_stack дерева. Счетчик номеров
+// и текст имён принадлежат дереву. Имена не пересекаются с пользовательскими:
+// в них есть точка. MIDEND_NO_TEMP, если в параллельном режиме кончился блок элемента
+size_t midend_new_temp(tree_t* tree, const char* prefix, error_code* error);
+
+// Параллельный режим: каждому из jobs_count элементов заранее заводится
+// в ident_stack свой блок заглушек: MIDEND_JOB_TEMPS и еще по одной на
+// несколько из job_nodes[job] узлов элемента. midend_new_temp в потоке лишь
+// переименовывает заглушку из блока элемента, не трогая общий стек.
+// Вызывать до запуска потоков
+error_code midend_temps_reserve(tree_t* tree, const size_t* job_nodes, size_t jobs_count);
+
+// Временные потока дальше берутся из блока элемента job
+void midend_temps_enter_job(size_t job);
+
+// Выходит из параллельного режима: взятые заглушки в порядке элементов
+// получают идентификаторы подряд и окончательные имена, неиспользованные
+// снимаются. Поэтому результат не зависит от того, как легли потоки.
+// Вызывать после завершения потоков
+error_code midend_temps_release(tree_t* tree);
+
+// Ставит stmt перед оператором, лежащим в *stmt_slot_ref, и сдвигает
+// *stmt_slot_ref на новое место оператора
+error_code midend_insert_before(tree_node_t*** stmt_slot_ref, tree_node_t* stmt);
+
+// Ставит `temp = expr` перед оператором, лежащим в *stmt_slot_ref, и сдвигает
+// *stmt_slot_ref на новое место оператора: следующая вставка встанет после этой
+error_code midend_assign_before(tree_node_t*** stmt_slot_ref, size_t temp_idx, tree_node_t* expr);
+
+#endif /* PROJECT_MIDEND_INCLUDE_TREE_TEMPS_H_NCLUDED */
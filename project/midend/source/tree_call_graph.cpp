@@ -0,0 +1,352 @@
+#include <stdlib.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "libs/My_string/include/my_string.h"
+#include "common/keywords/include/keywords.h"
+#include "libs/Vector/include/vector.h"
+#include "libs/Unordered_map/include/unordered_map.h"
+#include "tree_call_graph.h"
+#include "tree_node_utils.h"
+
+struct graph_build_t {
+    call_graph_t* graph;
+    error_code    error;
+};
+
+//================================================================================
+
+static bool node_is_decl(const tree_node_t* node) {
+    return midend_node_is_func(node, OP_FUNC_DECL) || midend_node_is_func(node, OP_PROC_DECL);
+}
+
+static call_graph_func_t* func_at(const call_graph_t* graph, size_t index) {
+    return (call_graph_func_t*)vector_get(&graph->funcs, index);
+}
+
+static call_graph_edge_t* edge_at(const call_graph_t* graph, size_t index) {
+    return (call_graph_edge_t*)vector_get(&graph->edges, index);
+}
+
+static size_t name_idx_hash(const void* key) {
+    return *(const size_t*)key * 0x9E3779B97F4A7C15ull;
+}
+
+static bool name_idx_cmp(const void* a, const void* b) {
+    return *(const size_t*)a == *(const size_t*)b;
+}
+
+static size_t decl_hash(const void* key) {
+    return (size_t)(*(const tree_node_t* const*)key) * 0x9E3779B97F4A7C15ull;
+}
+
+static bool decl_cmp(const void* a, const void* b) {
+    return *(const tree_node_t* const*)a == *(const tree_node_t* const*)b;
+}
+
+static size_t find_func(const call_graph_t* graph, size_t name_idx) {
+    size_t index = CALL_GRAPH_NO_FUNC;
+    if (!u_map_get_elem(&graph->by_name, &name_idx, &index)) return CALL_GRAPH_NO_FUNC;
+    return index;
+}
+
+static size_t* first_out_of(call_graph_t* graph, size_t caller) {
+    return caller == CALL_GRAPH_NO_FUNC ? &graph->top_first_out : &func_at(graph, caller)->first_out;
+}
+
+static c_string_t func_name(const call_graph_t* graph, size_t index) {
+    return graph->tree->ident_stack->data[func_at(graph, index)->name_idx];
+}
+
+//================================================================================
+//                                Построение
+//================================================================================
+
+static void collect_funcs(graph_build_t* build, tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION || build->error != ERROR_NO) return;
+
+    if (node_is_decl(node)) {
+        const tree_node_t* info = node->left;
+        if (!midend_node_is_func(info, OP_FUNC_INFO) || info->right == nullptr ||
+            info->right->type != IDENT) return;
+
+        call_graph_func_t func = {};
+        func.decl      = node;
+        func.name_idx  = info->right->value.ident_idx;
+        func.is_proc   = node->value.func == OP_PROC_DECL;
+        func.first_out = CALL_GRAPH_NO_EDGE;
+
+        size_t index = vector_size(&build->graph->funcs);
+        if (vector_push_back(&build->graph->funcs, &func) != VEC_ERR_OK) {
+            build->error |= ERROR_MEM_ALLOC;
+            return;
+        }
+        // При повторном имени вызовы идут к первому объявлению
+        if (find_func(build->graph, func.name_idx) == CALL_GRAPH_NO_FUNC &&
+            u_map_insert_elem(&build->graph->by_name, &func.name_idx, &index) != HM_ERR_OK) {
+            build->error |= ERROR_MEM_ALLOC;
+        }
+        const tree_node_t* decl = node;
+        if (u_map_insert_elem(&build->graph->by_decl, &decl, &index) != HM_ERR_OK) build->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+
+    collect_funcs(build, node->left);
+    collect_funcs(build, node->right);
+}
+
+// Повтор ищется только среди рёбер caller
+static void add_edge(graph_build_t* build, size_t caller, size_t callee) {
+    size_t* first = first_out_of(build->graph, caller);
+    for (size_t i = *first; i != CALL_GRAPH_NO_EDGE; i = edge_at(build->graph, i)->next_out) {
+        call_graph_edge_t* edge = edge_at(build->graph, i);
+        if (edge->callee == callee) {
+            edge->sites++;
+            return;
+        }
+    }
+
+    size_t            index = vector_size(&build->graph->edges);
+    call_graph_edge_t edge  = {caller, callee, 1, *first};
+    if (vector_push_back(&build->graph->edges, &edge) != VEC_ERR_OK) {
+        build->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+    *first_out_of(build->graph, caller) = index;
+}
+
+// Вложенные объявления — отдельные вершины, их вызовы им и принадлежат
+static void collect_edges(graph_build_t* build, size_t caller, const tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION || build->error != ERROR_NO) return;
+
+    if (node_is_decl(node)) {
+        const tree_node_t* info = node->left;
+        size_t own = midend_node_is_func(info, OP_FUNC_INFO) && info->right != nullptr && info->right->type == IDENT ?
+                     find_func(build->graph, info->right->value.ident_idx) : CALL_GRAPH_NO_FUNC;
+        if (own != CALL_GRAPH_NO_FUNC) {
+            collect_edges(build, own, node->right);
+            return;
+        }
+    }
+
+    // CALL(FUNC_INFO(args, name), nullptr)
+    if (midend_node_is_func(node, OP_CALL) && midend_node_is_func(node->left, OP_FUNC_INFO) &&
+        node->left->right != nullptr && node->left->right->type == IDENT) {
+        size_t callee = find_func(build->graph, node->left->right->value.ident_idx);
+        if (callee != CALL_GRAPH_NO_FUNC) add_edge(build, caller, callee);
+    }
+
+    collect_edges(build, caller, node->left);
+    collect_edges(build, caller, node->right);
+}
+
+static void mark_reachable(call_graph_t* graph, size_t from) {
+    for (size_t i = *first_out_of(graph, from); i != CALL_GRAPH_NO_EDGE; i = edge_at(graph, i)->next_out) {
+        const call_graph_edge_t* edge = edge_at(graph, i);
+
+        call_graph_func_t* callee = func_at(graph, edge->callee);
+        if (callee->reachable) continue;
+
+        callee->reachable = true;
+        mark_reachable(graph, edge->callee);
+    }
+}
+
+static size_t find_root(const call_graph_t* graph, const char* root_name) {
+    for (size_t i = 0; i < vector_size(&graph->funcs); i++) {
+        if (my_scstrcmp(func_name(graph, i), root_name) == 0) return i;
+    }
+    return CALL_GRAPH_NO_FUNC;
+}
+
+error_code call_graph_build(const tree_t* tree, const char* root_name, call_graph_t* graph) {
+    HARD_ASSERT(tree  != nullptr, "call_graph_build: tree is nullptr");
+    HARD_ASSERT(graph != nullptr, "call_graph_build: graph is nullptr");
+
+    if (root_name == nullptr) root_name = CALL_GRAPH_DEFAULT_ROOT;
+
+    *graph = {};
+    graph->tree          = tree;
+    graph->root          = CALL_GRAPH_NO_FUNC;
+    graph->top_first_out = CALL_GRAPH_NO_EDGE;
+
+    if (SIMPLE_VECTOR_INIT(&graph->funcs, 16, call_graph_func_t) != VEC_ERR_OK ||
+        SIMPLE_VECTOR_INIT(&graph->edges, 32, call_graph_edge_t) != VEC_ERR_OK ||
+        SIMPLE_U_MAP_INIT(&graph->by_name, 16, size_t, size_t, name_idx_hash, name_idx_cmp) != HM_ERR_OK ||
+        SIMPLE_U_MAP_INIT(&graph->by_decl, 16, const tree_node_t*, size_t, decl_hash, decl_cmp) != HM_ERR_OK) {
+        LOGGER_ERROR("call_graph_build: init failed");
+        call_graph_destroy(graph);
+        return ERROR_MEM_ALLOC;
+    }
+    if (tree->root == nullptr || tree->ident_stack == nullptr) return ERROR_NO;
+
+    graph_build_t build = {graph, ERROR_NO};
+    collect_funcs(&build, tree->root);
+    collect_edges(&build, CALL_GRAPH_NO_FUNC, tree->root);
+    if (build.error != ERROR_NO) {
+        call_graph_destroy(graph);
+        return build.error;
+    }
+
+    graph->root = find_root(graph, root_name);
+    if (graph->root == CALL_GRAPH_NO_FUNC) {
+        LOGGER_WARNING("call_graph_build: no root function '%s', everything is reachable", root_name);
+        for (size_t i = 0; i < vector_size(&graph->funcs); i++) func_at(graph, i)->reachable = true;
+        return ERROR_NO;
+    }
+
+    func_at(graph, graph->root)->reachable = true;
+    mark_reachable(graph, graph->root);
+    mark_reachable(graph, CALL_GRAPH_NO_FUNC);
+
+    LOGGER_DEBUG("call_graph_build: %zu functions, %zu call edges",
+                 vector_size(&graph->funcs), vector_size(&graph->edges));
+    return ERROR_NO;
+}
+
+void call_graph_destroy(call_graph_t* graph) {
+    if (graph == nullptr) return;
+
+    vector_destroy(&graph->funcs);
+    vector_destroy(&graph->edges);
+    u_map_destroy(&graph->by_name);
+    u_map_destroy(&graph->by_decl);
+    graph->root = CALL_GRAPH_NO_FUNC;
+}
+
+//================================================================================
+//                                 Выгрузка
+//================================================================================
+
+static const char* const CALL_GRAPH_TOP_NAME = "<top>";
+
+static bool has_top_calls(const call_graph_t* graph) {
+    return graph->top_first_out != CALL_GRAPH_NO_EDGE;
+}
+
+static int print_node_name(const call_graph_t* graph, FILE* file, size_t index) {
+    if (index == CALL_GRAPH_NO_FUNC) return fprintf(file, "\"%s\"", CALL_GRAPH_TOP_NAME);
+
+    c_string_t name = func_name(graph, index);
+    return fprintf(file, "\"%.*s\"", (int)name.len, name.ptr);
+}
+
+error_code call_graph_write_dot(const call_graph_t* graph, FILE* file) {
+    HARD_ASSERT(graph != nullptr, "call_graph_write_dot: graph is nullptr");
+    HARD_ASSERT(file  != nullptr, "call_graph_write_dot: file is nullptr");
+
+    bool ok = fprintf(file, "digraph calls {\n") >= 0;
+    if (has_top_calls(graph)) ok = ok && fprintf(file, "    \"%s\" [shape=point];\n", CALL_GRAPH_TOP_NAME) >= 0;
+
+    for (size_t i = 0; i < vector_size(&graph->funcs) && ok; i++) {
+        const call_graph_func_t* func = func_at(graph, i);
+
+        const char* style = i == graph->root   ? " [shape=doublecircle]" :
+                            !func->reachable  ? " [style=dashed, color=gray]" : "";
+        ok = fprintf(file, "    ") >= 0 && print_node_name(graph, file, i) >= 0 &&
+             fprintf(file, "%s;\n", style) >= 0;
+    }
+
+    for (size_t i = 0; i < vector_size(&graph->edges) && ok; i++) {
+        const call_graph_edge_t* edge = edge_at(graph, i);
+        ok = fprintf(file, "    ") >= 0 && print_node_name(graph, file, edge->caller) >= 0 &&
+             fprintf(file, " -> ") >= 0 && print_node_name(graph, file, edge->callee) >= 0 &&
+             fprintf(file, " [label=\"%zu\"];\n", edge->sites) >= 0;
+    }
+
+    ok = ok && fprintf(file, "}\n") >= 0;
+    return ok ? ERROR_NO : ERROR_OPEN_FILE;
+}
+
+error_code call_graph_write_json(const call_graph_t* graph, FILE* file) {
+    HARD_ASSERT(graph != nullptr, "call_graph_write_json: graph is nullptr");
+    HARD_ASSERT(file  != nullptr, "call_graph_write_json: file is nullptr");
+
+    bool ok = fprintf(file, "{\n  \"root\": ") >= 0;
+    ok = ok && (graph->root == CALL_GRAPH_NO_FUNC ? fprintf(file, "null") :
+                                                    print_node_name(graph, file, graph->root)) >= 0;
+    ok = ok && fprintf(file, ",\n  \"functions\": [") >= 0;
+
+    for (size_t i = 0; i < vector_size(&graph->funcs) && ok; i++) {
+        const call_graph_func_t* func = func_at(graph, i);
+        ok = fprintf(file, "%s\n    {\"name\": ", i == 0 ? "" : ",") >= 0 &&
+             print_node_name(graph, file, i) >= 0 &&
+             fprintf(file, ", \"kind\": \"%s\", \"reachable\": %s}",
+                     func->is_proc ? "proc" : "func", func->reachable ? "true" : "false") >= 0;
+    }
+
+    ok = ok && fprintf(file, "\n  ],\n  \"calls\": [") >= 0;
+    for (size_t i = 0; i < vector_size(&graph->edges) && ok; i++) {
+        const call_graph_edge_t* edge = edge_at(graph, i);
+        ok = fprintf(file, "%s\n    {\"caller\": ", i == 0 ? "" : ",") >= 0 &&
+             print_node_name(graph, file, edge->caller) >= 0 &&
+             fprintf(file, ", \"callee\": ") >= 0 &&
+             print_node_name(graph, file, edge->callee) >= 0 &&
+             fprintf(file, ", \"sites\": %zu}", edge->sites) >= 0;
+    }
+
+    ok = ok && fprintf(file, "\n  ]\n}\n") >= 0;
+    return ok ? ERROR_NO : ERROR_OPEN_FILE;
+}
+
+//================================================================================
+//                        Удаление недостижимых функций
+//================================================================================
+
+static bool decl_is_dead(const call_graph_t* graph, const tree_node_t* node) {
+    size_t index = CALL_GRAPH_NO_FUNC;
+    if (!u_map_get_elem(&graph->by_decl, &node, &index)) return false;
+
+    return !func_at(graph, index)->reachable;
+}
+
+// Недостижимые объявления уходят из списков LCAT вместе со связкой
+static error_code remove_dead(const call_graph_t* graph, tree_node_t** slot, size_t* removed) {
+    tree_node_t* node = *slot;
+    if (node == nullptr || node->type != FUNCTION) return ERROR_NO;
+
+    if (node_is_decl(node)) {
+        if (!decl_is_dead(graph, node)) return ERROR_NO;
+
+        *slot = nullptr;
+        (*removed)++;
+        return destroy_node_recursive(node, nullptr);
+    }
+
+    if (node->value.func == OP_LCAT) {
+        error_code error = ERROR_NO;
+        error |= remove_dead(graph, &node->left,  removed);
+        error |= remove_dead(graph, &node->right, removed);
+
+        if (node->left == nullptr || node->right == nullptr) {
+            *slot = node->left != nullptr ? node->left : node->right;
+            free_node(node);
+        }
+        return error;
+    }
+
+    if (node->value.func == OP_VIS_START) return remove_dead(graph, &node->right, removed);
+    return ERROR_NO;
+}
+
+error_code tree_remove_dead_funcs(tree_t* tree, const char* root_name, size_t* removed_out) {
+    HARD_ASSERT(tree != nullptr, "tree_remove_dead_funcs: tree is nullptr");
+
+    if (removed_out != nullptr) *removed_out = 0;
+    if (tree->root == nullptr || tree->ident_stack == nullptr) return ERROR_NO;
+
+    call_graph_t graph = {};
+    error_code error = call_graph_build(tree, root_name, &graph);
+    if (error != ERROR_NO) return error;
+
+    size_t removed = 0;
+    error = remove_dead(&graph, &tree->root, &removed);
+    call_graph_destroy(&graph);
+
+    LOGGER_DEBUG("tree_remove_dead_funcs: %zu functions removed", removed);
+    if (removed_out != nullptr) *removed_out = removed;
+    return error;
+}
@@ -0,0 +1,362 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "libs/Vector/include/vector.h"
+#include "tree_optimize.h"
+#include "tree_summaries.h"
+#include "tree_const_eval.h"
+#include "tree_node_utils.h"
+
+static const size_t         NO_FUNC        = (size_t)-1;
+static const const_val_type EVAL_PRECISION = 1e-9;
+
+struct eval_func_t {
+    tree_node_t* decl;
+    size_t       name_idx;
+    bool         is_proc;
+    bool         pure;
+};
+
+// Значения переменных одного вызова, индекс — ident_idx.
+// У кадра верхнего уровня массивов нет: там переменные не определены
+struct eval_frame_t {
+    const_val_type* values;
+    bool*           defined;
+};
+
+enum eval_flow_t {
+    EVAL_FLOW_NEXT,
+    EVAL_FLOW_RETURN,
+    EVAL_FLOW_FINISH,
+    EVAL_FLOW_BREAK,
+    EVAL_FLOW_CONTINUE,
+    EVAL_FLOW_FAIL,
+};
+
+struct eval_state_t {
+    tree_t*    tree;
+    vector_t   funcs;        // eval_func_t
+    size_t     idents_count;
+    size_t     steps_left;
+    size_t     depth;
+    size_t     evaluated;
+    error_code error;
+};
+
+//================================================================================
+
+static eval_func_t* func_at(eval_state_t* state, size_t index) {
+    return (eval_func_t*)vector_get(&state->funcs, index);
+}
+
+static size_t find_func(eval_state_t* state, size_t name_idx) {
+    for (size_t i = 0; i < vector_size(&state->funcs); i++) {
+        if (func_at(state, i)->name_idx == name_idx) return i;
+    }
+    return NO_FUNC;
+}
+
+// CALL(FUNC_INFO(args, name), nullptr)
+static size_t find_callee(eval_state_t* state, const tree_node_t* call) {
+    if (!midend_node_is_func(call, OP_CALL) || !midend_node_is_func(call->left, OP_FUNC_INFO)) return NO_FUNC;
+
+    const tree_node_t* name = call->left->right;
+    if (name == nullptr || name->type != IDENT) return NO_FUNC;
+
+    return find_func(state, name->value.ident_idx);
+}
+
+static bool is_truthy(const_val_type value) {
+    return fabs(value) > EVAL_PRECISION;
+}
+
+static bool take_step(eval_state_t* state) {
+    if (state->steps_left == 0) return false;
+    state->steps_left--;
+    return true;
+}
+
+//================================================================================
+//                               Чистота
+//================================================================================
+
+static void collect_funcs(eval_state_t* state, tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    if (node->value.func == OP_FUNC_DECL || node->value.func == OP_PROC_DECL) {
+        const tree_node_t* info = node->left;
+        if (!midend_node_is_func(info, OP_FUNC_INFO) || info->right == nullptr ||
+            info->right->type != IDENT) return;
+
+        eval_func_t func = {};
+        func.decl     = node;
+        func.name_idx = info->right->value.ident_idx;
+        func.is_proc  = node->value.func == OP_PROC_DECL;
+
+        if (vector_push_back(&state->funcs, &func) != VEC_ERR_OK) state->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+
+    collect_funcs(state, node->left);
+    collect_funcs(state, node->right);
+}
+
+// Чистота берётся из сводок: функция без сводки не вычисляется
+static void mark_pure(eval_state_t* state, const func_summaries_t* summaries) {
+    for (size_t i = 0; i < vector_size(&state->funcs); i++) {
+        eval_func_t*          func    = func_at(state, i);
+        const func_summary_t* summary = func_summaries_find(summaries, func->name_idx);
+        func->pure = summary != nullptr && summary->pure;
+    }
+}
+
+//================================================================================
+//                            Интерпретатор
+//================================================================================
+
+static bool eval_call(eval_state_t* state, eval_frame_t* frame,
+                      const tree_node_t* call, const_val_type* value_out);
+
+static bool eval_expr(eval_state_t* state, eval_frame_t* frame,
+                      const tree_node_t* node, const_val_type* value_out) {
+    if (node == nullptr || !take_step(state)) return false;
+
+    if (node->type == CONSTANT) {
+        *value_out = node->value.constant;
+        return fits_spu_int(*value_out);
+    }
+
+    if (node->type == IDENT) {
+        size_t ident_idx = node->value.ident_idx;
+        if (frame->defined == nullptr || ident_idx >= state->idents_count ||
+            !frame->defined[ident_idx]) return false;
+
+        *value_out = frame->values[ident_idx];
+        return true;
+    }
+
+    op_code_t op_code = node->value.func;
+
+    if (op_code == OP_CALL) return eval_call(state, frame, node, value_out);
+
+    if (op_code == OP_ASSIGN) {
+        const tree_node_t* name = node->left;
+        if (name == nullptr || name->type != IDENT || name->value.ident_idx >= state->idents_count ||
+            frame->defined == nullptr) return false;
+
+        const_val_type value = 0;
+        if (!eval_expr(state, frame, node->right, &value)) return false;
+
+        frame->values[name->value.ident_idx]  = value;
+        frame->defined[name->value.ident_idx] = true;
+        *value_out = value;
+        return true;
+    }
+
+    if (op_code == OP_ENUM_SEP || !get_is_calculatable(op_code)) return false;
+
+    // Унарный минус: MINUS(nullptr, x)
+    const_val_type left_value  = 0;
+    const_val_type right_value = 0;
+    if (node->left == nullptr && op_code != OP_MINUS) return false;
+    if (node->left != nullptr && !eval_expr(state, frame, node->left,  &left_value))  return false;
+    if (!eval_expr(state, frame, node->right, &right_value))                          return false;
+
+    const_val_type value = eval_function_constant(op_code, left_value, right_value);
+    // На SPU дробное значение было бы другим: такой вызов не вычисляется
+    if (!fits_spu_int(value)) return false;
+
+    *value_out = value;
+    return true;
+}
+
+static eval_flow_t exec_stmt(eval_state_t* state, eval_frame_t* frame,
+                             const tree_node_t* node, const_val_type* return_out) {
+    if (node == nullptr) return EVAL_FLOW_NEXT;
+    if (!take_step(state)) return EVAL_FLOW_FAIL;
+
+    const_val_type value = 0;
+
+    if (node->type != FUNCTION) {
+        return eval_expr(state, frame, node, &value) ? EVAL_FLOW_NEXT : EVAL_FLOW_FAIL;
+    }
+
+    op_code_t op_code = node->value.func;
+
+    if (op_code == OP_LCAT || op_code == OP_VIS_START) {
+        eval_flow_t flow = exec_stmt(state, frame, node->left, return_out);
+        if (flow != EVAL_FLOW_NEXT) return flow;
+        return exec_stmt(state, frame, node->right, return_out);
+    }
+
+    if (op_code == OP_IF) {
+        if (!eval_expr(state, frame, node->left, &value)) return EVAL_FLOW_FAIL;
+        return is_truthy(value) ? exec_stmt(state, frame, node->right, return_out) : EVAL_FLOW_NEXT;
+    }
+
+    // Каждый проход тратит шаги, поэтому бесконечный цикл упрётся в бюджет
+    if (op_code == OP_WHILE) {
+        while (true) {
+            if (!eval_expr(state, frame, node->left, &value)) return EVAL_FLOW_FAIL;
+            if (!is_truthy(value)) return EVAL_FLOW_NEXT;
+
+            eval_flow_t flow = exec_stmt(state, frame, node->right, return_out);
+            if (flow == EVAL_FLOW_BREAK) return EVAL_FLOW_NEXT;
+            if (flow != EVAL_FLOW_NEXT && flow != EVAL_FLOW_CONTINUE) return flow;
+        }
+    }
+
+    if (op_code == OP_BREAK)    return EVAL_FLOW_BREAK;
+    if (op_code == OP_CONTINUE) return EVAL_FLOW_CONTINUE;
+    if (op_code == OP_FINISH)   return EVAL_FLOW_FINISH;
+
+    if (op_code == OP_RETURN) {
+        const tree_node_t* expr = node->right != nullptr ? node->right : node->left;
+        if (!eval_expr(state, frame, expr, return_out)) return EVAL_FLOW_FAIL;
+        return EVAL_FLOW_RETURN;
+    }
+
+    return eval_expr(state, frame, node, &value) ? EVAL_FLOW_NEXT : EVAL_FLOW_FAIL;
+}
+
+static bool bind_params(eval_state_t* state, eval_frame_t* caller, eval_frame_t* callee,
+                        tree_node_t* params, tree_node_t* args) {
+    vector_t param_items = {};
+    vector_t arg_items   = {};
+    if (SIMPLE_VECTOR_INIT(&param_items, 8, tree_node_t*) != VEC_ERR_OK ||
+        SIMPLE_VECTOR_INIT(&arg_items,   8, tree_node_t*) != VEC_ERR_OK) {
+        vector_destroy(&param_items);
+        state->error |= ERROR_MEM_ALLOC;
+        return false;
+    }
+
+    midend_collect_enum_items(params, &param_items, &state->error);
+    midend_collect_enum_items(args,   &arg_items,   &state->error);
+
+    bool ok = state->error == ERROR_NO && vector_size(&param_items) == vector_size(&arg_items);
+
+    // Аргументы вычисляются в кадре вызывающего, а потом пишутся в новый кадр
+    for (size_t i = 0; ok && i < vector_size(&arg_items); i++) {
+        const tree_node_t* param = *(tree_node_t**)vector_get(&param_items, i);
+        const tree_node_t* arg   = *(tree_node_t**)vector_get(&arg_items,   i);
+
+        const_val_type value = 0;
+        ok = param->type == IDENT && param->value.ident_idx < state->idents_count &&
+             eval_expr(state, caller, arg, &value);
+        if (!ok) break;
+
+        callee->values[param->value.ident_idx]  = value;
+        callee->defined[param->value.ident_idx] = true;
+    }
+
+    vector_destroy(&arg_items);
+    vector_destroy(&param_items);
+    return ok;
+}
+
+static bool eval_call(eval_state_t* state, eval_frame_t* frame,
+                      const tree_node_t* call, const_val_type* value_out) {
+    size_t callee_index = find_callee(state, call);
+    if (callee_index == NO_FUNC || state->depth >= CONST_EVAL_MAX_DEPTH) return false;
+
+    const eval_func_t* func = func_at(state, callee_index);
+    if (!func->pure) return false;
+
+    eval_frame_t callee = {};
+    callee.values  = (const_val_type*)calloc(state->idents_count, sizeof(const_val_type));
+    callee.defined = (bool*)          calloc(state->idents_count, sizeof(bool));
+    if (callee.values == nullptr || callee.defined == nullptr) {
+        LOGGER_ERROR("eval_call: calloc failed");
+        state->error |= ERROR_MEM_ALLOC;
+        free(callee.values);
+        free(callee.defined);
+        return false;
+    }
+
+    const_val_type result = 0;
+    bool ok = bind_params(state, frame, &callee, func->decl->left->left, call->left->left);
+
+    if (ok) {
+        state->depth++;
+        eval_flow_t flow = exec_stmt(state, &callee, func->decl->right, &result);
+        state->depth--;
+
+        // func обязана вернуть значение, proc ничего не возвращает
+        if (func->is_proc) ok = flow == EVAL_FLOW_NEXT || flow == EVAL_FLOW_FINISH;
+        else               ok = flow == EVAL_FLOW_RETURN;
+    }
+
+    free(callee.values);
+    free(callee.defined);
+
+    if (ok) *value_out = result;
+    return ok;
+}
+
+//================================================================================
+
+static void fold_calls(eval_state_t* state, tree_node_t* node, size_t step_budget) {
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    // Сначала вложенные: f(g(2)) сворачивается и тогда, когда f не уложилась
+    fold_calls(state, node->left,  step_budget);
+    fold_calls(state, node->right, step_budget);
+
+    if (node->value.func != OP_CALL) return;
+
+    size_t callee_index = find_callee(state, node);
+    if (callee_index == NO_FUNC || func_at(state, callee_index)->is_proc) return;
+
+    eval_frame_t   outer = {};
+    const_val_type value = 0;
+    state->steps_left = step_budget;
+    state->depth      = 0;
+    if (!eval_call(state, &outer, node, &value)) return;
+
+    state->error |= destroy_node_recursive(node->left, nullptr);
+    node->left           = nullptr;
+    node->type           = CONSTANT;
+    node->value.constant = value;
+    state->evaluated++;
+}
+
+error_code tree_evaluate_pure_calls(tree_t* tree, const func_summaries_t* summaries,
+                                    size_t step_budget, size_t* evaluated_out) {
+    HARD_ASSERT(tree != nullptr, "tree_evaluate_pure_calls: tree is nullptr");
+
+    if (evaluated_out != nullptr) *evaluated_out = 0;
+    if (tree->root == nullptr || tree->ident_stack == nullptr || step_budget == 0) return ERROR_NO;
+
+    eval_state_t state = {};
+    state.tree         = tree;
+    state.idents_count = tree->ident_stack->size;
+
+    if (SIMPLE_VECTOR_INIT(&state.funcs, 8, eval_func_t) != VEC_ERR_OK) {
+        LOGGER_ERROR("tree_evaluate_pure_calls: vector_init failed");
+        return ERROR_MEM_ALLOC;
+    }
+
+    // Без готовых сводок проход считает их сам
+    func_summaries_t own_summaries = {};
+    if (summaries == nullptr) {
+        state.error |= func_summaries_build(tree, &own_summaries);
+        summaries    = &own_summaries;
+    }
+
+    if (state.error == ERROR_NO) collect_funcs(&state, tree->root);
+    if (state.error == ERROR_NO) mark_pure(&state, summaries);
+    if (state.error == ERROR_NO) fold_calls(&state, tree->root, step_budget);
+
+    func_summaries_destroy(&own_summaries);
+    vector_destroy(&state.funcs);
+
+    LOGGER_DEBUG("tree_evaluate_pure_calls: %zu calls evaluated", state.evaluated);
+    if (evaluated_out != nullptr) *evaluated_out = state.evaluated;
+    return state.error;
+}
@@ -0,0 +1,340 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "libs/Vector/include/vector.h"
+#include "libs/Unordered_map/include/unordered_map.h"
+#include "tree_optimize.h"
+#include "tree_temps.h"
+#include "tree_summaries.h"
+#include "tree_cse.h"
+#include "tree_node_utils.h"
+
+//================================================================================
+//                            Номера значений
+//================================================================================
+
+// Чтение переменной нумеруется вместе с её версией и эпохой вызовов
+// (вызов чистой по сводке функции эпоху не меняет),
+// поэтому после присваивания то же выражение получает новый номер.
+// Операции нумеруются в пределах блока: вхождения из разных блоков не совпадают.
+
+enum cse_key_kind_t {
+    CSE_KEY_CONSTANT = 1,
+    CSE_KEY_IDENT    = 2,
+    CSE_KEY_FUNCTION = 3,
+};
+
+struct cse_key_t {
+    size_t kind;
+    size_t a;
+    size_t b;
+    size_t c;
+    size_t d;
+};
+
+struct cse_value_t {
+    tree_node_t* first;    // первое вхождение
+    size_t       stmt;     // оператор, перед которым объявляется временная
+    size_t       temp_idx; // NO_VALUE, пока повторов не было
+    size_t       cost;     // число операций в выражении
+};
+
+static const size_t NO_VALUE     = (size_t)-1;
+static const size_t CSE_MIN_COST = 2;
+
+struct cse_state_t {
+    tree_t*    tree;
+    const func_summaries_t* summaries;
+    u_map_t    numbers;  // cse_key_t -> номер значения
+    vector_t   values;   // cse_value_t по номеру значения
+    vector_t   stmts;    // tree_node_t**: текущий слот оператора
+    size_t*    versions;
+    size_t     versions_count;
+    size_t     epoch;
+    size_t     region;
+    size_t     regions_count;
+    size_t     temps;
+    error_code error;
+};
+
+static size_t cse_key_hash(const void* key_ptr) {
+    HARD_ASSERT(key_ptr != nullptr, "key_ptr is nullptr");
+    const cse_key_t* key = (const cse_key_t*)key_ptr;
+
+    uint64_t hash = 1469598103934665603ull;
+    const size_t parts[] = {key->kind, key->a, key->b, key->c, key->d};
+    for (size_t part : parts) {
+        hash ^= part;
+        hash *= 1099511628211ull;
+    }
+    return (size_t)hash;
+}
+
+static bool cse_key_cmp(const void* left_ptr, const void* right_ptr) {
+    HARD_ASSERT(left_ptr  != nullptr, "left_ptr is nullptr");
+    HARD_ASSERT(right_ptr != nullptr, "right_ptr is nullptr");
+    return memcmp(left_ptr, right_ptr, sizeof(cse_key_t)) == 0;
+}
+
+static cse_value_t* value_at(cse_state_t* state, size_t number) {
+    return (cse_value_t*)vector_get(&state->values, number);
+}
+
+static size_t number_of(cse_state_t* state, const cse_key_t* key, tree_node_t* node,
+                        size_t stmt, size_t cost) {
+    size_t number = NO_VALUE;
+    if (u_map_get_elem(&state->numbers, key, &number)) return number;
+
+    number = vector_size(&state->values);
+    cse_value_t value = {node, stmt, NO_VALUE, cost};
+
+    if (vector_push_back(&state->values, &value)          != VEC_ERR_OK ||
+        u_map_insert_elem(&state->numbers, key, &number) != HM_ERR_OK) {
+        LOGGER_ERROR("number_of: allocation failed");
+        state->error |= ERROR_MEM_ALLOC;
+        return NO_VALUE;
+    }
+    return number;
+}
+
+//================================================================================
+//                          Временные переменные
+//================================================================================
+
+static size_t new_temp_ident(cse_state_t* state) {
+    // Таблица версий рассчитана на MIDEND_MAX_TEMPS новых имён: дальше повторы остаются
+    if (state->tree->ident_stack->size >= state->versions_count) return NO_VALUE;
+
+    size_t temp_idx = midend_new_temp(state->tree, "cse", &state->error);
+    if (temp_idx == MIDEND_NO_TEMP) return NO_VALUE;
+
+    if (temp_idx >= state->versions_count) {
+        LOGGER_ERROR("new_temp_ident: ident index out of versions table");
+        state->error |= ERROR_INCORRECT_INDEX;
+        return NO_VALUE;
+    }
+    state->temps++;
+    return temp_idx;
+}
+
+static void turn_into_ident(tree_node_t* node, size_t ident_idx) {
+    node->type            = IDENT;
+    node->value.ident_idx = ident_idx;
+    node->left            = nullptr;
+    node->right           = nullptr;
+}
+
+// Первое вхождение переезжает в `temp = expr` перед своим оператором,
+// а на его месте остаётся чтение temp
+static bool hoist_into_temp(cse_state_t* state, cse_value_t* value) {
+    size_t temp_idx = new_temp_ident(state);
+    if (temp_idx == NO_VALUE) return false;
+
+    tree_node_t* first = value->first;
+    tree_node_t* moved = init_node(first->type, first->value, first->left, first->right);
+    if (moved == nullptr) {
+        LOGGER_ERROR("hoist_into_temp: init_node failed");
+        state->error |= ERROR_MEM_ALLOC;
+        return false;
+    }
+
+    tree_node_t*** slot_ref = (tree_node_t***)vector_get(&state->stmts, value->stmt);
+    state->error |= midend_assign_before(slot_ref, temp_idx, moved);
+    if (state->error != ERROR_NO) return false;
+
+    turn_into_ident(first, temp_idx);
+    value->temp_idx = temp_idx;
+    return true;
+}
+
+static void replace_with_temp(cse_state_t* state, tree_node_t* node, size_t temp_idx) {
+    state->error |= destroy_node_recursive(node->left,  nullptr);
+    state->error |= destroy_node_recursive(node->right, nullptr);
+    turn_into_ident(node, temp_idx);
+}
+
+//================================================================================
+//                        Нумерация выражений
+//================================================================================
+
+// Возвращает номер значения узла; повторы заменяются временной снизу вверх
+static size_t cse_number_expr(cse_state_t* state, tree_node_t* node, size_t stmt,
+                              size_t* cost_out) {
+    *cost_out = 0;
+    if (node == nullptr || state->error != ERROR_NO) return NO_VALUE;
+
+    cse_key_t key = {};
+
+    if (node->type == CONSTANT) {
+        key.kind = CSE_KEY_CONSTANT;
+        memcpy(&key.a, &node->value.constant, sizeof(node->value.constant));
+        return number_of(state, &key, node, stmt, 0);
+    }
+
+    if (node->type == IDENT) {
+        size_t ident_idx = node->value.ident_idx;
+        key.kind = CSE_KEY_IDENT;
+        key.a    = ident_idx;
+        key.b    = (ident_idx < state->versions_count) ? state->versions[ident_idx] : 0;
+        key.c    = state->epoch;
+        return number_of(state, &key, node, stmt, 0);
+    }
+
+    size_t left_cost  = 0;
+    size_t right_cost = 0;
+    key.kind = CSE_KEY_FUNCTION;
+    key.a    = (size_t)node->value.func;
+    key.b    = cse_number_expr(state, node->left,  stmt, &left_cost);
+    key.c    = cse_number_expr(state, node->right, stmt, &right_cost);
+    key.d    = state->region;
+    *cost_out = 1 + left_cost + right_cost;
+
+    size_t number = number_of(state, &key, node, stmt, *cost_out);
+    if (number == NO_VALUE || *cost_out < CSE_MIN_COST) return number;
+
+    cse_value_t* value = value_at(state, number);
+    if (value->first == node) return number;
+
+    if (value->temp_idx == NO_VALUE && !hoist_into_temp(state, value)) return number;
+
+    replace_with_temp(state, node, value->temp_idx);
+    return number;
+}
+
+static void cse_scan_expr(cse_state_t* state, tree_node_t* node, size_t stmt) {
+    if (node == nullptr || !midend_expr_is_pure(node)) return;
+
+    size_t cost = 0;
+    cse_number_expr(state, node, stmt, &cost);
+}
+
+//================================================================================
+//                              Операторы
+//================================================================================
+
+static void bump_effects(cse_state_t* state, const tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION) return;
+
+    if (node->value.func == OP_ASSIGN && node->left != nullptr && node->left->type == IDENT &&
+        node->left->value.ident_idx < state->versions_count) {
+        state->versions[node->left->value.ident_idx]++;
+    }
+    if (node->value.func == OP_CALL && !func_summaries_call_is_pure(state->summaries, node)) {
+        state->epoch++;
+    }
+
+    bump_effects(state, node->left);
+    bump_effects(state, node->right);
+}
+
+static void cse_block(cse_state_t* state, tree_node_t** slot);
+
+static void cse_stmt(cse_state_t* state, tree_node_t** slot) {
+    tree_node_t* node = *slot;
+    if (node == nullptr || state->error != ERROR_NO) return;
+
+    if (node->type != FUNCTION) return;
+
+    op_code_t op_code = node->value.func;
+
+    if (op_code == OP_LCAT) {
+        cse_stmt(state, &node->left);
+        cse_stmt(state, &node->right);
+        return;
+    }
+
+    if (op_code == OP_VIS_START) {
+        cse_block(state, &node->right);
+        return;
+    }
+
+    if (op_code == OP_FUNC_DECL || op_code == OP_PROC_DECL) {
+        state->epoch++;
+        cse_stmt(state, &node->right);
+        state->epoch++;
+        return;
+    }
+
+    // Условие цикла считается на каждой итерации, тело — отдельный блок
+    if (op_code == OP_WHILE) {
+        cse_stmt(state, &node->right);
+        bump_effects(state, node->left);
+        return;
+    }
+
+    tree_node_t** stmt_slot = slot;
+    if (vector_push_back(&state->stmts, &stmt_slot) != VEC_ERR_OK) {
+        state->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+    size_t stmt = vector_size(&state->stmts) - 1;
+
+    if (op_code == OP_IF) {
+        cse_scan_expr(state, node->left, stmt);
+        bump_effects(state, node->left);
+        cse_stmt(state, &node->right);
+        return;
+    }
+
+    if (op_code == OP_ASSIGN) {
+        cse_scan_expr(state, node->right, stmt);
+    } else if (op_code == OP_RETURN || op_code == OP_PRINT) {
+        cse_scan_expr(state, node->left,  stmt);
+        cse_scan_expr(state, node->right, stmt);
+    }
+    bump_effects(state, node);
+}
+
+static void cse_block(cse_state_t* state, tree_node_t** slot) {
+    size_t outer_region = state->region;
+    state->region = ++state->regions_count;
+
+    cse_stmt(state, slot);
+
+    state->region = outer_region;
+}
+
+//================================================================================
+
+error_code tree_eliminate_common_subexpr(tree_t* tree, const func_summaries_t* summaries, size_t* temps_out) {
+    HARD_ASSERT(tree != nullptr, "tree_eliminate_common_subexpr: tree is nullptr");
+
+    if (temps_out != nullptr) *temps_out = 0;
+    if (tree->root == nullptr || tree->ident_stack == nullptr) return ERROR_NO;
+
+    cse_state_t state = {};
+    state.tree           = tree;
+    state.summaries      = summaries;
+    state.versions_count = tree->ident_stack->size + MIDEND_MAX_TEMPS;
+    state.versions       = (size_t*)calloc(state.versions_count, sizeof(size_t));
+
+    bool init_ok = state.versions != nullptr;
+    init_ok = init_ok && SIMPLE_VECTOR_INIT(&state.values, tree->size + 1, cse_value_t)  == VEC_ERR_OK;
+    init_ok = init_ok && SIMPLE_VECTOR_INIT(&state.stmts,  64,             tree_node_t**) == VEC_ERR_OK;
+    init_ok = init_ok && SIMPLE_U_MAP_INIT(&state.numbers, tree->size + 1, cse_key_t, size_t,
+                                           cse_key_hash, cse_key_cmp) == HM_ERR_OK;
+    if (!init_ok) {
+        LOGGER_ERROR("tree_eliminate_common_subexpr: allocation failed");
+        free(state.versions);
+        vector_destroy(&state.values);
+        vector_destroy(&state.stmts);
+        return ERROR_MEM_ALLOC;
+    }
+
+    cse_stmt(&state, &tree->root);
+
+    LOGGER_DEBUG("tree_eliminate_common_subexpr: %zu temps", state.temps);
+    if (temps_out != nullptr) *temps_out = state.temps;
+
+    u_map_destroy(&state.numbers);
+    vector_destroy(&state.stmts);
+    vector_destroy(&state.values);
+    free(state.versions);
+    return state.error;
+}
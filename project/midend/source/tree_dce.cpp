@@ -0,0 +1,143 @@
+#include <math.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "tree_dce.h"
+
+static const double CMP_PRECISION = 1e-9;
+
+struct dce_state_t {
+    size_t     removed;
+    error_code error;
+};
+
+//================================================================================
+
+static bool node_is_terminator(const tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION) return false;
+
+    op_code_t op_code = node->value.func;
+    return op_code == OP_RETURN || op_code == OP_FINISH ||
+           op_code == OP_BREAK  || op_code == OP_CONTINUE;
+}
+
+static bool cond_is_constant(const tree_node_t* cond, bool* value_out) {
+    if (cond == nullptr || cond->type != CONSTANT) return false;
+
+    *value_out = fabs(cond->value.constant) >= CMP_PRECISION;
+    return true;
+}
+
+static void drop_subtree(dce_state_t* state, tree_node_t* node) {
+    if (node == nullptr) return;
+
+    state->error |= destroy_node_recursive(node, nullptr);
+    state->removed++;
+}
+
+// Заменяет узел в слоте его ребёнком, сам узел и второго ребёнка освобождает
+static void splice_child(dce_state_t* state, tree_node_t** slot, tree_node_t* keep) {
+    tree_node_t* node = *slot;
+    tree_node_t* drop = (node->left == keep) ? node->right : node->left;
+
+    if (drop != nullptr) state->error |= destroy_node_recursive(drop, nullptr);
+    free_node(node);
+    *slot = keep;
+}
+
+//================================================================================
+
+// terminated_out: после оператора управление дальше по списку не идёт
+static void dce_stmt(dce_state_t* state, tree_node_t** slot, bool* terminated_out) {
+    HARD_ASSERT(slot           != nullptr, "dce_stmt: slot is nullptr");
+    HARD_ASSERT(terminated_out != nullptr, "dce_stmt: terminated_out is nullptr");
+
+    *terminated_out = false;
+
+    tree_node_t* node = *slot;
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    op_code_t op_code = node->value.func;
+    bool      cond_value = false;
+
+    if (node_is_terminator(node)) {
+        *terminated_out = true;
+        return;
+    }
+
+    if (op_code == OP_LCAT) {
+        bool left_terminated = false;
+        dce_stmt(state, &node->left, &left_terminated);
+
+        if (left_terminated && node->right != nullptr) {
+            drop_subtree(state, node->right);
+            node->right = nullptr;
+        } else {
+            dce_stmt(state, &node->right, &left_terminated);
+        }
+        *terminated_out = left_terminated;
+
+        if      (node->right == nullptr) splice_child(state, slot, node->left);
+        else if (node->left  == nullptr) splice_child(state, slot, node->right);
+        return;
+    }
+
+    if (op_code == OP_VIS_START) {
+        dce_stmt(state, &node->right, terminated_out);
+        return;
+    }
+
+    if (op_code == OP_FUNC_DECL || op_code == OP_PROC_DECL) {
+        bool body_terminated = false;
+        dce_stmt(state, &node->right, &body_terminated);
+        return;
+    }
+
+    if (op_code == OP_IF && cond_is_constant(node->left, &cond_value)) {
+        state->removed++;
+        if (!cond_value) {
+            state->error |= destroy_node_recursive(node, nullptr);
+            *slot = nullptr;
+            return;
+        }
+
+        // Тело остаётся отдельной областью видимости на месте условия
+        splice_child(state, slot, node->right);
+        dce_stmt(state, slot, terminated_out);
+        return;
+    }
+
+    if (op_code == OP_WHILE && cond_is_constant(node->left, &cond_value) && !cond_value) {
+        state->removed++;
+        state->error |= destroy_node_recursive(node, nullptr);
+        *slot = nullptr;
+        return;
+    }
+
+    if (op_code == OP_IF || op_code == OP_WHILE) {
+        bool body_terminated = false;
+        dce_stmt(state, &node->right, &body_terminated);
+    }
+}
+
+//================================================================================
+
+error_code tree_eliminate_dead_code(tree_t* tree, size_t* removed_out) {
+    HARD_ASSERT(tree != nullptr, "tree_eliminate_dead_code: tree is nullptr");
+
+    dce_state_t state = {};
+    bool terminated = false;
+    dce_stmt(&state, &tree->root, &terminated);
+
+    LOGGER_DEBUG("tree_eliminate_dead_code: %zu statements removed", state.removed);
+    if (removed_out != nullptr) *removed_out = state.removed;
+
+    if (state.error != ERROR_NO) {
+        LOGGER_ERROR("tree_eliminate_dead_code: destroy_node_recursive failed");
+    }
+    return state.error;
+}
@@ -0,0 +1,447 @@
+#include <stdlib.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "libs/Vector/include/vector.h"
+#include "tree_temps.h"
+#include "tree_inline.h"
+#include "tree_node_utils.h"
+
+static const size_t NO_FUNC = (size_t)-1;
+
+struct inline_func_t {
+    tree_node_t* decl;
+    size_t       name_idx;
+    bool         is_proc;
+    bool         shape_ok;    // return/finish только последним оператором тела
+    bool         recursive;   // достижима из самой себя по графу вызовов
+    bool         in_progress;
+    bool         processed;
+};
+
+struct inline_edge_t {
+    size_t caller;
+    size_t callee;
+};
+
+struct inline_rename_t {
+    size_t from;
+    size_t to;
+};
+
+struct inline_state_t {
+    tree_t*    tree;
+    vector_t   funcs;    // inline_func_t
+    vector_t   edges;    // inline_edge_t: граф вызовов
+    vector_t   renames;  // inline_rename_t текущей подстановки
+    size_t     caller;
+    size_t     growth;
+    size_t     inlined;
+    bool       copy_failed;
+    error_code error;
+};
+
+//================================================================================
+
+static inline_func_t* func_at(inline_state_t* state, size_t index) {
+    return (inline_func_t*)vector_get(&state->funcs, index);
+}
+
+static size_t find_func(inline_state_t* state, size_t name_idx) {
+    for (size_t i = 0; i < vector_size(&state->funcs); i++) {
+        if (func_at(state, i)->name_idx == name_idx) return i;
+    }
+    return NO_FUNC;
+}
+
+// CALL(FUNC_INFO(args, name), nullptr)
+static bool call_name(const tree_node_t* call, size_t* name_out) {
+    if (!midend_node_is_func(call, OP_CALL) || !midend_node_is_func(call->left, OP_FUNC_INFO)) return false;
+
+    const tree_node_t* name = call->left->right;
+    if (name == nullptr || name->type != IDENT) return false;
+
+    *name_out = name->value.ident_idx;
+    return true;
+}
+
+static size_t count_ops(const tree_node_t* node, op_code_t op_code) {
+    if (node == nullptr || node->type != FUNCTION) return 0;
+    return (node->value.func == op_code ? 1 : 0) +
+           count_ops(node->left, op_code) + count_ops(node->right, op_code);
+}
+
+static tree_node_t** last_stmt_slot(tree_node_t** slot) {
+    while (midend_node_is_func(*slot, OP_LCAT) && (*slot)->right != nullptr) slot = &(*slot)->right;
+    return slot;
+}
+
+// Освобождает FUNC_INFO вызова вместе с именем; аргументы уже перенесены
+static void free_call_shell(tree_node_t* call) {
+    tree_node_t* info = call->left;
+    midend_free_enum_links(info->left);
+    free_node(info->right);
+    free_node(info);
+    call->left = nullptr;
+}
+
+//================================================================================
+//                              Граф вызовов
+//================================================================================
+
+static void collect_funcs(inline_state_t* state, tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    if (node->value.func == OP_FUNC_DECL || node->value.func == OP_PROC_DECL) {
+        const tree_node_t* info = node->left;
+        if (!midend_node_is_func(info, OP_FUNC_INFO) || info->right == nullptr ||
+            info->right->type != IDENT) return;
+
+        inline_func_t func = {};
+        func.decl     = node;
+        func.name_idx = info->right->value.ident_idx;
+        func.is_proc  = node->value.func == OP_PROC_DECL;
+
+        if (vector_push_back(&state->funcs, &func) != VEC_ERR_OK) state->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+
+    collect_funcs(state, node->left);
+    collect_funcs(state, node->right);
+}
+
+static void collect_edges(inline_state_t* state, size_t caller, const tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    size_t name_idx = 0;
+    if (call_name(node, &name_idx)) {
+        inline_edge_t edge = {caller, find_func(state, name_idx)};
+        if (edge.callee != NO_FUNC && vector_push_back(&state->edges, &edge) != VEC_ERR_OK) {
+            state->error |= ERROR_MEM_ALLOC;
+        }
+    }
+
+    collect_edges(state, caller, node->left);
+    collect_edges(state, caller, node->right);
+}
+
+static bool reaches(inline_state_t* state, size_t from, size_t target, bool* visited) {
+    for (size_t i = 0; i < vector_size(&state->edges); i++) {
+        const inline_edge_t* edge = (const inline_edge_t*)vector_get_const(&state->edges, i);
+        if (edge->caller != from) continue;
+
+        if (edge->callee == target) return true;
+        if (visited[edge->callee]) continue;
+
+        visited[edge->callee] = true;
+        if (reaches(state, edge->callee, target, visited)) return true;
+    }
+    return false;
+}
+
+// В func return только последним оператором, в proc return нет,
+// а finish разве что последним: иначе подстановку не выразить без переходов
+static bool body_shape_ok(const inline_func_t* func) {
+    tree_node_t* body = func->decl->right;
+    if (!midend_node_is_func(body, OP_VIS_START) || body->right == nullptr) return false;
+
+    const tree_node_t* last    = *last_stmt_slot(&body->right);
+    const size_t       returns = count_ops(body, OP_RETURN);
+    const size_t       ends    = count_ops(body, OP_FINISH);
+
+    if (!func->is_proc) return returns == 1 && ends == 0 && midend_node_is_func(last, OP_RETURN);
+    return returns == 0 && (ends == 0 || (ends == 1 && midend_node_is_func(last, OP_FINISH)));
+}
+
+static void analyze_funcs(inline_state_t* state) {
+    const size_t funcs_count = vector_size(&state->funcs);
+
+    for (size_t i = 0; i < funcs_count; i++) {
+        collect_edges(state, i, func_at(state, i)->decl->right);
+    }
+
+    bool* visited = (bool*)calloc(funcs_count + 1, sizeof(bool));
+    if (visited == nullptr) {
+        state->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+
+    for (size_t i = 0; i < funcs_count; i++) {
+        for (size_t j = 0; j < funcs_count; j++) visited[j] = false;
+
+        inline_func_t* func = func_at(state, i);
+        func->recursive = reaches(state, i, i, visited);
+        func->shape_ok  = body_shape_ok(func);
+    }
+    free(visited);
+}
+
+//================================================================================
+//                          Копирование тела
+//================================================================================
+
+static size_t rename_ident(inline_state_t* state, size_t from) {
+    for (size_t i = 0; i < vector_size(&state->renames); i++) {
+        const inline_rename_t* rename = (const inline_rename_t*)vector_get_const(&state->renames, i);
+        if (rename->from == from) return rename->to;
+    }
+
+    inline_rename_t rename = {from, midend_new_temp(state->tree, "inl", &state->error)};
+    if (rename.to == MIDEND_NO_TEMP || vector_push_back(&state->renames, &rename) != VEC_ERR_OK) {
+        state->copy_failed = true;
+        return from;
+    }
+    return rename.to;
+}
+
+static tree_node_t* copy_renamed(inline_state_t* state, const tree_node_t* node) {
+    if (node == nullptr) return nullptr;
+
+    value_t value = node->value;
+    if (node->type == IDENT) value.ident_idx = rename_ident(state, node->value.ident_idx);
+
+    tree_node_t* left  = copy_renamed(state, node->left);
+    tree_node_t* right = nullptr;
+
+    // Имя вызываемой функции — не переменная
+    if (midend_node_is_func(node, OP_FUNC_INFO) && node->right != nullptr) {
+        right = init_node(node->right->type, node->right->value, nullptr, nullptr);
+    } else {
+        right = copy_renamed(state, node->right);
+    }
+
+    tree_node_t* copy = init_node(node->type, value, left, right);
+    if (copy == nullptr) state->copy_failed = true;
+    return copy;
+}
+
+// Завершающий return становится `result = expr`, завершающий finish удаляется
+static void rewrite_body_tail(tree_node_t** body_slot, size_t result_idx) {
+    tree_node_t** slot = body_slot;
+    while (midend_node_is_func(*slot, OP_LCAT) && midend_node_is_func((*slot)->right, OP_LCAT)) {
+        slot = &(*slot)->right;
+    }
+
+    tree_node_t* list = *slot;
+    tree_node_t* last = midend_node_is_func(list, OP_LCAT) ? list->right : list;
+
+    if (midend_node_is_func(last, OP_RETURN)) {
+        last->value.func = OP_ASSIGN;
+        last->left       = init_node(IDENT, make_union_var(result_idx), nullptr, nullptr);
+        return;
+    }
+
+    if (midend_node_is_func(last, OP_FINISH)) {
+        if (last == list) {
+            *slot = nullptr;
+        } else {
+            *slot = list->left;
+            free_node(list);
+        }
+        free_node(last);
+    }
+}
+
+//================================================================================
+//                              Подстановка
+//================================================================================
+
+// false, если вызов остался на месте
+static bool inline_call(inline_state_t* state, tree_node_t*** stmt_slot_ref, tree_node_t* call) {
+    size_t name_idx   = 0;
+    size_t callee_idx = call_name(call, &name_idx) ? find_func(state, name_idx) : NO_FUNC;
+    if (callee_idx == NO_FUNC || callee_idx == state->caller) return false;
+
+    const inline_func_t callee     = *func_at(state, callee_idx);
+    const bool          whole_stmt = (**stmt_slot_ref == call);
+    if (!callee.shape_ok || callee.recursive || (callee.is_proc && !whole_stmt)) return false;
+
+    size_t callee_size = count_nodes_recursive(callee.decl->right);
+    if (callee_size > INLINE_MAX_CALLEE_NODES ||
+        state->growth + callee_size > INLINE_MAX_CALLER_GROWTH) return false;
+
+    vector_t params = {};
+    vector_t args   = {};
+    if (SIMPLE_VECTOR_INIT(&params, 8, tree_node_t*) != VEC_ERR_OK ||
+        SIMPLE_VECTOR_INIT(&args,   8, tree_node_t*) != VEC_ERR_OK) {
+        vector_destroy(&params);
+        state->error |= ERROR_MEM_ALLOC;
+        return false;
+    }
+    midend_collect_enum_items(callee.decl->left->left, &params, &state->error);
+    midend_collect_enum_items(call->left->left,        &args,   &state->error);
+
+    tree_node_t* body       = nullptr;
+    size_t       result_idx = MIDEND_NO_TEMP;
+
+    if (state->error == ERROR_NO && vector_size(&params) == vector_size(&args)) {
+        vector_clear(&state->renames);
+        state->copy_failed = false;
+
+        for (size_t i = 0; i < vector_size(&params); i++) {
+            rename_ident(state, (*(tree_node_t**)vector_get(&params, i))->value.ident_idx);
+        }
+        if (vector_size(&state->renames) != vector_size(&params)) state->copy_failed = true;
+        if (!callee.is_proc) result_idx = midend_new_temp(state->tree, "inl", &state->error);
+        if (!callee.is_proc && result_idx == MIDEND_NO_TEMP) state->copy_failed = true;
+
+        body = copy_renamed(state, callee.decl->right->right);
+        if (body != nullptr) rewrite_body_tail(&body, result_idx);
+
+        if (state->copy_failed || body == nullptr) {
+            state->error |= destroy_node_recursive(body, nullptr);
+            body = nullptr;
+        }
+    }
+
+    if (body != nullptr) {
+        // Аргументы вычисляются по порядку во временные параметров
+        for (size_t i = 0; i < vector_size(&args) && state->error == ERROR_NO; i++) {
+            const inline_rename_t* param = (const inline_rename_t*)vector_get_const(&state->renames, i);
+            tree_node_t*           arg   = *(tree_node_t**)vector_get(&args, i);
+            state->error |= midend_assign_before(stmt_slot_ref, param->to, arg);
+        }
+        free_call_shell(call);
+
+        if (whole_stmt) {
+            free_node(call);
+            **stmt_slot_ref = body;
+        } else {
+            state->error |= midend_insert_before(stmt_slot_ref, body);
+            call->type            = IDENT;
+            call->value.ident_idx = result_idx;
+            call->right           = nullptr;
+        }
+
+        state->growth += callee_size;
+        state->inlined++;
+    }
+
+    vector_destroy(&args);
+    vector_destroy(&params);
+    return body != nullptr;
+}
+
+// Первый завершающийся вызов (обход снизу вверх, слева направо — порядок
+// вычисления). До него в операторе вычисляется только чистое, поэтому его
+// аргументы и тело можно вынести перед оператором
+static void scan_calls(tree_node_t* node, bool is_root, tree_node_t** first_call,
+                       bool* impure) {
+    if (node == nullptr || node->type != FUNCTION) return;
+
+    scan_calls(node->left,  false, first_call, impure);
+    scan_calls(node->right, false, first_call, impure);
+
+    op_code_t op_code = node->value.func;
+    if (op_code == OP_CALL && *first_call == nullptr) *first_call = node;
+    if (op_code == OP_INPUT || (op_code == OP_ASSIGN && !is_root)) *impure = true;
+}
+
+static void inline_expr_of(inline_state_t* state, tree_node_t** stmt_slot, tree_node_t* expr,
+                           bool is_root) {
+    while (state->error == ERROR_NO) {
+        tree_node_t* call   = nullptr;
+        bool         impure = false;
+
+        scan_calls(expr, is_root, &call, &impure);
+        if (call == nullptr || impure) return;
+
+        const bool whole_stmt = (*stmt_slot == call);
+        if (!inline_call(state, &stmt_slot, call) || whole_stmt) return;
+    }
+}
+
+static void inline_stmt(inline_state_t* state, tree_node_t** slot) {
+    tree_node_t* node = *slot;
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    op_code_t op_code = node->value.func;
+
+    if (op_code == OP_LCAT) {
+        inline_stmt(state, &node->left);
+        inline_stmt(state, &node->right);
+        return;
+    }
+
+    if (op_code == OP_VIS_START) {
+        inline_stmt(state, &node->right);
+        return;
+    }
+
+    // Условие цикла считается на каждой итерации: вынести его нельзя
+    if (op_code == OP_WHILE) {
+        inline_stmt(state, &node->right);
+        return;
+    }
+
+    if (op_code == OP_IF) {
+        inline_expr_of(state, slot, node->left, false);
+        inline_stmt(state, &node->right);
+        return;
+    }
+
+    inline_expr_of(state, slot, node, true);
+}
+
+// Сначала встраиваем во вызываемые, чтобы в вызывающие шли уже готовые тела
+static void process_func(inline_state_t* state, size_t index) {
+    inline_func_t* func = func_at(state, index);
+    if (func->processed || func->in_progress) return;
+    func->in_progress = true;
+
+    for (size_t i = 0; i < vector_size(&state->edges); i++) {
+        const inline_edge_t* edge = (const inline_edge_t*)vector_get_const(&state->edges, i);
+        if (edge->caller == index) process_func(state, edge->callee);
+    }
+
+    func = func_at(state, index);
+    state->caller = index;
+    state->growth = 0;
+    inline_stmt(state, &func->decl->right);
+
+    func = func_at(state, index);
+    func->in_progress = false;
+    func->processed   = true;
+    func->shape_ok    = body_shape_ok(func);
+}
+
+//================================================================================
+
+error_code tree_inline_calls(tree_t* tree, size_t* inlined_out) {
+    HARD_ASSERT(tree != nullptr, "tree_inline_calls: tree is nullptr");
+
+    if (inlined_out != nullptr) *inlined_out = 0;
+    if (tree->root == nullptr || tree->ident_stack == nullptr) return ERROR_NO;
+
+    inline_state_t state = {};
+    state.tree = tree;
+
+    bool init_ok = SIMPLE_VECTOR_INIT(&state.funcs, 16, inline_func_t) == VEC_ERR_OK;
+    init_ok = init_ok && SIMPLE_VECTOR_INIT(&state.edges,   32, inline_edge_t)   == VEC_ERR_OK;
+    init_ok = init_ok && SIMPLE_VECTOR_INIT(&state.renames, 16, inline_rename_t) == VEC_ERR_OK;
+    if (!init_ok) {
+        LOGGER_ERROR("tree_inline_calls: allocation failed");
+        vector_destroy(&state.funcs);
+        vector_destroy(&state.edges);
+        return ERROR_MEM_ALLOC;
+    }
+
+    collect_funcs(&state, tree->root);
+    if (state.error == ERROR_NO) analyze_funcs(&state);
+
+    for (size_t i = 0; i < vector_size(&state.funcs) && state.error == ERROR_NO; i++) {
+        process_func(&state, i);
+    }
+
+    LOGGER_DEBUG("tree_inline_calls: %zu calls inlined", state.inlined);
+    if (inlined_out != nullptr) *inlined_out = state.inlined;
+
+    vector_destroy(&state.renames);
+    vector_destroy(&state.edges);
+    vector_destroy(&state.funcs);
+    return state.error;
+}
@@ -0,0 +1,207 @@
+#include <stdlib.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "tree_optimize.h"
+#include "tree_temps.h"
+#include "tree_node_utils.h"
+#include "tree_summaries.h"
+#include "tree_licm.h"
+
+struct licm_state_t {
+    tree_t*       tree;
+    const func_summaries_t* summaries;
+    bool*         assigned;       // переменные, присваиваемые в текущем цикле
+    size_t        idents_count;
+    tree_node_t** loop_slot;      // сюда, перед цикл, ставятся временные
+    size_t        hoisted;
+    error_code    error;
+};
+
+//================================================================================
+
+// false, если в цикле есть вызов не чистой по сводке функции: он затирает всё
+static bool mark_assigned(licm_state_t* state, const tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION) return true;
+
+    if (node->value.func == OP_CALL && !func_summaries_call_is_pure(state->summaries, node)) return false;
+
+    if (node->value.func == OP_ASSIGN && node->left != nullptr && node->left->type == IDENT &&
+        node->left->value.ident_idx < state->idents_count) {
+        state->assigned[node->left->value.ident_idx] = true;
+    }
+
+    return mark_assigned(state, node->left) && mark_assigned(state, node->right);
+}
+
+static bool node_is_comparison(const tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION) return false;
+
+    op_code_t op_code = node->value.func;
+    return op_code == OP_EQ || op_code == OP_NEQ || op_code == OP_LE ||
+           op_code == OP_GE || op_code == OP_LT  || op_code == OP_GT;
+}
+
+static bool is_invariant_op(op_code_t op_code) {
+    return op_code != OP_ENUM_SEP && get_is_calculatable(op_code);
+}
+
+//================================================================================
+
+static void hoist_expr(licm_state_t* state, tree_node_t* node) {
+    size_t temp_idx = midend_new_temp(state->tree, "licm", &state->error);
+    if (temp_idx == MIDEND_NO_TEMP || state->error != ERROR_NO) return;
+
+    tree_node_t* moved = init_node(node->type, node->value, node->left, node->right);
+    if (moved == nullptr) {
+        LOGGER_ERROR("hoist_expr: init_node failed");
+        state->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+
+    state->error |= midend_assign_before(&state->loop_slot, temp_idx, moved);
+    if (state->error != ERROR_NO) return;
+
+    node->type            = IDENT;
+    node->value.ident_idx = temp_idx;
+    node->left            = nullptr;
+    node->right           = nullptr;
+    state->hoisted++;
+}
+
+// true, если поддерево инвариантно; наибольшие инвариантные операции
+// выносятся, как только родитель перестаёт быть инвариантным
+static bool licm_expr(licm_state_t* state, tree_node_t* node, bool can_trap) {
+    if (node == nullptr)        return true;
+    if (node->type == CONSTANT) return true;
+    if (node->type == IDENT) {
+        size_t ident_idx = node->value.ident_idx;
+        return ident_idx < state->idents_count && !state->assigned[ident_idx];
+    }
+
+    bool left_ok  = licm_expr(state, node->left,  can_trap);
+    bool right_ok = licm_expr(state, node->right, can_trap);
+
+    if (left_ok && right_ok && is_invariant_op(node->value.func) &&
+        (can_trap || !midend_node_may_trap(node))) {
+        return true;
+    }
+
+    if (left_ok  && node->left  != nullptr && node->left->type  == FUNCTION) hoist_expr(state, node->left);
+    if (right_ok && node->right != nullptr && node->right->type == FUNCTION) hoist_expr(state, node->right);
+    return false;
+}
+
+static void licm_root_expr(licm_state_t* state, tree_node_t* node, bool can_trap) {
+    if (node == nullptr || node->type != FUNCTION) return;
+    if (licm_expr(state, node, can_trap)) hoist_expr(state, node);
+}
+
+// Сравнение в условии бэкенд превращает в один переход: форму сохраняем,
+// выносим изнутри
+static void licm_cond(licm_state_t* state, tree_node_t* cond, bool can_trap) {
+    if (!node_is_comparison(cond)) {
+        licm_root_expr(state, cond, can_trap);
+        return;
+    }
+    licm_root_expr(state, cond->left,  can_trap);
+    licm_root_expr(state, cond->right, can_trap);
+}
+
+// Выражения тела цикла, включая вложенные условия и циклы
+static void licm_body(licm_state_t* state, tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    op_code_t op_code = node->value.func;
+
+    if (op_code == OP_LCAT || op_code == OP_VIS_START) {
+        licm_body(state, node->left);
+        licm_body(state, node->right);
+        return;
+    }
+
+    if (op_code == OP_IF || op_code == OP_WHILE) {
+        licm_cond(state, node->left, false);
+        licm_body(state, node->right);
+        return;
+    }
+
+    if (op_code == OP_ASSIGN) {
+        licm_root_expr(state, node->right, false);
+        return;
+    }
+
+    if (op_code == OP_RETURN || op_code == OP_PRINT) {
+        licm_root_expr(state, node->left,  false);
+        licm_root_expr(state, node->right, false);
+    }
+}
+
+static void licm_loop(licm_state_t* state, tree_node_t** slot) {
+    tree_node_t* loop = *slot;
+
+    for (size_t i = 0; i < state->idents_count; i++) state->assigned[i] = false;
+    if (!mark_assigned(state, loop)) return;
+
+    state->loop_slot = slot;
+
+    // Условие вычисляется хотя бы раз, поэтому из него выносится всё инвариантное
+    licm_cond(state, loop->left, true);
+    licm_body(state, loop->right);
+}
+
+static void licm_stmt(licm_state_t* state, tree_node_t** slot) {
+    tree_node_t* node = *slot;
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    op_code_t op_code = node->value.func;
+
+    if (op_code == OP_LCAT) {
+        licm_stmt(state, &node->left);
+        licm_stmt(state, &node->right);
+        return;
+    }
+
+    if (op_code == OP_VIS_START || op_code == OP_FUNC_DECL || op_code == OP_PROC_DECL ||
+        op_code == OP_IF) {
+        licm_stmt(state, &node->right);
+        return;
+    }
+
+    // Внутренние циклы первыми: вынесенное из них может уйти и из внешнего
+    if (midend_node_is_func(node, OP_WHILE)) {
+        licm_stmt(state, &node->right);
+        licm_loop(state, slot);
+    }
+}
+
+//================================================================================
+
+error_code tree_hoist_loop_invariants(tree_t* tree, const func_summaries_t* summaries, size_t* hoisted_out) {
+    HARD_ASSERT(tree != nullptr, "tree_hoist_loop_invariants: tree is nullptr");
+
+    if (hoisted_out != nullptr) *hoisted_out = 0;
+    if (tree->root == nullptr || tree->ident_stack == nullptr) return ERROR_NO;
+
+    licm_state_t state = {};
+    state.tree         = tree;
+    state.summaries    = summaries;
+    state.idents_count = tree->ident_stack->size + MIDEND_MAX_TEMPS;
+    state.assigned     = (bool*)calloc(state.idents_count, sizeof(bool));
+    if (state.assigned == nullptr) {
+        LOGGER_ERROR("tree_hoist_loop_invariants: calloc failed");
+        return ERROR_MEM_ALLOC;
+    }
+
+    licm_stmt(&state, &tree->root);
+
+    LOGGER_DEBUG("tree_hoist_loop_invariants: %zu expressions hoisted", state.hoisted);
+    if (hoisted_out != nullptr) *hoisted_out = state.hoisted;
+
+    free(state.assigned);
+    return state.error;
+}
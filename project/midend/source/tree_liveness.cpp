@@ -0,0 +1,353 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "tree_summaries.h"
+#include "tree_liveness.h"
+#include "tree_node_utils.h"
+
+// Множества переменных — массивы bool, индекс — ident_idx
+struct live_state_t {
+    tree_t*    tree;
+    const func_summaries_t* summaries;
+    size_t     idents_count;
+    bool       removing;       // false, пока цикл доводится до неподвижной точки
+    bool*      break_live;     // живые после ближайшего цикла
+    bool*      continue_live;  // живые перед его условием
+    size_t     removed;
+    size_t     dropped;
+    size_t     args_zeroed;
+    error_code error;
+};
+
+//================================================================================
+
+static bool* live_alloc(live_state_t* state) {
+    bool* live = (bool*)calloc(state->idents_count + 1, sizeof(bool));
+    if (live == nullptr) {
+        LOGGER_ERROR("live_alloc: calloc failed");
+        state->error |= ERROR_MEM_ALLOC;
+    }
+    return live;
+}
+
+static void live_copy(const live_state_t* state, bool* dst, const bool* src) {
+    memcpy(dst, src, state->idents_count * sizeof(bool));
+}
+
+// true, если dst расширилось
+static bool live_union(const live_state_t* state, bool* dst, const bool* src) {
+    bool changed = false;
+    for (size_t i = 0; i < state->idents_count; i++) {
+        if (src[i] && !dst[i]) {
+            dst[i]  = true;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// Читаемые выражением переменные. Цель вложенного присваивания не читается,
+// но и не убивается: так множество остаётся с запасом
+static void add_uses(const live_state_t* state, bool* live, const tree_node_t* node) {
+    if (node == nullptr) return;
+
+    if (node->type == IDENT) {
+        if (node->value.ident_idx < state->idents_count) live[node->value.ident_idx] = true;
+        return;
+    }
+    if (node->type != FUNCTION) return;
+
+    if (node->value.func == OP_ASSIGN) {
+        add_uses(state, live, node->right);
+        return;
+    }
+
+    // Имя вызываемой функции — не переменная
+    if (node->value.func == OP_FUNC_INFO) {
+        add_uses(state, live, node->left);
+        return;
+    }
+
+    add_uses(state, live, node->left);
+    add_uses(state, live, node->right);
+}
+
+// Вызов выбрасывается, только если по сводке он чист и всегда завершается
+static bool expr_is_removable(const live_state_t* state, const tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION) return true;
+
+    op_code_t op_code = node->value.func;
+    if (op_code == OP_CALL && !func_summaries_call_is_removable(state->summaries, node)) return false;
+    if (op_code == OP_INPUT || op_code == OP_ASSIGN || op_code == OP_PRINT) return false;
+
+    return expr_is_removable(state, node->left) && expr_is_removable(state, node->right);
+}
+
+// Заменяет список оставшимся ребёнком, если второй удалён
+static void splice_list(tree_node_t** slot) {
+    tree_node_t* node = *slot;
+    if (node->left != nullptr && node->right != nullptr) return;
+
+    *slot = node->left != nullptr ? node->left : node->right;
+    free_node(node);
+}
+
+//================================================================================
+//                       Аргументы, которых не читают
+//================================================================================
+
+static size_t count_args(const tree_node_t* node) {
+    if (node == nullptr) return 0;
+    if (midend_node_is_func(node, OP_ENUM_SEP)) return count_args(node->left) + count_args(node->right);
+    return 1;
+}
+
+static void zero_unread_args(live_state_t* state, tree_node_t** slot,
+                             const func_summary_t* summary, size_t* arg_idx) {
+    tree_node_t* node = *slot;
+    if (node == nullptr || state->error != ERROR_NO) return;
+
+    if (midend_node_is_func(node, OP_ENUM_SEP)) {
+        zero_unread_args(state, &node->left,  summary, arg_idx);
+        zero_unread_args(state, &node->right, summary, arg_idx);
+        return;
+    }
+
+    size_t index = (*arg_idx)++;
+    if (func_summary_reads_arg(summary, index) || node->type == CONSTANT ||
+        !expr_is_removable(state, node)) return;
+
+    tree_node_t* zero = init_node(CONSTANT, make_union_const(0), nullptr, nullptr);
+    if (zero == nullptr) {
+        LOGGER_ERROR("zero_unread_args: init_node failed");
+        state->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+    state->error |= destroy_node_recursive(node, nullptr);
+    *slot = zero;
+    state->args_zeroed++;
+}
+
+// Аргумент, который вызываемая по сводке не читает, заменяется нулём:
+// тогда присваивания, которые кормили только его, тоже умирают
+static void drop_unread_args(live_state_t* state, tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    drop_unread_args(state, node->left);
+    drop_unread_args(state, node->right);
+
+    if (!midend_node_is_func(node, OP_CALL) || !midend_node_is_func(node->left, OP_FUNC_INFO)) return;
+
+    const func_summary_t* summary = func_summaries_callee(state->summaries, node);
+    if (summary == nullptr || count_args(node->left->left) != summary->params_count) return;
+
+    size_t arg_idx = 0;
+    zero_unread_args(state, &node->left->left, summary, &arg_idx);
+}
+
+//================================================================================
+
+static void live_stmt(live_state_t* state, tree_node_t** slot, bool* live);
+
+// Живые перед условием: выход цикла, условие и вход тела, чей выход — снова
+// условие. Пока множество растёт, тело только анализируется
+static void live_loop(live_state_t* state, tree_node_t* node, bool* live) {
+    bool* exit_live = live_alloc(state);
+    bool* head_live = live_alloc(state);
+    bool* body_live = live_alloc(state);
+    if (state->error != ERROR_NO) {
+        free(exit_live);
+        free(head_live);
+        free(body_live);
+        return;
+    }
+
+    live_copy(state, exit_live, live);
+    live_copy(state, head_live, live);
+    add_uses(state, head_live, node->left);
+
+    bool* saved_break    = state->break_live;
+    bool* saved_continue = state->continue_live;
+    bool  saved_removing = state->removing;
+    state->break_live    = exit_live;
+    state->continue_live = head_live;
+    state->removing      = false;
+
+    bool changed = true;
+    while (changed && state->error == ERROR_NO) {
+        live_copy(state, body_live, head_live);
+        live_stmt(state, &node->right, body_live);
+        changed = live_union(state, head_live, body_live);
+    }
+
+    state->removing = saved_removing;
+    if (state->removing && state->error == ERROR_NO) {
+        live_copy(state, body_live, head_live);
+        live_stmt(state, &node->right, body_live);
+    }
+
+    state->break_live    = saved_break;
+    state->continue_live = saved_continue;
+
+    live_copy(state, live, head_live);
+    free(exit_live);
+    free(head_live);
+    free(body_live);
+}
+
+static void mark_idents(const live_state_t* state, const tree_node_t* node, bool* seen) {
+    if (node == nullptr) return;
+
+    if (node->type == IDENT) {
+        if (node->value.ident_idx < state->idents_count) seen[node->value.ident_idx] = true;
+        return;
+    }
+    if (midend_node_is_func(node, OP_FUNC_INFO)) {
+        mark_idents(state, node->left, seen);
+        return;
+    }
+    mark_idents(state, node->left,  seen);
+    mark_idents(state, node->right, seen);
+}
+
+// Тело функции начинается с пустого множества: после него ничего не читается
+static void live_decl(live_state_t* state, tree_node_t* decl) {
+    bool* before = live_alloc(state);
+    bool* after  = live_alloc(state);
+    bool* params = live_alloc(state);
+    bool* live   = live_alloc(state);
+
+    if (state->error == ERROR_NO) {
+        mark_idents(state, decl->right, before);
+        if (midend_node_is_func(decl->left, OP_FUNC_INFO)) mark_idents(state, decl->left->left, params);
+
+        live_stmt(state, &decl->right, live);
+        mark_idents(state, decl->right, after);
+
+        const tree_node_t* name = midend_node_is_func(decl->left, OP_FUNC_INFO) ? decl->left->right : nullptr;
+        for (size_t i = 0; i < state->idents_count; i++) {
+            if (!before[i] || after[i] || params[i]) continue;
+
+            state->dropped++;
+            if (name != nullptr && name->type == IDENT) {
+                c_string_t func_name = state->tree->ident_stack->data[name->value.ident_idx];
+                c_string_t var_name  = state->tree->ident_stack->data[i];
+                LOGGER_INFO("tree_eliminate_dead_stores: '%.*s' dropped from '%.*s'",
+                            (int)var_name.len, var_name.ptr, (int)func_name.len, func_name.ptr);
+            }
+        }
+    }
+
+    free(before);
+    free(after);
+    free(params);
+    free(live);
+}
+
+// live на входе — живые после оператора, на выходе — перед ним
+static void live_stmt(live_state_t* state, tree_node_t** slot, bool* live) {
+    tree_node_t* node = *slot;
+    if (node == nullptr || state->error != ERROR_NO) return;
+
+    if (node->type != FUNCTION) {
+        add_uses(state, live, node);
+        return;
+    }
+
+    op_code_t op_code = node->value.func;
+
+    if (op_code == OP_LCAT || op_code == OP_VIS_START) {
+        live_stmt(state, &node->right, live);
+        live_stmt(state, &node->left,  live);
+        if (op_code == OP_LCAT) splice_list(slot);
+        return;
+    }
+
+    if (op_code == OP_FUNC_DECL || op_code == OP_PROC_DECL) {
+        live_decl(state, node);
+        return;
+    }
+
+    if (op_code == OP_IF) {
+        bool* body_live = live_alloc(state);
+        if (body_live == nullptr) return;
+
+        live_copy(state, body_live, live);
+        live_stmt(state, &node->right, body_live);
+        live_union(state, live, body_live);
+        add_uses(state, live, node->left);
+        free(body_live);
+        return;
+    }
+
+    if (op_code == OP_WHILE) {
+        live_loop(state, node, live);
+        return;
+    }
+
+    if (op_code == OP_RETURN || op_code == OP_FINISH) {
+        memset(live, 0, state->idents_count * sizeof(bool));
+        add_uses(state, live, node);
+        return;
+    }
+
+    if (op_code == OP_BREAK || op_code == OP_CONTINUE) {
+        const bool* target = op_code == OP_BREAK ? state->break_live : state->continue_live;
+        if (target != nullptr) live_copy(state, live, target);
+        return;
+    }
+
+    if (op_code == OP_ASSIGN && node->left != nullptr && node->left->type == IDENT &&
+        node->left->value.ident_idx < state->idents_count) {
+        size_t ident_idx = node->left->value.ident_idx;
+
+        if (state->removing && !live[ident_idx] && expr_is_removable(state, node->right)) {
+            state->error |= destroy_node_recursive(node, nullptr);
+            *slot = nullptr;
+            state->removed++;
+            return;
+        }
+
+        live[ident_idx] = false;
+        add_uses(state, live, node->right);
+        return;
+    }
+
+    add_uses(state, live, node);
+}
+
+//================================================================================
+
+error_code tree_eliminate_dead_stores(tree_t* tree, const func_summaries_t* summaries,
+                                      size_t* removed_out, size_t* dropped_out) {
+    HARD_ASSERT(tree != nullptr, "tree_eliminate_dead_stores: tree is nullptr");
+
+    if (removed_out != nullptr) *removed_out = 0;
+    if (dropped_out != nullptr) *dropped_out = 0;
+    if (tree->root == nullptr || tree->ident_stack == nullptr) return ERROR_NO;
+
+    live_state_t state = {};
+    state.tree         = tree;
+    state.summaries    = summaries;
+    state.idents_count = tree->ident_stack->size;
+    state.removing     = true;
+
+    drop_unread_args(&state, tree->root);
+
+    // Операторы вне функций бэкенд не исполняет, но и их переменные локальны
+    bool* live = live_alloc(&state);
+    if (live != nullptr && state.error == ERROR_NO) live_stmt(&state, &tree->root, live);
+    free(live);
+
+    LOGGER_DEBUG("tree_eliminate_dead_stores: %zu stores removed, %zu arguments zeroed, %zu variables dropped",
+                 state.removed, state.args_zeroed, state.dropped);
+    if (removed_out != nullptr) *removed_out = state.removed + state.args_zeroed;
+    if (dropped_out != nullptr) *dropped_out = state.dropped;
+    return state.error;
+}
@@ -0,0 +1,68 @@
+#include <math.h>
+
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "tree_node_utils.h"
+
+//================================================================================
+
+void midend_collect_enum_items(const tree_node_t* node, vector_t* items, error_code* error) {
+    if (node == nullptr) return;
+
+    if (midend_node_is_func(node, OP_ENUM_SEP)) {
+        midend_collect_enum_items(node->left,  items, error);
+        midend_collect_enum_items(node->right, items, error);
+        return;
+    }
+    if (vector_push_back(items, &node) != VEC_ERR_OK) *error |= ERROR_MEM_ALLOC;
+}
+
+void midend_collect_enum_array(tree_node_t* node, tree_node_t** items, size_t capacity, size_t* count) {
+    if (node == nullptr) return;
+
+    if (midend_node_is_func(node, OP_ENUM_SEP)) {
+        midend_collect_enum_array(node->left,  items, capacity, count);
+        midend_collect_enum_array(node->right, items, capacity, count);
+        return;
+    }
+    if (*count < capacity) items[*count] = node;
+    (*count)++;
+}
+
+void midend_free_enum_links(tree_node_t* node) {
+    if (!midend_node_is_func(node, OP_ENUM_SEP)) return;
+
+    midend_free_enum_links(node->left);
+    midend_free_enum_links(node->right);
+    free_node(node);
+}
+
+//================================================================================
+
+bool midend_node_may_trap(const tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION) return false;
+
+    op_code_t op_code = node->value.func;
+    if (op_code != OP_DIV && op_code != OP_LOG && op_code != OP_POW) return false;
+
+    const tree_node_t* right = node->right;
+    if (right == nullptr || right->type != CONSTANT) return true;
+    return op_code == OP_DIV && fabs(right->value.constant) < 1e-9;
+}
+
+bool midend_expr_may_trap(const tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION) return false;
+    if (midend_node_may_trap(node)) return true;
+
+    return midend_expr_may_trap(node->left) || midend_expr_may_trap(node->right);
+}
+
+bool midend_expr_is_pure(const tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION) return true;
+
+    const keyword_def_t* keyword = get_op_keyword(node->value.func);
+    if (keyword == nullptr || !keyword->is_pure) return false;
+
+    return midend_expr_is_pure(node->left) && midend_expr_is_pure(node->right);
+}
@@ -1,4 +1,6 @@
+#include <limits.h>
 #include <math.h>
+#include <string.h>
 
 #include "common/asserts/include/asserts.h"
 #include "common/logger/include/logger.h"
@@ -6,7 +8,10 @@
 #include "libs/AST/include/error_handler.h"
 #include "libs/AST/include/tree_operations.h"
 #include "common/keywords/include/keywords.h"
+#include "libs/Vector/include/vector.h"
 #include "tree_optimize.h"
+#include "tree_passes.h"
+#include "tree_rewrite.h"
 
 static const double CMP_PRECISION = 1e-9;
 
@@ -33,85 +38,6 @@ static bool node_is_constant(const tree_node_t* node) {
 
 //--------------------------------------------------------------------------------
 
-static error_code handle_fixed_elem(tree_node_t* node, const_val_type constant_value) {
-    if (node == nullptr) return ERROR_NO;
-
-    error_code error = ERROR_NO;
-
-    if (node->left) {
-        error |= destroy_node_recursive(node->left, nullptr);
-        node->left = nullptr;
-    }
-    if (node->right) {
-        error |= destroy_node_recursive(node->right, nullptr);
-        node->right = nullptr;
-    }
-
-    node->type           = CONSTANT;
-    node->value.constant = constant_value;
-
-    if (error != ERROR_NO) {
-        LOGGER_ERROR("handle_fixed_elem: destroy_node_recursive failed");
-    }
-    return error;
-}
-
-//--------------------------------------------------------------------------------
-
-static error_code handle_neutral_elem(tree_node_t* node,
-                                      tree_node_t* child_keep_ptr,
-                                      tree_node_t* child_drop_ptr) {
-    HARD_ASSERT(node           != nullptr,        "handle_neutral_elem: node is nullptr");
-    HARD_ASSERT(child_keep_ptr != nullptr, "handle_neutral_elem: child_keep_ptr is nullptr");
-
-    error_code error = ERROR_NO;
-
-    if (child_drop_ptr != nullptr) {
-        error |= destroy_node_recursive(child_drop_ptr, nullptr);
-    }
-
-    tree_node_t child_copy = *child_keep_ptr;
-    *node = child_copy;
-
-    free(child_keep_ptr);
-
-    if (error != ERROR_NO) {
-        LOGGER_ERROR("handle_neutral_elem: destroy_node_recursive failed");
-    }
-    return error;
-}
-
-//--------------------------------------------------------------------------------
-
-static const_val_type eval_function_constant(op_code_t      func_type_value,
-                                             const_val_type left_value,
-                                             const_val_type right_value) {
-
-    #define HANDLE_FUNC(func_name, ...) \
-        case func_name:                 \
-            return func_name##_func(left_value, right_value);
-
-    switch (func_type_value) {
-        #include "copy_past_file"
-        default:
-            LOGGER_ERROR("eval_function_constant: Unknown func op_code %d",
-                         (int)func_type_value);
-            return NAN;
-    }
-
-    #undef HANDLE_FUNC
-}
-
-//--------------------------------------------------------------------------------
-
-static bool get_is_calculatable(op_code_t op_code) { //TODO: change
-    for (size_t i = 0; i < KEYWORDS_COUNT; i++) {
-        if (op_code == KEYWORDS[i].op_code) return KEYWORDS[i].is_calculatable;
-    }
-    LOGGER_ERROR("Unknown op_code");
-    return false;
-}
-
 static error_code fold_constants_in_node(tree_node_t* node) {
     HARD_ASSERT(node != nullptr, "fold_constants_in_node: node is nullptr");
 
@@ -144,6 +70,11 @@ static error_code fold_constants_in_node(tree_node_t* node) {
         return ERROR_UNKNOWN_FUNC;
     }
 
+    // 5 / 2 на SPU — это 2: дробный результат от целых не сворачиваем
+    if (fits_spu_int(left_value) && fits_spu_int(right_value) && !fits_spu_int(result_value)) {
+        return ERROR_NO;
+    }
+
     error_code error = ERROR_NO;
 
     if (left_ptr != nullptr) {
@@ -167,196 +98,316 @@ static error_code fold_constants_in_node(tree_node_t* node) {
 
 //--------------------------------------------------------------------------------
 
-struct arg_rule_t {
-    const_val_type neutral_value;
-    const_val_type fixed_value;
-    const_val_type fixed_result;
+// Упрощения с нейтральными и поглощающими элементами. Правила идут по
+// приоритету: поглощение раньше, чем нейтральный элемент
+static constexpr rewrite_expr_t U = RW_v(0);
+static constexpr rewrite_expr_t V = RW_v(1);
+
+static constexpr rewrite_rule_t OP_SIMPLIFY_RULES[] = {
+    // 0 * v = 0, u * 0 = 0, 0 / v = 0
+    RW_RULE(RW_MUL_(RW_c(0), V), RW_c(0)),
+    RW_RULE(RW_MUL_(U, RW_c(0)), RW_c(0)),
+    RW_RULE(RW_DIV_(RW_c(0), V), RW_c(0)),
+
+    // 1^v = 1, u^0 = 1
+    RW_RULE(RW_POW_(RW_c(1), V), RW_c(1)),
+    RW_RULE(RW_POW_(U, RW_c(0)), RW_c(1)),
+
+    // log_u(1) = 0
+    RW_RULE(RW_LOG_(U, RW_c(1)), RW_c(0)),
+
+    // u + 0 = u, 0 + v = v, u - 0 = u
+    RW_RULE(RW_PLUS_(U, RW_c(0)),  U),
+    RW_RULE(RW_PLUS_(RW_c(0), V),  V),
+    RW_RULE(RW_MINUS_(U, RW_c(0)), U),
+
+    // 1 * v = v, u * 1 = u, u / 1 = u, u^1 = u
+    RW_RULE(RW_MUL_(RW_c(1), V), V),
+    RW_RULE(RW_MUL_(U, RW_c(1)), U),
+    RW_RULE(RW_DIV_(U, RW_c(1)), U),
+    RW_RULE(RW_POW_(U, RW_c(1)), U),
 };
 
-struct op_rule_t {
-    op_code_t  func_type_value;
-    size_t     arg_count;
-    arg_rule_t args[MAX_NEUTRAL_ARGS];
+static constexpr rewrite_program_t OP_SIMPLIFY_PROGRAM = rewrite_compile(OP_SIMPLIFY_RULES);
+static_assert(OP_SIMPLIFY_PROGRAM.error == RW_COMPILE_OK, "OP_SIMPLIFY_RULES do not compile");
+
+//--------------------------------------------------------------------------------
+
+typedef const_val_type (*op_eval_func_t)(const_val_type a, const_val_type b);
+
+// Дополнение KEYWORDS для midend: вычислитель по op_code
+struct op_midend_def_t {
+    op_eval_func_t eval;
 };
 
-#define ARG_RULE(neu, fix, res)  { (neu), (fix), (res) }
-
-static const op_rule_t OP_SIMPLIFY_RULES[] = {
-    // u + 0 = u, 0 + v = v
-    { OP_PLUS, 2, {
-        ARG_RULE(0.0, NAN, 0.0),  
-        ARG_RULE(0.0, NAN, 0.0)   
-    }},
-
-    // u - 0 = u
-    { OP_MINUS, 2, {
-        ARG_RULE(NAN, NAN, 0.0),
-        ARG_RULE(0.0, NAN, 0.0)  
-    }},
-
-    // 1 * v = v, u * 1 = u
-    // 0 * v = 0, u * 0 = 0
-    { OP_MUL, 2, {
-        ARG_RULE(1.0, 0.0, 0.0),  
-        ARG_RULE(1.0, 0.0, 0.0)  
-    }},
-
-    // 0 / v = 0   u / 1 = u
-    { OP_DIV, 2, {
-        ARG_RULE(NAN, 0.0, 0.0), 
-        ARG_RULE(1.0, NAN, 0.0)  
-    }},
-
-    // 1^v = 1  u^0 = 1  u^1 = u      
-    { OP_POW, 2, {
-        ARG_RULE(NAN, 1.0, 1.0),  
-        ARG_RULE(1.0, 0.0, 1.0)   
-    }},
-
-    // log_u(1) = 0 
-    { OP_LOG, 2, {
-        ARG_RULE(NAN, NAN, 0.0),  
-        ARG_RULE(NAN, 1.0, 0.0)   
-    }},
+struct op_midend_table_t {
+    op_midend_def_t ops[OP_CODES_COUNT];
 };
 
-#undef ARG_RULE
+static constexpr op_midend_table_t build_op_midend_table() {
+    op_midend_table_t table = {};
 
-static const op_rule_t* find_op_rule(op_code_t func_type_value) {
-    const size_t rules_count = sizeof(OP_SIMPLIFY_RULES) / sizeof(OP_SIMPLIFY_RULES[0]);
-    for (size_t i = 0; i < rules_count; ++i) {
-        if (OP_SIMPLIFY_RULES[i].func_type_value == func_type_value) {
-            return &OP_SIMPLIFY_RULES[i];
-        }
+    #define HANDLE_FUNC(op_code, ...) table.ops[op_code].eval = op_code##_func;
+    #include "copy_past_file"
+    #undef HANDLE_FUNC
+
+    return table;
+}
+
+static constexpr op_midend_table_t OP_MIDEND_TABLE = build_op_midend_table();
+
+static const op_midend_def_t* get_op_midend_def(op_code_t op_code) {
+    if ((size_t)op_code >= OP_CODES_COUNT) return nullptr;
+    return &OP_MIDEND_TABLE.ops[op_code];
+}
+
+const_val_type eval_function_constant(op_code_t      func_type_value,
+                                      const_val_type left_value,
+                                      const_val_type right_value) {
+    const op_midend_def_t* def = get_op_midend_def(func_type_value);
+    if (def == nullptr || def->eval == nullptr) {
+        LOGGER_ERROR("eval_function_constant: Unknown func op_code %d",
+                     (int)func_type_value);
+        return NAN;
     }
-    return nullptr;
+    return def->eval(left_value, right_value);
+}
+
+bool fits_spu_int(const_val_type value) {
+    return isfinite(value) && fabs(value - trunc(value)) < CMP_PRECISION && fabs(value) <= (const_val_type)INT_MAX;
+}
+
+bool get_is_calculatable(op_code_t op_code) {
+    const keyword_def_t* keyword = get_op_keyword(op_code);
+    if (keyword == nullptr) {
+        LOGGER_ERROR("Unknown op_code");
+        return false;
+    }
+    return keyword->is_calculatable;
 }
 
 //--------------------------------------------------------------------------------
-//TODO: поправить для разных фиксированных элементов аргументов
-static error_code simplify_fixed_elements(tree_node_t* node,
-                                          const op_rule_t* rule) {
-    HARD_ASSERT(node != nullptr, "simplify_fixed_elements: node is nullptr");
-    HARD_ASSERT(rule != nullptr, "simplify_fixed_elements: rule is nullptr");
 
-    tree_node_t* args[MAX_NEUTRAL_ARGS] = { node->left, node->right };
-    error_code error = ERROR_NO;
+static error_code simplify_neutral_and_constant_elements(tree_node_t* node) {
+    HARD_ASSERT(node != nullptr,
+                "simplify_neutral_and_constant_elements: node is nullptr");
+
+    bool applied = false;
+    return rewrite_apply(&OP_SIMPLIFY_PROGRAM, node, &applied);
+}
+
+//--------------------------------------------------------------------------------
+//TODO: 0^0
+tree_node_t* optimize_subtree_recursive(tree_node_t* node, error_code* error_ptr) {
+    HARD_ASSERT(error_ptr != nullptr, "optimize_subtree_recursive: error_ptr is nullptr");
 
-    for (size_t i = 0; i < rule->arg_count; ++i) {
-        const arg_rule_t& arg_rule = rule->args[i];
-        tree_node_t*      arg_node = args[i];
+    if (node == nullptr) {
+        return nullptr;
+    }
 
-        if (isnan(arg_rule.fixed_value))                                     continue;
-        if (!node_is_constant(arg_node))                                     continue;
-        if (double_cmp(arg_node->value.constant, arg_rule.fixed_value) != 0) continue;
+    if (*error_ptr != ERROR_NO) {
+        return node;
+    }
+
+    if (node->type == FUNCTION) {
+        node->left  = optimize_subtree_recursive(node->left,  error_ptr);
+        node->right = optimize_subtree_recursive(node->right, error_ptr);
 
-        error |= handle_fixed_elem(node, arg_rule.fixed_result);
-        return error;
+        *error_ptr |= fold_constants_in_node(node);
+        *error_ptr |= simplify_neutral_and_constant_elements(node);
     }
 
-    return error;
+    return node;
 }
 
+//================================================================================
+//                     Рабочий список до неподвижной точки
+//================================================================================
 
-static error_code simplify_neutral_elements(tree_node_t* node,
-                                            const op_rule_t* rule) {
-    HARD_ASSERT(node != nullptr, "simplify_neutral_elements: node is nullptr");
-    HARD_ASSERT(rule != nullptr, "simplify_neutral_elements: rule is nullptr");
+// Записи лежат в обратном порядке обхода, поэтому родитель всегда правее детей.
+// Узлы снимаются слева направо, а в список попадает только родитель
+// переписанного узла: курсор не идёт назад, и записи поддеревьев,
+// освобождённых переписыванием, больше не читаются.
 
-    tree_node_t* args[MAX_NEUTRAL_ARGS] = { node->left, node->right };
-    error_code error = ERROR_NO;
+static const size_t NO_ENTRY = (size_t)-1;
+
+struct optimize_entry_t {
+    tree_node_t* node;
+    size_t       parent;
+    bool         queued;
+};
 
-    for (size_t i = 0; i < rule->arg_count; ++i) {
-        const arg_rule_t& arg_rule = rule->args[i];
-        tree_node_t*      arg_node = args[i];
+struct optimize_worklist_t {
+    vector_t entries;
+    size_t   cursor;
+};
 
-        if (isnan(arg_rule.neutral_value))                                  continue;
-        if (!node_is_constant(arg_node))                                    continue;
-        if (double_cmp(arg_node->value.constant,  arg_rule.neutral_value))  continue;
+static optimize_entry_t* worklist_entry(optimize_worklist_t* worklist, size_t index) {
+    return (optimize_entry_t*)vector_get(&worklist->entries, index);
+}
 
-        size_t other_index = (i == 0 ? 1 : 0);
-        tree_node_t* keep_ptr = args[other_index];
-        tree_node_t* drop_ptr = arg_node;
+// Если все правила ждут константного операнда, остальные узлы можно не ставить в список
+static bool node_has_constant_child(const tree_node_t* node) {
+    return !OP_SIMPLIFY_PROGRAM.constant_operand_only ||
+           node_is_constant(node->left) || node_is_constant(node->right);
+}
 
-        if (keep_ptr != nullptr) {
-            error |= handle_neutral_elem(node, keep_ptr, drop_ptr);
-        }
-        return error;
+static size_t worklist_collect(optimize_worklist_t* worklist, tree_node_t* node,
+                               error_code* error_ptr) {
+    if (node == nullptr || node->type != FUNCTION || *error_ptr != ERROR_NO) {
+        return NO_ENTRY;
     }
 
-    return error;
+    size_t left_index  = worklist_collect(worklist, node->left,  error_ptr);
+    size_t right_index = worklist_collect(worklist, node->right, error_ptr);
+    if (*error_ptr != ERROR_NO) return NO_ENTRY;
+
+    optimize_entry_t entry = {node, NO_ENTRY, node_has_constant_child(node)};
+    if (vector_push_back(&worklist->entries, &entry) != VEC_ERR_OK) {
+        LOGGER_ERROR("worklist_collect: vector_push_back failed");
+        *error_ptr |= ERROR_MEM_ALLOC;
+        return NO_ENTRY;
+    }
+
+    size_t index = vector_size(&worklist->entries) - 1;
+    if (left_index  != NO_ENTRY) worklist_entry(worklist, left_index)->parent  = index;
+    if (right_index != NO_ENTRY) worklist_entry(worklist, right_index)->parent = index;
+
+    return index;
 }
 
-//--------------------------------------------------------------------------------
+static void worklist_push(optimize_worklist_t* worklist, size_t index) {
+    if (index == NO_ENTRY) return;
+    HARD_ASSERT(index > worklist->cursor, "worklist_push: index behind cursor");
 
-static error_code simplify_neutral_and_constant_elements(tree_node_t* node) {
-    HARD_ASSERT(node != nullptr,
-                "simplify_neutral_and_constant_elements: node is nullptr");
+    worklist_entry(worklist, index)->queued = true;
+}
 
-    if (node->type != FUNCTION) return ERROR_NO;
+static size_t worklist_pop(optimize_worklist_t* worklist) {
+    size_t count = vector_size(&worklist->entries);
 
-    const op_rule_t* rule = find_op_rule(node->value.func);
-    if (rule == nullptr) {
-        return ERROR_NO;
+    for (; worklist->cursor < count; worklist->cursor++) {
+        optimize_entry_t* entry = worklist_entry(worklist, worklist->cursor);
+        if (entry->queued) {
+            entry->queued = false;
+            return worklist->cursor;
+        }
     }
+    return NO_ENTRY;
+}
+
+//--------------------------------------------------------------------------------
+
+static bool node_unchanged(const tree_node_t* before, const tree_node_t* after) {
+    return before->type  == after->type  &&
+           before->left  == after->left  &&
+           before->right == after->right &&
+           memcmp(&before->value, &after->value, sizeof(before->value)) == 0;
+}
+
+// Применяет правила к узлу, пока они что-то меняют. Дети уже упрощены,
+// а правила оставляют на месте узла константу или упрощённого ребёнка
+static error_code rewrite_node_locally(tree_node_t* node, size_t* rewrites_out) {
+    HARD_ASSERT(node         != nullptr, "rewrite_node_locally: node is nullptr");
+    HARD_ASSERT(rewrites_out != nullptr, "rewrite_node_locally: rewrites_out is nullptr");
 
     error_code error = ERROR_NO;
+    *rewrites_out = 0;
 
-    error |= simplify_fixed_elements(node, rule);
-    if (error != ERROR_NO) {
-        return error;
-    }
+    while (node->type == FUNCTION) {
+        tree_node_t before = *node;
 
-    if (node->type != FUNCTION) {
-        return ERROR_NO;
+        error |= fold_constants_in_node(node);
+        if (error == ERROR_NO) error |= simplify_neutral_and_constant_elements(node);
+        if (error != ERROR_NO) return error;
+
+        if (node_unchanged(&before, node)) break;
+        (*rewrites_out)++;
     }
 
-    error |= simplify_neutral_elements(node, rule);
     return error;
 }
 
-//--------------------------------------------------------------------------------
-//TODO: 0^0
-tree_node_t* optimize_subtree_recursive(tree_node_t* node, error_code* error_ptr) {
-    HARD_ASSERT(error_ptr != nullptr, "optimize_subtree_recursive: error_ptr is nullptr");
+//================================================================================
 
-    if (node == nullptr) {
-        return nullptr;
+error_code tree_fold_locally(tree_t* tree, size_t budget, size_t* iterations_out,
+                             size_t* rewrites_out, bool* exhausted_out) {
+    HARD_ASSERT(tree           != nullptr, "tree_fold_locally: tree is nullptr");
+    HARD_ASSERT(iterations_out != nullptr, "tree_fold_locally: iterations_out is nullptr");
+    HARD_ASSERT(rewrites_out   != nullptr, "tree_fold_locally: rewrites_out is nullptr");
+    HARD_ASSERT(exhausted_out  != nullptr, "tree_fold_locally: exhausted_out is nullptr");
+
+    *iterations_out = 0;
+    *rewrites_out   = 0;
+    *exhausted_out  = false;
+    if (tree->root == nullptr) return ERROR_NO;
+
+    optimize_worklist_t worklist = {};
+    if (SIMPLE_VECTOR_INIT(&worklist.entries, tree->size + 1, optimize_entry_t) != VEC_ERR_OK) {
+        LOGGER_ERROR("tree_fold_locally: vector_init failed");
+        return ERROR_MEM_ALLOC;
     }
 
-    if (*error_ptr != ERROR_NO) {
-        return node;
-    }
+    error_code error_value = ERROR_NO;
+    worklist_collect(&worklist, tree->root, &error_value);
 
-    if (node->type == FUNCTION) {
-        node->left  = optimize_subtree_recursive(node->left,  error_ptr);
-        node->right = optimize_subtree_recursive(node->right, error_ptr);
+    size_t index = NO_ENTRY;
+    while (error_value == ERROR_NO && (index = worklist_pop(&worklist)) != NO_ENTRY) {
+        if (*iterations_out == budget) {
+            *exhausted_out = true;
+            break;
+        }
+        (*iterations_out)++;
 
-        *error_ptr |= fold_constants_in_node(node);
-        *error_ptr |= simplify_neutral_and_constant_elements(node);
+        optimize_entry_t* entry = worklist_entry(&worklist, index);
+
+        size_t rewrites = 0;
+        error_value |= rewrite_node_locally(entry->node, &rewrites);
+        if (rewrites == 0) continue;
+
+        *rewrites_out += rewrites;
+        worklist_push(&worklist, entry->parent);
     }
 
-    return node;
+    vector_destroy(&worklist.entries);
+
+    if (error_value != ERROR_NO) LOGGER_ERROR("tree_fold_locally: rewrite failed");
+    return error_value;
 }
 
 //================================================================================
 
-error_code tree_optimize(tree_t* tree) {
+error_code tree_optimize(tree_t* tree, const optimize_options_t* options, optimize_stats_t* stats_out) {
     HARD_ASSERT(tree != nullptr, "tree_optimize: tree is nullptr");
 
-    LOGGER_DEBUG("tree_optimize: started");
+    if (options == nullptr) options = &OPTIMIZE_DEFAULT_OPTIONS;
+
+    LOGGER_DEBUG("tree_optimize: started at -O%d", options->opt_level);
+    optimize_stats_t stats = {};
+    if (stats_out != nullptr) *stats_out = stats;
+
     if (tree->root == nullptr) {
         return ERROR_NO;
     }
 
-    error_code error_value = ERROR_NO;
-    tree->root = optimize_subtree_recursive(tree->root, &error_value);
-
+    error_code error_value = optimize_run_pipeline(tree, options, &stats);
     if (error_value != ERROR_NO) {
-        LOGGER_ERROR("tree_optimize: optimize_subtree_recursive failed");
+        LOGGER_ERROR("tree_optimize: optimize_run_pipeline failed");
         return error_value;
     }
 
+    LOGGER_DEBUG("tree_optimize: %zu tail calls, %zu inlined calls, %zu substitutions, %zu evaluated calls, "
+                 "%zu clones, %zu specialized calls, %zu dead functions, %zu reassociations, %zu iterations, %zu rewrites, %zu predicates, "
+                 "%zu dead statements, %zu loop invariants, %zu strength reductions, %zu cse temps, "
+                 "%zu dead stores, %zu dropped variables, %zu rounds%s",
+                 stats.tail_calls, stats.inlined_calls, stats.substitutions, stats.calls_evaluated,
+                 stats.clones, stats.specialized_calls, stats.dead_funcs, stats.reassociations,
+                 stats.iterations, stats.rewrites, stats.predicates, stats.statements_removed,
+                 stats.loop_invariants, stats.strength_reductions, stats.cse_temps,
+                 stats.dead_stores, stats.dropped_vars, stats.rounds,
+                 stats.budget_exhausted ? " (budget exhausted)" : "");
+
     tree->size = count_nodes_recursive(tree->root);
+    if (stats_out != nullptr) *stats_out = stats;
     return ERROR_NO;
-}
\ No newline at end of file
+}
@@ -0,0 +1,607 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <atomic>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_verification.h"
+#include "libs/AST/include/tree_operations.h"
+#include "libs/Vector/include/vector.h"
+#include "tree_optimize.h"
+#include "tree_tail_calls.h"
+#include "tree_inline.h"
+#include "tree_propagate.h"
+#include "tree_const_eval.h"
+#include "tree_call_graph.h"
+#include "tree_summaries.h"
+#include "tree_specialize.h"
+#include "tree_reassociate.h"
+#include "tree_predicates.h"
+#include "tree_dce.h"
+#include "tree_licm.h"
+#include "tree_strength.h"
+#include "tree_cse.h"
+#include "tree_liveness.h"
+#include "tree_temps.h"
+#include "tree_passes.h"
+
+//================================================================================
+//                                  Проходы
+//================================================================================
+
+static error_code pass_tail_calls(tree_t* tree, const optimize_options_t* options,
+                                  optimize_stats_t* stats, size_t* changes_out) {
+    (void)options;
+    error_code error = tree_eliminate_tail_calls(tree, changes_out);
+    stats->tail_calls += *changes_out;
+    return error;
+}
+
+static error_code pass_inline(tree_t* tree, const optimize_options_t* options,
+                              optimize_stats_t* stats, size_t* changes_out) {
+    (void)options;
+    error_code error = tree_inline_calls(tree, changes_out);
+    stats->inlined_calls += *changes_out;
+    return error;
+}
+
+static error_code pass_propagate(tree_t* tree, const optimize_options_t* options,
+                                 optimize_stats_t* stats, size_t* changes_out) {
+    error_code error = tree_propagate(tree, options->summaries, changes_out);
+    stats->substitutions += *changes_out;
+    return error;
+}
+
+static error_code pass_const_eval(tree_t* tree, const optimize_options_t* options,
+                                  optimize_stats_t* stats, size_t* changes_out) {
+    error_code error = tree_evaluate_pure_calls(tree, options->summaries, options->eval_steps, changes_out);
+    stats->calls_evaluated += *changes_out;
+    return error;
+}
+
+static error_code pass_specialize(tree_t* tree, const optimize_options_t* options,
+                                  optimize_stats_t* stats, size_t* changes_out) {
+    size_t clones = 0;
+    error_code error = tree_specialize_calls(tree, options->clone_budget, options->iterations_budget,
+                                             &clones, changes_out);
+    stats->clones            += clones;
+    stats->specialized_calls += *changes_out;
+    return error;
+}
+
+static error_code pass_dead_funcs(tree_t* tree, const optimize_options_t* options,
+                                  optimize_stats_t* stats, size_t* changes_out) {
+    error_code error = tree_remove_dead_funcs(tree, options->entry_name, changes_out);
+    stats->dead_funcs += *changes_out;
+    return error;
+}
+
+static error_code pass_reassociate(tree_t* tree, const optimize_options_t* options,
+                                   optimize_stats_t* stats, size_t* changes_out) {
+    error_code error = tree_reassociate(tree, options->fast_math, changes_out);
+    stats->reassociations += *changes_out;
+    return error;
+}
+
+static error_code pass_fold(tree_t* tree, const optimize_options_t* options,
+                            optimize_stats_t* stats, size_t* changes_out) {
+    size_t iterations = 0;
+    bool   exhausted  = false;
+    error_code error  = tree_fold_locally(tree, options->iterations_budget,
+                                          &iterations, changes_out, &exhausted);
+    stats->iterations       += iterations;
+    stats->rewrites         += *changes_out;
+    stats->budget_exhausted |= exhausted;
+    return error;
+}
+
+static error_code pass_predicates(tree_t* tree, const optimize_options_t* options,
+                                  optimize_stats_t* stats, size_t* changes_out) {
+    (void)options;
+    error_code error = tree_simplify_predicates(tree, changes_out);
+    stats->predicates += *changes_out;
+    return error;
+}
+
+static error_code pass_dce(tree_t* tree, const optimize_options_t* options,
+                           optimize_stats_t* stats, size_t* changes_out) {
+    (void)options;
+    error_code error = tree_eliminate_dead_code(tree, changes_out);
+    stats->statements_removed += *changes_out;
+    return error;
+}
+
+static error_code pass_licm(tree_t* tree, const optimize_options_t* options,
+                            optimize_stats_t* stats, size_t* changes_out) {
+    error_code error = tree_hoist_loop_invariants(tree, options->summaries, changes_out);
+    stats->loop_invariants += *changes_out;
+    return error;
+}
+
+static error_code pass_strength(tree_t* tree, const optimize_options_t* options,
+                                optimize_stats_t* stats, size_t* changes_out) {
+    (void)options;
+    error_code error = tree_reduce_strength(tree, changes_out);
+    stats->strength_reductions += *changes_out;
+    return error;
+}
+
+static error_code pass_cse(tree_t* tree, const optimize_options_t* options,
+                           optimize_stats_t* stats, size_t* changes_out) {
+    error_code error = tree_eliminate_common_subexpr(tree, options->summaries, changes_out);
+    stats->cse_temps += *changes_out;
+    return error;
+}
+
+static error_code pass_dead_stores(tree_t* tree, const optimize_options_t* options,
+                                   optimize_stats_t* stats, size_t* changes_out) {
+    size_t dropped = 0;
+    error_code error = tree_eliminate_dead_stores(tree, options->summaries, changes_out, &dropped);
+    stats->dead_stores  += *changes_out;
+    stats->dropped_vars += dropped;
+    return error;
+}
+
+// Порядок — порядок запуска. Вызовы перестраиваются до распространения
+// констант, локальные упрощения идут до проходов по циклам.
+// Межпроцедурные (inline, const-eval) стоят раньше: хвост можно гнать по функциям.
+// Стоимость — сколько раз проход примерно обходит дерево: по ней бюджет решает, кого пропустить
+static const optimize_pass_t OPTIMIZE_PASSES[] = {
+    {"tail-calls",  pass_tail_calls,  2, false, true,  1},
+    {"inline",      pass_inline,      2, false, false, 3},
+    {"propagate",   pass_propagate,   2, true,  true,  2},
+    {"const-eval",  pass_const_eval,  2, true,  false, 4},
+    {"specialize",  pass_specialize,  2, false, false, 2},
+    {"dead-funcs",  pass_dead_funcs,  1, false, false, 1},
+    {"reassociate", pass_reassociate, 2, false, true,  1},
+    {"fold",        pass_fold,        1, true,  true,  1},
+    {"predicates",  pass_predicates,  1, true,  true,  1},
+    {"dce",         pass_dce,         1, true,  true,  1},
+    {"licm",        pass_licm,        2, false, true,  3},
+    {"strength",    pass_strength,    2, false, true,  1},
+    {"cse",         pass_cse,         2, false, true,  3},
+    {"dead-stores", pass_dead_stores, 2, true,  true,  3},
+};
+
+static const size_t OPTIMIZE_PASSES_COUNT = sizeof(OPTIMIZE_PASSES) / sizeof(OPTIMIZE_PASSES[0]);
+static_assert(OPTIMIZE_PASSES_COUNT <= OPTIMIZE_MAX_PASSES, "too many passes for optimize_stats_t");
+
+size_t optimize_passes_count() {
+    return OPTIMIZE_PASSES_COUNT;
+}
+
+const optimize_pass_t* optimize_pass_at(size_t index) {
+    return index < OPTIMIZE_PASSES_COUNT ? &OPTIMIZE_PASSES[index] : nullptr;
+}
+
+size_t optimize_find_pass(const char* name) {
+    HARD_ASSERT(name != nullptr, "optimize_find_pass: name is nullptr");
+
+    for (size_t i = 0; i < OPTIMIZE_PASSES_COUNT; i++) {
+        if (strcmp(OPTIMIZE_PASSES[i].name, name) == 0) return i;
+    }
+    return OPTIMIZE_NO_PASS;
+}
+
+//================================================================================
+//                                 Конвейер
+//================================================================================
+
+static uint64_t passes_now_ns() {
+    timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static error_code run_pass(tree_t* tree, const optimize_options_t* options,
+                           optimize_stats_t* stats, size_t index, size_t* changes_out) {
+    const optimize_pass_t*  pass   = &OPTIMIZE_PASSES[index];
+    optimize_pass_stats_t*  record = &stats->passes[index];
+
+    size_t   changes = 0;
+    uint64_t start   = passes_now_ns();
+    error_code error = pass->run(tree, options, stats, &changes);
+    uint64_t spent   = passes_now_ns() - start;
+
+    record->runs++;
+    record->changes += changes;
+    record->time_ns += spent;
+    *changes_out    += changes;
+
+    LOGGER_DEBUG("optimize_run_pipeline: %s: %zu changes, %llu us", pass->name, changes,
+                 (unsigned long long)(spent / 1000));
+    if (error != ERROR_NO) {
+        LOGGER_ERROR("optimize_run_pipeline: pass '%s' failed", pass->name);
+        return error;
+    }
+
+    if (options->dump_after != nullptr && strcmp(options->dump_after, pass->name) == 0) {
+        tree_dump(tree, TREE_VER_INIT, true, "after %s", pass->name);
+    }
+    return ERROR_NO;
+}
+
+//================================================================================
+//                                  Бюджет
+//================================================================================
+
+struct pipeline_budget_t {
+    size_t   fuel_left;    // OPTIMIZE_NO_LIMIT — без предела
+    uint64_t start_ns;
+    uint64_t limit_ns;     // 0 — без предела
+    size_t   runs_left;    // бисекция
+    size_t   run_number;   // сквозной номер запуска прохода, с единицы
+};
+
+static bool budget_limited(const optimize_options_t* options) {
+    return options->fuel != OPTIMIZE_NO_LIMIT || options->time_budget_us != 0 ||
+           options->bisect_limit != OPTIMIZE_NO_LIMIT;
+}
+
+static bool budget_allows(const pipeline_budget_t* budget, const tree_t* tree,
+                          const optimize_pass_t* pass) {
+    if (budget->runs_left == 0) return false;
+
+    if (budget->limit_ns != 0) {
+        uint64_t spent = passes_now_ns() - budget->start_ns;
+        uint64_t share = budget->limit_ns / OPTIMIZE_MAX_PASS_COST *
+                         (OPTIMIZE_MAX_PASS_COST + 1 - pass->cost);
+        if (spent >= share) return false;
+    }
+
+    if (budget->fuel_left == OPTIMIZE_NO_LIMIT) return true;
+    // fold останавливается посреди работы, ему хватает любого остатка
+    if (pass->run == pass_fold) return budget->fuel_left > 0;
+    return budget->fuel_left / pass->cost >= tree->size;
+}
+
+static error_code run_budgeted_pass(tree_t* tree, const optimize_options_t* options,
+                                    optimize_stats_t* stats, pipeline_budget_t* budget,
+                                    size_t index, size_t* changes_out) {
+    if (!budget_limited(options)) return run_pass(tree, options, stats, index, changes_out);
+
+    const optimize_pass_t* pass   = &OPTIMIZE_PASSES[index];
+    optimize_pass_stats_t* record = &stats->passes[index];
+
+    // Проходы размер дерева не ведут, а топливо считается от него
+    tree->size = count_nodes_recursive(tree->root);
+    budget->run_number++;
+
+    bool allowed = budget_allows(budget, tree, pass);
+    if (options->bisect_limit != OPTIMIZE_NO_LIMIT) {
+        LOGGER_INFO("BISECT: %s pass (%zu) %s", allowed ? "running" : "NOT running",
+                    budget->run_number, pass->name);
+    }
+    if (!allowed) {
+        record->truncated++;
+        stats->truncated = true;
+        return ERROR_NO;
+    }
+    if (budget->runs_left != OPTIMIZE_NO_LIMIT) budget->runs_left--;
+
+    optimize_options_t pass_options = *options;
+    if (budget->fuel_left < pass_options.iterations_budget) {
+        pass_options.iterations_budget = budget->fuel_left;
+    }
+
+    size_t     iterations = stats->iterations;
+    error_code error      = run_pass(tree, &pass_options, stats, index, changes_out);
+
+    size_t burnt = pass->run == pass_fold ? stats->iterations - iterations : pass->cost * tree->size;
+    if (budget->fuel_left != OPTIMIZE_NO_LIMIT) {
+        burnt = burnt < budget->fuel_left ? burnt : budget->fuel_left;
+        budget->fuel_left -= burnt;
+        stats->fuel_used  += burnt;
+
+        // Оборван топливом, а не собственным бюджетом
+        if (pass->run == pass_fold && budget->fuel_left == 0 &&
+            pass_options.iterations_budget < options->iterations_budget) {
+            record->truncated++;
+            stats->truncated = true;
+        }
+    }
+    return error;
+}
+
+//================================================================================
+//                          Параллельно по функциям
+//================================================================================
+
+struct decl_job_t {
+    tree_node_t**    slot;    // элемент верхнего списка: объявление или оператор
+    optimize_stats_t stats;
+    size_t           changes;
+    error_code       error;
+};
+
+struct decl_pool_t {
+    tree_t*                   tree;
+    const optimize_options_t* options;    // без dump_after: дамп общий, после всех
+    size_t                    first_pass;
+    decl_job_t*               jobs;
+    size_t                    jobs_count;
+    std::atomic<size_t>       next_job;
+    size_t                    worker_nodes;  // запас узлов на поток
+};
+
+// С какого прохода конвейер уровня состоит только из внутрипроцедурных
+static size_t per_decl_tail_start(int opt_level) {
+    size_t start = OPTIMIZE_PASSES_COUNT;
+    for (size_t i = OPTIMIZE_PASSES_COUNT; i > 0; i--) {
+        const optimize_pass_t* pass = &OPTIMIZE_PASSES[i - 1];
+        if (pass->min_level > opt_level) continue;
+        if (!pass->per_decl) break;
+        start = i - 1;
+    }
+    return start;
+}
+
+static void collect_decl_slots(tree_node_t** slot, vector_t* slots, error_code* error) {
+    tree_node_t* node = *slot;
+    if (node == nullptr) return;
+
+    if (node->type == FUNCTION && node->value.func == OP_LCAT) {
+        collect_decl_slots(&node->left,  slots, error);
+        collect_decl_slots(&node->right, slots, error);
+        return;
+    }
+    if (vector_push_back(slots, &slot) != VEC_ERR_OK) *error |= ERROR_MEM_ALLOC;
+}
+
+static void run_decl_job(decl_pool_t* pool, size_t index) {
+    decl_job_t* job = &pool->jobs[index];
+
+    // Своё дерево-окно на элемент: общий у окон только ident_stack,
+    // а его в параллельном режиме никто не растит
+    tree_t view = *pool->tree;
+    view.root   = *job->slot;
+    view.size   = count_nodes_recursive(view.root);
+    midend_temps_enter_job(index);
+
+    for (size_t i = pool->first_pass; i < OPTIMIZE_PASSES_COUNT; i++) {
+        if (OPTIMIZE_PASSES[i].min_level > pool->options->opt_level) continue;
+
+        job->error = run_pass(&view, pool->options, &job->stats, i, &job->changes);
+        if (job->error != ERROR_NO) break;
+    }
+
+    *job->slot = view.root;
+}
+
+static void* decl_worker(void* arg) {
+    decl_pool_t* pool = (decl_pool_t*)arg;
+
+    // Запас на клоны и подстановки, чтобы поток не шел в calloc за каждым узлом.
+    // Один блок на поток: free_node просматривает все блоки пула.
+    // Не вышло — init_node обойдется calloc
+    if (tree_nodes_reserve(pool->worker_nodes) != ERROR_NO) {
+        LOGGER_WARNING("decl_worker: tree_nodes_reserve failed, nodes come from calloc");
+    }
+
+    size_t index = 0;
+    while ((index = pool->next_job.fetch_add(1)) < pool->jobs_count) {
+        run_decl_job(pool, index);
+    }
+    // Иначе освобожденные потоком узлы пропадут вместе с ним
+    tree_nodes_release();
+    return nullptr;
+}
+
+static void stats_add(optimize_stats_t* into, const optimize_stats_t* from) {
+    into->tail_calls          += from->tail_calls;
+    into->inlined_calls       += from->inlined_calls;
+    into->substitutions       += from->substitutions;
+    into->calls_evaluated     += from->calls_evaluated;
+    into->clones              += from->clones;
+    into->specialized_calls   += from->specialized_calls;
+    into->dead_funcs          += from->dead_funcs;
+    into->reassociations      += from->reassociations;
+    into->iterations          += from->iterations;
+    into->rewrites            += from->rewrites;
+    into->predicates          += from->predicates;
+    into->statements_removed  += from->statements_removed;
+    into->loop_invariants     += from->loop_invariants;
+    into->strength_reductions += from->strength_reductions;
+    into->cse_temps           += from->cse_temps;
+    into->dead_stores         += from->dead_stores;
+    into->dropped_vars        += from->dropped_vars;
+    into->budget_exhausted    |= from->budget_exhausted;
+
+    for (size_t i = 0; i < OPTIMIZE_PASSES_COUNT; i++) {
+        into->passes[i].runs    += from->passes[i].runs;
+        into->passes[i].changes += from->passes[i].changes;
+        into->passes[i].time_ns += from->passes[i].time_ns;
+    }
+}
+
+// Вызывающий поток работает наравне с запущенными; если поток не создался,
+// его работу разберут остальные
+static void run_workers(decl_pool_t* pool, size_t threads_count) {
+    pthread_t* threads = (pthread_t*)calloc(threads_count, sizeof(pthread_t));
+    size_t     started = 0;
+
+    for (; threads != nullptr && started < threads_count; started++) {
+        if (pthread_create(&threads[started], nullptr, decl_worker, pool) != 0) {
+            LOGGER_WARNING("run_workers: pthread_create failed, %zu threads started", started);
+            break;
+        }
+    }
+
+    decl_worker(pool);
+
+    for (size_t i = 0; i < started; i++) pthread_join(threads[i], nullptr);
+    free(threads);
+}
+
+static error_code run_per_decl(tree_t* tree, const optimize_options_t* options,
+                               optimize_stats_t* stats, size_t first_pass, size_t* changes_out) {
+    vector_t   slots = {};
+    error_code error = ERROR_NO;
+    if (SIMPLE_VECTOR_INIT(&slots, 64, tree_node_t**) != VEC_ERR_OK) {
+        LOGGER_ERROR("run_per_decl: vector_init failed");
+        return ERROR_MEM_ALLOC;
+    }
+    collect_decl_slots(&tree->root->right, &slots, &error);
+
+    decl_pool_t pool = {};
+    pool.tree        = tree;
+    pool.first_pass  = first_pass;
+    pool.jobs_count  = vector_size(&slots);
+    pool.jobs        = (decl_job_t*)calloc(pool.jobs_count + 1, sizeof(decl_job_t));
+    size_t* job_nodes = (size_t*)calloc(pool.jobs_count + 1, sizeof(size_t));
+    if (error != ERROR_NO || pool.jobs == nullptr || job_nodes == nullptr) {
+        LOGGER_ERROR("run_per_decl: allocation failed");
+        vector_destroy(&slots);
+        free(pool.jobs);
+        free(job_nodes);
+        return ERROR_MEM_ALLOC;
+    }
+
+    optimize_options_t job_options = *options;
+    job_options.dump_after = nullptr;
+    pool.options = &job_options;
+
+    size_t total_nodes = 0;
+    for (size_t i = 0; i < pool.jobs_count; i++) {
+        pool.jobs[i].slot = *(tree_node_t***)vector_get(&slots, i);
+        job_nodes[i]      = count_nodes_recursive(*pool.jobs[i].slot);
+        total_nodes      += job_nodes[i];
+    }
+    vector_destroy(&slots);
+
+    error = midend_temps_reserve(tree, job_nodes, pool.jobs_count);
+    free(job_nodes);
+    if (error == ERROR_NO) {
+        size_t threads = options->jobs < OPTIMIZE_MAX_JOBS ? options->jobs : OPTIMIZE_MAX_JOBS;
+        if (threads > pool.jobs_count) threads = pool.jobs_count;
+        if (threads == 0) threads = 1;
+
+        pool.worker_nodes = total_nodes / threads;
+        run_workers(&pool, threads - 1);
+    }
+    error |= midend_temps_release(tree);
+
+    // Порядок функций, а не завершения потоков
+    for (size_t i = 0; i < pool.jobs_count; i++) {
+        const decl_job_t* job = &pool.jobs[i];
+        if (job->error != ERROR_NO && error == ERROR_NO) {
+            LOGGER_ERROR("run_per_decl: top-level item #%zu failed", i);
+        }
+        error        |= job->error;
+        *changes_out += job->changes;
+        stats_add(stats, &job->stats);
+    }
+    free(pool.jobs);
+
+    LOGGER_DEBUG("run_per_decl: %zu items, %zu jobs", pool.jobs_count, options->jobs);
+    if (error != ERROR_NO) return error;
+
+    for (size_t i = first_pass; i < OPTIMIZE_PASSES_COUNT; i++) {
+        const char* name = OPTIMIZE_PASSES[i].name;
+        if (options->dump_after != nullptr && strcmp(options->dump_after, name) == 0) {
+            tree_dump(tree, TREE_VER_INIT, true, "after %s", name);
+        }
+    }
+    return ERROR_NO;
+}
+
+// Сводки пересчитываются после специализации и на каждом круге -O3:
+// устаревшие верны, но функция, лишившаяся цикла, становится
+// выбрасываемой только в новых
+static error_code refresh_summaries(tree_t* tree, func_summaries_t* summaries) {
+    func_summaries_destroy(summaries);
+    return func_summaries_build(tree, summaries);
+}
+
+// options->summaries указывает на summaries, которые обновляются между кругами
+static error_code run_levels(tree_t* tree, const optimize_options_t* options,
+                             optimize_stats_t* stats, func_summaries_t* summaries) {
+    pipeline_budget_t budget = {};
+    budget.fuel_left = options->fuel;
+    budget.start_ns  = passes_now_ns();
+    budget.limit_ns  = options->time_budget_us * 1000;
+    budget.runs_left = options->bisect_limit;
+
+    // Разбивать есть что, только если корень — область со списком объявлений
+    size_t parallel_from = OPTIMIZE_PASSES_COUNT;
+    if (options->jobs > 1 && !budget_limited(options) && tree->root != nullptr &&
+        tree->root->type == FUNCTION && tree->root->value.func == OP_VIS_START) {
+        parallel_from = per_decl_tail_start(options->opt_level);
+    }
+
+    size_t changes = 0;
+    for (size_t i = 0; i < parallel_from; i++) {
+        if (OPTIMIZE_PASSES[i].min_level > options->opt_level) continue;
+
+        size_t     before = changes;
+        error_code error  = run_budgeted_pass(tree, options, stats, &budget, i, &changes);
+        if (error != ERROR_NO) return error;
+
+        // Клонов в таблице нет, без пересчёта их вызовы затирали бы всё
+        if (OPTIMIZE_PASSES[i].run == pass_specialize && changes != before) {
+            error = refresh_summaries(tree, summaries);
+            if (error != ERROR_NO) return error;
+        }
+    }
+
+    if (parallel_from < OPTIMIZE_PASSES_COUNT) {
+        error_code error = run_per_decl(tree, options, stats, parallel_from, &changes);
+        if (error != ERROR_NO) return error;
+    }
+
+    // Первый прогон уже был; дальше только повторяемые и только пока есть изменения
+    stats->rounds = options->opt_level > 0 ? 1 : 0;
+    if (options->opt_level < OPTIMIZE_MAX_LEVEL) return ERROR_NO;
+
+    while (changes != 0 && stats->rounds < OPTIMIZE_MAX_ROUNDS) {
+        changes = 0;
+        stats->rounds++;
+
+        error_code error = refresh_summaries(tree, summaries);
+        if (error != ERROR_NO) return error;
+
+        for (size_t i = 0; i < OPTIMIZE_PASSES_COUNT; i++) {
+            if (!OPTIMIZE_PASSES[i].repeat) continue;
+
+            error = run_budgeted_pass(tree, options, stats, &budget, i, &changes);
+            if (error != ERROR_NO) return error;
+        }
+    }
+
+    return ERROR_NO;
+}
+
+error_code optimize_run_pipeline(tree_t* tree, const optimize_options_t* options,
+                                 optimize_stats_t* stats) {
+    HARD_ASSERT(tree    != nullptr, "optimize_run_pipeline: tree is nullptr");
+    HARD_ASSERT(options != nullptr, "optimize_run_pipeline: options is nullptr");
+    HARD_ASSERT(stats   != nullptr, "optimize_run_pipeline: stats is nullptr");
+
+    if (options->opt_level < 0 || options->opt_level > OPTIMIZE_MAX_LEVEL) {
+        LOGGER_ERROR("optimize_run_pipeline: bad level -O%d", options->opt_level);
+        return ERROR_INCORRECT_ARGS;
+    }
+    if (options->dump_after != nullptr && optimize_find_pass(options->dump_after) == OPTIMIZE_NO_PASS) {
+        LOGGER_WARNING("optimize_run_pipeline: unknown pass '%s' to dump after", options->dump_after);
+    }
+
+    stats->passes_count = OPTIMIZE_PASSES_COUNT;
+    for (size_t i = 0; i < OPTIMIZE_PASSES_COUNT; i++) stats->passes[i].name = OPTIMIZE_PASSES[i].name;
+
+    // Сводки функций общие для всех проходов и потоков: потоки их только читают
+    func_summaries_t   summaries    = {};
+    optimize_options_t pass_options = *options;
+    pass_options.summaries = &summaries;
+
+    error_code error = ERROR_NO;
+    if (options->opt_level > 0) error = func_summaries_build(tree, &summaries);
+    if (error == ERROR_NO)      error = run_levels(tree, &pass_options, stats, &summaries);
+
+    func_summaries_destroy(&summaries);
+    return error;
+}
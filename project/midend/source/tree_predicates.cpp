@@ -0,0 +1,266 @@
+#include <math.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "tree_optimize.h"
+#include "tree_predicates.h"
+#include "tree_node_utils.h"
+
+static const const_val_type PRED_PRECISION = 1e-9;
+
+struct pred_state_t {
+    size_t     simplified;
+    error_code error;
+};
+
+//================================================================================
+
+static bool node_is_constant(const tree_node_t* node) {
+    return node != nullptr && node->type == CONSTANT;
+}
+
+static bool is_comparison(op_code_t op_code) {
+    return op_code == OP_EQ || op_code == OP_NEQ || op_code == OP_LE ||
+           op_code == OP_GE || op_code == OP_LT  || op_code == OP_GT;
+}
+
+static bool node_is_comparison(const tree_node_t* node) {
+    return node != nullptr && node->type == FUNCTION && is_comparison(node->value.func);
+}
+
+static bool is_truthy(const_val_type value) {
+    return fabs(value) > PRED_PRECISION;
+}
+
+static bool constant_is(const tree_node_t* node, const_val_type value) {
+    return node_is_constant(node) && fabs(node->value.constant - value) < PRED_PRECISION;
+}
+
+// Значение — 0 или 1
+static bool node_is_boolean(const tree_node_t* node) {
+    if (node == nullptr) return false;
+    if (node->type == CONSTANT) return constant_is(node, 0) || constant_is(node, 1);
+
+    return node_is_comparison(node) || midend_node_is_func(node, OP_AND) || midend_node_is_func(node, OP_OR);
+}
+
+// Обратное сравнение: !(a < b) == (a >= b)
+static op_code_t invert_comparison(op_code_t op_code) {
+    if (op_code == OP_EQ) return OP_NEQ;
+    if (op_code == OP_NEQ) return OP_EQ;
+    if (op_code == OP_LT) return OP_GE;
+    if (op_code == OP_GE) return OP_LT;
+    if (op_code == OP_GT) return OP_LE;
+    return OP_GT;
+}
+
+// Сравнение с переставленными операндами: (a < b) == (b > a)
+static op_code_t mirror_comparison(op_code_t op_code) {
+    if (op_code == OP_LT) return OP_GT;
+    if (op_code == OP_GT) return OP_LT;
+    if (op_code == OP_LE) return OP_GE;
+    if (op_code == OP_GE) return OP_LE;
+    return op_code;
+}
+
+static bool same_expr(const tree_node_t* a, const tree_node_t* b) {
+    if (a == nullptr || b == nullptr) return a == b;
+    if (a->type != b->type) return false;
+
+    if (a->type == CONSTANT && fabs(a->value.constant - b->value.constant) >= PRED_PRECISION) return false;
+    if (a->type == IDENT    && a->value.ident_idx != b->value.ident_idx)                    return false;
+    if (a->type == FUNCTION && a->value.func      != b->value.func)                         return false;
+
+    return same_expr(a->left, b->left) && same_expr(a->right, b->right);
+}
+
+//================================================================================
+
+static void replace_with_constant(pred_state_t* state, tree_node_t* node, const_val_type value) {
+    if (node->left  != nullptr) state->error |= destroy_node_recursive(node->left,  nullptr);
+    if (node->right != nullptr) state->error |= destroy_node_recursive(node->right, nullptr);
+
+    node->left           = nullptr;
+    node->right          = nullptr;
+    node->type           = CONSTANT;
+    node->value.constant = value;
+}
+
+// Узел занимает место ребёнка keep, второй ребёнок освобождается
+static void replace_with_child(pred_state_t* state, tree_node_t* node, tree_node_t* keep) {
+    tree_node_t* drop = (node->left == keep) ? node->right : node->left;
+    if (drop != nullptr) state->error |= destroy_node_recursive(drop, nullptr);
+
+    *node = *keep;
+    free_node(keep);
+}
+
+// Узел становится bool(keep): сам keep, если он уже 0/1, иначе keep != 0
+static void replace_with_truth(pred_state_t* state, tree_node_t* node, tree_node_t* keep) {
+    if (node_is_boolean(keep)) {
+        replace_with_child(state, node, keep);
+        return;
+    }
+
+    tree_node_t* zero = init_node(CONSTANT, make_union_const(0), nullptr, nullptr);
+    if (zero == nullptr) {
+        LOGGER_ERROR("replace_with_truth: init_node failed");
+        state->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+
+    tree_node_t* drop = (node->left == keep) ? node->right : node->left;
+    if (drop != nullptr) state->error |= destroy_node_recursive(drop, nullptr);
+
+    node->value.func = OP_NEQ;
+    node->left       = keep;
+    node->right      = zero;
+}
+
+//--------------------------------------------------------------------------------
+
+static bool simplify_comparison(pred_state_t* state, tree_node_t* node) {
+    op_code_t    op_code = node->value.func;
+    tree_node_t* left    = node->left;
+    tree_node_t* right   = node->right;
+    if (left == nullptr || right == nullptr) return false;
+
+    if (node_is_constant(left) && node_is_constant(right)) {
+        replace_with_constant(state, node, eval_function_constant(op_code, left->value.constant,
+                                                                           right->value.constant));
+        return true;
+    }
+
+    if (node_is_constant(left)) {
+        node->left       = right;
+        node->right      = left;
+        node->value.func = mirror_comparison(op_code);
+        return true;
+    }
+
+    if (midend_expr_is_pure(left) && same_expr(left, right)) {
+        bool holds = op_code == OP_EQ || op_code == OP_LE || op_code == OP_GE;
+        replace_with_constant(state, node, holds ? 1 : 0);
+        return true;
+    }
+
+    // (b == 1), (b != 0)  ->  b
+    if (node_is_boolean(left) && ((op_code == OP_EQ  && constant_is(right, 1)) ||
+                                  (op_code == OP_NEQ && constant_is(right, 0)))) {
+        replace_with_child(state, node, left);
+        return true;
+    }
+
+    // (cmp == 0), (cmp != 1)  ->  обратное cmp
+    if (node_is_comparison(left) && ((op_code == OP_EQ  && constant_is(right, 0)) ||
+                                     (op_code == OP_NEQ && constant_is(right, 1)))) {
+        left->value.func = invert_comparison(left->value.func);
+        replace_with_child(state, node, left);
+        return true;
+    }
+
+    return false;
+}
+
+// a && b, a || b: absorbing — значение, при котором правая часть не вычисляется
+static bool simplify_logic(pred_state_t* state, tree_node_t* node) {
+    tree_node_t* left  = node->left;
+    tree_node_t* right = node->right;
+    if (left == nullptr || right == nullptr) return false;
+
+    const bool absorbing = node->value.func == OP_OR;
+
+    if (node_is_constant(left)) {
+        if (is_truthy(left->value.constant) == absorbing) replace_with_constant(state, node, absorbing ? 1 : 0);
+        else                                               replace_with_truth(state, node, right);
+        return true;
+    }
+
+    if (node_is_constant(right)) {
+        if (is_truthy(right->value.constant) != absorbing) {
+            replace_with_truth(state, node, left);
+            return true;
+        }
+        if (!midend_expr_is_pure(left)) return false;
+
+        replace_with_constant(state, node, absorbing ? 1 : 0);
+        return true;
+    }
+
+    return false;
+}
+
+static void simplify_expr(pred_state_t* state, tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    simplify_expr(state, node->left);
+    simplify_expr(state, node->right);
+
+    while (node->type == FUNCTION && state->error == ERROR_NO) {
+        op_code_t op_code = node->value.func;
+        bool      changed = false;
+
+        if      (is_comparison(op_code))                   changed = simplify_comparison(state, node);
+        else if (op_code == OP_AND || op_code == OP_OR)     changed = simplify_logic(state, node);
+
+        if (!changed) break;
+        state->simplified++;
+    }
+}
+
+//================================================================================
+
+// if (p && q) { body }  ->  if (p) { if (q) { body } }, если q чисто
+static void split_conjunction(pred_state_t* state, tree_node_t* node) {
+    while (midend_node_is_func(node->left, OP_AND) && midend_expr_is_pure(node->left->right)) {
+        tree_node_t* conj  = node->left;
+        tree_node_t* inner = init_node(FUNCTION, make_union_func(OP_IF), conj->right, node->right);
+        if (inner == nullptr) {
+            LOGGER_ERROR("split_conjunction: init_node failed");
+            state->error |= ERROR_MEM_ALLOC;
+            return;
+        }
+
+        node->left  = conj->left;
+        node->right = inner;
+        free_node(conj);
+        state->simplified++;
+
+        split_conjunction(state, inner);
+    }
+}
+
+static void simplify_stmt(pred_state_t* state, tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    if (node->value.func == OP_IF || node->value.func == OP_WHILE) {
+        simplify_expr(state, node->left);
+        if (node->value.func == OP_IF) split_conjunction(state, node);
+        simplify_stmt(state, node->right);
+        return;
+    }
+
+    if (node->value.func == OP_LCAT || node->value.func == OP_VIS_START ||
+        node->value.func == OP_FUNC_DECL || node->value.func == OP_PROC_DECL) {
+        simplify_stmt(state, node->left);
+        simplify_stmt(state, node->right);
+        return;
+    }
+
+    simplify_expr(state, node);
+}
+
+error_code tree_simplify_predicates(tree_t* tree, size_t* simplified_out) {
+    HARD_ASSERT(tree != nullptr, "tree_simplify_predicates: tree is nullptr");
+
+    pred_state_t state = {};
+    simplify_stmt(&state, tree->root);
+
+    LOGGER_DEBUG("tree_simplify_predicates: %zu predicates simplified", state.simplified);
+    if (simplified_out != nullptr) *simplified_out = state.simplified;
+    return state.error;
+}
@@ -0,0 +1,248 @@
+#include <stdlib.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "libs/Vector/include/vector.h"
+#include "tree_optimize.h"
+#include "tree_summaries.h"
+#include "tree_propagate.h"
+#include "tree_node_utils.h"
+
+//================================================================================
+
+enum prop_fact_kind_t {
+    PROP_FACT_NONE,
+    PROP_FACT_CONST,
+    PROP_FACT_COPY,
+};
+
+struct prop_fact_t {
+    prop_fact_kind_t kind;
+    size_t           epoch;          // факт жив, пока эпоха не сменилась
+    const_val_type   constant;       // PROP_FACT_CONST
+    size_t           source;         // PROP_FACT_COPY: переменная-источник
+    size_t           source_version; // версия источника в момент копирования
+};
+
+// Факты индексируются ident_idx. Присваивание увеличивает версию переменной,
+// чем заодно гасит все копии из неё; вызов увеличивает эпоху и гасит всё,
+// если сводка не говорит, что функция чиста.
+struct prop_state_t {
+    const func_summaries_t* summaries;
+    prop_fact_t* facts;
+    size_t*      versions;
+    size_t       idents_count;
+    size_t       epoch;
+    vector_t     assigned;    // журнал присвоенных переменных (size_t)
+    size_t       substituted;
+    error_code   error;
+};
+
+//================================================================================
+
+static const prop_fact_t* fact_lookup(const prop_state_t* state, size_t ident_idx) {
+    if (ident_idx >= state->idents_count) return nullptr;
+
+    const prop_fact_t* fact = &state->facts[ident_idx];
+    if (fact->kind == PROP_FACT_NONE || fact->epoch != state->epoch) return nullptr;
+
+    if (fact->kind == PROP_FACT_COPY &&
+        fact->source_version != state->versions[fact->source]) {
+        return nullptr;
+    }
+    return fact;
+}
+
+static void kill_ident(prop_state_t* state, size_t ident_idx) {
+    if (ident_idx >= state->idents_count) return;
+
+    state->facts[ident_idx].kind = PROP_FACT_NONE;
+    state->versions[ident_idx]++;
+}
+
+// Присваивание внутри условного блока или цикла не доживает до его конца
+static void kill_assigned_since(prop_state_t* state, size_t mark) {
+    size_t count = vector_size(&state->assigned);
+    for (size_t i = mark; i < count; i++) {
+        kill_ident(state, *(const size_t*)vector_get_const(&state->assigned, i));
+    }
+}
+
+static void record_assign(prop_state_t* state, size_t target, const tree_node_t* value) {
+    kill_ident(state, target);
+    if (target >= state->idents_count) return;
+
+    if (vector_push_back(&state->assigned, &target) != VEC_ERR_OK) {
+        LOGGER_ERROR("record_assign: vector_push_back failed");
+        state->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+
+    prop_fact_t* fact = &state->facts[target];
+    fact->epoch = state->epoch;
+
+    if (value == nullptr) return;
+
+    if (value->type == CONSTANT) {
+        fact->kind     = PROP_FACT_CONST;
+        fact->constant = value->value.constant;
+    } else if (value->type == IDENT && value->value.ident_idx != target &&
+               value->value.ident_idx < state->idents_count) {
+        fact->kind           = PROP_FACT_COPY;
+        fact->source         = value->value.ident_idx;
+        fact->source_version = state->versions[fact->source];
+    }
+}
+
+//================================================================================
+
+static void substitute_ident(prop_state_t* state, tree_node_t* node) {
+    const prop_fact_t* fact = fact_lookup(state, node->value.ident_idx);
+    if (fact == nullptr) return;
+
+    if (fact->kind == PROP_FACT_CONST) {
+        node->type           = CONSTANT;
+        node->value.constant = fact->constant;
+    } else {
+        node->value.ident_idx = fact->source;
+    }
+    state->substituted++;
+}
+
+static void propagate_expr(prop_state_t* state, tree_node_t* node) {
+    if (node == nullptr || state->error != ERROR_NO) return;
+
+    if (node->type == IDENT) {
+        substitute_ident(state, node);
+        return;
+    }
+    if (node->type != FUNCTION) return;
+
+    if (node->value.func == OP_ASSIGN) {
+        propagate_expr(state, node->right);
+        if (node->right != nullptr) {
+            node->right = optimize_subtree_recursive(node->right, &state->error);
+        }
+        if (node->left != nullptr && node->left->type == IDENT) {
+            record_assign(state, node->left->value.ident_idx, node->right);
+        }
+        return;
+    }
+
+    if (node->value.func == OP_CALL) {
+        // CALL(FUNC_INFO(args, name), nullptr): имя не подставляем,
+        // а нечистый вызов мог поменять глобальные переменные
+        if (midend_node_is_func(node->left, OP_FUNC_INFO)) {
+            propagate_expr(state, node->left->left);
+        }
+        if (!func_summaries_call_is_pure(state->summaries, node)) state->epoch++;
+        return;
+    }
+
+    propagate_expr(state, node->left);
+    propagate_expr(state, node->right);
+}
+
+// Перед циклом гасим всё, что он присваивает: на входе в тело после
+// первой итерации старые значения уже неверны
+static void kill_loop_effects(prop_state_t* state, const tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION) return;
+
+    if (node->value.func == OP_ASSIGN && node->left != nullptr && node->left->type == IDENT) {
+        kill_ident(state, node->left->value.ident_idx);
+    }
+    if (node->value.func == OP_CALL && !func_summaries_call_is_pure(state->summaries, node)) {
+        state->epoch++;
+    }
+
+    kill_loop_effects(state, node->left);
+    kill_loop_effects(state, node->right);
+}
+
+static void propagate_stmt(prop_state_t* state, tree_node_t* node) {
+    if (node == nullptr || state->error != ERROR_NO) return;
+
+    if (node->type != FUNCTION) {
+        propagate_expr(state, node);
+        return;
+    }
+
+    op_code_t op_code = node->value.func;
+
+    if (op_code == OP_LCAT) {
+        propagate_stmt(state, node->left);
+        propagate_stmt(state, node->right);
+        return;
+    }
+
+    if (op_code == OP_VIS_START) {
+        propagate_stmt(state, node->right);
+        return;
+    }
+
+    if (op_code == OP_FUNC_DECL || op_code == OP_PROC_DECL) {
+        // Параметры и глобальные переменные внутри тела неизвестны,
+        // а факты тела не выходят наружу
+        state->epoch++;
+        propagate_stmt(state, node->right);
+        state->epoch++;
+        return;
+    }
+
+    if (op_code == OP_IF) {
+        propagate_expr(state, node->left);
+        size_t mark = vector_size(&state->assigned);
+        propagate_stmt(state, node->right);
+        kill_assigned_since(state, mark);
+        return;
+    }
+
+    if (op_code == OP_WHILE) {
+        kill_loop_effects(state, node);
+        size_t mark = vector_size(&state->assigned);
+        propagate_expr(state, node->left);
+        propagate_stmt(state, node->right);
+        kill_assigned_since(state, mark);
+        return;
+    }
+
+    propagate_expr(state, node);
+}
+
+//================================================================================
+
+error_code tree_propagate(tree_t* tree, const func_summaries_t* summaries, size_t* substituted_out) {
+    HARD_ASSERT(tree != nullptr, "tree_propagate: tree is nullptr");
+
+    if (substituted_out != nullptr) *substituted_out = 0;
+    if (tree->root == nullptr || tree->ident_stack == nullptr) return ERROR_NO;
+
+    prop_state_t state = {};
+    state.summaries    = summaries;
+    state.idents_count = tree->ident_stack->size;
+    state.epoch        = 1;
+    state.facts        = (prop_fact_t*)calloc(state.idents_count + 1, sizeof(prop_fact_t));
+    state.versions     = (size_t*)     calloc(state.idents_count + 1, sizeof(size_t));
+
+    if (state.facts == nullptr || state.versions == nullptr ||
+        SIMPLE_VECTOR_INIT(&state.assigned, 64, size_t) != VEC_ERR_OK) {
+        LOGGER_ERROR("tree_propagate: allocation failed");
+        free(state.facts);
+        free(state.versions);
+        return ERROR_MEM_ALLOC;
+    }
+
+    propagate_stmt(&state, tree->root);
+
+    LOGGER_DEBUG("tree_propagate: %zu substitutions", state.substituted);
+    if (substituted_out != nullptr) *substituted_out = state.substituted;
+
+    vector_destroy(&state.assigned);
+    free(state.versions);
+    free(state.facts);
+    return state.error;
+}
@@ -0,0 +1,239 @@
+#include <math.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "libs/Vector/include/vector.h"
+#include "tree_optimize.h"
+#include "tree_reassociate.h"
+#include "tree_node_utils.h"
+
+// Больше этого целые в double теряют точность
+static const const_val_type EXACT_INT_LIMIT = 9007199254740992.0;
+
+struct reassoc_operand_t {
+    tree_node_t* node;
+    size_t       need;  // глубина стека VM для вычисления операнда
+};
+
+// Операнды всех открытых цепочек лежат в одном векторе стопкой:
+// цепочка занимает хвост начиная со своей отметки
+struct reassoc_state_t {
+    vector_t   operands;
+    bool       fast_math;
+    size_t     reassociated;
+    error_code error;
+};
+
+//================================================================================
+
+// and/or не трогаются: левый операнд — охрана правого, и predicates
+// превращает их в вложенные переходы именно в этом порядке
+static bool is_reassociable(op_code_t op_code) {
+    return op_code == OP_PLUS || op_code == OP_MUL;
+}
+
+static bool is_chain_link(const tree_node_t* node, op_code_t op_code) {
+    return node != nullptr && node->type == FUNCTION && node->value.func == op_code &&
+           node->left != nullptr && node->right != nullptr;
+}
+
+// Число Сетхи-Ульмана: сколько ячеек стека нужно на вычисление
+static size_t stack_need(const tree_node_t* node) {
+    if (node == nullptr)        return 0;
+    if (node->type != FUNCTION) return 1;
+
+    size_t left  = stack_need(node->left);
+    size_t right = stack_need(node->right);
+    if (left == right) return left + 1;
+    return (left > right) ? left : right;
+}
+
+static bool is_exact_constant(const_val_type value) {
+    return fabs(value - round(value)) < 1e-9 && fabs(value) <= EXACT_INT_LIMIT;
+}
+
+static reassoc_operand_t* operand_at(reassoc_state_t* state, size_t index) {
+    return (reassoc_operand_t*)vector_get(&state->operands, index);
+}
+
+//================================================================================
+
+static void collect_chain(reassoc_state_t* state, tree_node_t* node, op_code_t op_code,
+                          bool* left_deep) {
+    if (!is_chain_link(node, op_code)) {
+        reassoc_operand_t operand = {node, 0};
+        if (vector_push_back(&state->operands, &operand) != VEC_ERR_OK) {
+            LOGGER_ERROR("collect_chain: vector_push_back failed");
+            state->error |= ERROR_MEM_ALLOC;
+        }
+        return;
+    }
+
+    if (is_chain_link(node->right, op_code)) *left_deep = false;
+    collect_chain(state, node->left,  op_code, left_deep);
+    collect_chain(state, node->right, op_code, left_deep);
+}
+
+// Промежуточные узлы цепочки освобождаются, корень остаётся на месте
+static void free_chain_links(tree_node_t* node, op_code_t op_code, bool is_root) {
+    if (!is_chain_link(node, op_code)) return;
+
+    free_chain_links(node->left,  op_code, false);
+    free_chain_links(node->right, op_code, false);
+    if (!is_root) free_node(node);
+}
+
+// a раньше b: константы в конце, затем глубокие операнды раньше мелких,
+// затем операции раньше переменных, а переменные по номеру
+static bool operand_before(const reassoc_operand_t* a, const reassoc_operand_t* b) {
+    const bool a_const = a->node->type == CONSTANT;
+    const bool b_const = b->node->type == CONSTANT;
+    if (a_const != b_const) return b_const;
+    if (a_const)            return false;
+
+    if (a->need != b->need) return a->need > b->need;
+
+    if (a->node->type != b->node->type) return a->node->type == FUNCTION;
+    if (a->node->type == IDENT) return a->node->value.ident_idx < b->node->value.ident_idx;
+    return a->node->value.func < b->node->value.func;
+}
+
+// Устойчивая сортировка вставками; false, если порядок не изменился
+static bool sort_operands(reassoc_state_t* state, size_t mark, size_t end) {
+    bool moved = false;
+    for (size_t i = mark + 1; i < end; i++) {
+        reassoc_operand_t current = *operand_at(state, i);
+        size_t j = i;
+        while (j > mark && operand_before(&current, operand_at(state, j - 1))) {
+            *operand_at(state, j) = *operand_at(state, j - 1);
+            j--;
+        }
+        if (j != i) moved = true;
+        *operand_at(state, j) = current;
+    }
+    return moved;
+}
+
+// Свёртка констант хвоста [first_const, end); false, если она неточна
+static bool fold_tail_constants(reassoc_state_t* state, op_code_t op_code,
+                                size_t first_const, size_t end, const_val_type* merged_out) {
+    const_val_type merged = operand_at(state, first_const)->node->value.constant;
+    for (size_t i = first_const + 1; i < end; i++) {
+        merged = eval_function_constant(op_code, merged, operand_at(state, i)->node->value.constant);
+    }
+    *merged_out = merged;
+    return state->fast_math || is_exact_constant(merged);
+}
+
+// Первая константа хвоста получает свёртку, остальные освобождаются
+static void merge_tail_constants(reassoc_state_t* state, const_val_type merged,
+                                 size_t first_const, size_t end) {
+    operand_at(state, first_const)->node->value.constant = merged;
+    for (size_t i = first_const + 1; i < end; i++) {
+        free_node(operand_at(state, i)->node);
+    }
+}
+
+static void rebuild_chain(reassoc_state_t* state, tree_node_t* root, op_code_t op_code,
+                          size_t mark, size_t end) {
+    tree_node_t* chain = operand_at(state, mark)->node;
+    for (size_t i = mark + 1; i < end && chain != nullptr; i++) {
+        chain = init_node(FUNCTION, make_union_func(op_code), chain, operand_at(state, i)->node);
+    }
+    if (chain == nullptr) {
+        LOGGER_ERROR("rebuild_chain: init_node failed");
+        state->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+
+    *root = *chain;
+    free_node(chain);
+}
+
+//================================================================================
+
+static void reassoc_expr(reassoc_state_t* state, tree_node_t* node);
+
+static void reassoc_chain(reassoc_state_t* state, tree_node_t* root) {
+    op_code_t op_code   = root->value.func;
+    size_t    mark      = vector_size(&state->operands);
+    bool      left_deep = true;
+
+    collect_chain(state, root, op_code, &left_deep);
+    size_t end = vector_size(&state->operands);
+
+    bool   can_reorder = true;
+    size_t constants   = 0;
+    for (size_t i = mark; i < end && state->error == ERROR_NO; i++) {
+        tree_node_t* operand = operand_at(state, i)->node;
+        reassoc_expr(state, operand);
+
+        operand_at(state, i)->need = stack_need(operand);
+        // Падающий операнд мог стоять под охраной соседнего условия
+        if (!midend_expr_is_pure(operand) || midend_expr_may_trap(operand)) can_reorder = false;
+        if (operand->type == CONSTANT) {
+            constants++;
+            if (!state->fast_math && !is_exact_constant(operand->value.constant)) can_reorder = false;
+        }
+    }
+
+    if (state->error == ERROR_NO && can_reorder) {
+        bool           moved       = sort_operands(state, mark, end);
+        size_t         first_const = end - constants;
+        const_val_type folded      = 0;
+        bool           merge       = constants >= 2 &&
+                                     fold_tail_constants(state, op_code, first_const, end, &folded);
+
+        if (moved || merge || !left_deep) {
+            free_chain_links(root, op_code, true);
+            if (merge) merge_tail_constants(state, folded, first_const, end);
+            rebuild_chain(state, root, op_code, mark, merge ? first_const + 1 : end);
+            state->reassociated++;
+        }
+    }
+
+    while (vector_size(&state->operands) > mark) {
+        vector_pop_back(&state->operands, nullptr);
+    }
+}
+
+static void reassoc_expr(reassoc_state_t* state, tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    if (is_reassociable(node->value.func) && is_chain_link(node, node->value.func)) {
+        reassoc_chain(state, node);
+        return;
+    }
+
+    reassoc_expr(state, node->left);
+    reassoc_expr(state, node->right);
+}
+
+//================================================================================
+
+error_code tree_reassociate(tree_t* tree, bool fast_math, size_t* reassociated_out) {
+    HARD_ASSERT(tree != nullptr, "tree_reassociate: tree is nullptr");
+
+    if (reassociated_out != nullptr) *reassociated_out = 0;
+    if (tree->root == nullptr) return ERROR_NO;
+
+    reassoc_state_t state = {};
+    state.fast_math = fast_math;
+    if (SIMPLE_VECTOR_INIT(&state.operands, 64, reassoc_operand_t) != VEC_ERR_OK) {
+        LOGGER_ERROR("tree_reassociate: vector_init failed");
+        return ERROR_MEM_ALLOC;
+    }
+
+    reassoc_expr(&state, tree->root);
+
+    LOGGER_DEBUG("tree_reassociate: %zu chains%s", state.reassociated,
+                 fast_math ? " (fast math)" : "");
+    if (reassociated_out != nullptr) *reassociated_out = state.reassociated;
+
+    vector_destroy(&state.operands);
+    return state.error;
+}
@@ -0,0 +1,173 @@
+#include <math.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "tree_rewrite.h"
+
+static const double REWRITE_PRECISION = 1e-9;
+
+//================================================================================
+
+// Узел в позиции образца; nullptr, если на пути лист или пустой ребёнок
+static tree_node_t* node_at(tree_node_t* root, size_t position) {
+    if (position == 1) return root;
+
+    tree_node_t* parent = node_at(root, position / 2);
+    if (parent == nullptr || parent->type != FUNCTION) return nullptr;
+    return position % 2 == 0 ? parent->left : parent->right;
+}
+
+// Захват подходит к любому непустому узлу
+static bool symbol_matches(const rewrite_symbol_t* symbol, const tree_node_t* node) {
+    if (node == nullptr) return false;
+
+    if (symbol->kind == RW_SYM_OP) {
+        return node->type == FUNCTION && node->value.func == symbol->op_code;
+    }
+    if (symbol->kind == RW_SYM_CONST) {
+        return node->type == CONSTANT && fabs(node->value.constant - symbol->value) < REWRITE_PRECISION;
+    }
+    return true;
+}
+
+static size_t match_rule(const rewrite_program_t* program, tree_node_t* node) {
+    if (node->type != FUNCTION || (size_t)node->value.func >= OP_CODES_COUNT) return REWRITE_NO_INDEX;
+
+    size_t index = program->root[node->value.func];
+    while (index != REWRITE_NO_INDEX) {
+        const rewrite_decision_t* decision = &program->decisions[index];
+        if (decision->position == REWRITE_NO_INDEX) return decision->rule;
+
+        tree_node_t* subject = node_at(node, decision->position);
+
+        size_t next = decision->otherwise;
+        for (size_t i = 0; i < decision->edges_count; i++) {
+            const rewrite_edge_t* edge = &program->edges[decision->first_edge + i];
+            if (symbol_matches(&edge->symbol, subject)) {
+                next = edge->next;
+                break;
+            }
+        }
+        index = next;
+    }
+    return REWRITE_NO_INDEX;
+}
+
+//================================================================================
+
+// Освобождает собранную по шаблону часть, не трогая подставленные захваты
+static void destroy_built(const rewrite_expr_t* result, size_t position, tree_node_t* node) {
+    if (node == nullptr || position >= REWRITE_MAX_POSITIONS) return;
+
+    const rewrite_symbol_t* symbol = &result->at[position];
+    if (symbol->kind == RW_SYM_CAPTURE) return;
+
+    if (symbol->kind == RW_SYM_OP) {
+        destroy_built(result, 2 * position,     node->left);
+        destroy_built(result, 2 * position + 1, node->right);
+    }
+    free_node(node);
+}
+
+static tree_node_t* build_result(const rewrite_expr_t* result, size_t position,
+                                 tree_node_t** captures, error_code* error) {
+    if (position >= REWRITE_MAX_POSITIONS || *error != ERROR_NO) return nullptr;
+
+    const rewrite_symbol_t* symbol = &result->at[position];
+    if (symbol->kind == RW_SYM_ANY)     return nullptr;
+    if (symbol->kind == RW_SYM_CAPTURE) return captures[symbol->capture];
+
+    tree_node_t* node = nullptr;
+    if (symbol->kind == RW_SYM_CONST) {
+        node = init_node(CONSTANT, make_union_const(symbol->value), nullptr, nullptr);
+    } else {
+        tree_node_t* left  = build_result(result, 2 * position,     captures, error);
+        tree_node_t* right = build_result(result, 2 * position + 1, captures, error);
+        if (*error == ERROR_NO) node = init_node(FUNCTION, make_union_func(symbol->op_code), left, right);
+
+        if (node == nullptr) {
+            destroy_built(result, 2 * position,     left);
+            destroy_built(result, 2 * position + 1, right);
+            if (*error != ERROR_NO) return nullptr;
+        }
+    }
+
+    if (node == nullptr) {
+        LOGGER_ERROR("build_result: init_node failed");
+        *error |= ERROR_MEM_ALLOC;
+    }
+    return node;
+}
+
+// Освобождает сопоставленные части образца, кроме корня и перенесённых захватов
+static error_code release_matched(const rewrite_expr_t* pattern, size_t position,
+                                  tree_node_t* node, uint32_t kept_captures) {
+    if (node == nullptr) return ERROR_NO;
+
+    const rewrite_symbol_t* symbol = position < REWRITE_MAX_POSITIONS ? &pattern->at[position] : nullptr;
+
+    if (symbol != nullptr && symbol->kind == RW_SYM_OP) {
+        error_code error = ERROR_NO;
+        error |= release_matched(pattern, 2 * position,     node->left,  kept_captures);
+        error |= release_matched(pattern, 2 * position + 1, node->right, kept_captures);
+        if (position != 1) free_node(node);
+        return error;
+    }
+
+    if (symbol != nullptr && symbol->kind == RW_SYM_CAPTURE &&
+        (kept_captures & ((uint32_t)1 << symbol->capture)) != 0) {
+        return ERROR_NO;
+    }
+    return destroy_node_recursive(node, nullptr);
+}
+
+//================================================================================
+
+error_code rewrite_apply(const rewrite_program_t* program, tree_node_t* node, bool* applied_out) {
+    HARD_ASSERT(program     != nullptr, "rewrite_apply: program is nullptr");
+    HARD_ASSERT(node        != nullptr, "rewrite_apply: node is nullptr");
+    HARD_ASSERT(applied_out != nullptr, "rewrite_apply: applied_out is nullptr");
+
+    *applied_out = false;
+
+    size_t rule_idx = match_rule(program, node);
+    if (rule_idx == REWRITE_NO_INDEX) return ERROR_NO;
+    const rewrite_rule_t* rule = &program->rules[rule_idx];
+
+    tree_node_t* captures[REWRITE_MAX_CAPTURES] = {};
+    uint32_t     kept_captures = 0;
+    for (size_t position = 1; position < REWRITE_MAX_POSITIONS; position++) {
+        const rewrite_symbol_t* from = &rule->pattern.at[position];
+        const rewrite_symbol_t* to   = &rule->result.at[position];
+
+        if (to->kind == RW_SYM_CAPTURE) kept_captures |= (uint32_t)1 << to->capture;
+        if (from->kind != RW_SYM_CAPTURE) continue;
+
+        // Дерево решений уже проверило, что захват не пустой
+        captures[from->capture] = node_at(node, position);
+        HARD_ASSERT(captures[from->capture] != nullptr, "rewrite_apply: empty capture matched");
+    }
+
+    // Пока шаблон не собран, дерево не трогается: при нехватке памяти оно цело
+    error_code   error  = ERROR_NO;
+    tree_node_t* result = build_result(&rule->result, 1, captures, &error);
+    if (error != ERROR_NO) return error;
+
+    error |= release_matched(&rule->pattern, 1, node, kept_captures);
+
+    tree_node_t result_copy = *result;
+    *node = result_copy;
+    free_node(result);
+
+    if (error != ERROR_NO) {
+        LOGGER_ERROR("rewrite_apply: destroy_node_recursive failed");
+        return error;
+    }
+
+    *applied_out = true;
+    return ERROR_NO;
+}
@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "libs/Vector/include/vector.h"
+#include "tree_optimize.h"
+#include "tree_dce.h"
+#include "tree_temps.h"
+#include "tree_specialize.h"
+#include "tree_node_utils.h"
+
+static const size_t NO_INDEX         = (size_t)-1;
+static const size_t CLONE_PREFIX_LEN = 16;
+
+struct spec_func_t {
+    tree_node_t** slot;          // место в верхнем списке, за которым встанет следующий клон
+    tree_node_t*  decl;
+    size_t        name_idx;
+    size_t        params_count;
+    bool          fixed[SPECIALIZE_MAX_ARGS]; // параметр тело не перезаписывает
+    size_t        nodes;
+    bool          ambiguous;     // имя объявлено ещё раз
+};
+
+// Набор констант, под который сделан клон; неконстантные места не сравниваются
+struct spec_clone_t {
+    size_t         func;
+    size_t         name_idx;
+    bool           is_const[SPECIALIZE_MAX_ARGS];
+    const_val_type values[SPECIALIZE_MAX_ARGS];
+};
+
+struct spec_state_t {
+    tree_t*    tree;
+    vector_t   funcs;     // spec_func_t
+    vector_t   clones;    // spec_clone_t
+    size_t     clone_budget;
+    size_t     fold_budget;
+    size_t     retargeted;
+    error_code error;
+};
+
+//================================================================================
+
+static bool node_is_decl(const tree_node_t* node) {
+    return midend_node_is_func(node, OP_FUNC_DECL) || midend_node_is_func(node, OP_PROC_DECL);
+}
+
+static spec_func_t* func_at(spec_state_t* state, size_t index) {
+    return (spec_func_t*)vector_get(&state->funcs, index);
+}
+
+static spec_clone_t* clone_at(spec_state_t* state, size_t index) {
+    return (spec_clone_t*)vector_get(&state->clones, index);
+}
+
+static size_t find_func(spec_state_t* state, size_t name_idx) {
+    for (size_t i = 0; i < vector_size(&state->funcs); i++) {
+        if (func_at(state, i)->name_idx == name_idx) return i;
+    }
+    return NO_INDEX;
+}
+
+// Пересобирает список без отмеченных элементов в той же левой форме, что
+// строит парсер. Новые звенья заводятся до того, как трогать старые:
+// при нехватке памяти список остаётся целым
+static void drop_items(spec_state_t* state, tree_node_t** slot, const bool* drop) {
+    tree_node_t* items[SPECIALIZE_MAX_ARGS] = {};
+    size_t       count = 0;
+    midend_collect_enum_array(*slot, items, SPECIALIZE_MAX_ARGS, &count);
+    HARD_ASSERT(count <= SPECIALIZE_MAX_ARGS, "drop_items: too many items");
+
+    tree_node_t* links[SPECIALIZE_MAX_ARGS] = {};
+    size_t       links_count = 0;
+    tree_node_t* list = nullptr;
+
+    for (size_t i = 0; i < count; i++) {
+        if (drop[i]) continue;
+        if (list == nullptr) {
+            list = items[i];
+            continue;
+        }
+
+        tree_node_t* link = init_node(FUNCTION, make_union_func(OP_ENUM_SEP), list, items[i]);
+        if (link == nullptr) {
+            LOGGER_ERROR("drop_items: init_node failed");
+            for (size_t j = 0; j < links_count; j++) free_node(links[j]);
+            state->error |= ERROR_MEM_ALLOC;
+            return;
+        }
+        links[links_count++] = link;
+        list = link;
+    }
+
+    midend_free_enum_links(*slot);
+    for (size_t i = 0; i < count; i++) {
+        if (drop[i]) state->error |= destroy_node_recursive(items[i], nullptr);
+    }
+    *slot = list;
+}
+
+//================================================================================
+//                           Функции верхнего уровня
+//================================================================================
+
+static bool is_assigned(const tree_node_t* node, size_t ident_idx) {
+    if (node == nullptr || node->type != FUNCTION || node_is_decl(node)) return false;
+
+    if (node->value.func == OP_ASSIGN && node->left != nullptr && node->left->type == IDENT &&
+        node->left->value.ident_idx == ident_idx) return true;
+
+    return is_assigned(node->left, ident_idx) || is_assigned(node->right, ident_idx);
+}
+
+static void collect_funcs(spec_state_t* state, tree_node_t** slot) {
+    tree_node_t* node = *slot;
+    if (node == nullptr || state->error != ERROR_NO) return;
+
+    if (midend_node_is_func(node, OP_LCAT)) {
+        collect_funcs(state, &node->left);
+        collect_funcs(state, &node->right);
+        return;
+    }
+
+    const tree_node_t* info = node_is_decl(node) ? node->left : nullptr;
+    if (!midend_node_is_func(info, OP_FUNC_INFO) || info->right == nullptr || info->right->type != IDENT) return;
+
+    size_t same = find_func(state, info->right->value.ident_idx);
+    if (same != NO_INDEX) {
+        func_at(state, same)->ambiguous = true;
+        return;
+    }
+
+    tree_node_t* params[SPECIALIZE_MAX_ARGS] = {};
+    spec_func_t  func = {};
+    func.slot     = slot;
+    func.decl     = node;
+    func.name_idx = info->right->value.ident_idx;
+    func.nodes    = count_nodes_recursive(node);
+    midend_collect_enum_array(info->left, params, SPECIALIZE_MAX_ARGS, &func.params_count);
+    for (size_t i = 0; i < func.params_count && i < SPECIALIZE_MAX_ARGS; i++) {
+        func.fixed[i] = params[i]->type == IDENT && !is_assigned(node->right, params[i]->value.ident_idx);
+    }
+
+    if (vector_push_back(&state->funcs, &func) != VEC_ERR_OK) state->error |= ERROR_MEM_ALLOC;
+}
+
+//================================================================================
+//                                   Клоны
+//================================================================================
+
+static void specialize_in(spec_state_t* state, tree_node_t* node);
+
+// У вложенной функции своя область видимости, её не трогаем; имя
+// вызываемой тоже IDENT, но это не переменная
+static void substitute_param(tree_node_t* node, size_t ident_idx, const_val_type value) {
+    if (node == nullptr || node_is_decl(node)) return;
+
+    if (midend_node_is_func(node, OP_FUNC_INFO)) {
+        substitute_param(node->left, ident_idx, value);
+        return;
+    }
+
+    if (node->type == IDENT) {
+        if (node->value.ident_idx != ident_idx) return;
+        node->type           = CONSTANT;
+        node->value.constant = value;
+        return;
+    }
+
+    substitute_param(node->left,  ident_idx, value);
+    substitute_param(node->right, ident_idx, value);
+}
+
+// Константы в клоне превращают ветвления по флагам в прямой код
+static void simplify_clone(spec_state_t* state, tree_node_t* clone) {
+    tree_t view = *state->tree;
+    view.root   = clone;
+    view.size   = count_nodes_recursive(clone);
+
+    size_t iterations = 0;
+    size_t rewrites   = 0;
+    bool   exhausted  = false;
+    state->error |= tree_fold_locally(&view, state->fold_budget, &iterations, &rewrites, &exhausted);
+    if (state->error == ERROR_NO) state->error |= tree_eliminate_dead_code(&view, nullptr);
+
+    HARD_ASSERT(view.root == clone, "simplify_clone: declaration replaced");
+}
+
+static size_t new_clone_name(spec_state_t* state, size_t name_idx) {
+    c_string_t name = state->tree->ident_stack->data[name_idx];
+
+    char prefix[CLONE_PREFIX_LEN] = "spec";
+    if (name.len < CLONE_PREFIX_LEN) snprintf(prefix, CLONE_PREFIX_LEN, "%.*s", (int)name.len, name.ptr);
+
+    return midend_new_temp(state->tree, prefix, &state->error);
+}
+
+// NO_INDEX, если клон не сделан
+static size_t make_clone(spec_state_t* state, const spec_clone_t* signature) {
+    spec_func_t* func = func_at(state, signature->func);
+
+    size_t name_idx = new_clone_name(state, func->name_idx);
+    if (name_idx == MIDEND_NO_TEMP || state->error != ERROR_NO) return NO_INDEX;
+
+    tree_node_t* clone = subtree_deep_copy(func->decl, &state->error ON_TREE_DUMP_CREATION_DEBUG(, state->tree));
+    tree_node_t* list  = init_node(FUNCTION, make_union_func(OP_LCAT), nullptr, clone);
+    if (clone == nullptr || list == nullptr || state->error != ERROR_NO) {
+        LOGGER_ERROR("make_clone: copy failed");
+        if (list != nullptr) free_node(list);
+        if (clone != nullptr) state->error |= destroy_node_recursive(clone, nullptr);
+        state->error |= ERROR_MEM_ALLOC;
+        return NO_INDEX;
+    }
+    clone->left->right->value.ident_idx = name_idx;
+
+    tree_node_t* params[SPECIALIZE_MAX_ARGS] = {};
+    size_t       params_count = 0;
+    midend_collect_enum_array(clone->left->left, params, SPECIALIZE_MAX_ARGS, &params_count);
+    for (size_t i = 0; i < params_count && state->error == ERROR_NO; i++) {
+        if (signature->is_const[i]) substitute_param(clone->right, params[i]->value.ident_idx, signature->values[i]);
+    }
+    if (state->error == ERROR_NO) drop_items(state, &clone->left->left, signature->is_const);
+    if (state->error == ERROR_NO) simplify_clone(state, clone);
+
+    // Встаёт за оригиналом и прежними клонами, следующий клон встанет за этим
+    list->left  = *func->slot;
+    *func->slot = list;
+    func->slot  = &list->right;
+
+    spec_clone_t made = *signature;
+    made.name_idx = name_idx;
+    if (vector_push_back(&state->clones, &made) != VEC_ERR_OK) {
+        state->error |= ERROR_MEM_ALLOC;
+        return NO_INDEX;
+    }
+
+    c_string_t func_name = state->tree->ident_stack->data[func->name_idx];
+    c_string_t spec_name = state->tree->ident_stack->data[name_idx];
+    LOGGER_INFO("tree_specialize_calls: '%.*s' specialized as '%.*s'",
+                (int)func_name.len, func_name.ptr, (int)spec_name.len, spec_name.ptr);
+
+    // Вызовы внутри клона уже видят его набор: рекурсия с тем же флагом идёт в клон
+    if (state->error == ERROR_NO) specialize_in(state, clone->right);
+    return name_idx;
+}
+
+static bool same_signature(const spec_clone_t* left, const spec_clone_t* right) {
+    if (left->func != right->func) return false;
+
+    for (size_t i = 0; i < SPECIALIZE_MAX_ARGS; i++) {
+        if (left->is_const[i] != right->is_const[i]) return false;
+        if (left->is_const[i] && memcmp(&left->values[i], &right->values[i], sizeof(const_val_type)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t find_clone(spec_state_t* state, const spec_clone_t* signature) {
+    for (size_t i = 0; i < vector_size(&state->clones); i++) {
+        const spec_clone_t* clone = clone_at(state, i);
+        if (same_signature(clone, signature)) return clone->name_idx;
+    }
+    return NO_INDEX;
+}
+
+//================================================================================
+//                                  Вызовы
+//================================================================================
+
+// CALL(FUNC_INFO(args, name), nullptr)
+static void specialize_call(spec_state_t* state, tree_node_t* call) {
+    tree_node_t* info = call->left;
+    if (!midend_node_is_func(info, OP_FUNC_INFO) || info->right == nullptr || info->right->type != IDENT) return;
+
+    size_t func_idx = find_func(state, info->right->value.ident_idx);
+    if (func_idx == NO_INDEX || func_at(state, func_idx)->ambiguous) return;
+
+    tree_node_t* args[SPECIALIZE_MAX_ARGS] = {};
+    size_t       args_count = 0;
+    midend_collect_enum_array(info->left, args, SPECIALIZE_MAX_ARGS, &args_count);
+    if (args_count > SPECIALIZE_MAX_ARGS || args_count != func_at(state, func_idx)->params_count) return;
+
+    spec_clone_t signature = {};
+    signature.func = func_idx;
+    bool any_const = false;
+    // Перезаписываемый параметр — лишь начальное значение: клон ничего бы не выиграл
+    for (size_t i = 0; i < args_count; i++) {
+        if (args[i]->type != CONSTANT || !func_at(state, func_idx)->fixed[i]) continue;
+        signature.is_const[i] = true;
+        signature.values[i]   = args[i]->value.constant;
+        any_const = true;
+    }
+    if (!any_const) return;
+
+    size_t clone_name = find_clone(state, &signature);
+    if (clone_name == NO_INDEX) {
+        if (vector_size(&state->clones) >= state->clone_budget ||
+            func_at(state, func_idx)->nodes > SPECIALIZE_MAX_NODES) return;
+
+        clone_name = make_clone(state, &signature);
+        if (clone_name == NO_INDEX || state->error != ERROR_NO) return;
+    }
+
+    drop_items(state, &info->left, signature.is_const);
+    info->right->value.ident_idx = clone_name;
+    state->retargeted++;
+}
+
+// Сначала аргументы: f(g(1), 2) специализирует и g, и f
+static void specialize_in(spec_state_t* state, tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    specialize_in(state, node->left);
+    specialize_in(state, node->right);
+
+    if (node->value.func == OP_CALL) specialize_call(state, node);
+}
+
+//================================================================================
+
+error_code tree_specialize_calls(tree_t* tree, size_t clone_budget, size_t fold_budget,
+                                 size_t* clones_out, size_t* retargeted_out) {
+    HARD_ASSERT(tree != nullptr, "tree_specialize_calls: tree is nullptr");
+
+    if (clones_out     != nullptr) *clones_out     = 0;
+    if (retargeted_out != nullptr) *retargeted_out = 0;
+    if (clone_budget == 0 || tree->ident_stack == nullptr || !midend_node_is_func(tree->root, OP_VIS_START)) {
+        return ERROR_NO;
+    }
+
+    spec_state_t state = {};
+    state.tree         = tree;
+    state.clone_budget = clone_budget;
+    state.fold_budget  = fold_budget;
+
+    if (SIMPLE_VECTOR_INIT(&state.funcs,  16, spec_func_t)  != VEC_ERR_OK ||
+        SIMPLE_VECTOR_INIT(&state.clones, 16, spec_clone_t) != VEC_ERR_OK) {
+        LOGGER_ERROR("tree_specialize_calls: vector_init failed");
+        vector_destroy(&state.funcs);
+        return ERROR_MEM_ALLOC;
+    }
+
+    collect_funcs(&state, &tree->root->right);
+
+    // Клоны в список функций не попадают: их тела обходятся при создании
+    const size_t funcs_count = vector_size(&state.funcs);
+    for (size_t i = 0; i < funcs_count && state.error == ERROR_NO; i++) {
+        specialize_in(&state, func_at(&state, i)->decl->right);
+    }
+
+    LOGGER_DEBUG("tree_specialize_calls: %zu clones, %zu calls retargeted",
+                 vector_size(&state.clones), state.retargeted);
+    if (clones_out     != nullptr) *clones_out     = vector_size(&state.clones);
+    if (retargeted_out != nullptr) *retargeted_out = state.retargeted;
+
+    vector_destroy(&state.clones);
+    vector_destroy(&state.funcs);
+    return state.error;
+}
@@ -0,0 +1,287 @@
+#include <math.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "tree_optimize.h"
+#include "tree_temps.h"
+#include "tree_strength.h"
+#include "tree_node_utils.h"
+
+static const double CMP_PRECISION = 1e-9;
+
+// Квадратов во временных для степени не больше STRENGTH_MAX_POW_EXP
+static const size_t POWER_MAX_SQUARES = 3;
+
+struct strength_state_t {
+    tree_t*        tree;
+    tree_node_t**  stmt_slot;  // nullptr: временные вводить нельзя
+    size_t         reduced;
+    error_code     error;
+};
+
+//================================================================================
+
+static bool const_is(const tree_node_t* node, const_val_type value) {
+    return node != nullptr && node->type == CONSTANT &&
+           fabs(node->value.constant - value) < CMP_PRECISION;
+}
+
+static bool const_as_small_int(const tree_node_t* node, unsigned* value_out) {
+    if (node == nullptr || node->type != CONSTANT) return false;
+
+    const_val_type value   = node->value.constant;
+    const_val_type rounded = round(value);
+    if (fabs(value - rounded) >= CMP_PRECISION) return false;
+    if (rounded < 2 || rounded > STRENGTH_MAX_POW_EXP) return false;
+
+    *value_out = (unsigned)rounded;
+    return true;
+}
+
+static tree_node_t* leaf_copy(const tree_node_t* leaf) {
+    return init_node(leaf->type, leaf->value, nullptr, nullptr);
+}
+
+static tree_node_t* make_mul(tree_node_t* left, tree_node_t* right) {
+    return init_node(FUNCTION, make_union_func(OP_MUL), left, right);
+}
+
+// Узел получает содержимое replacement, сам replacement освобождается
+static void replace_node(tree_node_t* node, tree_node_t* replacement) {
+    *node = *replacement;
+    free_node(replacement);
+}
+
+// Переносит выражение в заранее заведенную временную перед оператором
+// и возвращает её лист
+static bool hoist_to_temp(strength_state_t* state, size_t temp_idx, tree_node_t* expr, tree_node_t* leaf_out) {
+    state->error |= midend_assign_before(&state->stmt_slot, temp_idx, expr);
+    if (state->error != ERROR_NO) return false;
+
+    leaf_out->type            = IDENT;
+    leaf_out->value.ident_idx = temp_idx;
+    leaf_out->left            = nullptr;
+    leaf_out->right           = nullptr;
+    return true;
+}
+
+// Сколько квадратов build_power вынесет во временные
+static size_t power_squares_hoisted(unsigned exp) {
+    size_t count = 0;
+    for (; exp > 3; exp >>= 1) count++;
+    return count;
+}
+
+// Все временные заводятся до правки дерева: не хватило — правило не применяется
+static bool take_temps(strength_state_t* state, size_t* temps, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        temps[i] = midend_new_temp(state->tree, "sr", &state->error);
+        if (temps[i] == MIDEND_NO_TEMP || state->error != ERROR_NO) return false;
+    }
+    return true;
+}
+
+//================================================================================
+//                                  Правила
+//================================================================================
+
+// x^n двоичным возведением: квадраты, нужные дважды, уходят во временные
+static tree_node_t* build_power(strength_state_t* state, tree_node_t base, unsigned exp, const size_t* temps) {
+    tree_node_t  current = base;
+    tree_node_t* result  = nullptr;
+
+    while (exp != 0 && state->error == ERROR_NO) {
+        if (exp & 1u) {
+            tree_node_t* factor = leaf_copy(&current);
+            result = (result == nullptr) ? factor : make_mul(result, factor);
+        }
+        exp >>= 1;
+        if (exp == 0) break;
+
+        tree_node_t* square = make_mul(leaf_copy(&current), leaf_copy(&current));
+        if (exp == 1) {
+            result = (result == nullptr) ? square : make_mul(result, square);
+            break;
+        }
+
+        if (!hoist_to_temp(state, *temps++, square, &current)) {
+            LOGGER_ERROR("build_power: cannot introduce temp");
+            destroy_node_recursive(square, nullptr);
+            destroy_node_recursive(result, nullptr);
+            return nullptr;
+        }
+    }
+    return result;
+}
+
+static bool reduce_small_power(strength_state_t* state, tree_node_t* node) {
+    unsigned     exp  = 0;
+    tree_node_t* base = node->left;
+
+    if (base == nullptr || base->type == CONSTANT)  return false;
+    if (!const_as_small_int(node->right, &exp))     return false;
+
+    const bool base_is_leaf = (base->type == IDENT);
+    const bool need_temps   = !base_is_leaf || exp >= 4;
+    if (need_temps && (state->stmt_slot == nullptr || !midend_expr_is_pure(base))) return false;
+
+    size_t temps[1 + POWER_MAX_SQUARES] = {};
+    size_t temps_count = (base_is_leaf ? 0 : 1) + power_squares_hoisted(exp);
+    HARD_ASSERT(temps_count <= 1 + POWER_MAX_SQUARES, "reduce_small_power: too many temps");
+    if (!take_temps(state, temps, temps_count)) return false;
+
+    tree_node_t base_leaf = *base;
+    if (!base_is_leaf) {
+        if (!hoist_to_temp(state, temps[0], base, &base_leaf)) return false;
+        node->left = nullptr;
+    }
+
+    tree_node_t* power = build_power(state, base_leaf, exp, base_is_leaf ? temps : temps + 1);
+    if (power == nullptr || state->error != ERROR_NO) return false;
+
+    state->error |= destroy_node_recursive(node->left,  nullptr);
+    state->error |= destroy_node_recursive(node->right, nullptr);
+    replace_node(node, power);
+    return true;
+}
+
+// x * 2 -> x + x: сложение дешевле умножения, а лист читается дважды бесплатно
+static bool reduce_mul_by_two(strength_state_t* state, tree_node_t* node) {
+    tree_node_t* value = nullptr;
+    tree_node_t* two   = nullptr;
+
+    if      (const_is(node->right, 2.0)) { value = node->left;  two = node->right; }
+    else if (const_is(node->left,  2.0)) { value = node->right; two = node->left;  }
+    else return false;
+
+    if (value == nullptr || value->type != IDENT) return false;
+
+    state->error |= destroy_node_recursive(two, nullptr);
+    node->value.func = OP_PLUS;
+    node->left       = value;
+    node->right      = leaf_copy(value);
+    return true;
+}
+
+// x / c -> x * (1 / c) только если 1 / c целое: SPU считает в целых,
+// и дробный множитель изменил бы результат
+static bool reduce_div_by_constant(strength_state_t* state, tree_node_t* node) {
+    if (node->right == nullptr || node->right->type != CONSTANT) return false;
+
+    const_val_type divisor = node->right->value.constant;
+    if (fabs(divisor) < CMP_PRECISION || const_is(node->right, 1.0)) return false;
+
+    const_val_type reciprocal = 1.0 / divisor;
+    if (fabs(reciprocal - round(reciprocal)) >= CMP_PRECISION) return false;
+
+    (void)state;
+    node->value.func             = OP_MUL;
+    node->right->value.constant  = round(reciprocal);
+    return true;
+}
+
+typedef bool (*strength_rule_func_t)(strength_state_t* state, tree_node_t* node);
+
+struct strength_rule_t {
+    op_code_t            func_type_value;
+    strength_rule_func_t apply;
+};
+
+static const strength_rule_t OP_STRENGTH_RULES[] = {
+    { OP_POW, reduce_small_power     },
+    { OP_MUL, reduce_mul_by_two      },
+    { OP_DIV, reduce_div_by_constant },
+};
+
+static const strength_rule_t* find_strength_rule(op_code_t func_type_value) {
+    const size_t rules_count = sizeof(OP_STRENGTH_RULES) / sizeof(OP_STRENGTH_RULES[0]);
+    for (size_t i = 0; i < rules_count; ++i) {
+        if (OP_STRENGTH_RULES[i].func_type_value == func_type_value) {
+            return &OP_STRENGTH_RULES[i];
+        }
+    }
+    return nullptr;
+}
+
+//================================================================================
+//                                  Обход
+//================================================================================
+
+static void reduce_expr(strength_state_t* state, tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    reduce_expr(state, node->left);
+    reduce_expr(state, node->right);
+
+    const strength_rule_t* rule = find_strength_rule(node->value.func);
+    if (rule != nullptr && state->error == ERROR_NO && rule->apply(state, node)) {
+        state->reduced++;
+    }
+}
+
+// Временные можно ставить перед оператором, только если до них
+// в операторе нет вызовов и вложенных присваиваний
+static bool stmt_allows_temps(const tree_node_t* node, bool is_root) {
+    if (node == nullptr || node->type != FUNCTION) return true;
+
+    op_code_t op_code = node->value.func;
+    if (op_code == OP_CALL || op_code == OP_INPUT) return false;
+    if (op_code == OP_ASSIGN && !is_root)          return false;
+
+    return stmt_allows_temps(node->left, false) && stmt_allows_temps(node->right, false);
+}
+
+static void reduce_stmt(strength_state_t* state, tree_node_t** slot) {
+    tree_node_t* node = *slot;
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    op_code_t op_code = node->value.func;
+
+    if (op_code == OP_LCAT) {
+        reduce_stmt(state, &node->left);
+        reduce_stmt(state, &node->right);
+        return;
+    }
+
+    if (op_code == OP_VIS_START || op_code == OP_FUNC_DECL || op_code == OP_PROC_DECL) {
+        reduce_stmt(state, &node->right);
+        return;
+    }
+
+    // Условие цикла считается на каждой итерации: перед циклом ему временные не поставить
+    if (op_code == OP_WHILE) {
+        state->stmt_slot = nullptr;
+        reduce_expr(state, node->left);
+        reduce_stmt(state, &node->right);
+        return;
+    }
+
+    if (op_code == OP_IF) {
+        state->stmt_slot = stmt_allows_temps(node->left, false) ? slot : nullptr;
+        reduce_expr(state, node->left);
+        reduce_stmt(state, &node->right);
+        return;
+    }
+
+    state->stmt_slot = stmt_allows_temps(node, true) ? slot : nullptr;
+    reduce_expr(state, node);
+}
+
+//================================================================================
+
+error_code tree_reduce_strength(tree_t* tree, size_t* reduced_out) {
+    HARD_ASSERT(tree != nullptr, "tree_reduce_strength: tree is nullptr");
+
+    strength_state_t state = {};
+    state.tree = tree;
+
+    reduce_stmt(&state, &tree->root);
+
+    LOGGER_DEBUG("tree_reduce_strength: %zu reductions", state.reduced);
+    if (reduced_out != nullptr) *reduced_out = state.reduced;
+    return state.error;
+}
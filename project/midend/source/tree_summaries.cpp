@@ -0,0 +1,393 @@
+#include <stdlib.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "common/keywords/include/keywords.h"
+#include "libs/Vector/include/vector.h"
+#include "tree_call_graph.h"
+#include "tree_summaries.h"
+#include "tree_node_utils.h"
+
+static const size_t NO_INDEX   = (size_t)-1;
+static const size_t AMBIGUOUS  = (size_t)-2;
+
+// Что видно в самом теле, без вызываемых
+struct func_facts_t {
+    bool   io;
+    bool   nested;          // вложенное объявление
+    bool   loops;
+    bool   unknown_calls;   // имя не объявлено или объявлено дважды
+    size_t index;           // порядок обхода Тарьяна, NO_INDEX — не посещена
+    size_t lowlink;
+    bool   on_stack;
+    size_t scc;             // номер компоненты, NO_INDEX — ещё не обработана
+};
+
+struct summary_build_t {
+    const tree_t*     tree;
+    call_graph_t      graph;
+    func_summaries_t* summaries;
+    func_facts_t*     facts;
+    func_summary_t*   computed;    // по номерам графа, в том числе с повторными именами
+    size_t*           func_of;     // ident_idx -> номер в графе, NO_INDEX или AMBIGUOUS
+    vector_t          stack;       // size_t
+    vector_t          members;     // size_t, текущая компонента
+    size_t            next_index;
+    size_t            sccs_count;
+    error_code        error;
+};
+
+//================================================================================
+
+static bool node_is_decl(const tree_node_t* node) {
+    return midend_node_is_func(node, OP_FUNC_DECL) || midend_node_is_func(node, OP_PROC_DECL);
+}
+
+static const call_graph_func_t* graph_func(const summary_build_t* build, size_t index) {
+    return (const call_graph_func_t*)vector_get(&build->graph.funcs, index);
+}
+
+static const call_graph_edge_t* graph_edge(const summary_build_t* build, size_t index) {
+    return (const call_graph_edge_t*)vector_get(&build->graph.edges, index);
+}
+
+// Имя из CALL(FUNC_INFO(args, name), nullptr) или NO_INDEX
+static size_t call_name(const tree_node_t* call) {
+    if (!midend_node_is_func(call, OP_CALL) || !midend_node_is_func(call->left, OP_FUNC_INFO)) return NO_INDEX;
+
+    const tree_node_t* name = call->left->right;
+    return name != nullptr && name->type == IDENT ? name->value.ident_idx : NO_INDEX;
+}
+
+static size_t callee_of(const summary_build_t* build, const tree_node_t* call) {
+    size_t name_idx = call_name(call);
+    if (name_idx == NO_INDEX || name_idx >= build->summaries->idents_count) return NO_INDEX;
+    return build->func_of[name_idx];
+}
+
+//================================================================================
+//                              Факты тела
+//================================================================================
+
+// Вложенное объявление — своя вершина графа, внутрь него не смотрим
+static void collect_facts(const summary_build_t* build, func_facts_t* facts, const tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION) return;
+
+    op_code_t op_code = node->value.func;
+    if (op_code == OP_FUNC_DECL || op_code == OP_PROC_DECL) {
+        facts->nested = true;
+        return;
+    }
+
+    if (op_code == OP_PRINT || op_code == OP_INPUT) facts->io = true;
+    if (op_code == OP_WHILE) facts->loops = true;
+    if (op_code == OP_CALL) {
+        size_t callee = callee_of(build, node);
+        if (callee == NO_INDEX || callee == AMBIGUOUS) facts->unknown_calls = true;
+    }
+
+    collect_facts(build, facts, node->left);
+    collect_facts(build, facts, node->right);
+}
+
+//================================================================================
+//                            Чтение параметров
+//================================================================================
+
+static bool reads_ident(summary_build_t* build, size_t scc, const tree_node_t* node, size_t ident_idx);
+
+// Аргумент на месте, которое вызываемая не читает, ничего не читает и здесь.
+// Уточняются только уже готовые сводки — из других компонент
+static bool call_reads_ident(summary_build_t* build, size_t scc, const tree_node_t* call, size_t ident_idx) {
+    const tree_node_t* args   = call->left->left;
+    size_t             callee = callee_of(build, call);
+    if (callee == NO_INDEX || callee == AMBIGUOUS || build->facts[callee].scc == scc) {
+        return reads_ident(build, scc, args, ident_idx);
+    }
+
+    vector_t items = {};
+    if (SIMPLE_VECTOR_INIT(&items, 8, const tree_node_t*) != VEC_ERR_OK) {
+        build->error |= ERROR_MEM_ALLOC;
+        return true;
+    }
+    midend_collect_enum_items(args, &items, &build->error);
+
+    const func_summary_t* summary = &build->computed[callee];
+    bool exact = vector_size(&items) == summary->params_count;
+
+    bool reads = false;
+    for (size_t i = 0; i < vector_size(&items) && !reads; i++) {
+        const tree_node_t* arg = *(const tree_node_t**)vector_get(&items, i);
+        if (exact && !func_summary_reads_arg(summary, i)) continue;
+
+        reads = reads_ident(build, scc, arg, ident_idx);
+    }
+
+    vector_destroy(&items);
+    return reads;
+}
+
+static bool reads_ident(summary_build_t* build, size_t scc, const tree_node_t* node, size_t ident_idx) {
+    if (node == nullptr) return false;
+    if (node->type == IDENT) return node->value.ident_idx == ident_idx;
+    if (node->type != FUNCTION) return false;
+
+    // У вложенной функции своя область видимости
+    if (node_is_decl(node)) return false;
+
+    // Цель присваивания пишется, а не читается
+    if (node->value.func == OP_ASSIGN) return reads_ident(build, scc, node->right, ident_idx);
+
+    if (midend_node_is_func(node, OP_CALL) && midend_node_is_func(node->left, OP_FUNC_INFO)) {
+        return call_reads_ident(build, scc, node, ident_idx);
+    }
+
+    return reads_ident(build, scc, node->left, ident_idx) || reads_ident(build, scc, node->right, ident_idx);
+}
+
+static void summarize_params(summary_build_t* build, size_t func_idx) {
+    const tree_node_t* decl    = graph_func(build, func_idx)->decl;
+    func_summary_t*    summary = &build->computed[func_idx];
+
+    vector_t params = {};
+    if (SIMPLE_VECTOR_INIT(&params, 8, const tree_node_t*) != VEC_ERR_OK) {
+        build->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+    midend_collect_enum_items(decl->left->left, &params, &build->error);
+
+    summary->params_count = vector_size(&params);
+    for (size_t i = 0; i < summary->params_count && i < SUMMARY_MAX_TRACKED_ARGS; i++) {
+        const tree_node_t* param = *(const tree_node_t**)vector_get(&params, i);
+        if (param->type != IDENT ||
+            reads_ident(build, build->facts[func_idx].scc, decl->right, param->value.ident_idx)) {
+            summary->reads_args |= (uint64_t)1 << i;
+        }
+    }
+
+    vector_destroy(&params);
+}
+
+//================================================================================
+//                         Компоненты связности
+//================================================================================
+
+// Вся компонента получает общие флаги: члены вызывают друг друга
+static void summarize_scc(summary_build_t* build) {
+    const size_t members_count = vector_size(&build->members);
+    const size_t scc           = build->sccs_count++;
+
+    bool does_io   = false;
+    bool pure      = true;
+    bool loops     = false;
+    bool recursive = members_count > 1;
+
+    // Номер компоненты ставится заранее: по нему проверяется членство
+    for (size_t m = 0; m < members_count; m++) {
+        size_t        func_idx = *(size_t*)vector_get(&build->members, m);
+        func_facts_t* facts    = &build->facts[func_idx];
+        facts->scc = scc;
+
+        does_io |= facts->io || facts->unknown_calls;
+        pure    &= !facts->nested;
+        loops   |= facts->loops;
+    }
+
+    bool callees_terminate = true;
+    for (size_t m = 0; m < members_count; m++) {
+        size_t func_idx = *(size_t*)vector_get(&build->members, m);
+
+        for (size_t i = graph_func(build, func_idx)->first_out; i != CALL_GRAPH_NO_EDGE;) {
+            const call_graph_edge_t* edge = graph_edge(build, i);
+            i = edge->next_out;
+
+            if (build->facts[edge->callee].scc == scc) {
+                recursive = true;
+                continue;
+            }
+
+            const func_summary_t* callee = &build->computed[edge->callee];
+            does_io           |= callee->does_io;
+            pure              &= callee->pure;
+            callees_terminate &= callee->terminates;
+        }
+    }
+    pure &= !does_io;
+
+    for (size_t m = 0; m < members_count; m++) {
+        size_t func_idx = *(size_t*)vector_get(&build->members, m);
+
+        func_summary_t* summary = &build->computed[func_idx];
+        summary->is_proc    = graph_func(build, func_idx)->is_proc;
+        summary->does_io    = does_io;
+        summary->pure       = pure;
+        summary->terminates = pure && !recursive && !loops && callees_terminate;
+        summary->recursive  = recursive;
+    }
+
+    // Чтение параметров смотрит на сводки вызываемых, поэтому после флагов
+    for (size_t m = 0; m < members_count && build->error == ERROR_NO; m++) {
+        summarize_params(build, *(size_t*)vector_get(&build->members, m));
+    }
+}
+
+// Тарьян: компонента закрывается после всех, до которых из неё можно дойти
+static void strong_connect(summary_build_t* build, size_t func_idx) {
+    func_facts_t* facts = &build->facts[func_idx];
+    facts->index    = build->next_index;
+    facts->lowlink  = build->next_index;
+    facts->on_stack = true;
+    build->next_index++;
+    if (vector_push_back(&build->stack, &func_idx) != VEC_ERR_OK) {
+        build->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+
+    for (size_t i = graph_func(build, func_idx)->first_out; i != CALL_GRAPH_NO_EDGE && build->error == ERROR_NO;) {
+        const call_graph_edge_t* edge = graph_edge(build, i);
+        i = edge->next_out;
+
+        func_facts_t* callee = &build->facts[edge->callee];
+        if (callee->index == NO_INDEX) {
+            strong_connect(build, edge->callee);
+            if (callee->lowlink < facts->lowlink) facts->lowlink = callee->lowlink;
+        } else if (callee->on_stack && callee->index < facts->lowlink) {
+            facts->lowlink = callee->index;
+        }
+    }
+    if (facts->lowlink != facts->index || build->error != ERROR_NO) return;
+
+    vector_clear(&build->members);
+    size_t member = NO_INDEX;
+    do {
+        vector_pop_back(&build->stack, &member);
+        build->facts[member].on_stack = false;
+        if (vector_push_back(&build->members, &member) != VEC_ERR_OK) build->error |= ERROR_MEM_ALLOC;
+    } while (member != func_idx);
+
+    if (build->error == ERROR_NO) summarize_scc(build);
+}
+
+//================================================================================
+
+static error_code build_alloc(summary_build_t* build, size_t funcs_count) {
+    func_summaries_t* summaries = build->summaries;
+
+    summaries->by_ident = (func_summary_t*)calloc(summaries->idents_count + 1, sizeof(func_summary_t));
+    build->facts        = (func_facts_t*)  calloc(funcs_count + 1, sizeof(func_facts_t));
+    build->computed     = (func_summary_t*)calloc(funcs_count + 1, sizeof(func_summary_t));
+    build->func_of      = (size_t*)        calloc(summaries->idents_count + 1, sizeof(size_t));
+
+    if (summaries->by_ident == nullptr || build->facts == nullptr || build->computed == nullptr ||
+        build->func_of == nullptr ||
+        SIMPLE_VECTOR_INIT(&build->stack,   16, size_t) != VEC_ERR_OK ||
+        SIMPLE_VECTOR_INIT(&build->members, 16, size_t) != VEC_ERR_OK) {
+        LOGGER_ERROR("func_summaries_build: allocation failed");
+        return ERROR_MEM_ALLOC;
+    }
+    return ERROR_NO;
+}
+
+static void build_release(summary_build_t* build) {
+    free(build->facts);
+    free(build->computed);
+    free(build->func_of);
+    vector_destroy(&build->stack);
+    vector_destroy(&build->members);
+    call_graph_destroy(&build->graph);
+}
+
+error_code func_summaries_build(const tree_t* tree, func_summaries_t* summaries) {
+    HARD_ASSERT(tree      != nullptr, "func_summaries_build: tree is nullptr");
+    HARD_ASSERT(summaries != nullptr, "func_summaries_build: summaries is nullptr");
+
+    *summaries = {};
+    if (tree->root == nullptr || tree->ident_stack == nullptr) return ERROR_NO;
+    summaries->idents_count = tree->ident_stack->size;
+
+    summary_build_t build = {};
+    build.tree      = tree;
+    build.summaries = summaries;
+
+    build.error = call_graph_build(tree, nullptr, &build.graph);
+    if (build.error != ERROR_NO) return build.error;
+
+    const size_t funcs_count = vector_size(&build.graph.funcs);
+    build.error = build_alloc(&build, funcs_count);
+
+    if (build.error == ERROR_NO) {
+        for (size_t i = 0; i < summaries->idents_count; i++) build.func_of[i] = NO_INDEX;
+        for (size_t i = 0; i < funcs_count; i++) {
+            size_t name_idx = graph_func(&build, i)->name_idx;
+            if (name_idx >= summaries->idents_count) continue;
+            build.func_of[name_idx] = build.func_of[name_idx] == NO_INDEX ? i : AMBIGUOUS;
+        }
+
+        for (size_t i = 0; i < funcs_count; i++) {
+            build.facts[i].index = NO_INDEX;
+            build.facts[i].scc   = NO_INDEX;
+            collect_facts(&build, &build.facts[i], graph_func(&build, i)->decl->right);
+        }
+        for (size_t i = 0; i < funcs_count && build.error == ERROR_NO; i++) {
+            if (build.facts[i].index == NO_INDEX) strong_connect(&build, i);
+        }
+    }
+
+    // Повторно объявленное имя в таблицу не попадает: по нему не понять, кого зовут
+    for (size_t i = 0; i < funcs_count && build.error == ERROR_NO; i++) {
+        size_t name_idx = graph_func(&build, i)->name_idx;
+        if (name_idx >= summaries->idents_count || build.func_of[name_idx] != i) continue;
+
+        summaries->by_ident[name_idx]       = build.computed[i];
+        summaries->by_ident[name_idx].known = true;
+        summaries->funcs_count++;
+    }
+
+    LOGGER_DEBUG("func_summaries_build: %zu functions, %zu components",
+                 summaries->funcs_count, build.sccs_count);
+    build_release(&build);
+    if (build.error != ERROR_NO) func_summaries_destroy(summaries);
+    return build.error;
+}
+
+void func_summaries_destroy(func_summaries_t* summaries) {
+    if (summaries == nullptr) return;
+
+    free(summaries->by_ident);
+    *summaries = {};
+}
+
+//================================================================================
+//                                Запросы
+//================================================================================
+
+const func_summary_t* func_summaries_find(const func_summaries_t* summaries, size_t name_idx) {
+    if (summaries == nullptr || summaries->by_ident == nullptr || name_idx >= summaries->idents_count) {
+        return nullptr;
+    }
+
+    const func_summary_t* summary = &summaries->by_ident[name_idx];
+    return summary->known ? summary : nullptr;
+}
+
+const func_summary_t* func_summaries_callee(const func_summaries_t* summaries, const tree_node_t* call) {
+    size_t name_idx = call_name(call);
+    return name_idx == NO_INDEX ? nullptr : func_summaries_find(summaries, name_idx);
+}
+
+bool func_summaries_call_is_pure(const func_summaries_t* summaries, const tree_node_t* call) {
+    const func_summary_t* summary = func_summaries_callee(summaries, call);
+    return summary != nullptr && summary->pure;
+}
+
+bool func_summaries_call_is_removable(const func_summaries_t* summaries, const tree_node_t* call) {
+    const func_summary_t* summary = func_summaries_callee(summaries, call);
+    return summary != nullptr && summary->terminates;
+}
+
+bool func_summary_reads_arg(const func_summary_t* summary, size_t arg_idx) {
+    if (summary == nullptr || arg_idx >= SUMMARY_MAX_TRACKED_ARGS) return true;
+    return (summary->reads_args & ((uint64_t)1 << arg_idx)) != 0;
+}
@@ -0,0 +1,241 @@
+#include <stdlib.h>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "libs/Vector/include/vector.h"
+#include "tree_temps.h"
+#include "tree_tail_calls.h"
+#include "tree_node_utils.h"
+
+struct tail_state_t {
+    tree_t*    tree;
+    size_t     name_idx;   // текущая функция
+    vector_t   params;     // tree_node_t*: IDENT параметров по порядку
+    vector_t   args;       // tree_node_t*: аргументы разбираемого вызова
+    vector_t   temps;      // size_t: временная на аргумент или MIDEND_NO_TEMP
+    size_t     eliminated;
+    error_code error;
+};
+
+//================================================================================
+
+static bool node_is_ident(const tree_node_t* node, size_t ident_idx) {
+    return node != nullptr && node->type == IDENT && node->value.ident_idx == ident_idx;
+}
+
+static tree_node_t* item_at(vector_t* items, size_t index) {
+    return *(tree_node_t**)vector_get(items, index);
+}
+
+// RETURN(nullptr, CALL(FUNC_INFO(args, name), nullptr)) с именем текущей функции
+static bool is_self_tail_call(const tail_state_t* state, const tree_node_t* node) {
+    if (!midend_node_is_func(node, OP_RETURN)) return false;
+
+    const tree_node_t* call = node->right;
+    if (!midend_node_is_func(call, OP_CALL) || !midend_node_is_func(call->left, OP_FUNC_INFO)) return false;
+
+    return node_is_ident(call->left->right, state->name_idx);
+}
+
+//================================================================================
+
+// Временные заводятся до правки дерева: при нехватке имён вызов остаётся
+static bool plan_temps(tail_state_t* state) {
+    vector_clear(&state->temps);
+
+    for (size_t i = 0; i < vector_size(&state->args); i++) {
+        tree_node_t* arg   = item_at(&state->args,   i);
+        tree_node_t* param = item_at(&state->params, i);
+
+        size_t temp_idx = MIDEND_NO_TEMP;
+        if (arg->type != CONSTANT && !node_is_ident(arg, param->value.ident_idx)) {
+            temp_idx = midend_new_temp(state->tree, "tc", &state->error);
+            if (temp_idx == MIDEND_NO_TEMP || state->error != ERROR_NO) return false;
+        }
+
+        if (vector_push_back(&state->temps, &temp_idx) != VEC_ERR_OK) {
+            state->error |= ERROR_MEM_ALLOC;
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t temp_at(tail_state_t* state, size_t index) {
+    return *(size_t*)vector_get(&state->temps, index);
+}
+
+// { tc.i = arg_i; ... p_i = tc.i; ... continue; } на месте return
+static void rewrite_tail_call(tail_state_t* state, tree_node_t** slot) {
+    tree_node_t* ret  = *slot;
+    tree_node_t* call = ret->right;
+    tree_node_t* info = call->left;
+
+    vector_clear(&state->args);
+    midend_collect_enum_items(info->left, &state->args, &state->error);
+    if (state->error != ERROR_NO) return;
+
+    if (vector_size(&state->args) != vector_size(&state->params)) {
+        LOGGER_WARNING("rewrite_tail_call: %zu args for %zu params",
+                       vector_size(&state->args), vector_size(&state->params));
+        return;
+    }
+    if (!plan_temps(state)) return;
+
+    tree_node_t* head = init_node(FUNCTION, make_union_func(OP_CONTINUE), nullptr, nullptr);
+    if (head == nullptr) {
+        LOGGER_ERROR("rewrite_tail_call: init_node failed");
+        state->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+    tree_node_t** cursor = &head;
+
+    for (size_t i = 0; i < vector_size(&state->args) && state->error == ERROR_NO; i++) {
+        size_t temp_idx = temp_at(state, i);
+        if (temp_idx != MIDEND_NO_TEMP) {
+            state->error |= midend_assign_before(&cursor, temp_idx, item_at(&state->args, i));
+        }
+    }
+
+    for (size_t i = 0; i < vector_size(&state->args) && state->error == ERROR_NO; i++) {
+        tree_node_t* arg      = item_at(&state->args, i);
+        size_t       param    = item_at(&state->params, i)->value.ident_idx;
+        size_t       temp_idx = temp_at(state, i);
+
+        if (temp_idx != MIDEND_NO_TEMP) {
+            arg = init_node(IDENT, make_union_var(temp_idx), nullptr, nullptr);
+        } else if (arg->type != CONSTANT) {
+            free_node(arg);     // p = p
+            continue;
+        }
+
+        if (arg == nullptr) {
+            LOGGER_ERROR("rewrite_tail_call: init_node failed");
+            state->error |= ERROR_MEM_ALLOC;
+            break;
+        }
+        state->error |= midend_assign_before(&cursor, param, arg);
+    }
+
+    midend_free_enum_links(info->left);
+    free_node(info->right);
+    free_node(info);
+    free_node(call);
+    free_node(ret);
+
+    *slot = head;
+    state->eliminated++;
+}
+
+static void tail_stmt(tail_state_t* state, tree_node_t** slot) {
+    tree_node_t* node = *slot;
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    op_code_t op_code = node->value.func;
+
+    if (op_code == OP_LCAT) {
+        tail_stmt(state, &node->left);
+        tail_stmt(state, &node->right);
+        return;
+    }
+
+    if (op_code == OP_VIS_START || op_code == OP_IF) {
+        tail_stmt(state, &node->right);
+        return;
+    }
+
+    if (is_self_tail_call(state, node)) rewrite_tail_call(state, slot);
+}
+
+//================================================================================
+
+// decl->right = VIS_START(nullptr, WHILE(1, VIS_START(nullptr, LCAT(тело, BREAK))))
+static void wrap_in_loop(tail_state_t* state, tree_node_t* decl) {
+    tree_node_t* body  = decl->right;
+    tree_node_t* stop  = init_node(FUNCTION, make_union_func(OP_BREAK), nullptr, nullptr);
+    tree_node_t* list  = body->right == nullptr ? stop :
+                         init_node(FUNCTION, make_union_func(OP_LCAT), body->right, stop);
+    tree_node_t* cond  = init_node(CONSTANT, make_union_const(1), nullptr, nullptr);
+    tree_node_t* loop  = init_node(FUNCTION, make_union_func(OP_WHILE), cond, body);
+    tree_node_t* scope = init_node(FUNCTION, make_union_func(OP_VIS_START), nullptr, loop);
+
+    if (stop == nullptr || list == nullptr || cond == nullptr || loop == nullptr || scope == nullptr) {
+        LOGGER_ERROR("wrap_in_loop: init_node failed");
+        state->error |= ERROR_MEM_ALLOC;
+        return;
+    }
+
+    body->right = list;
+    decl->right = scope;
+}
+
+static void tail_decl(tail_state_t* state, tree_node_t* decl) {
+    tree_node_t* info = decl->left;
+    if (!midend_node_is_func(info, OP_FUNC_INFO) || info->right == nullptr || info->right->type != IDENT) return;
+    if (!midend_node_is_func(decl->right, OP_VIS_START)) return;
+
+    state->name_idx = info->right->value.ident_idx;
+
+    vector_clear(&state->params);
+    midend_collect_enum_items(info->left, &state->params, &state->error);
+    for (size_t i = 0; i < vector_size(&state->params); i++) {
+        if (item_at(&state->params, i)->type != IDENT) return;
+    }
+
+    size_t before = state->eliminated;
+    tail_stmt(state, &decl->right);
+    if (state->eliminated == before || state->error != ERROR_NO) return;
+
+    wrap_in_loop(state, decl);
+    LOGGER_DEBUG("tail_decl: %zu tail calls turned into a loop", state->eliminated - before);
+}
+
+static void tail_tree(tail_state_t* state, tree_node_t* node) {
+    if (node == nullptr || node->type != FUNCTION || state->error != ERROR_NO) return;
+
+    // proc завершается finish без значения: хвостовой return есть только у func
+    if (node->value.func == OP_FUNC_DECL) {
+        tail_decl(state, node);
+        return;
+    }
+    if (node->value.func == OP_PROC_DECL) return;
+
+    tail_tree(state, node->left);
+    tail_tree(state, node->right);
+}
+
+//================================================================================
+
+error_code tree_eliminate_tail_calls(tree_t* tree, size_t* eliminated_out) {
+    HARD_ASSERT(tree != nullptr, "tree_eliminate_tail_calls: tree is nullptr");
+
+    if (eliminated_out != nullptr) *eliminated_out = 0;
+    if (tree->root == nullptr || tree->ident_stack == nullptr) return ERROR_NO;
+
+    tail_state_t state = {};
+    state.tree = tree;
+
+    if (SIMPLE_VECTOR_INIT(&state.params, 8, tree_node_t*) != VEC_ERR_OK ||
+        SIMPLE_VECTOR_INIT(&state.args,   8, tree_node_t*) != VEC_ERR_OK ||
+        SIMPLE_VECTOR_INIT(&state.temps,  8, size_t)       != VEC_ERR_OK) {
+        LOGGER_ERROR("tree_eliminate_tail_calls: vector_init failed");
+        vector_destroy(&state.params);
+        vector_destroy(&state.args);
+        vector_destroy(&state.temps);
+        return ERROR_MEM_ALLOC;
+    }
+
+    tail_tree(&state, tree->root);
+
+    LOGGER_DEBUG("tree_eliminate_tail_calls: %zu tail calls eliminated", state.eliminated);
+    if (eliminated_out != nullptr) *eliminated_out = state.eliminated;
+
+    vector_destroy(&state.params);
+    vector_destroy(&state.args);
+    vector_destroy(&state.temps);
+    return state.error;
+}
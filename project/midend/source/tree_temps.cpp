@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "common/asserts/include/asserts.h"
+#include "common/logger/include/logger.h"
+#include "libs/AST/include/tree_info.h"
+#include "libs/AST/include/error_handler.h"
+#include "libs/AST/include/tree_operations.h"
+#include "common/keywords/include/keywords.h"
+#include "tree_temps.h"
+
+static const size_t TEMP_NAME_SIZE = 24;
+
+// Параллельный режим: у каждого элемента свой блок заглушек, блоки подряд
+// занимают идентификаторы начиная с reserved_first_ident. Текст заглушек
+// заранее выделен в дереве, элемент пишет только в свой блок
+struct temp_block_t {
+    size_t first;  // номер первой заглушки блока
+    size_t size;
+    size_t used;
+};
+
+static const size_t NO_JOB = (size_t)-1;
+
+// Временная заменяет хотя бы столько узлов элемента
+static const size_t NODES_PER_TEMP = 4;
+
+static bool          reserved_mode        = false;
+static size_t        reserved_jobs        = 0;
+static size_t        reserved_total       = 0;
+static size_t        reserved_first_ident = 0;
+static char*         reserved_names       = nullptr;
+static temp_block_t* reserved_blocks      = nullptr;
+
+static thread_local size_t current_job = NO_JOB;
+
+static size_t take_reserved_temp(tree_t* tree, const char* prefix) {
+    if (current_job >= reserved_jobs) return MIDEND_NO_TEMP;
+
+    temp_block_t* block = &reserved_blocks[current_job];
+    if (block->used >= block->size) return MIDEND_NO_TEMP;
+
+    // Номер в имени временный: окончательный дает midend_temps_release
+    size_t slot = block->first + block->used;
+    char*  name = reserved_names + slot * TEMP_NAME_SIZE;
+    int    len  = snprintf(name, TEMP_NAME_SIZE, "%s.%zu", prefix, slot);
+    if (len <= 0 || (size_t)len >= TEMP_NAME_SIZE) {
+        LOGGER_ERROR("take_reserved_temp: prefix too long");
+        return MIDEND_NO_TEMP;
+    }
+    block->used++;
+
+    size_t ident_idx = reserved_first_ident + slot;
+    tree->ident_stack->data[ident_idx] = {name, (size_t)len};
+    return ident_idx;
+}
+
+// Следующий свободный номер: имена, прочитанные из файла, не перекрываются
+static int format_free_name(tree_t* tree, const char* prefix, char* name) {
+    while (true) {
+        int len = snprintf(name, TEMP_NAME_SIZE, "%s.%zu", prefix, tree->names.generated);
+        if (len <= 0 || (size_t)len >= TEMP_NAME_SIZE) return -1;
+
+        tree->names.generated++;
+        if (get_ident_idx({name, (size_t)len}, tree->ident_stack) == -1) return len;
+    }
+}
+
+size_t midend_new_temp(tree_t* tree, const char* prefix, error_code* error) {
+    HARD_ASSERT(tree   != nullptr, "midend_new_temp: tree is nullptr");
+    HARD_ASSERT(prefix != nullptr, "midend_new_temp: prefix is nullptr");
+    HARD_ASSERT(error  != nullptr, "midend_new_temp: error is nullptr");
+
+    if (tree->ident_stack == nullptr) return MIDEND_NO_TEMP;
+    if (reserved_mode) return take_reserved_temp(tree, prefix);
+
+    char buff[TEMP_NAME_SIZE] = "";
+    int  len = format_free_name(tree, prefix, buff);
+    if (len < 0) {
+        LOGGER_ERROR("midend_new_temp: prefix too long");
+        return MIDEND_NO_TEMP;
+    }
+
+    char* name = tree_names_alloc(tree, (size_t)len);
+    if (name == nullptr) {
+        *error |= ERROR_MEM_ALLOC;
+        return MIDEND_NO_TEMP;
+    }
+    memcpy(name, buff, (size_t)len);
+
+    return add_ident({name, (size_t)len}, tree->ident_stack, error);
+}
+
+static void drop_reserved() {
+    free(reserved_blocks);
+    reserved_blocks = nullptr;
+    reserved_names  = nullptr;
+    reserved_jobs   = 0;
+    reserved_total  = 0;
+    reserved_mode   = false;
+}
+
+error_code midend_temps_reserve(tree_t* tree, const size_t* job_nodes, size_t jobs_count) {
+    HARD_ASSERT(tree      != nullptr, "midend_temps_reserve: tree is nullptr");
+    HARD_ASSERT(job_nodes != nullptr, "midend_temps_reserve: job_nodes is nullptr");
+    HARD_ASSERT(!reserved_mode,       "midend_temps_reserve: already reserved");
+
+    if (tree->ident_stack == nullptr || jobs_count == 0) return ERROR_NO;
+
+    reserved_blocks = (temp_block_t*)calloc(jobs_count, sizeof(temp_block_t));
+    if (reserved_blocks == nullptr) {
+        LOGGER_ERROR("midend_temps_reserve: calloc failed");
+        return ERROR_MEM_ALLOC;
+    }
+
+    // Размер блока зависит только от самого элемента, а не от потоков
+    size_t total = 0;
+    for (size_t job = 0; job < jobs_count; job++) {
+        reserved_blocks[job].first = total;
+        reserved_blocks[job].size  = MIDEND_JOB_TEMPS + job_nodes[job] / NODES_PER_TEMP;
+        total += reserved_blocks[job].size;
+    }
+
+    reserved_names = tree_names_alloc(tree, total * TEMP_NAME_SIZE);
+    if (reserved_names == nullptr) {
+        drop_reserved();
+        return ERROR_MEM_ALLOC;
+    }
+
+    reserved_first_ident = tree->ident_stack->size;
+    reserved_jobs        = jobs_count;
+    reserved_total       = total;
+    reserved_mode        = true;
+
+    error_code error = ERROR_NO;
+    for (size_t slot = 0; slot < total && error == ERROR_NO; slot++) {
+        char* name = reserved_names + slot * TEMP_NAME_SIZE;
+        int   len  = snprintf(name, TEMP_NAME_SIZE, "tmp.%zu", slot);
+        (void)add_ident({name, (size_t)len}, tree->ident_stack, &error);
+    }
+
+    if (error != ERROR_NO) {
+        LOGGER_ERROR("midend_temps_reserve: add_ident failed");
+        error_code pop_error = ERROR_NO;
+        while (tree->ident_stack->size > reserved_first_ident && pop_error == ERROR_NO) {
+            (void)ident_stack_pop(tree->ident_stack, &pop_error);
+        }
+        drop_reserved();
+    }
+    return error;
+}
+
+void midend_temps_enter_job(size_t job) {
+    current_job = job;
+}
+
+static void remap_temps(tree_node_t* node, const size_t* remap) {
+    if (node == nullptr) return;
+
+    if (node->type == IDENT && node->value.ident_idx >= reserved_first_ident &&
+        node->value.ident_idx <  reserved_first_ident + reserved_total) {
+        size_t new_idx = remap[node->value.ident_idx - reserved_first_ident];
+        HARD_ASSERT(new_idx != MIDEND_NO_TEMP, "remap_temps: unused placeholder in tree");
+        node->value.ident_idx = new_idx;
+    }
+
+    remap_temps(node->left,  remap);
+    remap_temps(node->right, remap);
+}
+
+// Взятые заглушки по порядку элементов становятся идентификаторами подряд
+// с окончательными именами; неиспользованные снимаются
+static error_code compact_reserved(tree_t* tree) {
+    size_t* remap = (size_t*)calloc(reserved_total, sizeof(size_t));
+    if (remap == nullptr) return ERROR_MEM_ALLOC;
+    for (size_t i = 0; i < reserved_total; i++) remap[i] = MIDEND_NO_TEMP;
+
+    error_code error = ERROR_NO;
+    while (tree->ident_stack->size > reserved_first_ident && error == ERROR_NO) {
+        (void)ident_stack_pop(tree->ident_stack, &error);
+    }
+
+    for (size_t job = 0; job < reserved_jobs && error == ERROR_NO; job++) {
+        const temp_block_t* block = &reserved_blocks[job];
+        for (size_t slot = block->first; slot < block->first + block->used && error == ERROR_NO; slot++) {
+            char* name = reserved_names + slot * TEMP_NAME_SIZE;
+
+            char* dot = strrchr(name, '.');
+            HARD_ASSERT(dot != nullptr, "compact_reserved: placeholder without number");
+            *dot = '\0';
+
+            char buff[TEMP_NAME_SIZE] = "";
+            int  len = format_free_name(tree, name, buff);
+            HARD_ASSERT(len > 0, "compact_reserved: name does not fit");
+            memcpy(name, buff, TEMP_NAME_SIZE);
+
+            remap[slot] = add_ident({name, (size_t)len}, tree->ident_stack, &error);
+        }
+    }
+
+    if (error == ERROR_NO) remap_temps(tree->root, remap);
+    free(remap);
+    return error;
+}
+
+error_code midend_temps_release(tree_t* tree) {
+    HARD_ASSERT(tree != nullptr, "midend_temps_release: tree is nullptr");
+
+    if (!reserved_mode) return ERROR_NO;
+
+    HARD_ASSERT(tree->ident_stack->size == reserved_first_ident + reserved_total,
+                "midend_temps_release: ident_stack changed while reserved");
+
+    error_code error = compact_reserved(tree);
+    size_t     used  = tree->ident_stack->size - reserved_first_ident;
+    drop_reserved();
+    current_job = NO_JOB;
+
+    LOGGER_DEBUG("midend_temps_release: %zu temps taken in parallel", used);
+    if (error != ERROR_NO) LOGGER_ERROR("midend_temps_release: compaction failed");
+    return error;
+}
+
+error_code midend_insert_before(tree_node_t*** stmt_slot_ref, tree_node_t* stmt) {
+    HARD_ASSERT(stmt_slot_ref  != nullptr, "midend_insert_before: stmt_slot_ref is nullptr");
+    HARD_ASSERT(*stmt_slot_ref != nullptr, "midend_insert_before: slot is nullptr");
+
+    tree_node_t** slot = *stmt_slot_ref;
+    tree_node_t*  list = init_node(FUNCTION, make_union_func(OP_LCAT), stmt, *slot);
+    if (list == nullptr) {
+        LOGGER_ERROR("midend_insert_before: init_node failed");
+        return ERROR_MEM_ALLOC;
+    }
+
+    *slot          = list;
+    *stmt_slot_ref = &list->right;
+    return ERROR_NO;
+}
+
+error_code midend_assign_before(tree_node_t*** stmt_slot_ref, size_t temp_idx, tree_node_t* expr) {
+    tree_node_t* name   = init_node(IDENT, make_union_var(temp_idx), nullptr, nullptr);
+    tree_node_t* assign = init_node(FUNCTION, make_union_func(OP_ASSIGN), name, expr);
+
+    if (name == nullptr || assign == nullptr) {
+        LOGGER_ERROR("midend_assign_before: init_node failed");
+        free_node(assign);
+        free_node(name);
+        return ERROR_MEM_ALLOC;
+    }
+
+    return midend_insert_before(stmt_slot_ref, assign);
+}
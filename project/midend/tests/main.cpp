@@ -1,6 +1,906 @@
+#include <pthread.h>
+#include <string.h>
+
 #include "libs/AST/include/DSL.h"
 #include "libs/AST/include/node_info.h"
 #include "tree_optimize.h"
+#include "tree_passes.h"
+#include "tree_rewrite.h"
+#include "tree_call_graph.h"
+#include "tree_summaries.h"
+#include "tree_liveness.h"
+#include "tree_const_eval.h"
+#include "tree_specialize.h"
+#include "tree_reassociate.h"
+#include "tree_strength.h"
+
+// (x * (3 - 2)) + (0 * y): упрощения идут снизу вверх через рабочий список
+static void test_fixed_point() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+    tree_node_t* new_root = PLUS_(MUL_(v("x"), MINUS_(c(3), c(2))), MUL_(c(0), v("y")));
+    tree_change_root(tree, new_root);
+
+    optimize_stats_t stats = {};
+    tree_optimize(tree, &OPTIMIZE_DEFAULT_OPTIONS, &stats);
+    printf("fixed point: iterations=%zu, rewrites=%zu, size=%zu\n",
+           stats.iterations, stats.rewrites, tree->size);
+    if (tree->root->type != IDENT || tree->size != 1) printf("\nFailed\n");
+    else                                              printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// x = 5; y = x * 2; z = y; print(z);  ->  ...; print(10);
+static void test_propagation() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* print_node = FUNC_TEMPLATE(OP_PRINT, v("z"), nullptr);
+    tree_node_t* stmts =
+        FUNC_TEMPLATE(OP_LCAT,
+            FUNC_TEMPLATE(OP_LCAT,
+                FUNC_TEMPLATE(OP_LCAT,
+                    FUNC_TEMPLATE(OP_ASSIGN, v("x"), c(5)),
+                    FUNC_TEMPLATE(OP_ASSIGN, v("y"), MUL_(v("x"), c(2)))),
+                FUNC_TEMPLATE(OP_ASSIGN, v("z"), v("y"))),
+            print_node);
+    tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, stmts));
+
+    optimize_stats_t stats = {};
+    tree_optimize(tree, &OPTIMIZE_DEFAULT_OPTIONS, &stats);
+    printf("propagation: substitutions=%zu, rewrites=%zu\n",
+           stats.substitutions, stats.rewrites);
+
+    const tree_node_t* printed = print_node->left;
+    if (printed->type != CONSTANT || printed->value.constant < 9.5 ||
+        printed->value.constant > 10.5) printf("\nFailed\n");
+    else                               printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// if (0 == 1) {...}; while (0) {...}; return 1; print(3);  ->  return 1;
+static void test_dead_code() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* return_node = FUNC_TEMPLATE(OP_RETURN, nullptr, c(1));
+    tree_node_t* stmts =
+        FUNC_TEMPLATE(OP_LCAT,
+            FUNC_TEMPLATE(OP_LCAT,
+                FUNC_TEMPLATE(OP_LCAT,
+                    FUNC_TEMPLATE(OP_IF, FUNC_TEMPLATE(OP_EQ, c(0), c(1)),
+                        FUNC_TEMPLATE(OP_VIS_START, nullptr,
+                                      FUNC_TEMPLATE(OP_ASSIGN, v("x"), c(1)))),
+                    FUNC_TEMPLATE(OP_WHILE, c(0),
+                        FUNC_TEMPLATE(OP_VIS_START, nullptr,
+                                      FUNC_TEMPLATE(OP_ASSIGN, v("y"), c(2))))),
+                return_node),
+            FUNC_TEMPLATE(OP_PRINT, c(3), nullptr));
+    tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, stmts));
+
+    optimize_stats_t stats = {};
+    tree_optimize(tree, &OPTIMIZE_DEFAULT_OPTIONS, &stats);
+    printf("dead code: removed=%zu, size=%zu\n", stats.statements_removed, tree->size);
+
+    if (tree->root->right != return_node || tree->size != 3) printf("\nFailed\n");
+    else                                                     printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// x = a * b + c; y = a * b + c; return x + y;  ->  cse.N = a * b + c; x = cse.N; y = cse.N; ...
+static void test_common_subexpr() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* first  = FUNC_TEMPLATE(OP_ASSIGN, v("x"), PLUS_(MUL_(v("a"), v("b")), v("c")));
+    tree_node_t* second = FUNC_TEMPLATE(OP_ASSIGN, v("y"), PLUS_(MUL_(v("a"), v("b")), v("c")));
+    tree_node_t* result = FUNC_TEMPLATE(OP_RETURN, nullptr, PLUS_(v("x"), v("y")));
+    tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr,
+                                         FUNC_TEMPLATE(OP_LCAT, FUNC_TEMPLATE(OP_LCAT, first, second), result)));
+
+    optimize_stats_t stats = {};
+    tree_optimize(tree, &OPTIMIZE_DEFAULT_OPTIONS, &stats);
+    printf("common subexpr: temps=%zu, size=%zu\n", stats.cse_temps, tree->size);
+
+    if (stats.cse_temps != 1 || first->right->type != IDENT || second->right->type != IDENT ||
+        first->right->value.ident_idx != second->right->value.ident_idx) printf("\nFailed\n");
+    else                                                                  printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// y = x ^ 4; z = x * 2; return y + z;  ->  sr.0 = x * x; y = sr.0 * sr.0; z = x + x; ...
+static void test_strength_reduction() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* power    = FUNC_TEMPLATE(OP_ASSIGN, v("y"), POW_(v("x"), c(4)));
+    tree_node_t* doubling = FUNC_TEMPLATE(OP_ASSIGN, v("z"), MUL_(v("x"), c(2)));
+    tree_node_t* result   = FUNC_TEMPLATE(OP_RETURN, nullptr, PLUS_(v("y"), v("z")));
+    tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr,
+                                         FUNC_TEMPLATE(OP_LCAT, FUNC_TEMPLATE(OP_LCAT, power, doubling), result)));
+
+    optimize_stats_t stats = {};
+    tree_optimize(tree, &OPTIMIZE_DEFAULT_OPTIONS, &stats);
+    printf("strength reduction: reductions=%zu, size=%zu\n", stats.strength_reductions, tree->size);
+
+    const tree_node_t* square = power->right;
+    if (stats.strength_reductions != 2 || square->type != FUNCTION || square->value.func != OP_MUL ||
+        square->left->type != IDENT || square->right->type != IDENT ||
+        square->left->value.ident_idx != square->right->value.ident_idx ||
+        doubling->right->type != FUNCTION || doubling->right->value.func != OP_PLUS) printf("\nFailed\n");
+    else                                                                           printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// ((x + 1) + 2) * (3 * y)  ->  (x + 3) * y * 3
+static void test_reassociation() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+    tree_node_t* new_root = MUL_(PLUS_(PLUS_(v("x"), c(1)), c(2)), MUL_(c(3), v("y")));
+    tree_change_root(tree, new_root);
+
+    optimize_stats_t stats = {};
+    tree_optimize(tree, &OPTIMIZE_DEFAULT_OPTIONS, &stats);
+    printf("reassociation: chains=%zu, size=%zu\n", stats.reassociations, tree->size);
+
+    const tree_node_t* root = tree->root;
+    if (tree->size != 7 || root->value.func != OP_MUL || root->right->type != CONSTANT ||
+        (int)root->right->value.constant != 3 || root->left->left->value.func != OP_PLUS ||
+        (int)root->left->left->right->value.constant != 3) printf("\nFailed\n");
+    else                                                printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// x != 0 && (10 / x) * (y + 1) > 1: правая часть глубже, но охрана должна
+// остаться первой, а деление — на своем месте в произведении
+static void test_reassociation_guard() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* guard   = FUNC_TEMPLATE(OP_NEQ, v("x"), c(0));
+    tree_node_t* product = MUL_(DIV_(c(10), v("x")), PLUS_(v("y"), c(1)));
+    tree_node_t* cond    = FUNC_TEMPLATE(OP_AND, guard, FUNC_TEMPLATE(OP_GT, product, c(1)));
+    tree_change_root(tree, cond);
+
+    size_t reassociated = 0;
+    error_code error = tree_reassociate(tree, false, &reassociated);
+    printf("reassociation guard: chains=%zu\n", reassociated);
+
+    if (error != ERROR_NO || reassociated != 0 || cond->left != guard ||
+        product->left->type != FUNCTION || product->left->value.func != OP_DIV) printf("\nFailed\n");
+    else                                                                       printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// func sq(v) { return v * v; }; func main(a) { print(sq(a + 1)); };  ->  вызова нет
+static void test_inlining() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* callee = FUNC_TEMPLATE(OP_FUNC_DECL,
+        FUNC_TEMPLATE(OP_FUNC_INFO, v("v"), v("sq")),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_RETURN, nullptr, MUL_(v("v"), v("v")))));
+
+    tree_node_t* print_node = FUNC_TEMPLATE(OP_PRINT,
+        FUNC_TEMPLATE(OP_CALL, FUNC_TEMPLATE(OP_FUNC_INFO, PLUS_(v("a"), c(1)), v("sq")), nullptr),
+        nullptr);
+    tree_node_t* caller = FUNC_TEMPLATE(OP_FUNC_DECL,
+        FUNC_TEMPLATE(OP_FUNC_INFO, v("a"), v("main")),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, print_node));
+
+    tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr,
+                                         FUNC_TEMPLATE(OP_LCAT, callee, caller)));
+
+    optimize_stats_t stats = {};
+    tree_optimize(tree, &OPTIMIZE_DEFAULT_OPTIONS, &stats);
+    printf("inlining: inlined=%zu, size=%zu\n", stats.inlined_calls, tree->size);
+
+    if (stats.inlined_calls != 1 || print_node->left->type != IDENT) printf("\nFailed\n");
+    else                                                              printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// while (i < n) { x = a * b + i; y = a / b; i = i + 1; }; return x + y;
+// a * b выносится перед циклом и при n = 0 лишь пишет свою временную,
+// a / b остаётся в теле: при нуле итераций деление на b не должно случиться
+static void test_loop_invariants() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* product  = MUL_(v("a"), v("b"));
+    tree_node_t* division = DIV_(v("a"), v("b"));
+    tree_node_t* body = FUNC_TEMPLATE(OP_LCAT,
+        FUNC_TEMPLATE(OP_LCAT,
+            FUNC_TEMPLATE(OP_ASSIGN, v("x"), PLUS_(product, v("i"))),
+            FUNC_TEMPLATE(OP_ASSIGN, v("y"), division)),
+        FUNC_TEMPLATE(OP_ASSIGN, v("i"), PLUS_(v("i"), c(1))));
+    tree_node_t* loop = FUNC_TEMPLATE(OP_WHILE, FUNC_TEMPLATE(OP_LT, v("i"), v("n")),
+                                      FUNC_TEMPLATE(OP_VIS_START, nullptr, body));
+    tree_node_t* result = FUNC_TEMPLATE(OP_RETURN, nullptr, PLUS_(v("x"), v("y")));
+    tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT, loop, result)));
+
+    optimize_stats_t stats = {};
+    tree_optimize(tree, &OPTIMIZE_DEFAULT_OPTIONS, &stats);
+    printf("loop invariants: hoisted=%zu, size=%zu\n", stats.loop_invariants, tree->size);
+
+    const tree_node_t* list   = tree->root->right->left;
+    const tree_node_t* before = list->left;
+    if (stats.loop_invariants != 1 || list->value.func != OP_LCAT || list->right != loop ||
+        before->value.func != OP_ASSIGN || before->right->value.func != OP_MUL ||
+        product->type != IDENT || product->value.ident_idx != before->left->value.ident_idx ||
+        division->type != FUNCTION) printf("\nFailed\n");
+    else                            printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// func fact(n) { if (n < 2) { return 1; }; return n * fact(n - 1); };
+// func main() { print(fact(5)); };  ->  print(120), а при бюджете в 10 шагов вызов остаётся
+static tree_node_t* build_fact_program(tree_t* tree, tree_node_t** print_out) {
+    tree_node_t* base = FUNC_TEMPLATE(OP_IF,
+        FUNC_TEMPLATE(OP_EQ, FUNC_TEMPLATE(OP_LT, v("n"), c(2)), c(1)),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_RETURN, nullptr, c(1))));
+    tree_node_t* step = FUNC_TEMPLATE(OP_RETURN, nullptr, MUL_(v("n"),
+        FUNC_TEMPLATE(OP_CALL, FUNC_TEMPLATE(OP_FUNC_INFO, MINUS_(v("n"), c(1)), v("fact")), nullptr)));
+    tree_node_t* fact = FUNC_TEMPLATE(OP_FUNC_DECL,
+        FUNC_TEMPLATE(OP_FUNC_INFO, v("n"), v("fact")),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT, base, step)));
+
+    *print_out = FUNC_TEMPLATE(OP_PRINT,
+        FUNC_TEMPLATE(OP_CALL, FUNC_TEMPLATE(OP_FUNC_INFO, c(5), v("fact")), nullptr), nullptr);
+    tree_node_t* caller = FUNC_TEMPLATE(OP_FUNC_DECL,
+        FUNC_TEMPLATE(OP_FUNC_INFO, nullptr, v("main")),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, *print_out));
+
+    return FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT, fact, caller));
+}
+
+static void test_pure_calls() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* print_node = nullptr;
+    tree_change_root(tree, build_fact_program(tree, &print_node));
+
+    optimize_stats_t stats = {};
+    tree_optimize(tree, &OPTIMIZE_DEFAULT_OPTIONS, &stats);
+    printf("pure calls: evaluated=%zu, size=%zu\n", stats.calls_evaluated, tree->size);
+
+    bool folded = stats.calls_evaluated == 1 && print_node->left->type == CONSTANT &&
+                  (int)print_node->left->value.constant == 120;
+    tree_destroy(tree);
+
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+    tree_change_root(tree, build_fact_program(tree, &print_node));
+
+    optimize_options_t options = OPTIMIZE_DEFAULT_OPTIONS;
+    options.eval_steps = 10;
+    tree_optimize(tree, &options, &stats);
+
+    bool kept = stats.calls_evaluated == 0 && print_node->left->type == FUNCTION &&
+                print_node->left->value.func == OP_CALL;
+    tree_destroy(tree);
+
+    if (!folded || !kept) printf("\nFailed\n");
+    else                  printf("\nPAssed\n");
+}
+
+// func main(n) { t = 0; i = 0; s = 0; while (i < n) { s = s + i; t = s * 2; i = i + 1; }; print(s); };
+// t нигде не читается: оба присваивания уходят, а сама t выпадает из кадра
+static void test_dead_stores() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* accumulate = FUNC_TEMPLATE(OP_ASSIGN, v("s"), PLUS_(v("s"), v("i")));
+    tree_node_t* body = FUNC_TEMPLATE(OP_LCAT,
+        FUNC_TEMPLATE(OP_LCAT, accumulate, FUNC_TEMPLATE(OP_ASSIGN, v("t"), MUL_(v("s"), c(2)))),
+        FUNC_TEMPLATE(OP_ASSIGN, v("i"), PLUS_(v("i"), c(1))));
+    tree_node_t* loop = FUNC_TEMPLATE(OP_WHILE, FUNC_TEMPLATE(OP_LT, v("i"), v("n")),
+                                      FUNC_TEMPLATE(OP_VIS_START, nullptr, body));
+    tree_node_t* init = FUNC_TEMPLATE(OP_LCAT,
+        FUNC_TEMPLATE(OP_LCAT, FUNC_TEMPLATE(OP_ASSIGN, v("t"), c(0)), FUNC_TEMPLATE(OP_ASSIGN, v("i"), c(0))),
+        FUNC_TEMPLATE(OP_ASSIGN, v("s"), c(0)));
+    tree_node_t* stmts = FUNC_TEMPLATE(OP_LCAT, FUNC_TEMPLATE(OP_LCAT, init, loop),
+                                       FUNC_TEMPLATE(OP_PRINT, v("s"), nullptr));
+    tree_node_t* decl = FUNC_TEMPLATE(OP_FUNC_DECL, FUNC_TEMPLATE(OP_FUNC_INFO, v("n"), v("main")),
+                                      FUNC_TEMPLATE(OP_VIS_START, nullptr, stmts));
+    tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, decl));
+
+    optimize_stats_t stats = {};
+    tree_optimize(tree, &OPTIMIZE_DEFAULT_OPTIONS, &stats);
+    printf("dead stores: removed=%zu, dropped=%zu, size=%zu\n",
+           stats.dead_stores, stats.dropped_vars, tree->size);
+
+    if (stats.dead_stores != 2 || stats.dropped_vars != 1 ||
+        accumulate->value.func != OP_ASSIGN) printf("\nFailed\n");
+    else                                     printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// if (3 > x && y == y) { print(x); }; r = 1 || input(); s = input() && 0; return r + s;
+// ->  if (x < 3) {...}; r = 1; s = input() && 0: ввод слева не выбрасывается
+static void test_predicates() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* cond = FUNC_TEMPLATE(OP_EQ,
+        FUNC_TEMPLATE(OP_AND, FUNC_TEMPLATE(OP_GT, c(3), v("x")), FUNC_TEMPLATE(OP_EQ, v("y"), v("y"))),
+        c(1));
+    tree_node_t* if_node = FUNC_TEMPLATE(OP_IF, cond,
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_PRINT, v("x"), nullptr)));
+    tree_node_t* absorbed = FUNC_TEMPLATE(OP_ASSIGN, v("r"),
+        FUNC_TEMPLATE(OP_OR, c(1), FUNC_TEMPLATE(OP_INPUT, nullptr, nullptr)));
+    tree_node_t* kept = FUNC_TEMPLATE(OP_ASSIGN, v("s"),
+        FUNC_TEMPLATE(OP_AND, FUNC_TEMPLATE(OP_INPUT, nullptr, nullptr), c(0)));
+    tree_node_t* stmts = FUNC_TEMPLATE(OP_LCAT,
+        FUNC_TEMPLATE(OP_LCAT, FUNC_TEMPLATE(OP_LCAT, if_node, absorbed), kept),
+        FUNC_TEMPLATE(OP_RETURN, nullptr, PLUS_(v("r"), v("s"))));
+    tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, stmts));
+
+    optimize_stats_t stats = {};
+    tree_optimize(tree, &OPTIMIZE_DEFAULT_OPTIONS, &stats);
+    printf("predicates: simplified=%zu, size=%zu\n", stats.predicates, tree->size);
+
+    const tree_node_t* test = if_node->left;
+    if (test->type != FUNCTION || test->value.func != OP_LT || test->left->type != IDENT ||
+        test->right->type != CONSTANT || absorbed->right->type != CONSTANT ||
+        (int)absorbed->right->value.constant != 1 ||
+        kept->right->type != FUNCTION || kept->right->value.func != OP_AND) printf("\nFailed\n");
+    else                                                                   printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+static bool has_op(const tree_node_t* node, op_code_t op_code) {
+    if (node == nullptr || node->type != FUNCTION) return false;
+    return node->value.func == op_code || has_op(node->left, op_code) || has_op(node->right, op_code);
+}
+
+// func sum(n, acc) { if (n < 1) { return acc; }; return sum(n - 1, acc + n); };
+// ->  while (1) { if (n < 1) {...}; n, acc = n - 1, acc + n; continue; break; }
+static void test_tail_calls() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* base = FUNC_TEMPLATE(OP_IF,
+        FUNC_TEMPLATE(OP_EQ, FUNC_TEMPLATE(OP_LT, v("n"), c(1)), c(1)),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_RETURN, nullptr, v("acc"))));
+    tree_node_t* args = FUNC_TEMPLATE(OP_ENUM_SEP, MINUS_(v("n"), c(1)), PLUS_(v("acc"), v("n")));
+    tree_node_t* step = FUNC_TEMPLATE(OP_RETURN, nullptr,
+        FUNC_TEMPLATE(OP_CALL, FUNC_TEMPLATE(OP_FUNC_INFO, args, v("sum")), nullptr));
+    tree_node_t* decl = FUNC_TEMPLATE(OP_FUNC_DECL,
+        FUNC_TEMPLATE(OP_FUNC_INFO, FUNC_TEMPLATE(OP_ENUM_SEP, v("n"), v("acc")), v("sum")),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT, base, step)));
+    tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, decl));
+
+    optimize_stats_t stats = {};
+    tree_optimize(tree, &OPTIMIZE_DEFAULT_OPTIONS, &stats);
+    printf("tail calls: eliminated=%zu, size=%zu\n", stats.tail_calls, tree->size);
+
+    const tree_node_t* loop = decl->right->right;
+    if (stats.tail_calls != 1 || loop == nullptr || loop->type != FUNCTION ||
+        loop->value.func != OP_WHILE || has_op(decl, OP_CALL)) printf("\nFailed\n");
+    else                                                               printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// 1200 раз y = (a + b)^5: по две временные на оператор, счетчик у каждого дерева свой
+static const size_t MANY_TEMPS_STMTS = 1200;
+
+static void test_strength_many_temps() {
+    bool failed = false;
+    for (int round = 0; round < 2 && !failed; round++) {
+        tree_t tree_main = {};
+        tree_t* tree = &tree_main;
+        tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+        tree_node_t* stmts = nullptr;
+        for (size_t i = 0; i < MANY_TEMPS_STMTS; i++) {
+            tree_node_t* power = FUNC_TEMPLATE(OP_ASSIGN, v("y"), POW_(PLUS_(v("a"), v("b")), c(5)));
+            stmts = (stmts == nullptr) ? power : FUNC_TEMPLATE(OP_LCAT, stmts, power);
+        }
+        tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, stmts));
+
+        size_t     idents  = tree->ident_stack->size;
+        size_t     reduced = 0;
+        error_code error   = tree_reduce_strength(tree, &reduced);
+
+        c_string_t first = tree->ident_stack->data[idents];
+        failed = error != ERROR_NO || reduced != MANY_TEMPS_STMTS || has_op(tree->root, OP_POW) ||
+                 tree->ident_stack->size != idents + 2 * MANY_TEMPS_STMTS ||
+                 first.len != 4 || strncmp(first.ptr, "sr.0", 4) != 0;
+        printf("strength many temps: reduced=%zu, temps=%zu\n", reduced, tree->ident_stack->size - idents);
+
+        tree_destroy(tree);
+    }
+    if (failed) printf("\nFailed\n");
+    else        printf("\nPAssed\n");
+}
+
+// x = 2 + 3; return x;  ->  на -O0 сложение остаётся, на -O1 сворачивается
+// одним проходом fold, а propagate, включённый с -O2, не запускается
+static void test_pass_levels() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+
+    bool ok = true;
+    for (int level = 0; level <= 1; level++) {
+        tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+        tree_node_t* assign = FUNC_TEMPLATE(OP_ASSIGN, v("x"), PLUS_(c(2), c(3)));
+        tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT, assign,
+                                             FUNC_TEMPLATE(OP_RETURN, nullptr, v("x")))));
+
+        optimize_options_t options = OPTIMIZE_DEFAULT_OPTIONS;
+        options.opt_level = level;
+        optimize_stats_t stats = {};
+        tree_optimize(tree, &options, &stats);
+
+        size_t fold      = optimize_find_pass("fold");
+        size_t propagate = optimize_find_pass("propagate");
+        printf("pass levels: -O%d, fold runs=%zu, changes=%zu\n",
+               level, stats.passes[fold].runs, stats.passes[fold].changes);
+
+        ok = ok && stats.passes[propagate].runs == 0 &&
+             stats.passes[fold].runs == (size_t)level &&
+             assign->right->type == (level == 0 ? FUNCTION : CONSTANT);
+        tree_destroy(tree);
+    }
+
+    if (!ok) printf("\nFailed\n");
+    else     printf("\nPAssed\n");
+}
+
+// proc f_i() { if (0 == 1) { x = 1; }; print(2 * 3 + i); }; ... — на jobs=4
+// функции оптимизируются в потоках, итог и счётчики те же, что на jobs=1
+static tree_node_t* parallel_decl(tree_t* tree, size_t index) {
+    // Стек имён хранит указатели, строки должны жить дольше дерева
+    static const char* NAMES[] = {"f0", "f1", "f2", "f3", "f4"};
+
+    tree_node_t* dead  = FUNC_TEMPLATE(OP_IF, FUNC_TEMPLATE(OP_EQ, c(0), c(1)),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_ASSIGN, v("x"), c(1))));
+    tree_node_t* print = FUNC_TEMPLATE(OP_PRINT, PLUS_(MUL_(c(2), c(3)), c((double)index)), nullptr);
+    return FUNC_TEMPLATE(OP_PROC_DECL, FUNC_TEMPLATE(OP_FUNC_INFO, nullptr, v(NAMES[index])),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT, dead, print)));
+}
+
+static void test_parallel_decls() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+
+    const size_t DECLS = 5;
+    optimize_stats_t results[2] = {};
+    bool ok = true;
+    for (size_t run = 0; run < 2; run++) {
+        tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+        tree_node_t* list = parallel_decl(tree, 0);
+        for (size_t i = 1; i < DECLS; i++) list = FUNC_TEMPLATE(OP_LCAT, list, parallel_decl(tree, i));
+        tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, list));
+
+        optimize_options_t options = OPTIMIZE_DEFAULT_OPTIONS;
+        options.jobs = run == 0 ? 1 : 4;
+        ok = ok && tree_optimize(tree, &options, &results[run]) == ERROR_NO;
+
+        // После оптимизации тело каждой функции — один print(константа)
+        tree_node_t* item = tree->root->right;
+        for (size_t i = DECLS; i > 0 && ok; i--) {
+            tree_node_t* decl = item->type == FUNCTION && item->value.func == OP_LCAT ? item->right : item;
+            tree_node_t* body = decl->right->right;
+            ok = body->type == FUNCTION && body->value.func == OP_PRINT &&
+                 body->left->type == CONSTANT && (size_t)body->left->value.constant == 6 + i - 1;
+            item = item->left;
+        }
+        tree_destroy(tree);
+    }
+
+    printf("parallel decls: rewrites=%zu/%zu, removed=%zu/%zu\n",
+           results[0].rewrites, results[1].rewrites,
+           results[0].statements_removed, results[1].statements_removed);
+    size_t dce = optimize_find_pass("dce");
+    if (!ok || results[0].rewrites != results[1].rewrites ||
+        results[0].statements_removed != results[1].statements_removed ||
+        results[0].statements_removed != DECLS ||
+        results[0].passes[dce].runs != results[1].passes[dce].runs / DECLS) printf("\nFailed\n");
+    else                                                                    printf("\nPAssed\n");
+}
+
+// proc f_i() { print((a + b)^n_i); } — временные из потоков получают номера и
+// идентификаторы в порядке функций, как бы ни легли потоки
+static const size_t TEMPS_ORDER_DECLS = 6;
+static const size_t TEMPS_ORDER_TEXT  = 1024;
+
+static tree_node_t* temps_order_decl(tree_t* tree, size_t index) {
+    static const char* NAMES[] = {"f0", "f1", "f2", "f3", "f4", "f5"};
+    const double       EXPS[]  = {5, 16, 2, 9, 4, 12};
+
+    tree_node_t* print = FUNC_TEMPLATE(OP_PRINT, POW_(PLUS_(v("a"), v("b")), c(EXPS[index])), nullptr);
+    return FUNC_TEMPLATE(OP_PROC_DECL, FUNC_TEMPLATE(OP_FUNC_INFO, nullptr, v(NAMES[index])),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, print));
+}
+
+static void test_parallel_temps_order() {
+    char texts[4][TEMPS_ORDER_TEXT] = {};
+    bool ok = true;
+
+    for (size_t run = 0; run < 4 && ok; run++) {
+        tree_t tree_main = {};
+        tree_t* tree = &tree_main;
+        tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+        tree_node_t* list = temps_order_decl(tree, 0);
+        for (size_t i = 1; i < TEMPS_ORDER_DECLS; i++) list = FUNC_TEMPLATE(OP_LCAT, list, temps_order_decl(tree, i));
+        tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, list));
+
+        optimize_options_t options = OPTIMIZE_DEFAULT_OPTIONS;
+        options.jobs = run == 0 ? 1 : 4;
+        ok = tree_optimize(tree, &options, nullptr) == ERROR_NO;
+
+        // Имена и их порядок в стеке, а потом идентификаторы по дереву слева направо
+        size_t len = 0;
+        for (size_t i = 0; i < tree->ident_stack->size && len < TEMPS_ORDER_TEXT; i++) {
+            c_string_t name = tree->ident_stack->data[i];
+            len += (size_t)snprintf(texts[run] + len, TEMPS_ORDER_TEXT - len, "%.*s,", (int)name.len, name.ptr);
+        }
+        ok = ok && len < TEMPS_ORDER_TEXT && strcmp(texts[run], texts[0]) == 0 &&
+             strstr(texts[run], "sr.0,sr.1,") != nullptr;
+        tree_destroy(tree);
+    }
+
+    printf("parallel temps order: %s\n", texts[0]);
+    if (!ok) printf("\nFailed\n");
+    else     printf("\nPAssed\n");
+}
+
+// x = 2 + 3; return x;  ->  без топлива ничего не запускается, бисекция
+// пускает ровно N запусков, а при скромном топливе const-eval (самый дорогой)
+// пропускается, хотя дешёвые проходы отработали
+static void test_fuel() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+
+    const size_t FUELS[]   = {0,                 OPTIMIZE_NO_LIMIT, 12};
+    const size_t BISECTS[] = {OPTIMIZE_NO_LIMIT, 3,                 OPTIMIZE_NO_LIMIT};
+    optimize_stats_t results[3] = {};
+    bool folded[3] = {};
+
+    for (size_t run = 0; run < 3; run++) {
+        tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+        tree_node_t* assign = FUNC_TEMPLATE(OP_ASSIGN, v("x"), PLUS_(c(2), c(3)));
+        tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT, assign,
+                                             FUNC_TEMPLATE(OP_RETURN, nullptr, v("x")))));
+
+        optimize_options_t options = OPTIMIZE_DEFAULT_OPTIONS;
+        options.fuel         = FUELS[run];
+        options.bisect_limit = BISECTS[run];
+        tree_optimize(tree, &options, &results[run]);
+        folded[run] = assign->right->type == CONSTANT;
+        tree_destroy(tree);
+    }
+
+    size_t bisect_runs = 0;
+    for (size_t i = 0; i < results[1].passes_count; i++) bisect_runs += results[1].passes[i].runs;
+
+    size_t tail_calls = optimize_find_pass("tail-calls");
+    size_t const_eval = optimize_find_pass("const-eval");
+    printf("fuel: empty truncated=%d, bisect runs=%zu, fuel used=%zu\n",
+           (int)results[0].truncated, bisect_runs, results[2].fuel_used);
+
+    if (folded[0] || !results[0].truncated || results[0].passes[tail_calls].runs != 0 ||
+        bisect_runs != 3 || !results[1].truncated ||
+        results[2].passes[tail_calls].runs != 1 || results[2].passes[const_eval].runs != 0 ||
+        results[2].passes[const_eval].truncated == 0 || results[2].fuel_used > 12) printf("\nFailed\n");
+    else                                                                            printf("\nPAssed\n");
+}
+
+// Своё правило на три уровня: u - (0 - v) = u + v. Общее u - v стоит позже
+// и срабатывает только там, где первое не подошло
+static constexpr rewrite_rule_t TEST_REWRITE_RULES[] = {
+    RW_RULE(RW_MINUS_(RW_v(0), RW_MINUS_(RW_c(0), RW_v(1))), RW_PLUS_(RW_v(0), RW_v(1))),
+    RW_RULE(RW_MINUS_(RW_v(0), RW_v(1)), RW_c(42)),
+};
+static constexpr rewrite_program_t TEST_REWRITE_PROGRAM = rewrite_compile(TEST_REWRITE_RULES);
+static_assert(TEST_REWRITE_PROGRAM.error == RW_COMPILE_OK, "TEST_REWRITE_RULES do not compile");
+
+static void test_rewrite_rules() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* x = v("x");
+    tree_node_t* y = v("y");
+    tree_node_t* nested  = MINUS_(x, MINUS_(c(0), y));
+    tree_node_t* general = MINUS_(v("a"), v("b"));
+    tree_node_t* other   = MUL_(v("a"), v("b"));
+    tree_change_root(tree, FUNC_TEMPLATE(OP_LCAT, FUNC_TEMPLATE(OP_LCAT, nested, general), other));
+
+    bool applied[3] = {};
+    error_code error = ERROR_NO;
+    error |= rewrite_apply(&TEST_REWRITE_PROGRAM, nested,  &applied[0]);
+    error |= rewrite_apply(&TEST_REWRITE_PROGRAM, general, &applied[1]);
+    error |= rewrite_apply(&TEST_REWRITE_PROGRAM, other,   &applied[2]);
+    printf("rewrite rules: %zu decisions, %zu edges\n",
+           TEST_REWRITE_PROGRAM.decisions_count, TEST_REWRITE_PROGRAM.edges_count);
+
+    if (error != ERROR_NO || !applied[0] || !applied[1] || applied[2] ||
+        nested->type != FUNCTION || nested->value.func != OP_PLUS ||
+        nested->left != x || nested->right != y ||
+        general->type != CONSTANT || (int)general->value.constant != 42) printf("\nFailed\n");
+    else                                                                 printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// PRINT(x) с пустым правым ребенком: первое правило требует там захват и не
+// подходит, но разбор должен дойти до второго, а не сдаться
+static constexpr rewrite_rule_t TEST_UNARY_REWRITE_RULES[] = {
+    RW_RULE(RW_OP(OP_PRINT, RW_v(0), RW_v(1)), RW_c(42)),
+    RW_RULE(RW_OP(OP_PRINT, RW_v(0), RW_NONE), RW_v(0)),
+};
+static constexpr rewrite_program_t TEST_UNARY_REWRITE_PROGRAM = rewrite_compile(TEST_UNARY_REWRITE_RULES);
+static_assert(TEST_UNARY_REWRITE_PROGRAM.error == RW_COMPILE_OK, "TEST_UNARY_REWRITE_RULES do not compile");
+
+static void test_rewrite_empty_capture() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* unary  = FUNC_TEMPLATE(OP_PRINT, v("x"), nullptr);
+    tree_node_t* binary = FUNC_TEMPLATE(OP_PRINT, v("x"), v("y"));
+    tree_change_root(tree, FUNC_TEMPLATE(OP_LCAT, unary, binary));
+
+    bool applied[2] = {};
+    error_code error = ERROR_NO;
+    error |= rewrite_apply(&TEST_UNARY_REWRITE_PROGRAM, unary,  &applied[0]);
+    error |= rewrite_apply(&TEST_UNARY_REWRITE_PROGRAM, binary, &applied[1]);
+    printf("rewrite empty capture: applied=%d,%d\n", applied[0], applied[1]);
+
+    if (error != ERROR_NO || !applied[0] || !applied[1] || unary->type != IDENT ||
+        binary->type != CONSTANT || (int)binary->value.constant != 42) printf("\nFailed\n");
+    else                                                                printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// func used(v) {...}; func dead() { return dead2(); }; func dead2() {...};
+// func main(a) { return used(a) + used(1); };  ->  dead и dead2 недостижимы из main и удаляются
+static tree_node_t* call_graph_decl(tree_t* tree, const char* name, tree_node_t* params, tree_node_t* result) {
+    return FUNC_TEMPLATE(OP_FUNC_DECL, FUNC_TEMPLATE(OP_FUNC_INFO, params, v(name)),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_RETURN, nullptr, result)));
+}
+
+static tree_node_t* call_graph_call(tree_t* tree, const char* name, tree_node_t* args) {
+    return FUNC_TEMPLATE(OP_CALL, FUNC_TEMPLATE(OP_FUNC_INFO, args, v(name)), nullptr);
+}
+
+static void test_dead_funcs() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* used  = call_graph_decl(tree, "used",  v("v"),   v("v"));
+    tree_node_t* dead  = call_graph_decl(tree, "dead",  nullptr, call_graph_call(tree, "dead2", nullptr));
+    tree_node_t* dead2 = call_graph_decl(tree, "dead2", nullptr, c(1));
+    tree_node_t* entry = call_graph_decl(tree, "main",  v("a"),
+        PLUS_(call_graph_call(tree, "used", v("a")), call_graph_call(tree, "used", c(1))));
+    tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr,
+        FUNC_TEMPLATE(OP_LCAT, FUNC_TEMPLATE(OP_LCAT, FUNC_TEMPLATE(OP_LCAT, used, dead), dead2), entry)));
+
+    call_graph_t graph = {};
+    bool graph_ok = call_graph_build(tree, nullptr, &graph) == ERROR_NO &&
+                    vector_size(&graph.funcs) == 4 && vector_size(&graph.edges) == 2 &&
+                    graph.root == 3 &&
+                    !((const call_graph_func_t*)vector_get_const(&graph.funcs, 1))->reachable;
+    if (graph_ok) {
+        // Оба вызова used из main — одно ребро, и оно в списке рёбер main
+        size_t first = ((const call_graph_func_t*)vector_get_const(&graph.funcs, 3))->first_out;
+        const call_graph_edge_t* edge = (const call_graph_edge_t*)vector_get_const(&graph.edges, first);
+        graph_ok = edge->callee == 0 && edge->sites == 2 && edge->next_out == CALL_GRAPH_NO_EDGE;
+    }
+    call_graph_destroy(&graph);
+
+    // Только -O1: встраивание не должно убрать used раньше времени
+    optimize_options_t options = OPTIMIZE_DEFAULT_OPTIONS;
+    options.opt_level = 1;
+    optimize_stats_t stats = {};
+    tree_optimize(tree, &options, &stats);
+    printf("dead funcs: removed=%zu, size=%zu\n", stats.dead_funcs, tree->size);
+
+    const tree_node_t* list = tree->root->right;
+    if (!graph_ok || stats.dead_funcs != 2 || list->value.func != OP_LCAT ||
+        list->left != used || list->right != entry) printf("\nFailed\n");
+    else                                            printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// func twice(x, unused) { return x * 2; }; func loud(y) { print(y); return y; };
+// func even(n) { return odd(n); }; func odd(n) { return even(n); };
+// func main(a) { t = twice(a, a + 1); return loud(a); }  ->  twice чиста и не
+// читает второй аргумент, loud печатает, even/odd — чистая рекурсия;
+// t = twice(...) удаляется вместе с обнулённым аргументом
+static void test_summaries() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* twice = call_graph_decl(tree, "twice", FUNC_TEMPLATE(OP_ENUM_SEP, v("x"), v("unused")),
+                                         MUL_(v("x"), c(2)));
+    tree_node_t* loud  = FUNC_TEMPLATE(OP_FUNC_DECL, FUNC_TEMPLATE(OP_FUNC_INFO, v("y"), v("loud")),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT,
+            FUNC_TEMPLATE(OP_PRINT, nullptr, v("y")), FUNC_TEMPLATE(OP_RETURN, nullptr, v("y")))));
+    tree_node_t* even  = call_graph_decl(tree, "even", v("n"), call_graph_call(tree, "odd",  v("n")));
+    tree_node_t* odd   = call_graph_decl(tree, "odd",  v("n"), call_graph_call(tree, "even", v("n")));
+    tree_node_t* entry = FUNC_TEMPLATE(OP_FUNC_DECL, FUNC_TEMPLATE(OP_FUNC_INFO, v("a"), v("main")),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT,
+            FUNC_TEMPLATE(OP_ASSIGN, v("t"), call_graph_call(tree, "twice",
+                FUNC_TEMPLATE(OP_ENUM_SEP, v("a"), PLUS_(v("a"), c(1))))),
+            FUNC_TEMPLATE(OP_RETURN, nullptr, call_graph_call(tree, "loud", v("a"))))));
+    tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT,
+        FUNC_TEMPLATE(OP_LCAT, FUNC_TEMPLATE(OP_LCAT, FUNC_TEMPLATE(OP_LCAT, twice, loud), even), odd), entry)));
+
+    func_summaries_t summaries = {};
+    bool built = func_summaries_build(tree, &summaries) == ERROR_NO;
+
+    const func_summary_t* twice_sum = func_summaries_find(&summaries, twice->left->right->value.ident_idx);
+    const func_summary_t* loud_sum  = func_summaries_find(&summaries, loud->left->right->value.ident_idx);
+    const func_summary_t* even_sum  = func_summaries_find(&summaries, even->left->right->value.ident_idx);
+    bool summaries_ok = built && twice_sum != nullptr && loud_sum != nullptr && even_sum != nullptr &&
+                        twice_sum->pure && twice_sum->terminates && twice_sum->params_count == 2 &&
+                        func_summary_reads_arg(twice_sum, 0) && !func_summary_reads_arg(twice_sum, 1) &&
+                        loud_sum->does_io && !loud_sum->pure &&
+                        even_sum->pure && even_sum->recursive && !even_sum->terminates;
+
+    size_t removed = 0;
+    tree_eliminate_dead_stores(tree, &summaries, &removed, nullptr);
+    func_summaries_destroy(&summaries);
+    printf("summaries: removed=%zu, size=%zu\n", removed, tree->size);
+
+    const tree_node_t* body = entry->right->right;
+    if (!summaries_ok || removed != 2 || body->type != FUNCTION || body->value.func != OP_RETURN) {
+        printf("\nFailed\n");
+    } else {
+        printf("\nPAssed\n");
+    }
+
+    tree_destroy(tree);
+}
+
+// func pick(x, mode) { if (mode == 1) { return x * 2; }; return x; };
+// func main(a) { return pick(a, 1) + pick(a, 1); }  ->  оба вызова идут в один
+// клон pick.N(x) без ветвления, оригинал остаётся до dead-funcs
+static void test_specialize() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* pick = FUNC_TEMPLATE(OP_FUNC_DECL,
+        FUNC_TEMPLATE(OP_FUNC_INFO, FUNC_TEMPLATE(OP_ENUM_SEP, v("x"), v("mode")), v("pick")),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT,
+            FUNC_TEMPLATE(OP_IF, FUNC_TEMPLATE(OP_EQ, v("mode"), c(1)),
+                FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_RETURN, nullptr, MUL_(v("x"), c(2))))),
+            FUNC_TEMPLATE(OP_RETURN, nullptr, v("x")))));
+    tree_node_t* entry = call_graph_decl(tree, "main", v("a"),
+        PLUS_(call_graph_call(tree, "pick", FUNC_TEMPLATE(OP_ENUM_SEP, v("a"), c(1))),
+              call_graph_call(tree, "pick", FUNC_TEMPLATE(OP_ENUM_SEP, v("a"), c(1)))));
+    tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT, pick, entry)));
+
+    size_t clones     = 0;
+    size_t retargeted = 0;
+    error_code error  = tree_specialize_calls(tree, OPTIMIZE_DEFAULT_CLONE_BUDGET, OPTIMIZE_DEFAULT_BUDGET,
+                                              &clones, &retargeted);
+    printf("specialize: clones=%zu, retargeted=%zu\n", clones, retargeted);
+
+    // VIS_START(nullptr, LCAT(LCAT(pick, clone), main))
+    const tree_node_t* list  = tree->root->right;
+    const tree_node_t* clone = list->left->type == FUNCTION && list->left->value.func == OP_LCAT ?
+                               list->left->right : nullptr;
+    const tree_node_t* sum   = entry->right->right->right;
+    const tree_node_t* call  = sum->left;
+    bool ok = error == ERROR_NO && clones == 1 && retargeted == 2 && clone != nullptr &&
+              list->left->left == pick && clone->left->left->type == IDENT &&
+              !has_op(clone->right, OP_IF) && has_op(pick->right, OP_IF) &&
+              call->left->left->type == IDENT &&
+              call->left->right->value.ident_idx == clone->left->right->value.ident_idx &&
+              sum->right->left->right->value.ident_idx == clone->left->right->value.ident_idx;
+    if (!ok) printf("\nFailed\n");
+    else     printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+// func half(x) { return x / 2; }; func main(a) { print(half(5)); print(half(4)); }
+// SPU делит нацело: half(5) остаётся вызовом, half(4) становится 2
+static void test_pure_calls_int() {
+    tree_t tree_main = {};
+    tree_t* tree = &tree_main;
+    tree_init(tree ON_TREE_DEBUG(, TREE_VER_INIT));
+
+    tree_node_t* half  = call_graph_decl(tree, "half", v("x"), DIV_(v("x"), c(2)));
+    tree_node_t* odd   = FUNC_TEMPLATE(OP_PRINT, call_graph_call(tree, "half", c(5)), nullptr);
+    tree_node_t* even  = FUNC_TEMPLATE(OP_PRINT, call_graph_call(tree, "half", c(4)), nullptr);
+    tree_node_t* entry = FUNC_TEMPLATE(OP_FUNC_DECL, FUNC_TEMPLATE(OP_FUNC_INFO, v("a"), v("main")),
+        FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT, odd, even)));
+    tree_change_root(tree, FUNC_TEMPLATE(OP_VIS_START, nullptr, FUNC_TEMPLATE(OP_LCAT, half, entry)));
+
+    size_t evaluated = 0;
+    error_code error = tree_evaluate_pure_calls(tree, nullptr, OPTIMIZE_DEFAULT_EVAL_STEPS, &evaluated);
+    printf("pure calls int: evaluated=%zu\n", evaluated);
+
+    if (error != ERROR_NO || evaluated != 1 ||
+        odd->left->type  != FUNCTION || odd->left->value.func != OP_CALL ||
+        even->left->type != CONSTANT || (int)even->left->value.constant != 2) printf("\nFailed\n");
+    else                                                                      printf("\nPAssed\n");
+
+    tree_destroy(tree);
+}
+
+static const size_t ARENA_TEST_NODES = 8;
+
+struct arena_job_t {
+    tree_node_t* freed[ARENA_TEST_NODES];
+    bool         reserved;
+};
+
+static void* arena_worker(void* arg) {
+    arena_job_t* job = (arena_job_t*)arg;
+
+    job->reserved = tree_nodes_reserve(ARENA_TEST_NODES) == ERROR_NO;
+    for (size_t i = 0; i < ARENA_TEST_NODES; i++) {
+        job->freed[i] = init_node(CONSTANT, make_union_const((const_val_type)i), nullptr, nullptr);
+    }
+    for (size_t i = 0; i < ARENA_TEST_NODES; i++) free_node(job->freed[i]);
+
+    tree_nodes_release();
+    return nullptr;
+}
+
+// Узлы, освобожденные рабочим потоком, после его выхода достаются другим
+static void test_node_arena() {
+    tree_nodes_release();
+
+    arena_job_t job    = {};
+    pthread_t   worker = {};
+    if (pthread_create(&worker, nullptr, arena_worker, &job) != 0) {
+        printf("\nFailed\n");
+        return;
+    }
+    pthread_join(worker, nullptr);
+
+    tree_node_t* reused = init_node(CONSTANT, make_union_const(0), nullptr, nullptr);
+    bool found = false;
+    for (size_t i = 0; i < ARENA_TEST_NODES; i++) found |= reused == job.freed[i];
+    printf("node arena: reserved=%d, reused=%d\n", job.reserved, found);
+
+    if (!job.reserved || !found) printf("\nFailed\n");
+    else        printf("\nPAssed\n");
+
+    free_node(reused);
+}
 
 int main() {
     tree_t tree_main = {};
@@ -9,10 +909,36 @@ int main() {
     tree_node_t* new_root = init_node(FUNCTION, make_union_func(OP_BREAK), nullptr, v("x"));
     tree_change_root(tree, new_root);
 
-    tree_optimize(tree);
+    tree_optimize(tree, &OPTIMIZE_DEFAULT_OPTIONS, nullptr);
     if(tree->root->type != FUNCTION && tree->root->value.func != OP_BREAK) printf("\nFailed\n");
     else                                                                   printf("\nPAssed\n");
 
     tree_destroy(tree);
+
+    test_fixed_point();
+    test_propagation();
+    test_dead_code();
+    test_common_subexpr();
+    test_strength_reduction();
+    test_strength_many_temps();
+    test_reassociation();
+    test_reassociation_guard();
+    test_inlining();
+    test_loop_invariants();
+    test_pure_calls();
+    test_dead_stores();
+    test_predicates();
+    test_tail_calls();
+    test_pass_levels();
+    test_parallel_decls();
+    test_parallel_temps_order();
+    test_fuel();
+    test_rewrite_rules();
+    test_rewrite_empty_capture();
+    test_dead_funcs();
+    test_summaries();
+    test_specialize();
+    test_pure_calls_int();
+    test_node_arena();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,26 @@
+// Auto-generated file with all project headers
+// DO NOT EDIT MANUALLY
+
+#include "project/backend/include/backend.h"
+#include "project/frontend/error_logger/include/frontend_err_logger.h"
+#include "project/midend/include/tree_optimize.h"
+#include "project/midend/include/tree_passes.h"
+#include "project/midend/include/tree_rewrite.h"
+#include "project/midend/include/tree_tail_calls.h"
+#include "project/midend/include/tree_inline.h"
+#include "project/midend/include/tree_propagate.h"
+#include "project/midend/include/tree_const_eval.h"
+#include "project/midend/include/tree_call_graph.h"
+#include "project/midend/include/tree_summaries.h"
+#include "project/midend/include/tree_specialize.h"
+#include "project/midend/include/tree_reassociate.h"
+#include "project/midend/include/tree_predicates.h"
+#include "project/midend/include/tree_dce.h"
+#include "project/midend/include/tree_temps.h"
+#include "project/midend/include/tree_node_utils.h"
+#include "project/midend/include/tree_licm.h"
+#include "project/midend/include/tree_strength.h"
+#include "project/midend/include/tree_cse.h"
+#include "project/midend/include/tree_liveness.h"
+#include "project/frontend/lexer/include/lexer_tokenizer.h"
+#include "project/frontend/parser/include/frontend_parser.h"